@@ -0,0 +1,221 @@
+/*
+ * bench_hash.c - Shared hash table scalability benchmark for Reasons DSL
+ *
+ * Features:
+ * - Compares a HashTable behind one mutex with the sharded
+ *   ConcurrentHashTable on the same read-mostly workload
+ * - Runs at 1, 2, 4, ... up to N threads
+ * - Configurable read ratio, key count and operations per thread
+ */
+
+#include "utils/hash.h"
+#include "utils/concurrent_hash.h"
+#include "utils/memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ======== STRUCTURE DEFINITIONS ======== */
+
+typedef enum {
+    TABLE_MUTEX,                // HashTable guarded by a single mutex
+    TABLE_SHARDED               // ConcurrentHashTable
+} TableKind;
+
+typedef struct {
+    TableKind kind;
+    HashTable *mutex_table;
+    pthread_mutex_t mutex;
+    ConcurrentHashTable *sharded_table;
+    size_t key_count;
+    size_t ops_per_thread;
+    unsigned read_percent;
+    pthread_barrier_t start;
+} BenchShared;
+
+typedef struct {
+    BenchShared *shared;
+    uint64_t seed;
+    uint64_t checksum;          // Keeps lookups from being optimized away
+} BenchThread;
+
+/* ======== PRIVATE HELPER FUNCTIONS ======== */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static inline uint64_t next_random(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void* bench_worker(void *arg) {
+    BenchThread *thread = arg;
+    BenchShared *shared = thread->shared;
+    uint64_t rng = thread->seed;
+    
+    pthread_barrier_wait(&shared->start);
+    
+    for (size_t i = 0; i < shared->ops_per_thread; i++) {
+        uint64_t r = next_random(&rng);
+        uint64_t key = r % shared->key_count;
+        uint64_t value = 0;
+        bool is_read = (r >> 32) % 100 < shared->read_percent;
+        
+        if (shared->kind == TABLE_MUTEX) {
+            // The value must be copied under the lock: a concurrent set frees it
+            pthread_mutex_lock(&shared->mutex);
+            if (is_read) {
+                uint64_t *found = hashtable_get(shared->mutex_table, &key, sizeof(key));
+                if (found) value = *found;
+            } else {
+                hashtable_set(shared->mutex_table, &key, sizeof(key), &r, sizeof(r));
+            }
+            pthread_mutex_unlock(&shared->mutex);
+        } else if (is_read) {
+            concurrent_hashtable_get(shared->sharded_table, &key, sizeof(key),
+                                     &value, sizeof(value));
+        } else {
+            concurrent_hashtable_set(shared->sharded_table, &key, sizeof(key), &r, sizeof(r));
+        }
+        thread->checksum += value;
+    }
+    return NULL;
+}
+
+static double run_benchmark(TableKind kind, int threads, size_t key_count,
+                            size_t ops_per_thread, unsigned read_percent) {
+    BenchShared shared;
+    memset(&shared, 0, sizeof(shared));
+    shared.kind = kind;
+    shared.key_count = key_count;
+    shared.ops_per_thread = ops_per_thread;
+    shared.read_percent = read_percent;
+    pthread_barrier_init(&shared.start, NULL, threads + 1);
+    
+    if (kind == TABLE_MUTEX) {
+        shared.mutex_table = hashtable_create(key_count * 2, NULL);
+        pthread_mutex_init(&shared.mutex, NULL);
+    } else {
+        shared.sharded_table = concurrent_hashtable_create(key_count, 0, NULL);
+    }
+    
+    // Pre-populate so reads hit
+    for (uint64_t key = 0; key < key_count; key++) {
+        if (kind == TABLE_MUTEX) {
+            hashtable_set(shared.mutex_table, &key, sizeof(key), &key, sizeof(key));
+        } else {
+            concurrent_hashtable_set(shared.sharded_table, &key, sizeof(key), &key, sizeof(key));
+        }
+    }
+    
+    pthread_t *handles = calloc(threads, sizeof(pthread_t));
+    BenchThread *workers = calloc(threads, sizeof(BenchThread));
+    for (int t = 0; t < threads; t++) {
+        workers[t].shared = &shared;
+        workers[t].seed = 0x9E3779B97F4A7C15ULL * (t + 1);
+        pthread_create(&handles[t], NULL, bench_worker, &workers[t]);
+    }
+    
+    pthread_barrier_wait(&shared.start);
+    double start = now_seconds();
+    uint64_t checksum = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(handles[t], NULL);
+        checksum += workers[t].checksum;
+    }
+    double elapsed = now_seconds() - start;
+    
+    if (kind == TABLE_MUTEX) {
+        hashtable_destroy(shared.mutex_table);
+        pthread_mutex_destroy(&shared.mutex);
+    } else {
+        concurrent_hashtable_destroy(shared.sharded_table);
+    }
+    pthread_barrier_destroy(&shared.start);
+    free(handles);
+    free(workers);
+    
+    if (checksum == 1) putchar(' ');
+    return (double)ops_per_thread * threads / elapsed;
+}
+
+static void print_help(void) {
+    printf("Usage: reasons-bench-hash [options]\n");
+    printf("Compare the mutex-guarded and sharded hash tables across thread counts.\n\n");
+    printf("Options:\n");
+    printf("  -t, --threads <n>   Maximum thread count (default: online CPUs)\n");
+    printf("  -k, --keys <n>      Distinct keys (default: 65536)\n");
+    printf("  -n, --ops <n>       Operations per thread (default: 1000000)\n");
+    printf("  -r, --reads <pct>   Percentage of lookups (default: 95)\n");
+    printf("  -h, --help          Show this help message\n");
+}
+
+/* ======== MAIN ======== */
+
+int main(int argc, char **argv) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = cpus > 0 ? (int)cpus : 1;
+    size_t key_count = 65536;
+    size_t ops = 1000000;
+    unsigned read_percent = 95;
+    
+    static struct option long_options[] = {
+        {"threads", required_argument, 0, 't'},
+        {"keys", required_argument, 0, 'k'},
+        {"ops", required_argument, 0, 'n'},
+        {"reads", required_argument, 0, 'r'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:k:n:r:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 't': max_threads = atoi(optarg); break;
+            case 'k': key_count = strtoull(optarg, NULL, 10); break;
+            case 'n': ops = strtoull(optarg, NULL, 10); break;
+            case 'r': read_percent = (unsigned)atoi(optarg); break;
+            case 'h':
+                print_help();
+                return EXIT_SUCCESS;
+            default:
+                print_help();
+                return EXIT_FAILURE;
+        }
+    }
+    if (max_threads < 1 || key_count == 0 || ops == 0 || read_percent > 100) {
+        print_help();
+        return EXIT_FAILURE;
+    }
+    
+    // Plain malloc-backed allocations: guard pages would dominate the numbers
+    memory_set_guard_pages(false);
+    memory_set_tracking(false);
+    
+    printf("keys=%zu ops/thread=%zu reads=%u%%\n\n", key_count, ops, read_percent);
+    printf("%8s %16s %16s %9s\n", "threads", "mutex ops/s", "sharded ops/s", "speedup");
+    
+    for (int threads = 1; ; threads *= 2) {
+        if (threads > max_threads) threads = max_threads;
+        
+        double mutex_rate = run_benchmark(TABLE_MUTEX, threads, key_count, ops, read_percent);
+        double sharded_rate = run_benchmark(TABLE_SHARDED, threads, key_count, ops, read_percent);
+        printf("%8d %16.0f %16.0f %8.2fx\n", threads, mutex_rate, sharded_rate,
+               sharded_rate / mutex_rate);
+        
+        if (threads == max_threads) break;
+    }
+    
+    return EXIT_SUCCESS;
+}
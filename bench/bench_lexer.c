@@ -0,0 +1,161 @@
+/*
+ * bench_lexer.c - Lexer throughput benchmark for Reasons DSL
+ *
+ * Features:
+ * - Tokenizes a source file repeatedly and reports tokens/sec and MB/sec
+ * - Reports lexer-owned literal storage (interned string literals)
+ * - Optionally pre-tokenizes into token buffers across several threads
+ * - Memory tracking and guard pages disabled so the allocator stays out
+ *   of the measurement
+ */
+
+#include "reasons/lexer.h"
+#include "utils/memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+/* ======== PRIVATE HELPER FUNCTIONS ======== */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char* read_source(const char *path, size_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    if (size < 0) {
+        fclose(file);
+        return NULL;
+    }
+    
+    char *source = malloc((size_t)size + 1);
+    if (source && fread(source, 1, (size_t)size, file) != (size_t)size) {
+        free(source);
+        source = NULL;
+    }
+    fclose(file);
+    
+    if (source) {
+        source[size] = '\0';
+        *length = (size_t)size;
+    }
+    return source;
+}
+
+static void print_help(void) {
+    printf("Usage: reasons-bench-lexer [options] <file>\n");
+    printf("Tokenize a source file repeatedly and report lexer throughput.\n\n");
+    printf("Options:\n");
+    printf("  -n, --iterations <n>  Passes over the file (default: 10)\n");
+    printf("  -j, --jobs <n>        Pre-tokenize into token buffers on n threads\n");
+    printf("                        (0: one per CPU; default: stream tokens)\n");
+    printf("  -h, --help            Show this help message\n");
+}
+
+/* ======== MAIN ======== */
+
+int main(int argc, char **argv) {
+    int iterations = 10;
+    int jobs = -1;
+    
+    static struct option long_options[] = {
+        {"iterations", required_argument, 0, 'n'},
+        {"jobs", required_argument, 0, 'j'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:j:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': iterations = atoi(optarg); break;
+            case 'j': jobs = atoi(optarg); break;
+            case 'h':
+                print_help();
+                return EXIT_SUCCESS;
+            default:
+                print_help();
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc || iterations < 1) {
+        print_help();
+        return EXIT_FAILURE;
+    }
+    
+    size_t length = 0;
+    char *source = read_source(argv[optind], &length);
+    if (!source) {
+        fprintf(stderr, "Cannot read %s\n", argv[optind]);
+        return EXIT_FAILURE;
+    }
+    
+    memory_set_guard_pages(false);
+    memory_set_tracking(false);
+    
+    size_t tokens = 0;
+    size_t errors = 0;
+    lexer_statistics_t stats;
+    memset(&stats, 0, sizeof(stats));
+    
+    double start = now_seconds();
+    for (int i = 0; i < iterations; i++) {
+        if (jobs >= 0) {
+            token_buffer_t *buffer = lexer_tokenize_parallel(source, NULL, (size_t)jobs);
+            if (!buffer) {
+                fprintf(stderr, "Failed to tokenize\n");
+                free(source);
+                return EXIT_FAILURE;
+            }
+            
+            tokens += buffer->count;
+            for (size_t t = 0; t < buffer->count; t++) {
+                if (buffer->types[t] == TOKEN_ERROR) errors++;
+            }
+            token_buffer_destroy(buffer);
+            continue;
+        }
+        
+        lexer_t *lexer = lexer_create(source);
+        if (!lexer) {
+            fprintf(stderr, "Failed to create lexer\n");
+            free(source);
+            return EXIT_FAILURE;
+        }
+        
+        token_t token;
+        do {
+            token = lexer_next_token(lexer);
+            tokens++;
+            if (token.type == TOKEN_ERROR) errors++;
+        } while (token.type != TOKEN_EOF);
+        
+        lexer_get_statistics(lexer, &stats);
+        lexer_destroy(lexer);
+    }
+    double elapsed = now_seconds() - start;
+    
+    printf("file:        %s (%zu bytes)\n", argv[optind], length);
+    if (jobs >= 0) {
+        printf("mode:        token buffers, %d jobs\n", jobs);
+    }
+    printf("tokens:      %zu per pass, %zu errors\n", tokens / iterations, errors / iterations);
+    printf("throughput:  %.2f Mtokens/s, %.1f MB/s\n",
+           tokens / elapsed / 1e6, (double)length * iterations / elapsed / 1e6);
+    if (jobs < 0) {
+        printf("literals:    %zu interned, %zu bytes of lexer storage\n",
+               stats.literals_interned, stats.literal_bytes);
+    }
+    
+    free(source);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,297 @@
+/*
+ * bench_swap.c - Tree hot-swap benchmark for Reasons DSL
+ *
+ * Features:
+ * - Reader threads evaluate a balanced decision tree in a loop while a
+ *   writer publishes a new version at a fixed interval
+ * - Compares the epoch-based tree slot with a tree behind a rwlock
+ * - Reports reader evaluations/sec per swap interval, so the cost of
+ *   swapping under load is read straight off the table
+ * - New versions are O(1) clones with a fresh root condition, so the
+ *   writer's own work stays out of the measurement
+ */
+
+#include "reasons/tree.h"
+#include "reasons/tree_swap.h"
+#include "reasons/ast.h"
+#include "reasons/runtime.h"
+#include "utils/memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ======== STRUCTURE DEFINITIONS ======== */
+
+typedef enum {
+    SWAP_EPOCH,                 // tree_slot_t
+    SWAP_RWLOCK                 // DecisionTree* behind a pthread rwlock
+} SwapKind;
+
+typedef struct {
+    SwapKind kind;
+    tree_slot_t *slot;
+    DecisionTree *locked_tree;
+    pthread_rwlock_t lock;
+    unsigned interval_us;       // 0: no swaps
+    volatile int stop;
+    pthread_barrier_t start;
+    uint64_t swaps;
+} BenchShared;
+
+typedef struct {
+    BenchShared *shared;
+    uint64_t seed;
+    uint64_t evaluations;
+    double checksum;            // Keeps results from being optimized away
+} BenchThread;
+
+/* ======== PRIVATE HELPER FUNCTIONS ======== */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static inline uint64_t next_random(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static AST_Node* make_condition(double threshold) {
+    reasons_value_t value = {VALUE_NUMBER};
+    value.data.number_val = threshold;
+    return ast_create_comparison(CMP_LT, ast_create_identifier("x"), ast_create_literal(&value));
+}
+
+// Splits [low, high) in half at every level; leaves return their bucket
+static TreeNode* build_node(double low, double high, unsigned depth) {
+    double mid = (low + high) / 2;
+    if (depth == 0) {
+        reasons_value_t value = {VALUE_NUMBER};
+        value.data.number_val = mid;
+        return tree_create_outcome_node(&value);
+    }
+
+    TreeNode *node = tree_create_condition_node(make_condition(mid), 1.0);
+    tree_node_set_branches(node, build_node(low, mid, depth - 1), build_node(mid, high, depth - 1));
+    return node;
+}
+
+static DecisionTree* build_tree(unsigned depth) {
+    DecisionTree *tree = tree_create("bench");
+    tree_set_root(tree, build_node(0.0, 1.0, depth));
+    return tree;
+}
+
+// Next version: shares every node with the current one but the root
+static DecisionTree* next_version(DecisionTree *current, uint64_t swap) {
+    DecisionTree *tree = tree_clone(current);
+    double jitter = (double)(swap % 16) / 1e6;
+    tree_set_condition(tree, tree_root(tree), make_condition(0.5 + jitter), 1.0);
+    return tree;
+}
+
+static void* bench_reader(void *arg) {
+    BenchThread *thread = arg;
+    BenchShared *shared = thread->shared;
+    uint64_t rng = thread->seed;
+    runtime_env_t *env = runtime_create();
+
+    pthread_barrier_wait(&shared->start);
+
+    while (!__atomic_load_n(&shared->stop, __ATOMIC_RELAXED)) {
+        reasons_value_t x = {VALUE_NUMBER};
+        x.data.number_val = (double)(next_random(&rng) >> 11) / (double)(1ULL << 53);
+        runtime_set_variable(env, "x", x);
+
+        reasons_value_t result;
+        if (shared->kind == SWAP_EPOCH) {
+            DecisionTree *tree = tree_slot_enter(shared->slot);
+            result = tree_evaluate(tree, env, NULL, NULL);
+            tree_slot_exit(shared->slot);
+        } else {
+            pthread_rwlock_rdlock(&shared->lock);
+            result = tree_evaluate(shared->locked_tree, env, NULL, NULL);
+            pthread_rwlock_unlock(&shared->lock);
+        }
+
+        if (result.type == VALUE_NUMBER) thread->checksum += result.data.number_val;
+        reasons_value_free(&result);
+        thread->evaluations++;
+    }
+
+    runtime_destroy(env);
+    return NULL;
+}
+
+static void* bench_writer(void *arg) {
+    BenchShared *shared = arg;
+    struct timespec pause = {
+        shared->interval_us / 1000000,
+        (long)(shared->interval_us % 1000000) * 1000
+    };
+
+    pthread_barrier_wait(&shared->start);
+
+    while (!__atomic_load_n(&shared->stop, __ATOMIC_RELAXED)) {
+        if (shared->kind == SWAP_EPOCH) {
+            // The writer is the only publisher, so its pin cannot go stale
+            DecisionTree *current = tree_slot_enter(shared->slot);
+            DecisionTree *next = next_version(current, shared->swaps);
+            tree_slot_exit(shared->slot);
+            tree_slot_publish(shared->slot, next);
+        } else {
+            DecisionTree *next = next_version(shared->locked_tree, shared->swaps);
+            pthread_rwlock_wrlock(&shared->lock);
+            DecisionTree *old = shared->locked_tree;
+            shared->locked_tree = next;
+            pthread_rwlock_unlock(&shared->lock);
+            tree_destroy(old);
+        }
+        shared->swaps++;
+        nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+static double run_benchmark(SwapKind kind, int threads, unsigned depth,
+                            unsigned interval_us, double duration, double *swap_rate) {
+    BenchShared shared;
+    memset(&shared, 0, sizeof(shared));
+    shared.kind = kind;
+    shared.interval_us = interval_us;
+
+    bool swapping = interval_us > 0;
+    pthread_barrier_init(&shared.start, NULL, threads + (swapping ? 1 : 0) + 1);
+
+    if (kind == SWAP_EPOCH) {
+        shared.slot = tree_slot_create(build_tree(depth));
+    } else {
+        shared.locked_tree = build_tree(depth);
+        pthread_rwlock_init(&shared.lock, NULL);
+    }
+
+    pthread_t *handles = calloc(threads, sizeof(pthread_t));
+    BenchThread *readers = calloc(threads, sizeof(BenchThread));
+    for (int t = 0; t < threads; t++) {
+        readers[t].shared = &shared;
+        readers[t].seed = 0x9E3779B97F4A7C15ULL * (t + 1);
+        pthread_create(&handles[t], NULL, bench_reader, &readers[t]);
+    }
+    pthread_t writer;
+    if (swapping) pthread_create(&writer, NULL, bench_writer, &shared);
+
+    pthread_barrier_wait(&shared.start);
+    double start = now_seconds();
+    struct timespec run = {(time_t)duration, (long)((duration - (time_t)duration) * 1e9)};
+    nanosleep(&run, NULL);
+    __atomic_store_n(&shared.stop, 1, __ATOMIC_RELAXED);
+
+    uint64_t evaluations = 0;
+    double checksum = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(handles[t], NULL);
+        evaluations += readers[t].evaluations;
+        checksum += readers[t].checksum;
+    }
+    if (swapping) pthread_join(writer, NULL);
+    double elapsed = now_seconds() - start;
+
+    if (kind == SWAP_EPOCH) {
+        tree_slot_destroy(shared.slot);
+    } else {
+        tree_destroy(shared.locked_tree);
+        pthread_rwlock_destroy(&shared.lock);
+    }
+    pthread_barrier_destroy(&shared.start);
+    free(handles);
+    free(readers);
+
+    if (checksum == 1) putchar(' ');
+    *swap_rate = shared.swaps / elapsed;
+    return evaluations / elapsed;
+}
+
+static void print_help(void) {
+    printf("Usage: reasons-bench-swap [options]\n");
+    printf("Measure reader throughput while tree versions are swapped underneath.\n\n");
+    printf("Options:\n");
+    printf("  -t, --threads <n>   Reader threads (default: online CPUs - 1)\n");
+    printf("  -d, --depth <n>     Depth of the balanced tree (default: 8)\n");
+    printf("  -s, --seconds <s>   Duration of each run (default: 1.0)\n");
+    printf("  -h, --help          Show this help message\n");
+}
+
+/* ======== MAIN ======== */
+
+int main(int argc, char **argv) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 1 ? (int)cpus - 1 : 1;
+    unsigned depth = 8;
+    double duration = 1.0;
+
+    static struct option long_options[] = {
+        {"threads", required_argument, 0, 't'},
+        {"depth", required_argument, 0, 'd'},
+        {"seconds", required_argument, 0, 's'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:d:s:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 't': threads = atoi(optarg); break;
+            case 'd': depth = (unsigned)atoi(optarg); break;
+            case 's': duration = atof(optarg); break;
+            case 'h':
+                print_help();
+                return EXIT_SUCCESS;
+            default:
+                print_help();
+                return EXIT_FAILURE;
+        }
+    }
+    if (threads < 1 || depth == 0 || depth > 20 || duration <= 0) {
+        print_help();
+        return EXIT_FAILURE;
+    }
+
+    // Plain malloc-backed allocations: guard pages would dominate the numbers
+    memory_set_guard_pages(false);
+    memory_set_tracking(false);
+
+    // Swap intervals in microseconds; 0 is the no-swap baseline
+    static const unsigned intervals[] = {0, 100000, 10000, 1000, 100, 10};
+
+    printf("readers=%d depth=%u seconds=%.1f\n\n", threads, depth, duration);
+    printf("%10s %14s %16s %14s %16s\n", "interval", "epoch swaps/s", "epoch evals/s",
+           "lock swaps/s", "rwlock evals/s");
+
+    for (size_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++) {
+        double epoch_swaps, lock_swaps;
+        double epoch_rate = run_benchmark(SWAP_EPOCH, threads, depth, intervals[i],
+                                          duration, &epoch_swaps);
+        double lock_rate = run_benchmark(SWAP_RWLOCK, threads, depth, intervals[i],
+                                         duration, &lock_swaps);
+
+        char label[32];
+        if (intervals[i] == 0) {
+            snprintf(label, sizeof(label), "none");
+        } else {
+            snprintf(label, sizeof(label), "%uus", intervals[i]);
+        }
+        printf("%10s %14.0f %16.0f %14.0f %16.0f\n", label, epoch_swaps, epoch_rate,
+               lock_swaps, lock_rate);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -16,6 +16,7 @@ typedef enum {
     AST_IDENTIFIER,
     AST_LITERAL,
     AST_CHAIN,
+    AST_IMPORT,            // use "path": rules from another module
     AST_NODE_TYPE_COUNT
 } ast_node_type_t;
 
@@ -83,11 +84,13 @@ ast_node_t *ast_create_rule(const char *name, ast_node_t *body);
 ast_node_t *ast_create_logic_op(logic_op_t op, ast_node_t *left, ast_node_t *right);
 ast_node_t *ast_create_comparison(comparison_op_t op, ast_node_t *left, ast_node_t *right);
 ast_node_t *ast_create_identifier(const char *name);
+ast_node_t *ast_create_import(const char *path);
 ast_node_t *ast_create_literal(const reasons_value_t *value);
 ast_node_t *ast_create_chain(ast_node_t *first, ast_node_t *second);
 
 // Tree manipulation
 bool ast_add_child(ast_node_t *parent, ast_node_t *child);
+bool ast_insert_child(ast_node_t *parent, ast_node_t *after, ast_node_t *child);  // after NULL: first
 bool ast_remove_child(ast_node_t *parent, ast_node_t *child);
 ast_node_t *ast_get_child(const ast_node_t *parent, size_t index);
 size_t ast_get_child_count(const ast_node_t *parent);
@@ -0,0 +1,103 @@
+#ifndef REASONS_AST_COMPACT_H
+#define REASONS_AST_COMPACT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "reasons/ast.h"
+#include "reasons/types.h"
+
+/* Compact AST
+ *
+ * Read-mostly form of an AST for traversal-heavy passes. All nodes live in
+ * one array in preorder (node, structural operands, then generic children),
+ * linked by 32-bit indices instead of pointers, and all names, conditions,
+ * actions and string literals live once each in an intern table. A subtree
+ * is the index range [index, end), so preorder traversal is a linear scan,
+ * node counts are a subtraction and skipping a subtree is a jump.
+ *
+ * The pointer form stays the one the parser builds and the evaluator runs;
+ * ast_compact_from_ast and ast_compact_to_ast convert between the two.
+ * Precompiled modules, imports and tree images read this form directly.
+ * Explanations are built from the evaluation trace and visualizations
+ * from TreeNode graphs, so neither has an AST walk to move here.
+ */
+
+/* No node / no string */
+#define AST_COMPACT_NONE UINT32_MAX
+
+/* Node flags */
+#define AST_COMPACT_ACTIVE   0x01      /* Rule is active */
+#define AST_COMPACT_EXECUTED 0x02      /* Consequence has been executed */
+
+/* Structural operand slots */
+#define AST_COMPACT_LEFT  0            /* True branch, left operand, chain first, rule body */
+#define AST_COMPACT_RIGHT 1            /* False branch, right operand, chain second */
+
+typedef struct {
+    uint8_t type;                      /* ast_node_type_t */
+    uint8_t op;                        /* Logic/comparison op, condition, consequence or chain type */
+    uint8_t flags;                     /* AST_COMPACT_* flags */
+    uint8_t reserved;
+    uint32_t operand[2];               /* Structural children */
+    uint32_t first_child;              /* Generic children */
+    uint32_t next_sibling;
+    uint32_t parent;
+    uint32_t end;                      /* One past the last node of the subtree */
+    uint32_t line;
+    uint32_t column;
+    uint32_t text;                     /* Interned condition, action, rule or identifier name */
+    uint32_t literal;                  /* Literal table index */
+    union {
+        double weight;                 /* Consequence weight */
+        int64_t integer;               /* Decision priority, rule execution count */
+    } value;
+} ast_compact_node_t;
+
+typedef struct ast_compact ast_compact_t;
+
+/* Visitor over node indices; returning false stops the traversal */
+typedef bool (*ast_compact_visitor_func_t)(const ast_compact_t *tree, uint32_t index,
+                                           void *user_data);
+
+/* Creation and destruction */
+ast_compact_t *ast_compact_from_ast(const ast_node_t *root);
+ast_node_t *ast_compact_to_ast(const ast_compact_t *tree, uint32_t index);
+ast_compact_t *ast_compact_clone(const ast_compact_t *tree);
+void ast_compact_destroy(ast_compact_t *tree);
+
+/* Wraps sections stored elsewhere (e.g. a mapped module) without copying.
+ * Nodes and strings must outlive the tree; on success literals are taken
+ * over and their string values pointed into strings. Links, node types
+ * and ops are checked. */
+ast_compact_t *ast_compact_borrow(const ast_compact_node_t *nodes, size_t count,
+                                  const char *strings, size_t string_size,
+                                  reasons_value_t *literals, size_t literal_count);
+
+/* Access */
+size_t ast_compact_size(const ast_compact_t *tree);
+const ast_compact_node_t *ast_compact_node(const ast_compact_t *tree, uint32_t index);
+const char *ast_compact_strings(const ast_compact_t *tree, size_t *size);
+const char *ast_compact_text(const ast_compact_t *tree, uint32_t index);
+const reasons_value_t *ast_compact_literal(const ast_compact_t *tree, uint32_t index);
+
+/* Traversal (index 0 is the root) */
+void ast_compact_traverse_preorder(const ast_compact_t *tree, uint32_t index,
+                                   ast_compact_visitor_func_t visitor, void *user_data);
+void ast_compact_traverse_postorder(const ast_compact_t *tree, uint32_t index,
+                                    ast_compact_visitor_func_t visitor, void *user_data);
+uint32_t ast_compact_find_node(const ast_compact_t *tree, uint32_t index,
+                               ast_compact_visitor_func_t predicate, void *user_data);
+
+/* Queries */
+size_t ast_compact_count_nodes(const ast_compact_t *tree, uint32_t index);
+size_t ast_compact_get_depth(const ast_compact_t *tree, uint32_t index);
+bool ast_compact_validate(const ast_compact_t *tree, uint32_t index);
+bool ast_compact_equals(const ast_compact_t *a, uint32_t index_a,
+                        const ast_compact_t *b, uint32_t index_b);
+
+/* Memory footprint: nodes, intern table and literal table */
+size_t ast_compact_memory_usage(const ast_compact_t *tree);
+
+#endif /* REASONS_AST_COMPACT_H */
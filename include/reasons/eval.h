@@ -4,6 +4,7 @@
 #include "reasons/ast.h"
 #include "reasons/types.h"
 #include "reasons/trace.h"
+#include "reasons/import.h"
 #include <stdbool.h>
 #include <stddef.h>
 
@@ -34,6 +35,8 @@ void eval_set_tracing(eval_context_t *ctx, bool enabled);
 void eval_set_explanation(eval_context_t *ctx, bool enabled);
 void eval_set_golf_mode(eval_context_t *ctx, bool enabled);
 void eval_set_max_recursion(eval_context_t *ctx, unsigned max_depth);
+void eval_set_imports(eval_context_t *ctx, import_scope_t *imports);  /* Not owned */
+void eval_set_base_dir(eval_context_t *ctx, const char *dir);  /* For `use` without a scope; NULL: "." */
 
 /* Main evaluation API */
 reasons_value_t eval_tree(eval_context_t *ctx, ast_node_t *root);
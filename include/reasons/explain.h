@@ -23,6 +23,7 @@ typedef struct {
     size_t rules_explained;          /* Rules explained */
     size_t alternatives_considered;  /* Alternative paths considered */
     size_t errors_detected;          /* Errors detected in execution */
+    bool truncated;                  /* Output cut short by memory budget */
 } explain_stats_t;
 
 /* Opaque explanation engine structure */
@@ -0,0 +1,45 @@
+#ifndef REASONS_HISTORY_H
+#define REASONS_HISTORY_H
+
+#include "reasons/types.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* Decision history
+ *
+ * Records the decision nodes visited during execution, in order, for the
+ * debugger. Records are charged to the history memory budget; when it is
+ * reached the oldest quarter is rolled over and counted, never the newest.
+ */
+typedef struct DecisionHistory DecisionHistory;
+typedef struct DecisionRecord DecisionRecord;
+
+/* Creation/destruction */
+DecisionHistory* history_create();
+void history_destroy(DecisionHistory *history);
+
+/* Recording */
+void history_record_decision(DecisionHistory *history, TreeNode *node,
+                            reasons_value_t decision, double exec_time);
+void history_clear(DecisionHistory *history);
+
+/* Configuration */
+void history_set_enabled(DecisionHistory *history, bool enabled);
+bool history_is_enabled(DecisionHistory *history);
+void history_set_detail_level(DecisionHistory *history, bool detailed);
+
+/* Queries */
+size_t history_count(DecisionHistory *history);
+size_t history_rolled_over(DecisionHistory *history);      /* Records dropped for budget */
+const DecisionRecord* history_get_record(DecisionHistory *history, size_t index);
+vector_t* history_find_records(DecisionHistory *history, const char *node_id);
+const DecisionRecord* history_last_decision(DecisionHistory *history);
+vector_t* history_get_path(DecisionHistory *history, size_t index);
+double history_get_total_time(DecisionHistory *history);
+
+/* Output */
+void history_print(DecisionHistory *history, FILE *output, int max_records);
+void history_export_json(DecisionHistory *history, FILE *output);
+
+#endif /* REASONS_HISTORY_H */
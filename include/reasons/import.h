@@ -0,0 +1,51 @@
+#ifndef REASONS_IMPORT_H
+#define REASONS_IMPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "reasons/ast.h"
+
+/* Module imports
+ *
+ * `use "lib/checks"` makes the rules of another file available by name. An
+ * import scope collects a program's imports without loading anything; the
+ * first reference to a name no variable answers loads the imported modules
+ * in order until one defines a rule of that name, and only that rule is
+ * converted for the evaluator.
+ *
+ * Modules are cached for the whole process by the hash of their contents,
+ * so a library shared by many policies is parsed at most once, and on disk
+ * as precompiled modules (.rsc) so later processes skip parsing entirely.
+ * Imports of a loaded module join the scope that loaded it and resolve
+ * against the directory that scope found the file in, so identical files
+ * in two places each see their own neighbours.
+ *
+ * Paths resolve against the scope's base directory, then each directory in
+ * REASONS_PATH (colon-separated); ".reasons" is appended when the path has
+ * no extension. The disk cache lives in REASONS_CACHE_DIR, else
+ * $XDG_CACHE_HOME/reasons, else ~/.cache/reasons.
+ */
+typedef struct import_scope import_scope_t;
+
+/* Import statistics (process-wide) */
+typedef struct {
+    size_t modules_loaded;            /* Distinct modules in the process cache */
+    size_t memory_hits;               /* Imports served from the process cache */
+    size_t disk_hits;                 /* Modules mapped from the disk cache */
+    size_t parses;                    /* Modules parsed from source */
+    size_t rules_materialized;        /* Imported rules converted for evaluation */
+} import_statistics_t;
+
+/* Scopes */
+import_scope_t *import_scope_create(const char *base_dir);
+void import_scope_destroy(import_scope_t *scope);
+bool import_scope_add(import_scope_t *scope, const char *path);
+ast_node_t *import_scope_find_rule(import_scope_t *scope, const char *name);
+
+/* Process-wide cache */
+void import_set_cache_dir(const char *dir);   /* NULL: default location */
+void import_set_disk_cache(bool enabled);
+void import_cache_clear(void);
+void import_get_statistics(import_statistics_t *stats);
+
+#endif /* REASONS_IMPORT_H */
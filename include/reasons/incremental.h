@@ -0,0 +1,52 @@
+#ifndef REASONS_INCREMENTAL_H
+#define REASONS_INCREMENTAL_H
+
+#include "reasons/ast.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Incremental document
+ *
+ * Keeps a source text together with its token buffer and parsed program so
+ * that an edit only re-lexes the damaged tokens and re-parses the top-level
+ * declarations (rules and decisions) they touch. Declarations outside the
+ * edit keep their AST nodes, as do reparsed ones that come out structurally
+ * unchanged, so pointers held by the debugger stay valid across edits.
+ *
+ * A failed reparse keeps the new text and leaves the previous declarations
+ * in the program; the region is reparsed with the next edit.
+ */
+typedef struct incremental_doc incremental_doc_t;
+
+/* Statistics of the last update */
+typedef struct {
+    size_t tokens_relexed;            /* Tokens produced by the re-lex */
+    size_t tokens_total;              /* Tokens in the document */
+    size_t declarations_reparsed;     /* Declarations parsed again */
+    size_t declarations_reused;       /* Of those, unchanged and kept */
+    size_t declarations_total;        /* Declarations in the document */
+    double update_ms;                 /* Edit-to-ready time */
+    size_t edits;                     /* Edits applied since creation */
+} incremental_statistics_t;
+
+/* Creation and destruction */
+incremental_doc_t *incremental_create(const char *source);
+void incremental_destroy(incremental_doc_t *doc);
+
+/* Editing
+ *
+ * incremental_edit replaces removed bytes at offset with length bytes of
+ * text; incremental_update diffs against a complete new text and applies
+ * the changed middle as one edit. Both return false on a syntax error.
+ */
+bool incremental_edit(incremental_doc_t *doc, size_t offset, size_t removed,
+                      const char *text, size_t length);
+bool incremental_update(incremental_doc_t *doc, const char *source);
+
+/* Accessors */
+ast_node_t *incremental_program(const incremental_doc_t *doc);
+const char *incremental_source(const incremental_doc_t *doc);
+bool incremental_has_errors(const incremental_doc_t *doc);
+void incremental_get_statistics(const incremental_doc_t *doc, incremental_statistics_t *stats);
+
+#endif /* REASONS_INCREMENTAL_H */
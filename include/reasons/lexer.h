@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include "reasons/types.h"
 
@@ -126,12 +127,21 @@ typedef struct {
     size_t current_column;
     size_t bytes_processed;
     size_t total_bytes;
+    size_t literals_interned;   /* Distinct escape-processed literals stored */
+    size_t literal_bytes;       /* Bytes of lexer-owned literal storage */
 } lexer_statistics_t;
 
-/* Token structure */
+/* Token structure
+ *
+ * Tokens are slices: value points into the lexer's source buffer, or into
+ * storage owned by the lexer for escape-processed string literals and error
+ * messages. The text is NOT NUL-terminated and stays valid until the lexer
+ * is destroyed.
+ */
 typedef struct {
     token_type_t type;
-    const char *value;   /* Allocated string for token text */
+    const char *value;   /* Token text (length bytes, not NUL-terminated) */
+    size_t offset;       /* Byte offset of the token in the source */
     size_t length;       /* Length of token text */
     size_t line;         /* Line number (1-based) */
     size_t column;       /* Column number (1-based) */
@@ -147,6 +157,41 @@ typedef struct {
 /* Lexer handle (opaque structure) */
 typedef struct lexer_state lexer_t;
 
+/* Pre-tokenized stream (structure of arrays)
+ *
+ * The whole input tokenized up front, one entry per token in parallel
+ * arrays, always terminated by a TOKEN_EOF entry. offsets[i] is where the
+ * token starts; its text is the lengths[i] source bytes from there (from
+ * one past the opening quote for strings) unless lengths[i] carries
+ * TOKEN_BUFFER_LITERAL, in which case the text lives in lexer-owned storage
+ * (escape-processed strings, error messages). token_buffer_text resolves
+ * both. Entries are 32-bit, so inputs are limited to 2 GiB.
+ */
+#define TOKEN_BUFFER_LITERAL 0x80000000u
+
+typedef struct {
+    uint32_t token;             /* Index of the token */
+    const char *text;           /* Token text (not a source slice) */
+} token_literal_t;
+
+typedef struct {
+    uint8_t *types;             /* token_type_t of each token */
+    uint32_t *offsets;          /* Byte offset in the source */
+    uint32_t *lengths;          /* Text length, possibly | TOKEN_BUFFER_LITERAL */
+    uint32_t *lines;            /* Line number (1-based) */
+    uint32_t *columns;          /* Column number (1-based) */
+    size_t count;
+    size_t capacity;
+    
+    token_literal_t *literals;  /* Non-slice texts, sorted by token index */
+    size_t literal_count;
+    size_t literal_capacity;
+    
+    const char *source;         /* Source the offsets refer to */
+    lexer_t **owners;           /* Lexers owned by the buffer (parallel mode) */
+    size_t owner_count;
+} token_buffer_t;
+
 /* Lexer creation and destruction */
 lexer_t *lexer_create(const char *source);
 lexer_t *lexer_create_with_options(const char *source, const lexer_options_t *options);
@@ -158,10 +203,39 @@ token_t lexer_peek_token(lexer_t *lexer, size_t offset);
 bool lexer_match_token(lexer_t *lexer, token_type_t type);
 bool lexer_at_end(const lexer_t *lexer);
 
+/* Whole-input tokenization
+ *
+ * lexer_tokenize_all consumes the rest of the lexer's input; literal texts
+ * stay owned by the lexer, which must outlive the buffer.
+ * lexer_tokenize_parallel splits the source at newlines outside strings
+ * and comments and lexes the pieces on up to jobs threads (0 picks the
+ * number of CPUs); the buffer owns everything it refers to except source.
+ */
+token_buffer_t *lexer_tokenize_all(lexer_t *lexer);
+token_buffer_t *lexer_tokenize_parallel(const char *source, const lexer_options_t *options,
+                                        size_t jobs);
+void token_buffer_destroy(token_buffer_t *buffer);
+
+/* Incremental re-lexing
+ *
+ * source is the full text after replacing removed bytes at offset with
+ * inserted bytes. Re-lexes from the token before the edit until the stream
+ * lines up with the old tokens again and shifts the rest. The returned
+ * buffer takes over the old buffer's lexers, so tokens must still be
+ * destroyed but no longer owns literal text. Tokens in
+ * [*first_changed, *end_changed) of the result are new.
+ */
+token_buffer_t *token_buffer_relex(token_buffer_t *tokens, const char *source, size_t offset,
+                                   size_t removed, size_t inserted, size_t *first_changed,
+                                   size_t *end_changed);
+token_t token_buffer_get(const token_buffer_t *buffer, size_t index);
+const char *token_buffer_text(const token_buffer_t *buffer, size_t index, size_t *length);
+
 /* Token utilities */
 const char *lexer_token_name(token_type_t type);
 void lexer_print_token(const token_t *token, FILE *fp);
-void token_free(token_t *token);
+void token_free(token_t *token);  /* No-op: token text is owned by the lexer */
+bool token_text_equals(const token_t *token, const char *text);
 
 /* Position and error handling */
 lexer_position_t lexer_get_position(const lexer_t *lexer);
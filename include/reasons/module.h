@@ -0,0 +1,47 @@
+#ifndef REASONS_MODULE_H
+#define REASONS_MODULE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "reasons/ast.h"
+#include "reasons/ast_compact.h"
+
+/* Precompiled modules (.rsc)
+ *
+ * A module is a compiled program in the compact AST layout: the node array,
+ * the interned string table and the literal table, each a section with its
+ * own CRC32, behind a versioned header. Links are indices and offsets, so
+ * the file is position-independent and loads by mapping it: no lexing, no
+ * parsing, and one allocation besides the literal table.
+ *
+ * Modules are tied to the node layout of the build that wrote them; the
+ * header records it and loading a mismatched module fails cleanly.
+ */
+
+#define MODULE_EXTENSION ".rsc"
+#define MODULE_FORMAT_VERSION 1
+
+typedef struct CompiledModule CompiledModule;
+
+/* Writing */
+bool module_write(const char *path, const ast_compact_t *tree);
+bool module_write_program(const char *path, const ast_node_t *program);
+void* module_encode(const ast_compact_t *tree, size_t *size);   /* mem_free the image */
+
+/* Loading */
+CompiledModule* module_load(const char *path);
+void module_unload(CompiledModule *module);
+
+/* Opens an image embedded in a larger file or buffer, which must stay
+ * mapped (and 8-byte aligned) for the module's lifetime */
+CompiledModule* module_open(const void *data, size_t size, const char *name);
+
+/* Access */
+const ast_compact_t* module_tree(const CompiledModule *module);
+size_t module_file_size(const CompiledModule *module);
+
+/* True when path names a module rather than a source file */
+bool module_is_module_path(const char *path);
+
+#endif /* REASONS_MODULE_H */
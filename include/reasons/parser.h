@@ -11,13 +11,30 @@
 /* Opaque parser structure */
 typedef struct parser_state parser_t;
 
-/* Parser creation and destruction */
+/* Parser creation and destruction
+ *
+ * parser_create tokenizes the lexer's remaining input up front.
+ * parser_create_from_tokens parses an existing token buffer (for example
+ * one built by lexer_tokenize_parallel), which must outlive the parser.
+ */
 parser_t *parser_create(lexer_t *lexer);
+parser_t *parser_create_from_tokens(const token_buffer_t *tokens);
 void parser_destroy(parser_t *parser);
 
 /* Main parsing function */
 ast_node_t *parser_parse(parser_t *parser);
 
+/* Declaration-at-a-time parsing (incremental reparsing)
+ *
+ * parser_parse_declaration parses one top-level rule or decision at the
+ * current token and returns NULL on a syntax error without recovering.
+ * Positions are token indices into the parser's token buffer; seeking
+ * clears the error state.
+ */
+ast_node_t *parser_parse_declaration(parser_t *parser);
+size_t parser_position(const parser_t *parser);
+void parser_seek(parser_t *parser, size_t token);
+
 /* Context control */
 void parser_set_condition_context(parser_t *parser, bool enabled);
 void parser_set_consequence_context(parser_t *parser, bool enabled);
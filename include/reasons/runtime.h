@@ -5,6 +5,7 @@
 #include "reasons/eval.h"
 #include "utils/collections.h"
 #include "utils/error.h"
+#include "utils/memory.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <time.h>
@@ -52,6 +53,8 @@ typedef struct {
     unsigned max_recursion_depth;
     unsigned errors_occurred;
     size_t memory_allocated;
+    size_t memory_limit;
+    MemTagStats subsystem_memory[MEM_TAG_COUNT];
     unsigned gc_runs;
     size_t last_gc_freed;
     double uptime_seconds;
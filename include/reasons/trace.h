@@ -26,6 +26,8 @@ typedef struct {
     size_t custom_messages;           /* Custom trace messages */
     size_t sections_begun;            /* Sections started */
     size_t sections_ended;            /* Sections ended */
+    size_t entries_evicted;           /* Entries dropped to stay in limits */
+    bool budget_degraded;             /* Detail shed due to memory budget */
 } trace_stats_t;
 
 /* Opaque trace structure */
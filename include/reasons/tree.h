@@ -6,6 +6,11 @@
 #include "reasons/explain.h"
 #include "utils/collections.h"
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Dense ID of a node not (or no longer) in a tree's registry
+#define TREE_NODE_NO_INDEX UINT32_MAX
 
 typedef enum {
     NODE_CONDITION,
@@ -27,6 +32,30 @@ typedef struct {
     unsigned outcome_nodes;
 } TreeStatistics;
 
+// Node counts are of distinct nodes: a node shared by several parents
+// counts once
+typedef struct {
+    unsigned nodes_before;
+    unsigned nodes_after;
+    unsigned conditions_folded;   // Literal true/false conditions
+    unsigned branches_pruned;     // Conditions decided by the tests above them
+    unsigned subtrees_merged;     // Subtrees replaced by an identical one
+} TreeOptimizationReport;
+
+// Tests are condition nodes evaluated per tree evaluation
+typedef struct {
+    double expected_tests_before;  // Under the recorded branch probabilities
+    double expected_tests_after;
+    double observed_tests_before;  // As counted while the old order ran
+    double observed_tests_after;   // Filled by tree_reorder_observe
+    unsigned max_depth_before;     // Most tests on any path
+    unsigned max_depth_after;
+    unsigned observed_depth_before; // Most tests on any path that ran
+    unsigned observed_depth_after;  // Filled by tree_reorder_observe
+    unsigned cascades_reordered;
+    unsigned conditions_moved;
+} TreeReorderReport;
+
 typedef struct {
     char *name;
     reasons_value_t value;
@@ -38,19 +67,90 @@ void tree_destroy(DecisionTree *tree);
 TreeNode* tree_create_condition_node(AST_Node *condition, double weight);
 TreeNode* tree_create_action_node(Vector *actions, consequence_type_t type);
 TreeNode* tree_create_outcome_node(const reasons_value_t *value);
+// Links a condition node's branches before it joins a tree; the node takes
+// ownership of both
+bool tree_node_set_branches(TreeNode *node, TreeNode *true_branch, TreeNode *false_branch);
 
 void tree_set_root(DecisionTree *tree, TreeNode *root);
 void tree_add_variable(DecisionTree *tree, const char *name, reasons_value_t value);
 TreeNode* tree_find_node(DecisionTree *tree, const char *id);
 
+// Dense node IDs: 0..tree_node_count()-1 in pre-order, reassigned whenever
+// the tree changes shape, for tables keyed by integer instead of string.
+// A node shared by several versions has an ID in each of them.
+TreeNode* tree_node_at(DecisionTree *tree, uint32_t index);
+uint32_t tree_node_index(DecisionTree *tree, const TreeNode *node);
+size_t tree_node_count(DecisionTree *tree);
+// The lookups above build the index on first use after a shape change. A
+// tree shared between threads must have it built beforehand, so that
+// concurrent lookups only read it; tree_slot_publish does this.
+void tree_build_index(DecisionTree *tree);
+
+// Versioned edits. tree_clone is O(1): versions share nodes, and an edit
+// copies only the shared nodes between the root and the edited node, so
+// other versions never see it. target is a node of this tree, as returned
+// by tree_find_node; ownership of replacement and condition passes to the
+// tree. Execution statistics live in the nodes: a node still shared with
+// another version counts executions from both, while a node an edit copied
+// starts from the original's history and from then on counts only its own
+// version's, so the edited paths of A/B versions are measured separately.
+bool tree_replace_subtree(DecisionTree *tree, const TreeNode *target, TreeNode *replacement);
+bool tree_set_condition(DecisionTree *tree, const TreeNode *target, AST_Node *condition, double weight);
+bool tree_set_node_id(DecisionTree *tree, const TreeNode *target, const char *id);
+
+// Read-only node access, for serializers and tools outside the core
+TreeNode* tree_root(const DecisionTree *tree);
+NodeType tree_node_type(const TreeNode *node);
+const char* tree_node_id(const TreeNode *node);
+const char* tree_node_description(const TreeNode *node);
+void tree_node_location(const TreeNode *node, int *line, int *column);
+TreeNode* tree_node_branch(const TreeNode *node, bool branch);
+const AST_Node* tree_node_condition(const TreeNode *node, double *weight);
+Vector* tree_node_actions(const TreeNode *node, consequence_type_t *type);
+const reasons_value_t* tree_node_outcome(const TreeNode *node);
+
 void tree_traverse(TreeNode *root, TreeVisitor visit, void *context);
-void tree_traverse_path(TreeNode *node, PathVisitor visit, void *context);
+// Root-to-node path within tree; parents come from the tree's index, so a
+// node shared with other versions is reached through this one
+void tree_traverse_path(DecisionTree *tree, const TreeNode *node, PathVisitor visit, void *context);
 
 reasons_value_t tree_evaluate(DecisionTree *tree, runtime_env_t *env, 
                               explain_engine_t *explainer, trace_t *trace);
 
 DecisionTree* tree_clone(const DecisionTree *src);
+
+// Folds constant conditions, drops branches the comparisons above them
+// rule out (`x > 10` under `x < 5`; only tests without side effects are
+// dropped) and merges identical subtrees, which turns the tree into a DAG.
+// A merged node occurs at several places: its statistics cover all of
+// them, tree_node_index returns the first, and an edit through one place
+// leaves the others as they were. The debugger's `optimize` command runs
+// it and prints the report.
 void tree_optimize(DecisionTree *tree);
+TreeOptimizationReport tree_get_optimization_report(const DecisionTree *tree);
+
+// Reorders runs of side-effect-free tests whose order cannot change the
+// result (guards sharing a failure exit, alternatives sharing a success
+// exit, else-if chains of mutually exclusive comparisons) so the tests
+// most likely to decide come first, weighted by their measured cost when
+// timing is on. Uses the folded statistics and assumes the tests in a run
+// are independent. Returns whether anything moved; to reorder a live tree,
+// reorder a clone and publish it (see tree_swap.h).
+bool tree_reorder(DecisionTree *tree, TreeReorderReport *report);
+// Measures the new order: after tree_reorder, call tree_reset_counts, run
+// the same inputs again, then fill in the observed tests and depth with
+// this. The bench's tree_reorder cases do so.
+void tree_reorder_observe(DecisionTree *tree, TreeReorderReport *report);
+
+// Execution statistics. Evaluation only bumps per-thread counter shards;
+// the per-node counts and moving averages catch up when folded, on demand
+// or from a periodic tick. Timing costs a clock read per node and is off
+// by default.
+void tree_set_timing(DecisionTree *tree, bool enabled);
+void tree_fold_statistics(DecisionTree *tree);
+// Starts the execution counts over, keeping the branch probabilities and
+// timings; nodes shared with other versions start over in those too
+void tree_reset_counts(DecisionTree *tree);
 
 TreeStatistics tree_get_statistics(const DecisionTree *tree);
 void tree_serialize(const TreeNode *node, SerializeCallback callback, void *context);
@@ -0,0 +1,51 @@
+#ifndef REASONS_TREE_IMAGE_H
+#define REASONS_TREE_IMAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "reasons/tree.h"
+#include "reasons/runtime.h"
+
+/* Binary decision tree images (.rti)
+ *
+ * A relocatable, read-only form of a DecisionTree: a node array linked by
+ * indices, a threshold array (condition weights), a string pool (node IDs
+ * and descriptions) and the conditions, actions and outcomes as an
+ * embedded precompiled module (see module.h). Loading maps the file and
+ * checks it. Nodes, thresholds and strings are used in place, so every
+ * process that loads the same image shares those pages through the page
+ * cache; the expression literals are copied by module_open.
+ *
+ * A loaded image is evaluated in place. Comparisons, logic operators,
+ * identifiers and literals run directly on the mapped expressions; any
+ * other condition, and every action, is converted to the pointer AST at
+ * load and kept for the image's lifetime. After loading an image is
+ * read-only, so any number of threads can evaluate it without locking.
+ */
+
+#define TREE_IMAGE_EXTENSION ".rti"
+#define TREE_IMAGE_FORMAT_VERSION 1
+#define TREE_IMAGE_NONE UINT32_MAX
+
+typedef struct TreeImage TreeImage;
+
+/* Writing */
+bool tree_image_write(const char *path, const DecisionTree *tree);
+
+/* Loading */
+TreeImage* tree_image_load(const char *path);
+void tree_image_unload(TreeImage *image);
+
+/* Access (node 0 is the root and every node precedes its branches: preorder
+ * for a tree; a node the optimizer shared between parents is stored once) */
+size_t tree_image_node_count(const TreeImage *image);
+size_t tree_image_file_size(const TreeImage *image);
+uint32_t tree_image_find_node(const TreeImage *image, const char *id);
+NodeType tree_image_node_type(const TreeImage *image, uint32_t index);
+const char* tree_image_node_id(const TreeImage *image, uint32_t index);
+
+/* Evaluation; leaf receives the index of the node evaluation ended at */
+reasons_value_t tree_image_evaluate(TreeImage *image, runtime_env_t *env, uint32_t *leaf);
+
+#endif /* REASONS_TREE_IMAGE_H */
@@ -0,0 +1,55 @@
+#ifndef REASONS_TREE_SWAP_H
+#define REASONS_TREE_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "reasons/tree.h"
+
+/* Hot-swappable trees
+ *
+ * A tree slot holds the live version of a decision tree for concurrent
+ * evaluators. Readers pin it for the length of an evaluation:
+ *
+ *     DecisionTree *tree = tree_slot_enter(slot);
+ *     result = tree_evaluate(tree, env, NULL, NULL);
+ *     tree_slot_exit(slot);
+ *
+ * Entering and leaving touch only the reader's own record and never block.
+ * Publishing a new version swaps the root pointer atomically and retires
+ * the old version; a retired version is freed once every reader that could
+ * have pinned it has left, so writers never wait for readers either.
+ *
+ * A version's node index is built before it becomes visible, so the
+ * tree_find_node/tree_node_at lookups are safe from concurrent readers.
+ *
+ * Enter/exit pairs may nest within a thread. The tree returned by a nested
+ * enter can be newer than the one pinned outside it; both stay valid until
+ * the outermost exit.
+ */
+typedef struct tree_slot tree_slot_t;
+
+/* Slot statistics */
+typedef struct {
+    uint64_t version;                 /* Versions published, initial one included */
+    size_t retired;                   /* Old versions waiting for readers */
+    size_t reclaimed;                 /* Old versions freed */
+    size_t readers;                   /* Reader records; exited threads' are reused */
+} tree_slot_statistics_t;
+
+/* Slots take ownership of every tree published to them */
+tree_slot_t *tree_slot_create(DecisionTree *tree);
+void tree_slot_destroy(tree_slot_t *slot);    /* No reader may be inside */
+
+/* Readers */
+DecisionTree *tree_slot_enter(tree_slot_t *slot);
+void tree_slot_exit(tree_slot_t *slot);
+
+/* Writers */
+bool tree_slot_publish(tree_slot_t *slot, DecisionTree *tree);
+size_t tree_slot_reclaim(tree_slot_t *slot);  /* Returns versions freed */
+void tree_slot_synchronize(tree_slot_t *slot); /* Waits until nothing is retired */
+
+void tree_slot_get_statistics(tree_slot_t *slot, tree_slot_statistics_t *stats);
+
+#endif /* REASONS_TREE_SWAP_H */
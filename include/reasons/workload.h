@@ -0,0 +1,60 @@
+#ifndef REASONS_WORKLOAD_H
+#define REASONS_WORKLOAD_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Synthetic workloads
+ *
+ * Seeded generators for .reasons programs and for input datasets that bind
+ * the same variables, so benchmarks and scaling runs are reproducible at
+ * any size. The same options and seed always produce the same bytes.
+ *
+ * Variables are numeric (n0, n1, ...) or categorical (c0, c1, ...) with
+ * values "v0".."v<categories-1>". Each top-level rule nests sub-rules depth
+ * levels deep, fanout per body; the innermost bodies hold fanout decisions
+ * whose conditions join up to terms comparisons with && or ||.
+ *
+ * Skew shapes the datasets, not the program: at 0 numeric inputs are
+ * uniform over [0, 100) and categories equally likely; towards 1 numeric
+ * inputs crowd towards 0 and categories towards v0, so each comparison
+ * takes the same branch for most rows.
+ */
+
+#define WORKLOAD_NUMERIC_RANGE 100.0
+
+typedef enum {
+    WORKLOAD_CSV,
+    WORKLOAD_JSONL
+} WorkloadFormat;
+
+typedef struct {
+    uint64_t seed;
+    unsigned rules;                   /* Top-level rules */
+    unsigned depth;                   /* Sub-rule nesting inside each rule */
+    unsigned fanout;                  /* Statements per rule body */
+    unsigned variables;
+    double categorical;               /* Fraction of categorical variables */
+    unsigned categories;              /* Values per categorical variable */
+    unsigned terms;                   /* Most comparisons per condition */
+    double skew;                      /* Input skew in [0, 1) */
+} WorkloadOptions;
+
+void workload_options_default(WorkloadOptions *options);
+
+/* Variables (numeric ones first) */
+unsigned workload_categorical_count(const WorkloadOptions *options);
+void workload_variable_name(const WorkloadOptions *options, unsigned index,
+                            char *buffer, size_t size);
+
+/* Generation; both return false on invalid options or a write error */
+bool workload_write_program(FILE *output, const WorkloadOptions *options);
+bool workload_write_dataset(FILE *output, const WorkloadOptions *options, size_t rows,
+                            WorkloadFormat format);
+
+/* Decisions in a generated program */
+size_t workload_decision_count(const WorkloadOptions *options);
+
+#endif /* REASONS_WORKLOAD_H */
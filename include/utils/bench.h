@@ -0,0 +1,202 @@
+#ifndef UTILS_BENCH_H
+#define UTILS_BENCH_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* ======== STRUCTURE DEFINITIONS ======== */
+
+/*
+ * A benchmark is a setup/run/teardown triple. run performs one unit of work
+ * and returns how many items it processed (tokens, rows, evaluations...),
+ * which turns timings into throughput.
+ *
+ * Each sample times a batch of run calls. The batch size is calibrated once,
+ * by doubling until a batch lasts at least min_sample_time, so that
+ * sub-microsecond operations are not dominated by clock overhead. Warmup
+ * samples are taken at the calibrated batch size and discarded.
+ */
+
+typedef struct {
+    const char *name;               // "group/case", e.g. "eval_tree/depth=8"
+    const char *item_unit;          // What run() counts, e.g. "tokens"
+    void* (*setup)(const void *param);
+    size_t (*run)(void *state);     // Returns items processed
+    void (*teardown)(void *state);
+    const void *param;              // Passed to setup
+} BenchCase;
+
+typedef struct {
+    unsigned warmup;                // Discarded samples
+    unsigned repetitions;           // Recorded samples
+    double min_sample_time;         // Seconds per sample
+} BenchOptions;
+
+typedef struct {
+    char *name;
+    const char *item_unit;
+    size_t batch;                   // run() calls per sample
+    size_t items;                   // Items per run() call
+    double *samples;                // Nanoseconds per run() call, in run order
+    size_t sample_count;
+
+    // Summary over samples (nanoseconds per call)
+    double min;
+    double max;
+    double mean;
+    double stddev;
+    double median;
+    double p90;
+    double p99;
+    double items_per_second;        // At the median
+} BenchResult;
+
+typedef enum {
+    BENCH_UNCHANGED,                // No significant change beyond the threshold
+    BENCH_IMPROVED,
+    BENCH_REGRESSED
+} BenchVerdict;
+
+/*
+ * Baseline versus candidate for one benchmark. The change is the
+ * Hodges-Lehmann estimate of the time ratio: the median of
+ * candidate/baseline over all sample pairs, minus one. Its confidence
+ * interval comes from the order statistics of those pairwise ratios at the
+ * Mann-Whitney critical value, so the test and the interval agree.
+ */
+typedef struct {
+    const char *name;
+    double baseline_median;         // Nanoseconds per call
+    double candidate_median;
+    double change;                  // Relative, 0.10 = 10% slower
+    double change_low;              // Confidence interval of change
+    double change_high;
+    double p_value;                 // Two-sided Mann-Whitney U test
+    BenchVerdict verdict;
+} BenchComparison;
+
+typedef struct {
+    double threshold;               // Smallest relative change that counts
+    double alpha;                   // Significance level (and 1 - confidence)
+} BenchCompareOptions;
+
+/* ======== PUBLIC API ======== */
+
+/**
+ * Fills in the default options (3 warmup, 15 recorded samples, 10ms each)
+ *
+ * @param options Options to initialize
+ */
+void bench_options_default(BenchOptions *options);
+
+/**
+ * Runs a benchmark and summarizes its samples
+ *
+ * @param bench Benchmark to run
+ * @param options Run options (NULL for defaults)
+ * @param result Receives the samples and summary; free with bench_result_free
+ * @return False if setup failed or memory ran out
+ */
+bool bench_run(const BenchCase *bench, const BenchOptions *options, BenchResult *result);
+
+/**
+ * Frees the samples and name of a result
+ *
+ * @param result Result to free
+ */
+void bench_result_free(BenchResult *result);
+
+/**
+ * Recomputes a result's summary from its samples
+ *
+ * @param result Result whose samples are set
+ */
+void bench_summarize(BenchResult *result);
+
+/**
+ * Percentile of sorted data with linear interpolation between ranks
+ *
+ * @param sorted Ascending data
+ * @param count Number of elements
+ * @param percentile Percentile in [0, 100]
+ * @return Interpolated value (0 for empty data)
+ */
+double bench_percentile(const double *sorted, size_t count, double percentile);
+
+/**
+ * Prints a human-readable table of results
+ *
+ * @param output Output stream
+ * @param results Results to print
+ * @param count Number of results
+ */
+void bench_print_table(FILE *output, const BenchResult *results, size_t count);
+
+/**
+ * Writes results, including every sample, as JSON
+ *
+ * @param output Output stream
+ * @param results Results to write
+ * @param count Number of results
+ * @param options Options the results were measured with
+ * @return False on a write error
+ */
+bool bench_write_json(FILE *output, const BenchResult *results, size_t count,
+                      const BenchOptions *options);
+
+/* ======== COMPARISON ======== */
+
+/**
+ * Fills in the default comparison options (5% threshold, alpha 0.01)
+ *
+ * @param options Options to initialize
+ */
+void bench_compare_options_default(BenchCompareOptions *options);
+
+/**
+ * Two-sided Mann-Whitney U test (normal approximation, tie corrected)
+ *
+ * @param a First sample set
+ * @param count_a Number of samples in a
+ * @param b Second sample set
+ * @param count_b Number of samples in b
+ * @return Probability of a shift at least this large if a and b come from
+ *         the same distribution (1 when either set is empty)
+ */
+double bench_mann_whitney(const double *a, size_t count_a, const double *b, size_t count_b);
+
+/**
+ * Compares a candidate result with its baseline
+ *
+ * A benchmark regresses when the test is significant at alpha and the
+ * estimated slowdown exceeds the threshold; improvements are symmetric.
+ *
+ * @param baseline Baseline result (samples required)
+ * @param candidate Candidate result (samples required)
+ * @param options Comparison options (NULL for defaults)
+ * @param comparison Receives the comparison; name points into candidate
+ * @return False if either result has no samples
+ */
+bool bench_compare(const BenchResult *baseline, const BenchResult *candidate,
+                   const BenchCompareOptions *options, BenchComparison *comparison);
+
+/**
+ * Prints a table of comparisons
+ *
+ * @param output Output stream
+ * @param comparisons Comparisons to print
+ * @param count Number of comparisons
+ * @param options Options the comparisons were made with
+ */
+void bench_print_comparison(FILE *output, const BenchComparison *comparisons, size_t count,
+                            const BenchCompareOptions *options);
+
+/**
+ * Keeps a computed value alive so the compiler cannot drop the work
+ *
+ * @param value Value to consume
+ */
+void bench_consume(size_t value);
+
+#endif /* UTILS_BENCH_H */
@@ -0,0 +1,102 @@
+#ifndef UTILS_CONCURRENT_HASH_H
+#define UTILS_CONCURRENT_HASH_H
+
+#include "utils/hash.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/* ======== PUBLIC INTERFACE ======== */
+
+/*
+ * Sharded hash table for registries shared between threads. Keys are spread
+ * over independently locked shards, each a regular HashTable behind a
+ * reader-writer lock, so readers of different keys (and concurrent readers of
+ * the same shard) never serialize on one mutex.
+ *
+ * Unlike hashtable_get, lookups copy the value out while the shard is locked:
+ * a pointer into the table could be freed by a concurrent set or remove.
+ */
+typedef struct ConcurrentHashTable ConcurrentHashTable;
+
+/**
+ * Creates a concurrent hash table
+ *
+ * @param initial_capacity Expected number of entries (0 for default)
+ * @param shard_count Number of shards, rounded up to a power of 2 (0 for default)
+ * @param hash_func Hash function (NULL for default FNV-1a)
+ * @return New table or NULL on failure
+ */
+ConcurrentHashTable* concurrent_hashtable_create(size_t initial_capacity, size_t shard_count,
+                                                 HashFunction hash_func);
+
+/**
+ * Destroys a concurrent hash table and all copied keys and values
+ *
+ * @param table Table to destroy (no other thread may be using it)
+ */
+void concurrent_hashtable_destroy(ConcurrentHashTable *table);
+
+/**
+ * Inserts or replaces a value (key and value are copied)
+ *
+ * @param table Table instance
+ * @param key Key bytes
+ * @param key_size Key size in bytes
+ * @param value Value bytes
+ * @param value_size Value size in bytes
+ */
+void concurrent_hashtable_set(ConcurrentHashTable *table, const void *key, size_t key_size,
+                              const void *value, size_t value_size);
+
+/**
+ * Looks up a key and copies its value out
+ *
+ * @param table Table instance
+ * @param key Key bytes
+ * @param key_size Key size in bytes
+ * @param value_out Receives the value, truncated to value_size bytes; bytes
+ *                  beyond a shorter stored value are left untouched (may be NULL)
+ * @param value_size Size of value_out in bytes
+ * @return True if the key was found
+ */
+bool concurrent_hashtable_get(ConcurrentHashTable *table, const void *key, size_t key_size,
+                              void *value_out, size_t value_size);
+
+/**
+ * Removes a key
+ *
+ * @param table Table instance
+ * @param key Key bytes
+ * @param key_size Key size in bytes
+ * @return True if the key was present
+ */
+bool concurrent_hashtable_remove(ConcurrentHashTable *table, const void *key, size_t key_size);
+
+/**
+ * Returns the number of entries (a snapshot under concurrent updates)
+ *
+ * @param table Table instance
+ * @return Entry count
+ */
+size_t concurrent_hashtable_size(ConcurrentHashTable *table);
+
+/**
+ * Removes all entries
+ *
+ * @param table Table instance
+ */
+void concurrent_hashtable_clear(ConcurrentHashTable *table);
+
+/**
+ * Visits every entry, one shard at a time under its read lock
+ *
+ * The callback must not modify the table.
+ *
+ * @param table Table instance
+ * @param callback Function called for each entry
+ * @param user_data Passed through to the callback
+ */
+void concurrent_hashtable_iterate(ConcurrentHashTable *table, HashIterCallback callback,
+                                  void *user_data);
+
+#endif /* UTILS_CONCURRENT_HASH_H */
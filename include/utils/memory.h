@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdio.h>
 
 /* ======== PUBLIC INTERFACE ======== */
 
@@ -46,9 +47,38 @@ void* memory_reallocate(void *ptr, size_t new_size, const char *file, int line);
  */
 void memory_free(void *ptr, const char *file, int line);
 
+/* ======== SUBSYSTEM ACCOUNTING ======== */
+
+typedef enum {
+    MEM_TAG_GENERAL,            // Untagged allocations
+    MEM_TAG_PARSER,             // Lexer, parser and AST
+    MEM_TAG_RUNTIME,            // Runtime environment and evaluation
+    MEM_TAG_TRACE,              // Execution traces
+    MEM_TAG_EXPLAIN,            // Explanation engine output
+    MEM_TAG_COVERAGE,           // Coverage data
+    MEM_TAG_HISTORY,            // Decision history
+    MEM_TAG_PROFILER,           // Profiler entries
+    MEM_TAG_COUNT
+} MemTag;
+
+/**
+ * Allocates memory accounted to a subsystem
+ * 
+ * Fails without touching the system allocator when the allocation would take
+ * the subsystem over its budget. Reallocations keep the original tag.
+ * 
+ * @param size Number of bytes to allocate
+ * @param tag Subsystem the allocation is charged to
+ * @param file Source file name (automatically passed by macro)
+ * @param line Source line number (automatically passed by macro)
+ * @return Pointer to allocated memory or NULL on failure or exhausted budget
+ */
+void* memory_allocate_tagged(size_t size, MemTag tag, const char *file, int line);
+
 /* ======== CONVENIENCE MACROS ======== */
 
 #define mem_alloc(size) memory_allocate((size), __FILE__, __LINE__)
+#define mem_alloc_tagged(size, tag) memory_allocate_tagged((size), (tag), __FILE__, __LINE__)
 #define mem_realloc(ptr, size) memory_reallocate((ptr), (size), __FILE__, __LINE__)
 #define mem_free(ptr) memory_free((ptr), __FILE__, __LINE__)
 
@@ -141,6 +171,13 @@ typedef struct {
     size_t leak_count;          // Detected leaks
 } MemStats;
 
+typedef struct {
+    size_t current;             // Bytes currently allocated
+    size_t peak;                // Peak bytes allocated
+    size_t budget;              // Budget in bytes (0 = unlimited)
+    size_t denied;              // Allocations refused by the budget
+} MemTagStats;
+
 /**
  * Retrieves current memory statistics
  * 
@@ -148,6 +185,38 @@ typedef struct {
  */
 MemStats memory_get_stats(void);
 
+/**
+ * Returns the number of bytes currently allocated
+ * 
+ * @return Live bytes across all subsystems
+ */
+size_t memory_current_usage(void);
+
+/**
+ * Retrieves accounting and budget usage for one subsystem
+ * 
+ * @param tag Subsystem tag
+ * @return Subsystem statistics (zeroed for an invalid tag)
+ */
+MemTagStats memory_get_tag_stats(MemTag tag);
+
+/**
+ * Returns the display name of a subsystem tag
+ * 
+ * @param tag Subsystem tag
+ * @return Static name string
+ */
+const char* memory_tag_name(MemTag tag);
+
+/**
+ * Looks up a subsystem tag by its display name
+ * 
+ * @param name Subsystem name (e.g., "trace")
+ * @param tag Receives the tag on success
+ * @return True if the name is known
+ */
+bool memory_tag_from_name(const char *name, MemTag *tag);
+
 /**
  * Reports memory leaks to an output stream
  * 
@@ -171,6 +240,42 @@ void memory_report(FILE *output);
  */
 void memory_set_tracking(bool enabled);
 
+/**
+ * Sets the memory budget of a subsystem
+ * 
+ * @param tag Subsystem tag
+ * @param budget Budget in bytes (0 for unlimited)
+ */
+void memory_set_budget(MemTag tag, size_t budget);
+
+/**
+ * Checks whether a subsystem can allocate more memory within its budget
+ * 
+ * Subsystems call this before growing so they can shed detail or drop old
+ * records instead of having allocations fail.
+ * 
+ * @param tag Subsystem tag
+ * @param size Number of bytes about to be allocated
+ * @return True if the allocation fits (always true without a budget)
+ */
+bool memory_budget_check(MemTag tag, size_t size);
+
+/**
+ * Sets the overall memory limit and derives default budgets for the
+ * diagnostic subsystems (trace, explain, coverage, history, profiler)
+ * that have no explicit budget
+ * 
+ * @param limit Limit in bytes (0 for unlimited)
+ */
+void memory_set_limit(size_t limit);
+
+/**
+ * Returns the overall memory limit
+ * 
+ * @return Limit in bytes (0 if unlimited)
+ */
+size_t memory_get_limit(void);
+
 /**
  * Enables or disables guard pages for overflow detection
  * 
@@ -178,4 +283,51 @@ void memory_set_tracking(bool enabled);
  */
 void memory_set_guard_pages(bool enabled);
 
+/* ======== SAMPLING HEAP PROFILER ======== */
+
+typedef enum {
+    HEAP_PROFILE_TEXT,          // Human-readable top sites by live bytes
+    HEAP_PROFILE_PPROF,         // pprof legacy heap_v2 text profile
+    HEAP_PROFILE_SPEEDSCOPE     // speedscope sampled JSON profile
+} HeapProfileFormat;
+
+#define HEAP_PROFILE_DEFAULT_INTERVAL (512 * 1024)
+
+/**
+ * Starts sampling allocations made through memory_allocate
+ * 
+ * On average one allocation is sampled per sample_interval bytes (Poisson
+ * sampling), so the overhead is independent of how many allocations are made.
+ * Restarting discards the previous profile.
+ * 
+ * @param sample_interval Mean bytes between samples (0 for default)
+ */
+void memory_heap_profile_start(size_t sample_interval);
+
+/**
+ * Stops sampling and releases the profile
+ */
+void memory_heap_profile_stop(void);
+
+/**
+ * Checks whether the heap profiler is running
+ * 
+ * @return True if allocations are being sampled
+ */
+bool memory_heap_profile_active(void);
+
+/**
+ * Clears all samples while keeping the profiler running
+ */
+void memory_heap_profile_reset(void);
+
+/**
+ * Writes the current heap profile
+ * 
+ * @param output Output stream
+ * @param format Output format
+ * @return True on success, false if the profiler is not running
+ */
+bool memory_heap_profile_dump(FILE *output, HeapProfileFormat format);
+
 #endif /* UTILS_MEMORY_H */
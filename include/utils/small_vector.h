@@ -0,0 +1,106 @@
+#ifndef UTILS_SMALL_VECTOR_H
+#define UTILS_SMALL_VECTOR_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* ======== PUBLIC INTERFACE ======== */
+
+/*
+ * Macro-generated typed vectors. Elements are stored unboxed and accessed
+ * directly through the data/size fields, so an element access is a plain
+ * array index instead of a void* round trip through vector_at.
+ *
+ *   VECTOR_DEFINE(NodeVec, node_vec, ast_node_t*)
+ *       Heap-backed vector; no allocation until the first push.
+ *
+ *   SMALL_VECTOR_DEFINE(NodeStack, node_stack, ast_node_t*, 16)
+ *       Starts in 16 inline slots inside the struct and only spills to the
+ *       heap when it grows past them. Because data points into the struct
+ *       while inline, a small vector must not be copied by value.
+ *
+ * Both define the struct type `name` and static inline prefix_init,
+ * prefix_destroy, prefix_clear, prefix_reserve, prefix_push, prefix_pop and
+ * prefix_back. pop and back do not check for an empty vector.
+ */
+
+#define SMALL_VECTOR_MIN_CAPACITY 4
+
+/**
+ * Grows a typed vector's buffer (used by the generated push/reserve)
+ *
+ * Moves the elements out of the inline buffer on the first spill and
+ * reallocates afterwards. Leaves the vector untouched on failure.
+ *
+ * @param data In/out element buffer
+ * @param capacity In/out capacity in elements
+ * @param element_size Element size in bytes
+ * @param inline_buf Inline storage of a small vector (NULL if none)
+ * @param size Number of elements in use
+ * @param min_capacity Required capacity in elements
+ * @return True on success
+ */
+bool small_vector_grow(void **data, size_t *capacity, size_t element_size,
+                       void *inline_buf, size_t size, size_t min_capacity);
+
+/**
+ * Frees a typed vector's buffer unless it is the inline storage
+ *
+ * @param data Element buffer (may be NULL)
+ * @param inline_buf Inline storage of a small vector (NULL if none)
+ */
+void small_vector_release(void *data, void *inline_buf);
+
+#define SMALL_VECTOR_NO_INLINE_(v) ((void*)0)
+#define SMALL_VECTOR_INLINE_(v) ((void*)(v)->inline_buf)
+
+#define SMALL_VECTOR_OPS_(name, prefix, type, inline_of, inline_capacity)       \
+    static inline void prefix##_init(name *v) {                                 \
+        v->data = (type*)inline_of(v);                                          \
+        v->size = 0;                                                            \
+        v->capacity = (inline_capacity);                                        \
+    }                                                                           \
+    static inline void prefix##_destroy(name *v) {                              \
+        small_vector_release(v->data, inline_of(v));                            \
+        prefix##_init(v);                                                       \
+    }                                                                           \
+    static inline void prefix##_clear(name *v) {                                \
+        v->size = 0;                                                            \
+    }                                                                           \
+    static inline bool prefix##_reserve(name *v, size_t capacity) {             \
+        if (capacity <= v->capacity) return true;                               \
+        return small_vector_grow((void**)&v->data, &v->capacity, sizeof(type),  \
+                                 inline_of(v), v->size, capacity);              \
+    }                                                                           \
+    static inline bool prefix##_push(name *v, type item) {                      \
+        if (v->size == v->capacity && !prefix##_reserve(v, v->size + 1)) {      \
+            return false;                                                       \
+        }                                                                       \
+        v->data[v->size++] = item;                                              \
+        return true;                                                            \
+    }                                                                           \
+    static inline type prefix##_pop(name *v) {                                  \
+        return v->data[--v->size];                                              \
+    }                                                                           \
+    static inline type prefix##_back(const name *v) {                           \
+        return v->data[v->size - 1];                                            \
+    }
+
+#define VECTOR_DEFINE(name, prefix, type)                                       \
+    typedef struct {                                                            \
+        type *data;                                                             \
+        size_t size;                                                            \
+        size_t capacity;                                                        \
+    } name;                                                                     \
+    SMALL_VECTOR_OPS_(name, prefix, type, SMALL_VECTOR_NO_INLINE_, 0)
+
+#define SMALL_VECTOR_DEFINE(name, prefix, type, inline_count)                   \
+    typedef struct {                                                            \
+        type *data;                                                             \
+        size_t size;                                                            \
+        size_t capacity;                                                        \
+        type inline_buf[inline_count];                                          \
+    } name;                                                                     \
+    SMALL_VECTOR_OPS_(name, prefix, type, SMALL_VECTOR_INLINE_, (inline_count))
+
+#endif /* UTILS_SMALL_VECTOR_H */
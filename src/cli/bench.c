@@ -0,0 +1,1064 @@
+/*
+ * bench.c - Benchmark suite CLI for Reasons DSL
+ *
+ * Features:
+ * - Lexing and parsing throughput on generated sources
+ * - eval_tree on generated programs of varying rule nesting and width
+ * - tree_evaluate on balanced decision trees
+ * - tree_evaluate after profile-guided reordering, with a check that every
+ *   cascade kind still gives the same results
+ * - Tracing on versus off, and explanation generation
+ * - AST validation over the pointer and the compact form
+ * - Hash table, vector and allocator (heap, arena, pool) micro-benchmarks
+ * - CSV and JSONL parsing
+ * - Inputs from the seeded workload generator, identical on every run
+ * - Warmup, repeated samples, median and percentiles, JSON output
+ * - Comparison against a baseline results file with regression gating
+ */
+
+#include "reasons/cli.h"
+#include "reasons/lexer.h"
+#include "reasons/parser.h"
+#include "reasons/ast.h"
+#include "reasons/ast_compact.h"
+#include "reasons/eval.h"
+#include "reasons/trace.h"
+#include "reasons/explain.h"
+#include "reasons/runtime.h"
+#include "reasons/tree.h"
+#include "reasons/io.h"
+#include "reasons/workload.h"
+#include "utils/bench.h"
+#include "utils/hash.h"
+#include "utils/vector.h"
+#include "utils/error.h"
+#include "utils/logger.h"
+#include "utils/memory.h"
+#include "utils/string_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#define BENCH_VARIABLES 4           // Numeric variables n0..n3 read by generated programs
+#define BENCH_PROGRAM_FANOUT 2      // Sub-rules per body, and decisions per innermost body
+#define BENCH_SOURCE_RULES 500      // Rules in the generated lexer/parser source
+#define BENCH_TABLE_ROWS 10000      // Rows in the generated CSV and JSONL inputs
+#define BENCH_SEED 20250101         // Workload seed; fixed so runs are comparable
+#define BENCH_MICRO_COUNT 1024      // Operations per hash/vector/memory run
+#define BENCH_CASCADE_TESTS 8       // Tests in each reordered cascade
+#define BENCH_CASCADE_INPUTS 4096   // Inputs profiled, then checked after reordering
+
+// Exit statuses of a comparison
+#define BENCH_EXIT_REGRESSED 1
+#define BENCH_EXIT_ERROR 2
+
+/* ======== STRUCTURE DEFINITIONS ======== */
+
+typedef struct {
+    unsigned depth;                 // Sub-rule nesting; a decision tree's depth for trees
+    unsigned width;                 // Top-level rules per program
+    bool tracing;
+    bool explanation;
+} ProgramParam;
+
+typedef struct {
+    char *source;
+    size_t length;
+} SourceState;
+
+typedef struct {
+    ast_node_t *program;
+    ast_compact_t *compact;         // Flat copy of program, for the validation cases
+    runtime_env_t *env;
+    eval_context_t *ctx;
+    explain_engine_t *explainer;
+    uint64_t rng;
+    size_t decisions;               // Decisions evaluated per run
+} ProgramState;
+
+typedef enum {
+    BENCH_CASCADE_ALL,              // Guards sharing a failure exit
+    BENCH_CASCADE_ANY,              // Alternatives sharing a success exit
+    BENCH_CASCADE_EXCLUSIVE         // Else-if chain over one variable
+} CascadeShape;
+
+typedef struct {
+    DecisionTree *tree;
+    runtime_env_t *env;
+    uint64_t rng;
+    CascadeShape shape;             // Inputs of the reorder cases
+} TreeState;
+
+typedef struct {
+    HashTable *table;
+    Vector *vector;
+    MemArena *arena;
+    MemPool *pool;
+    void *blocks[BENCH_MICRO_COUNT];
+} MicroState;
+
+typedef struct {
+    char path[64];
+    char *text;
+    size_t length;
+} TableState;
+
+/* ======== FUNCTION PROTOTYPES ======== */
+
+static void print_help();
+static void source_teardown(void *arg);
+static void csv_teardown(void *arg);
+static void json_teardown(void *arg);
+static bool load_results(const char *path, BenchResult **results, size_t *count);
+static bool run_suite(const char *filter, const BenchOptions *options, bool quiet,
+                      FILE *progress, BenchResult **results, size_t *count);
+static int compare_results(const BenchResult *baseline, size_t baseline_count,
+                           const BenchResult *candidate, size_t candidate_count,
+                           const BenchCompareOptions *options, FILE *output);
+static void free_results(BenchResult *results, size_t count);
+
+/* ======== PRIVATE HELPER FUNCTIONS ======== */
+
+static inline uint64_t next_random(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static double next_unit(uint64_t *state) {
+    return (double)(next_random(state) >> 11) / (double)(1ULL << 53);
+}
+
+// As the workload generator names numeric variables
+static const char *variable_names[BENCH_VARIABLES] = {"n0", "n1", "n2", "n3"};
+
+static void set_random_variable(runtime_env_t *env, uint64_t *rng) {
+    reasons_value_t value = {VALUE_NUMBER};
+    value.data.number_val = next_unit(rng) * WORKLOAD_NUMERIC_RANGE;
+    runtime_set_variable(env, variable_names[*rng % BENCH_VARIABLES], value);
+}
+
+// Generator defaults with a fixed seed and shape: sub-rules of four decisions each
+static void bench_workload(WorkloadOptions *options) {
+    workload_options_default(options);
+    options->seed = BENCH_SEED;
+    options->depth = 1;
+    options->fanout = 4;
+}
+
+/* ======== SOURCES: LEXER AND PARSER ======== */
+
+static void* source_setup(const void *param) {
+    (void)param;
+    SourceState *state = mem_alloc(sizeof(SourceState));
+    if (!state) return NULL;
+
+    FILE *stream = open_memstream(&state->source, &state->length);
+    if (!stream) {
+        mem_free(state);
+        return NULL;
+    }
+
+    WorkloadOptions workload;
+    bench_workload(&workload);
+    workload.rules = BENCH_SOURCE_RULES;
+    bool ok = workload_write_program(stream, &workload);
+    fclose(stream);
+    if (!ok) {
+        source_teardown(state);
+        return NULL;
+    }
+    return state;
+}
+
+static void source_teardown(void *arg) {
+    SourceState *state = arg;
+    free(state->source);
+    mem_free(state);
+}
+
+static size_t run_lexer(void *arg) {
+    SourceState *state = arg;
+    lexer_t *lexer = lexer_create(state->source);
+    size_t tokens = 0;
+    for (;;) {
+        token_t token = lexer_next_token(lexer);
+        tokens++;
+        if (token.type == TOKEN_EOF || token.type == TOKEN_ERROR) break;
+    }
+    lexer_destroy(lexer);
+    return tokens;
+}
+
+static size_t run_parser(void *arg) {
+    SourceState *state = arg;
+    lexer_t *lexer = lexer_create(state->source);
+    parser_t *parser = parser_create(lexer);
+    ast_node_t *program = parser_parse(parser);
+    bench_consume(program != NULL);
+    ast_destroy(program);
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+    return state->length;
+}
+
+/* ======== GENERATED PROGRAMS: eval_tree, TRACING, EXPLAIN ======== */
+
+static ast_node_t* parse_source(const char *source) {
+    lexer_t *lexer = lexer_create(source);
+    parser_t *parser = parser_create(lexer);
+    ast_node_t *program = parser_parse(parser);
+    if (program && parser_had_error(parser)) {
+        ast_destroy(program);
+        program = NULL;
+    }
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+    return program;
+}
+
+static void* program_setup(const void *param) {
+    const ProgramParam *shape = param;
+    ProgramState *state = mem_alloc(sizeof(ProgramState));
+    if (!state) return NULL;
+    memset(state, 0, sizeof(ProgramState));
+
+    // One generated rule per unit of width, nesting sub-rules depth levels
+    // deep, parsed as the CLI would parse it
+    WorkloadOptions workload;
+    bench_workload(&workload);
+    workload.rules = shape->width;
+    workload.depth = shape->depth;
+    workload.fanout = BENCH_PROGRAM_FANOUT;
+    workload.variables = BENCH_VARIABLES;
+    workload.categorical = 0;
+
+    char *source = NULL;
+    size_t length = 0;
+    FILE *stream = open_memstream(&source, &length);
+    bool ok = stream && workload_write_program(stream, &workload);
+    if (stream) fclose(stream);
+    state->program = ok ? parse_source(source) : NULL;
+    free(source);
+    if (!state->program) {
+        LOG_ERROR("Failed to generate the depth=%u width=%u program", shape->depth, shape->width);
+        mem_free(state);
+        return NULL;
+    }
+    state->decisions = workload_decision_count(&workload);
+
+    state->rng = 0x9E3779B97F4A7C15ULL;
+    state->env = runtime_create();
+    for (int i = 0; i < BENCH_VARIABLES; i++) {
+        reasons_value_t value = {VALUE_NUMBER};
+        value.data.number_val = next_unit(&state->rng) * WORKLOAD_NUMERIC_RANGE;
+        runtime_set_variable(state->env, variable_names[i], value);
+    }
+    state->ctx = eval_context_create(state->env);
+    eval_set_tracing(state->ctx, shape->tracing);
+    eval_set_explanation(state->ctx, shape->explanation);
+    return state;
+}
+
+static void program_teardown(void *arg) {
+    ProgramState *state = arg;
+    explain_destroy(state->explainer);
+    ast_compact_destroy(state->compact);
+    eval_context_destroy(state->ctx);
+    runtime_destroy(state->env);
+    ast_destroy(state->program);
+    mem_free(state);
+}
+
+static size_t run_eval_tree(void *arg) {
+    ProgramState *state = arg;
+    set_random_variable(state->env, &state->rng);
+    reasons_value_t result = eval_tree(state->ctx, state->program);
+    bench_consume(result.type);
+    reasons_value_free(&result);
+    return state->decisions;
+}
+
+// Explanation of a fixed trace, without the evaluation that produced it
+static void* explain_setup(const void *param) {
+    ProgramState *state = program_setup(param);
+    if (!state) return NULL;
+
+    reasons_value_t result = eval_tree(state->ctx, state->program);
+    reasons_value_free(&result);
+    state->explainer = explain_create();
+    return state;
+}
+
+static size_t run_explain(void *arg) {
+    ProgramState *state = arg;
+    explain_reset(state->explainer);
+    explain_generate(state->explainer, state->program, eval_get_trace(state->ctx));
+    const char *output = explain_get_output(state->explainer);
+    bench_consume(output ? strlen(output) : 0);
+    return state->decisions;
+}
+
+/* ======== AST PASSES: POINTER VERSUS COMPACT ======== */
+
+// The same program in both forms; both cases report nodes validated
+static void* compact_setup(const void *param) {
+    ProgramState *state = program_setup(param);
+    if (!state) return NULL;
+
+    state->compact = ast_compact_from_ast(state->program);
+    if (!state->compact) {
+        program_teardown(state);
+        return NULL;
+    }
+    return state;
+}
+
+static size_t run_validate(void *arg) {
+    ProgramState *state = arg;
+    bench_consume(ast_validate(state->program));
+    return ast_compact_size(state->compact);
+}
+
+static size_t run_compact_validate(void *arg) {
+    ProgramState *state = arg;
+    bench_consume(ast_compact_validate(state->compact, 0));
+    return ast_compact_size(state->compact);
+}
+
+/* ======== DECISION TREES: tree_evaluate ======== */
+
+static TreeNode* build_tree_node(double low, double high, unsigned depth) {
+    double mid = (low + high) / 2;
+    if (depth == 0) {
+        reasons_value_t value = {VALUE_NUMBER};
+        value.data.number_val = mid;
+        return tree_create_outcome_node(&value);
+    }
+
+    reasons_value_t threshold = {VALUE_NUMBER};
+    threshold.data.number_val = mid;
+    TreeNode *node = tree_create_condition_node(
+        ast_create_comparison(CMP_LT, ast_create_identifier("x0"), ast_create_literal(&threshold)),
+        1.0);
+    tree_node_set_branches(node, build_tree_node(low, mid, depth - 1),
+                           build_tree_node(mid, high, depth - 1));
+    return node;
+}
+
+static void* tree_setup(const void *param) {
+    const ProgramParam *shape = param;
+    TreeState *state = mem_alloc(sizeof(TreeState));
+    if (!state) return NULL;
+
+    state->tree = tree_create("bench");
+    tree_set_root(state->tree, build_tree_node(0.0, 1.0, shape->depth));
+    state->env = runtime_create();
+    state->rng = 0x9E3779B97F4A7C15ULL;
+    return state;
+}
+
+static void tree_teardown(void *arg) {
+    TreeState *state = arg;
+    runtime_destroy(state->env);
+    tree_destroy(state->tree);
+    mem_free(state);
+}
+
+static size_t run_tree_evaluate(void *arg) {
+    TreeState *state = arg;
+    reasons_value_t x = {VALUE_NUMBER};
+    x.data.number_val = next_unit(&state->rng);
+    runtime_set_variable(state->env, "x0", x);
+
+    reasons_value_t result = tree_evaluate(state->tree, state->env, NULL, NULL);
+    bench_consume(result.type);
+    reasons_value_free(&result);
+    return 1;
+}
+
+/* ======== DECISION TREES: REORDERED CASCADES ======== */
+
+static TreeNode* outcome_node(double number) {
+    reasons_value_t value = {VALUE_NUMBER};
+    value.data.number_val = number;
+    return tree_create_outcome_node(&value);
+}
+
+static TreeNode* comparison_node(comparison_op_t op, const char *name, double constant) {
+    reasons_value_t value = {VALUE_NUMBER};
+    value.data.number_val = constant;
+    return tree_create_condition_node(
+        ast_create_comparison(op, ast_create_identifier(name), ast_create_literal(&value)), 1.0);
+}
+
+// Tests written in the worst order for the inputs below, so the reorder
+// has to move them: guards that fail most often last, alternatives that
+// hold most often last, and the most frequent else-if arm last
+static TreeNode* build_cascade(CascadeShape shape) {
+    TreeNode *rest = outcome_node(shape == BENCH_CASCADE_ALL ? 1.0 : -1.0);
+    for (unsigned i = BENCH_CASCADE_TESTS; i-- > 0;) {
+        const char *name = variable_names[i % BENCH_VARIABLES];
+        TreeNode *node;
+        switch (shape) {
+            case BENCH_CASCADE_ALL:
+                node = comparison_node(CMP_LT, name, 0.95 - 0.1 * i);
+                tree_node_set_branches(node, rest, outcome_node(0.0));
+                break;
+            case BENCH_CASCADE_ANY:
+                node = comparison_node(CMP_LT, name, 0.05 + 0.1 * i);
+                tree_node_set_branches(node, outcome_node(1.0), rest);
+                break;
+            default:
+                node = comparison_node(CMP_EQ, variable_names[0], (double)i);
+                tree_node_set_branches(node, outcome_node((double)i), rest);
+                break;
+        }
+        rest = node;
+    }
+    return rest;
+}
+
+// Next input of a seeded sequence; x0 is a small integer for the else-if
+// chain, skewed towards the arms tested last
+static void set_cascade_input(runtime_env_t *env, CascadeShape shape, uint64_t *rng) {
+    for (int i = 0; i < BENCH_VARIABLES; i++) {
+        reasons_value_t value = {VALUE_NUMBER};
+        value.data.number_val = next_unit(rng);
+        if (i == 0 && shape == BENCH_CASCADE_EXCLUSIVE) {
+            value.data.number_val = (double)(unsigned)(BENCH_CASCADE_TESTS * sqrt(value.data.number_val));
+        }
+        runtime_set_variable(env, variable_names[i], value);
+    }
+}
+
+// Evaluates the fixed inputs, recording each result into results, or
+// comparing against it when check is set
+static bool run_cascade_inputs(TreeState *state, CascadeShape shape, double *results, bool check) {
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    for (size_t k = 0; k < BENCH_CASCADE_INPUTS; k++) {
+        set_cascade_input(state->env, shape, &rng);
+        reasons_value_t result = tree_evaluate(state->tree, state->env, NULL, NULL);
+        double number = result.type == VALUE_NUMBER ? result.data.number_val : NAN;
+        reasons_value_free(&result);
+        
+        if (!check) {
+            results[k] = number;
+        } else if (!(number == results[k])) {
+            LOG_ERROR("Reordered cascade changed the result of input %zu: %g, was %g",
+                      k, number, results[k]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Profiles the cascade, reorders it and checks that every input still
+// gives the same result; the bench then times the reordered tree. The
+// repository has no test suite, so this equivalence check lives here and
+// fails the run when a reorder changes a result.
+static void* reorder_setup(const void *param) {
+    CascadeShape shape = *(const CascadeShape*)param;
+    double *results = mem_alloc(BENCH_CASCADE_INPUTS * sizeof(double));
+    TreeState *state = mem_alloc(sizeof(TreeState));
+    if (!results || !state) {
+        mem_free(results);
+        mem_free(state);
+        return NULL;
+    }
+
+    state->tree = tree_create("bench");
+    tree_set_root(state->tree, build_cascade(shape));
+    state->env = runtime_create();
+    state->rng = 0x9E3779B97F4A7C15ULL;
+    state->shape = shape;
+
+    TreeReorderReport report;
+    bool ok = run_cascade_inputs(state, shape, results, false);
+    if (ok && !tree_reorder(state->tree, &report)) {
+        LOG_ERROR("Cascade was not reordered");
+        ok = false;
+    }
+    if (ok) {
+        tree_reset_counts(state->tree);
+        ok = run_cascade_inputs(state, shape, results, true);
+    }
+    mem_free(results);
+    if (!ok) {
+        tree_teardown(state);
+        return NULL;
+    }
+
+    tree_reorder_observe(state->tree, &report);
+    LOG_INFO("Reordered %u tests: %.3f -> %.3f tests per evaluation, deepest path %u -> %u",
+             report.conditions_moved, report.observed_tests_before, report.observed_tests_after,
+             report.observed_depth_before, report.observed_depth_after);
+    return state;
+}
+
+static size_t run_reordered(void *arg) {
+    TreeState *state = arg;
+    set_cascade_input(state->env, state->shape, &state->rng);
+
+    reasons_value_t result = tree_evaluate(state->tree, state->env, NULL, NULL);
+    bench_consume(result.type);
+    reasons_value_free(&result);
+    return 1;
+}
+
+/* ======== CONTAINERS AND ALLOCATORS ======== */
+
+static void* micro_setup(const void *param) {
+    (void)param;
+    MicroState *state = mem_alloc(sizeof(MicroState));
+    if (!state) return NULL;
+    memset(state, 0, sizeof(MicroState));
+
+    state->table = hashtable_create(16, NULL);
+    state->vector = vector_create(sizeof(uint64_t));
+    state->arena = arena_create(0, "bench");
+    state->pool = pool_create(64, BENCH_MICRO_COUNT, "bench");
+    return state;
+}
+
+static void micro_teardown(void *arg) {
+    MicroState *state = arg;
+    hashtable_destroy(state->table);
+    vector_destroy(state->vector);
+    arena_reset(state->arena);      // Arenas and pools live until memory_shutdown
+    mem_free(state);
+}
+
+// Inserts into a table that starts small, so growth is included, then reads back
+static size_t run_hash(void *arg) {
+    MicroState *state = arg;
+    hashtable_clear(state->table);
+    for (uint64_t key = 0; key < BENCH_MICRO_COUNT; key++) {
+        hashtable_set(state->table, &key, sizeof(key), &key, sizeof(key));
+    }
+    size_t found = 0;
+    for (uint64_t key = 0; key < BENCH_MICRO_COUNT; key++) {
+        found += hashtable_get(state->table, &key, sizeof(key)) != NULL;
+    }
+    bench_consume(found);
+    return 2 * BENCH_MICRO_COUNT;
+}
+
+static size_t run_vector(void *arg) {
+    MicroState *state = arg;
+    vector_clear(state->vector);
+    for (uint64_t value = 0; value < BENCH_MICRO_COUNT; value++) {
+        vector_append(state->vector, &value);
+    }
+    uint64_t sum = 0;
+    for (size_t i = 0; i < vector_size(state->vector); i++) {
+        sum += *(uint64_t*)vector_at(state->vector, i);
+    }
+    bench_consume((size_t)sum);
+    return BENCH_MICRO_COUNT;
+}
+
+static size_t run_heap(void *arg) {
+    MicroState *state = arg;
+    for (size_t i = 0; i < BENCH_MICRO_COUNT; i++) {
+        state->blocks[i] = mem_alloc(16 + (i * 37) % 496);
+    }
+    for (size_t i = 0; i < BENCH_MICRO_COUNT; i++) {
+        mem_free(state->blocks[i]);
+    }
+    return BENCH_MICRO_COUNT;
+}
+
+static size_t run_arena(void *arg) {
+    MicroState *state = arg;
+    for (size_t i = 0; i < BENCH_MICRO_COUNT; i++) {
+        state->blocks[i] = arena_alloc(state->arena, 16 + (i * 37) % 496, __FILE__, __LINE__);
+    }
+    bench_consume((size_t)state->blocks[BENCH_MICRO_COUNT - 1]);
+    arena_reset(state->arena);
+    return BENCH_MICRO_COUNT;
+}
+
+static size_t run_pool(void *arg) {
+    MicroState *state = arg;
+    for (size_t i = 0; i < BENCH_MICRO_COUNT; i++) {
+        state->blocks[i] = pool_alloc(state->pool, __FILE__, __LINE__);
+    }
+    for (size_t i = 0; i < BENCH_MICRO_COUNT; i++) {
+        pool_free(state->pool, state->blocks[i]);
+    }
+    return BENCH_MICRO_COUNT;
+}
+
+/* ======== DATA FORMATS: CSV AND JSONL ======== */
+
+static void* csv_setup(const void *param) {
+    (void)param;
+    TableState *state = mem_alloc(sizeof(TableState));
+    if (!state) return NULL;
+    memset(state, 0, sizeof(TableState));
+
+    snprintf(state->path, sizeof(state->path), "/tmp/reasons-bench-XXXXXX");
+    int fd = mkstemp(state->path);
+    FILE *file = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!file) {
+        LOG_ERROR("Failed to create CSV input in /tmp");
+        if (fd >= 0) close(fd);
+        mem_free(state);
+        return NULL;
+    }
+
+    WorkloadOptions workload;
+    bench_workload(&workload);
+    bool ok = workload_write_dataset(file, &workload, BENCH_TABLE_ROWS, WORKLOAD_CSV);
+    fclose(file);
+    if (!ok) {
+        csv_teardown(state);
+        return NULL;
+    }
+    return state;
+}
+
+static void csv_teardown(void *arg) {
+    TableState *state = arg;
+    unlink(state->path);
+    mem_free(state);
+}
+
+static size_t run_csv(void *arg) {
+    TableState *state = arg;
+    CsvParser *parser = csv_parser_create(state->path, NULL);
+    if (!parser) return 0;
+
+    size_t rows = 0;
+    while (csv_parse_next_row(parser)) {
+        rows++;
+    }
+    csv_parser_free(parser);
+    return rows;
+}
+
+static void* json_setup(const void *param) {
+    (void)param;
+    TableState *state = mem_alloc(sizeof(TableState));
+    if (!state) return NULL;
+    memset(state, 0, sizeof(TableState));
+
+    FILE *stream = open_memstream(&state->text, &state->length);
+    if (!stream) {
+        mem_free(state);
+        return NULL;
+    }
+
+    WorkloadOptions workload;
+    bench_workload(&workload);
+    bool ok = workload_write_dataset(stream, &workload, BENCH_TABLE_ROWS, WORKLOAD_JSONL);
+    fclose(stream);
+    if (!ok) {
+        json_teardown(state);
+        return NULL;
+    }
+    return state;
+}
+
+static void json_teardown(void *arg) {
+    TableState *state = arg;
+    free(state->text);
+    mem_free(state);
+}
+
+// One json_parse per line, as a streaming JSONL reader would
+static size_t run_json(void *arg) {
+    TableState *state = arg;
+    size_t rows = 0;
+    const char *line = state->text;
+    const char *end = state->text + state->length;
+    while (line < end) {
+        const char *newline = memchr(line, '\n', (size_t)(end - line));
+        size_t length = newline ? (size_t)(newline - line) : (size_t)(end - line);
+        JsonValue *value = json_parse(line, length, NULL);
+        rows += value != NULL;
+        json_value_free(value);
+        line += length + 1;
+    }
+    return rows;
+}
+
+/* ======== SUITE ======== */
+
+static const ProgramParam shape_d4_w1 = {4, 1, false, false};
+static const ProgramParam shape_d8_w1 = {8, 1, false, false};
+static const ProgramParam shape_d12_w1 = {12, 1, false, false};
+static const ProgramParam shape_d4_w16 = {4, 16, false, false};
+static const ProgramParam shape_d8_w16 = {8, 16, false, false};
+static const ProgramParam shape_d12_w16 = {12, 16, false, false};
+static const ProgramParam shape_trace_off = {8, 16, false, false};
+static const ProgramParam shape_trace_on = {8, 16, true, false};
+static const ProgramParam shape_explain = {8, 16, true, false};
+static const ProgramParam shape_tree_d4 = {4, 1, false, false};
+static const ProgramParam shape_tree_d8 = {8, 1, false, false};
+static const ProgramParam shape_tree_d16 = {16, 1, false, false};
+static const CascadeShape cascade_all = BENCH_CASCADE_ALL;
+static const CascadeShape cascade_any = BENCH_CASCADE_ANY;
+static const CascadeShape cascade_exclusive = BENCH_CASCADE_EXCLUSIVE;
+
+static const BenchCase suite[] = {
+    {"lexer/tokens", "tokens", source_setup, run_lexer, source_teardown, NULL},
+    {"parser/parse", "bytes", source_setup, run_parser, source_teardown, NULL},
+    {"eval_tree/depth=4/width=1", "decisions", program_setup, run_eval_tree, program_teardown, &shape_d4_w1},
+    {"eval_tree/depth=8/width=1", "decisions", program_setup, run_eval_tree, program_teardown, &shape_d8_w1},
+    {"eval_tree/depth=12/width=1", "decisions", program_setup, run_eval_tree, program_teardown, &shape_d12_w1},
+    {"eval_tree/depth=4/width=16", "decisions", program_setup, run_eval_tree, program_teardown, &shape_d4_w16},
+    {"eval_tree/depth=8/width=16", "decisions", program_setup, run_eval_tree, program_teardown, &shape_d8_w16},
+    {"eval_tree/depth=12/width=16", "decisions", program_setup, run_eval_tree, program_teardown, &shape_d12_w16},
+    {"tree_evaluate/depth=4", "evals", tree_setup, run_tree_evaluate, tree_teardown, &shape_tree_d4},
+    {"tree_evaluate/depth=8", "evals", tree_setup, run_tree_evaluate, tree_teardown, &shape_tree_d8},
+    {"tree_evaluate/depth=16", "evals", tree_setup, run_tree_evaluate, tree_teardown, &shape_tree_d16},
+    {"tree_reorder/all", "evals", reorder_setup, run_reordered, tree_teardown, &cascade_all},
+    {"tree_reorder/any", "evals", reorder_setup, run_reordered, tree_teardown, &cascade_any},
+    {"tree_reorder/exclusive", "evals", reorder_setup, run_reordered, tree_teardown, &cascade_exclusive},
+    {"trace/off", "decisions", program_setup, run_eval_tree, program_teardown, &shape_trace_off},
+    {"trace/on", "decisions", program_setup, run_eval_tree, program_teardown, &shape_trace_on},
+    {"explain/generate", "decisions", explain_setup, run_explain, program_teardown, &shape_explain},
+    {"ast/validate", "nodes", compact_setup, run_validate, program_teardown, &shape_d12_w16},
+    {"ast_compact/validate", "nodes", compact_setup, run_compact_validate, program_teardown, &shape_d12_w16},
+    {"hash/set+get", "ops", micro_setup, run_hash, micro_teardown, NULL},
+    {"vector/append+read", "ops", micro_setup, run_vector, micro_teardown, NULL},
+    {"memory/heap", "allocs", micro_setup, run_heap, micro_teardown, NULL},
+    {"memory/arena", "allocs", micro_setup, run_arena, micro_teardown, NULL},
+    {"memory/pool", "allocs", micro_setup, run_pool, micro_teardown, NULL},
+    {"csv/parse", "rows", csv_setup, run_csv, csv_teardown, NULL},
+    {"jsonl/parse", "rows", json_setup, run_json, json_teardown, NULL},
+};
+
+#define SUITE_SIZE (sizeof(suite) / sizeof(suite[0]))
+
+/* ======== PUBLIC API IMPLEMENTATION ======== */
+
+int cli_bench(int argc, char **argv) {
+    // Default options
+    BenchOptions options;
+    bench_options_default(&options);
+    BenchCompareOptions compare_options;
+    bench_compare_options_default(&compare_options);
+    const char *filter = NULL;
+    const char *json_file = NULL;
+    const char *baseline_file = NULL;
+    bool list_benchmarks = false;
+    bool quiet = false;
+
+    static struct option long_options[] = {
+        {"filter", required_argument, 0, 'f'},
+        {"warmup", required_argument, 0, 'w'},
+        {"repetitions", required_argument, 0, 'r'},
+        {"min-time", required_argument, 0, 't'},
+        {"json", required_argument, 0, 'o'},
+        {"compare", required_argument, 0, 'c'},
+        {"threshold", required_argument, 0, 'T'},
+        {"alpha", required_argument, 0, 'a'},
+        {"list", no_argument, 0, 'l'},
+        {"quiet", no_argument, 0, 'q'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "f:w:r:t:o:c:T:a:lqh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'f':
+                filter = optarg;
+                break;
+            case 'w':
+                options.warmup = (unsigned)atoi(optarg);
+                break;
+            case 'r':
+                options.repetitions = (unsigned)atoi(optarg);
+                if (options.repetitions < 1) options.repetitions = 1;
+                break;
+            case 't':
+                options.min_sample_time = atof(optarg) / 1000.0;
+                if (options.min_sample_time < 0) options.min_sample_time = 0;
+                break;
+            case 'o':
+                json_file = optarg;
+                break;
+            case 'c':
+                baseline_file = optarg;
+                break;
+            case 'T':
+                compare_options.threshold = atof(optarg) / 100.0;
+                if (compare_options.threshold < 0) compare_options.threshold = 0;
+                break;
+            case 'a':
+                compare_options.alpha = atof(optarg);
+                if (compare_options.alpha <= 0 || compare_options.alpha >= 1) {
+                    LOG_ERROR("Significance level must be between 0 and 1: %s", optarg);
+                    return BENCH_EXIT_ERROR;
+                }
+                break;
+            case 'l':
+                list_benchmarks = true;
+                break;
+            case 'q':
+                quiet = true;
+                break;
+            case 'h':
+                print_help();
+                return EXIT_SUCCESS;
+            case '?':
+                print_help();
+                return baseline_file ? BENCH_EXIT_ERROR : EXIT_FAILURE;
+        }
+    }
+
+    if (list_benchmarks) {
+        for (size_t i = 0; i < SUITE_SIZE; i++) {
+            if (!filter || strstr(suite[i].name, filter)) printf("%s\n", suite[i].name);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // A candidate file compares two earlier runs without running anything
+    const char *candidate_file = optind < argc ? argv[optind] : NULL;
+    if (candidate_file && !baseline_file) {
+        LOG_ERROR("A candidate results file needs --compare <baseline>");
+        print_help();
+        return EXIT_FAILURE;
+    }
+    int error_status = baseline_file ? BENCH_EXIT_ERROR : EXIT_FAILURE;
+
+    BenchResult *baseline = NULL;
+    size_t baseline_count = 0;
+    if (baseline_file && !load_results(baseline_file, &baseline, &baseline_count)) {
+        return BENCH_EXIT_ERROR;
+    }
+
+    // The tables go to stderr when the JSON takes stdout
+    bool json_stdout = json_file && strcmp(json_file, "-") == 0;
+    FILE *progress = json_stdout ? stderr : stdout;
+
+    BenchResult *results = NULL;
+    size_t count = 0;
+    int status = EXIT_SUCCESS;
+    if (candidate_file) {
+        if (!load_results(candidate_file, &results, &count)) {
+            free_results(baseline, baseline_count);
+            return BENCH_EXIT_ERROR;
+        }
+    } else if (!run_suite(filter, &options, quiet || baseline_file, progress, &results, &count)) {
+        status = error_status;
+    }
+
+    if (json_file && !candidate_file) {
+        FILE *output = json_stdout ? stdout : fopen(json_file, "w");
+        if (!output) {
+            LOG_ERROR("Cannot open %s for writing", json_file);
+            status = error_status;
+        } else {
+            if (!bench_write_json(output, results, count, &options)) {
+                LOG_ERROR("Failed to write benchmark results");
+                status = error_status;
+            }
+            if (!json_stdout) fclose(output);
+        }
+    }
+
+    if (baseline_file && status == EXIT_SUCCESS) {
+        status = compare_results(baseline, baseline_count, results, count,
+                                 &compare_options, progress);
+    }
+
+    // Cleanup
+    free_results(results, count);
+    free_results(baseline, baseline_count);
+
+    return status;
+}
+
+/* ======== SUITE RUNNER AND RESULT FILES ======== */
+
+static bool run_suite(const char *filter, const BenchOptions *options, bool quiet,
+                      FILE *progress, BenchResult **results, size_t *count) {
+    // Allocator bookkeeping would otherwise dominate the numbers
+    memory_set_guard_pages(false);
+    memory_set_tracking(false);
+
+    *count = 0;
+    *results = mem_alloc(SUITE_SIZE * sizeof(BenchResult));
+    if (!*results) {
+        LOG_ERROR("Out of memory");
+        return false;
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < SUITE_SIZE; i++) {
+        if (filter && !strstr(suite[i].name, filter)) continue;
+
+        if (!quiet) {
+            fprintf(progress, "running %s...\r", suite[i].name);
+            fflush(progress);
+        }
+        if (!bench_run(&suite[i], options, &(*results)[*count])) {
+            LOG_ERROR("Benchmark %s failed to set up", suite[i].name);
+            ok = false;
+            continue;
+        }
+        (*count)++;
+    }
+
+    if (!quiet) {
+        fprintf(progress, "%-60s\r", "");
+        bench_print_table(progress, *results, *count);
+    }
+    return ok;
+}
+
+static double json_number(const JsonValue *value) {
+    if (!value) return 0;
+    if (value->type == JSON_NUMBER) return value->number_value;
+    if (value->type == JSON_INTEGER) return (double)value->integer_value;
+    return 0;
+}
+
+// Reads a file written by --json; only names and samples are needed
+static bool load_results(const char *path, BenchResult **results, size_t *count) {
+    *results = NULL;
+    *count = 0;
+
+    Error *error = NULL;
+    JsonValue *root = json_parse_file(path, &error);
+    if (!root) {
+        LOG_ERROR("Failed to parse benchmark results: %s", path);
+        if (error) error_free(error);
+        return false;
+    }
+
+    JsonValue *benchmarks = root->type == JSON_OBJECT ?
+        json_object_get(root->object_value, "benchmarks") : NULL;
+    const char *format = root->type == JSON_OBJECT ?
+        json_object_get_string(root->object_value, "format") : NULL;
+    if (!benchmarks || benchmarks->type != JSON_ARRAY ||
+        !format || strcmp(format, "reasons-bench") != 0) {
+        LOG_ERROR("Not a reasons bench results file: %s", path);
+        json_value_free(root);
+        return false;
+    }
+
+    size_t total = json_array_size(benchmarks->array_value);
+    *results = mem_alloc((total ? total : 1) * sizeof(BenchResult));
+    if (!*results) {
+        json_value_free(root);
+        return false;
+    }
+
+    for (size_t i = 0; i < total; i++) {
+        JsonValue *entry = json_array_get(benchmarks->array_value, i);
+        if (!entry || entry->type != JSON_OBJECT) continue;
+
+        const char *name = json_object_get_string(entry->object_value, "name");
+        JsonValue *samples = json_object_get(entry->object_value, "samples");
+        if (!name || !samples || samples->type != JSON_ARRAY ||
+            json_array_size(samples->array_value) == 0) {
+            LOG_WARN("Skipping benchmark without samples in %s", path);
+            continue;
+        }
+
+        BenchResult *result = &(*results)[*count];
+        memset(result, 0, sizeof(BenchResult));
+        result->name = string_dup(name);
+        result->sample_count = json_array_size(samples->array_value);
+        result->samples = mem_alloc(result->sample_count * sizeof(double));
+        if (!result->name || !result->samples) {
+            bench_result_free(result);
+            continue;
+        }
+        for (size_t s = 0; s < result->sample_count; s++) {
+            result->samples[s] = json_number(json_array_get(samples->array_value, s));
+        }
+        result->batch = (size_t)json_number(json_object_get(entry->object_value, "batch"));
+        result->items = (size_t)json_number(json_object_get(entry->object_value, "items"));
+        bench_summarize(result);
+        (*count)++;
+    }
+
+    json_value_free(root);
+    return true;
+}
+
+static const BenchResult* find_result(const BenchResult *results, size_t count, const char *name) {
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(results[i].name, name) == 0) return &results[i];
+    }
+    return NULL;
+}
+
+static int compare_results(const BenchResult *baseline, size_t baseline_count,
+                           const BenchResult *candidate, size_t candidate_count,
+                           const BenchCompareOptions *options, FILE *output) {
+    BenchComparison *comparisons = mem_alloc((candidate_count ? candidate_count : 1) *
+                                             sizeof(BenchComparison));
+    if (!comparisons) {
+        LOG_ERROR("Out of memory");
+        return BENCH_EXIT_ERROR;
+    }
+
+    size_t count = 0;
+    bool regressed = false;
+    for (size_t i = 0; i < candidate_count; i++) {
+        const BenchResult *base = find_result(baseline, baseline_count, candidate[i].name);
+        if (!base) {
+            fprintf(output, "new: %s (no baseline)\n", candidate[i].name);
+            continue;
+        }
+        if (bench_compare(base, &candidate[i], options, &comparisons[count])) {
+            if (comparisons[count].verdict == BENCH_REGRESSED) regressed = true;
+            count++;
+        }
+    }
+    for (size_t i = 0; i < baseline_count; i++) {
+        if (!find_result(candidate, candidate_count, baseline[i].name)) {
+            fprintf(output, "missing: %s (not in candidate)\n", baseline[i].name);
+        }
+    }
+
+    bench_print_comparison(output, comparisons, count, options);
+    mem_free(comparisons);
+    return regressed ? BENCH_EXIT_REGRESSED : EXIT_SUCCESS;
+}
+
+static void free_results(BenchResult *results, size_t count) {
+    if (!results) return;
+    for (size_t i = 0; i < count; i++) {
+        bench_result_free(&results[i]);
+    }
+    mem_free(results);
+}
+
+static void print_help() {
+    printf("Usage: reasons bench [options]\n");
+    printf("       reasons bench --compare <baseline.json> [candidate.json]\n");
+    printf("Run the Reasons DSL benchmark suite, or compare results with a baseline.\n\n");
+    printf("Options:\n");
+    printf("  -f, --filter <text>     Only run benchmarks whose name contains text\n");
+    printf("  -w, --warmup <n>        Discarded samples per benchmark (default: 3)\n");
+    printf("  -r, --repetitions <n>   Recorded samples per benchmark (default: 15)\n");
+    printf("  -t, --min-time <ms>     Minimum duration of a sample (default: 10)\n");
+    printf("  -o, --json <file>       Write results with all samples as JSON ('-': stdout)\n");
+    printf("  -l, --list              List benchmarks without running them\n");
+    printf("  -q, --quiet             Do not print the results table\n");
+    printf("  -h, --help              Show this help message\n\n");
+    printf("Comparison:\n");
+    printf("  -c, --compare <file>    Compare with a baseline written by --json; without\n");
+    printf("                          a candidate file the suite runs as the candidate\n");
+    printf("  -T, --threshold <pct>   Smallest slowdown that counts (default: 5)\n");
+    printf("  -a, --alpha <p>         Significance level of the Mann-Whitney test and\n");
+    printf("                          1 - confidence of the intervals (default: 0.01)\n\n");
+    printf("A benchmark regresses when its samples are significantly slower and the\n");
+    printf("estimated slowdown exceeds the threshold. Comparisons exit with 0 when\n");
+    printf("nothing regressed, 1 when something did and 2 on errors.\n");
+}
@@ -3,7 +3,10 @@
  *
  * Features:
  * - Compiles one or more Reasons source files
+ * - Parses and validates sources in parallel on a worker pool (--jobs)
+ *   and links them in a deterministic order
  * - Outputs executable or intermediate representation
+ * - Writes precompiled modules (.rsc) that load without parsing
  * - Dependency resolution
  * - Optimization levels
  * - Cross-compilation support
@@ -13,6 +16,10 @@
 
 #include "reasons/cli.h"
 #include "reasons/compiler.h"
+#include "reasons/lexer.h"
+#include "reasons/parser.h"
+#include "reasons/ast.h"
+#include "reasons/module.h"
 #include "utils/error.h"
 #include "utils/logger.h"
 #include "utils/memory.h"
@@ -21,17 +28,40 @@
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
 /* ======== CONSTANTS ======== */
 
 #define DEFAULT_OUTPUT "a.out"
 
+/* ======== STRUCTURE DEFINITIONS ======== */
+
+typedef struct {
+    const char *path;
+    ast_node_t *program;        // Parsed and validated program, NULL on failure
+    double parse_ms;            // Read + lex + parse + validate time
+} ParseResult;
+
+typedef struct {
+    ParseResult *results;
+    size_t count;
+    size_t next;                // Next file to claim (atomic)
+} ParseQueue;
+
 /* ======== FUNCTION PROTOTYPES ======== */
 
 static void print_help();
+static double now_ms(void);
 static bool is_directory(const char *path);
 static bool ensure_output_directory(const char *path);
+static void add_directory_sources(vector_t *source_files, const char *dir);
+static ParseResult* parse_sources(vector_t *source_files, int jobs, double *wall_ms);
+static ast_node_t* link_programs(ParseResult *results, size_t count);
+static void report_parse_times(const ParseResult *results, size_t count, int jobs,
+                               double wall_ms);
 
 /* ======== PUBLIC API IMPLEMENTATION ======== */
 
@@ -48,6 +78,8 @@ int cli_compile(int argc, char **argv) {
     bool warnings_as_errors = false;
     bool build_deps = true;
     const char *target_arch = NULL;
+    int jobs = 0;
+    bool report_times = false;
     vector_t *source_files = vector_create(8);
     vector_t *include_dirs = vector_create(4);
     vector_t *define_list = vector_create(4);
@@ -61,12 +93,13 @@ int cli_compile(int argc, char **argv) {
         {"define", required_argument, 0, 'D'},
         {"target", required_argument, 0, 't'},
         {"no-deps", no_argument, 0, 'n'},
+        {"jobs", required_argument, 0, 'j'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "o:O::gWI:D:t:nh", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "o:O::gWI:D:t:nj:h", long_options, NULL)) != -1) {
         switch (opt) {
             case 'o':
                 output_file = optarg;
@@ -96,6 +129,10 @@ int cli_compile(int argc, char **argv) {
             case 'n':
                 build_deps = false;
                 break;
+            case 'j':
+                jobs = atoi(optarg);
+                report_times = true;
+                break;
             case 'h':
                 print_help();
                 return EXIT_SUCCESS;
@@ -108,15 +145,7 @@ int cli_compile(int argc, char **argv) {
     // Collect source files
     for (int i = optind; i < argc; i++) {
         if (is_directory(argv[i])) {
-            // Recursively add all .reasons files in directory
-            vector_t *files = file_list_directory(argv[i], true);
-            for (size_t j = 0; j < vector_size(files); j++) {
-                const char *path = vector_at(files, j);
-                if (strstr(path, ".reasons")) {
-                    vector_append(source_files, string_dup(path));
-                }
-            }
-            vector_destroy_deep(files, mem_free);
+            add_directory_sources(source_files, argv[i]);
         } else {
             vector_append(source_files, string_dup(argv[i]));
         }
@@ -134,6 +163,49 @@ int cli_compile(int argc, char **argv) {
         return EXIT_FAILURE;
     }
 
+    if (jobs <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = cpus > 0 ? (int)cpus : 1;
+    }
+
+    // Parse and validate every source up front, then link them in order
+    size_t file_count = vector_size(source_files);
+    double wall_ms = 0.0;
+    ParseResult *parsed = parse_sources(source_files, jobs, &wall_ms);
+    if (!parsed) {
+        LOG_ERROR("Failed to allocate parse results");
+        return EXIT_FAILURE;
+    }
+
+    if (report_times) {
+        report_parse_times(parsed, file_count, jobs, wall_ms);
+    }
+
+    ast_node_t *program = link_programs(parsed, file_count);
+    mem_free(parsed);
+    if (!program) {
+        return EXIT_FAILURE;
+    }
+
+    // A .rsc output is the parsed program itself, ready to be mapped by
+    // `reasons run`
+    if (module_is_module_path(output_file)) {
+        double start = now_ms();
+        bool written = module_write_program(output_file, program);
+        if (written) {
+            LOG_INFO("Wrote module %s in %.2f ms", output_file, now_ms() - start);
+        } else {
+            LOG_ERROR("Failed to write module %s", output_file);
+        }
+        
+        ast_destroy(program);
+        vector_destroy_deep(source_files, mem_free);
+        vector_destroy_deep(include_dirs, mem_free);
+        vector_destroy_deep(define_list, mem_free);
+        if (target_arch) mem_free((void*)target_arch);
+        return written ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     // Initialize compiler
     CompilerOptions options = {
         .output_file = output_file,
@@ -144,7 +216,8 @@ int cli_compile(int argc, char **argv) {
         .target_arch = target_arch,
         .source_files = source_files,
         .include_dirs = include_dirs,
-        .definitions = define_list
+        .definitions = define_list,
+        .program = program
     };
 
     CompilerResult result = compile(&options);
@@ -157,6 +230,7 @@ int cli_compile(int argc, char **argv) {
     }
 
     // Cleanup
+    ast_destroy(program);
     for (size_t i = 0; i < vector_size(source_files); i++) {
         mem_free(vector_at(source_files, i));
     }
@@ -179,7 +253,8 @@ int cli_compile(int argc, char **argv) {
 
 static void print_help() {
     printf("Usage: reasons compile [options] <source files or directories>\n");
-    printf("Compile Reasons DSL source files into an executable.\n\n");
+    printf("Compile Reasons DSL source files into an executable, or into a\n");
+    printf("precompiled module when the output ends in %s.\n\n", MODULE_EXTENSION);
     printf("Options:\n");
     printf("  -o, --output <file>      Place the output into <file> (default: a.out)\n");
     printf("  -O, --optimize[=level]   Set optimization level (0-3, default: 2)\n");
@@ -189,6 +264,8 @@ static void print_help() {
     printf("  -D, --define <macro>     Define preprocessor macro\n");
     printf("  -t, --target <arch>      Set target architecture\n");
     printf("  -n, --no-deps            Skip dependency building\n");
+    printf("  -j, --jobs <n>           Parse on n threads and report parse times\n");
+    printf("                           (default: one per CPU)\n");
     printf("  -h, --help               Show this help message\n");
 }
 
@@ -210,3 +287,189 @@ static bool ensure_output_directory(const char *path) {
     mem_free(dir);
     return true; // No directory component
 }
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static void add_directory_sources(vector_t *source_files, const char *dir) {
+    // Recursively add all .reasons files in directory, sorted so the link
+    // order does not depend on the order readdir happens to return
+    vector_t *files = file_list_directory(dir, true);
+    size_t count = vector_size(files);
+    const char **paths = mem_alloc((count ? count : 1) * sizeof(char*));
+    size_t matched = 0;
+    
+    for (size_t j = 0; j < count; j++) {
+        const char *path = vector_at(files, j);
+        if (strstr(path, ".reasons")) {
+            paths[matched++] = path;
+        }
+    }
+    qsort(paths, matched, sizeof(char*), compare_paths);
+    
+    for (size_t j = 0; j < matched; j++) {
+        vector_append(source_files, string_dup(paths[j]));
+    }
+    
+    mem_free(paths);
+    vector_destroy_deep(files, mem_free);
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static char* read_source(const char *path) {
+    // Read directly rather than through file_read_all: its file cache is
+    // shared state and workers read concurrently
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    if (size < 0) {
+        fclose(file);
+        return NULL;
+    }
+    
+    char *source = mem_alloc((size_t)size + 1);
+    if (source && fread(source, 1, (size_t)size, file) != (size_t)size) {
+        mem_free(source);
+        source = NULL;
+    }
+    fclose(file);
+    
+    if (source) source[size] = '\0';
+    return source;
+}
+
+static void parse_file(ParseResult *result) {
+    double start = now_ms();
+    
+    // Each file gets its own lexer and parser; the AST keeps copies of the
+    // token text, so both (and the source) go away once it is built
+    char *source = read_source(result->path);
+    if (!source) {
+        LOG_ERROR("Cannot read %s", result->path);
+        result->parse_ms = now_ms() - start;
+        return;
+    }
+    
+    lexer_t *lexer = lexer_create(source);
+    parser_t *parser = lexer ? parser_create(lexer) : NULL;
+    ast_node_t *program = parser ? parser_parse(parser) : NULL;
+    
+    if (!program) {
+        LOG_ERROR("%s: parse failed", result->path);
+    } else if (!ast_validate(program)) {
+        LOG_ERROR("%s: invalid program", result->path);
+        ast_destroy(program);
+        program = NULL;
+    }
+    
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+    mem_free(source);
+    
+    result->program = program;
+    result->parse_ms = now_ms() - start;
+}
+
+static void* parse_worker(void *arg) {
+    ParseQueue *queue = arg;
+    
+    // Claim files one at a time so a few large files don't leave the
+    // other workers idle
+    for (;;) {
+        size_t index = __atomic_fetch_add(&queue->next, 1, __ATOMIC_RELAXED);
+        if (index >= queue->count) break;
+        parse_file(&queue->results[index]);
+    }
+    return NULL;
+}
+
+static ParseResult* parse_sources(vector_t *source_files, int jobs, double *wall_ms) {
+    size_t count = vector_size(source_files);
+    ParseResult *results = mem_alloc((count ? count : 1) * sizeof(ParseResult));
+    if (!results) return NULL;
+    memset(results, 0, (count ? count : 1) * sizeof(ParseResult));
+    
+    for (size_t i = 0; i < count; i++) {
+        results[i].path = vector_at(source_files, i);
+    }
+    
+    ParseQueue queue = { .results = results, .count = count, .next = 0 };
+    size_t workers = (size_t)jobs < count ? (size_t)jobs : count;
+    pthread_t *threads = workers > 1 ? mem_alloc((workers - 1) * sizeof(pthread_t)) : NULL;
+    size_t started = 0;
+    
+    double start = now_ms();
+    
+    // The calling thread is worker 0; it also covers for threads that
+    // could not be started
+    if (threads) {
+        while (started < workers - 1 &&
+               pthread_create(&threads[started], NULL, parse_worker, &queue) == 0) {
+            started++;
+        }
+    }
+    parse_worker(&queue);
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    *wall_ms = now_ms() - start;
+    if (threads) mem_free(threads);
+    
+    LOG_DEBUG("Parsed %zu files on %zu threads in %.1f ms", count, started + 1, *wall_ms);
+    return results;
+}
+
+static ast_node_t* link_programs(ParseResult *results, size_t count) {
+    // Link in source order whatever order the workers finished in; on any
+    // failure every parsed program is released
+    size_t failures = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!results[i].program) failures++;
+    }
+    
+    ast_node_t *program = failures == 0 ? ast_create_node(AST_PROGRAM) : NULL;
+    
+    for (size_t i = 0; i < count; i++) {
+        ast_node_t *unit = results[i].program;
+        if (!unit) continue;
+        
+        ast_node_t *child;
+        while (program && (child = ast_get_child(unit, 0)) != NULL) {
+            ast_remove_child(unit, child);
+            ast_add_child(program, child);
+        }
+        ast_destroy(unit);
+        results[i].program = NULL;
+    }
+    
+    if (failures > 0) {
+        LOG_ERROR("%zu of %zu files failed to parse", failures, count);
+    }
+    return program;
+}
+
+static void report_parse_times(const ParseResult *results, size_t count, int jobs,
+                               double wall_ms) {
+    double total_ms = 0.0;
+    
+    printf("%10s  %s\n", "parse ms", "file");
+    for (size_t i = 0; i < count; i++) {
+        printf("%10.2f  %s%s\n", results[i].parse_ms, results[i].path,
+               results[i].program ? "" : "  (failed)");
+        total_ms += results[i].parse_ms;
+    }
+    
+    // Speedup relative to parsing the same files one after another
+    printf("\n%zu files, %d jobs: %.2f ms wall, %.2f ms summed, speedup %.2fx\n",
+           count, jobs, wall_ms, total_ms, wall_ms > 0.0 ? total_ms / wall_ms : 1.0);
+}
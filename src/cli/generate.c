@@ -0,0 +1,201 @@
+/*
+ * generate.c - Workload generator CLI for Reasons DSL
+ *
+ * Features:
+ * - Seeded .reasons programs of configurable size and shape
+ * - Matching CSV or JSONL input datasets
+ * - Input skew to control branch predictability
+ */
+
+#include "reasons/cli.h"
+#include "reasons/workload.h"
+#include "utils/error.h"
+#include "utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+/* ======== FUNCTION PROTOTYPES ======== */
+
+static void print_help();
+static bool parse_unsigned(const char *text, unsigned *value);
+static bool write_output(const char *path, const WorkloadOptions *options, bool dataset,
+                         size_t rows, WorkloadFormat format);
+
+/* ======== PUBLIC API IMPLEMENTATION ======== */
+
+int cli_generate(int argc, char **argv) {
+    // Default options
+    WorkloadOptions options;
+    workload_options_default(&options);
+    const char *program_file = NULL;
+    const char *data_file = NULL;
+    const char *format_name = NULL;
+    size_t rows = 10000;
+
+    static struct option long_options[] = {
+        {"seed", required_argument, 0, 's'},
+        {"rules", required_argument, 0, 'n'},
+        {"depth", required_argument, 0, 'd'},
+        {"fanout", required_argument, 0, 'F'},
+        {"variables", required_argument, 0, 'V'},
+        {"categorical", required_argument, 0, 'c'},
+        {"categories", required_argument, 0, 'k'},
+        {"terms", required_argument, 0, 'T'},
+        {"skew", required_argument, 0, 'S'},
+        {"output", required_argument, 0, 'o'},
+        {"data", required_argument, 0, 'D'},
+        {"rows", required_argument, 0, 'r'},
+        {"format", required_argument, 0, 'f'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    bool ok = true;
+    while ((opt = getopt_long(argc, argv, "s:n:d:F:V:c:k:T:S:o:D:r:f:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                options.seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'n':
+                ok = parse_unsigned(optarg, &options.rules);
+                break;
+            case 'd':
+                ok = parse_unsigned(optarg, &options.depth);
+                break;
+            case 'F':
+                ok = parse_unsigned(optarg, &options.fanout);
+                break;
+            case 'V':
+                ok = parse_unsigned(optarg, &options.variables);
+                break;
+            case 'c':
+                options.categorical = atof(optarg);
+                ok = options.categorical >= 0 && options.categorical <= 1;
+                break;
+            case 'k':
+                ok = parse_unsigned(optarg, &options.categories);
+                break;
+            case 'T':
+                ok = parse_unsigned(optarg, &options.terms);
+                break;
+            case 'S':
+                options.skew = atof(optarg);
+                ok = options.skew >= 0 && options.skew < 1;
+                break;
+            case 'o':
+                program_file = optarg;
+                break;
+            case 'D':
+                data_file = optarg;
+                break;
+            case 'r':
+                rows = (size_t)strtoull(optarg, NULL, 10);
+                break;
+            case 'f':
+                format_name = optarg;
+                break;
+            case 'h':
+                print_help();
+                return EXIT_SUCCESS;
+            case '?':
+                print_help();
+                return EXIT_FAILURE;
+        }
+        if (!ok) {
+            LOG_ERROR("Invalid option value: %s", optarg);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!program_file && !data_file) {
+        program_file = "-";
+    }
+
+    // Dataset format: explicit, else from the extension, else CSV
+    WorkloadFormat format = WORKLOAD_CSV;
+    if (format_name) {
+        if (strcmp(format_name, "jsonl") == 0) {
+            format = WORKLOAD_JSONL;
+        } else if (strcmp(format_name, "csv") != 0) {
+            LOG_ERROR("Unknown dataset format: %s", format_name);
+            return EXIT_FAILURE;
+        }
+    } else if (data_file) {
+        const char *extension = strrchr(data_file, '.');
+        if (extension && (strcmp(extension, ".jsonl") == 0 || strcmp(extension, ".ndjson") == 0)) {
+            format = WORKLOAD_JSONL;
+        }
+    }
+
+    if (program_file && !write_output(program_file, &options, false, 0, format)) {
+        return EXIT_FAILURE;
+    }
+    if (data_file && !write_output(data_file, &options, true, rows, format)) {
+        return EXIT_FAILURE;
+    }
+
+    LOG_INFO("Generated %zu decisions over %u variables (seed %llu)",
+             workload_decision_count(&options), options.variables,
+             (unsigned long long)options.seed);
+    return EXIT_SUCCESS;
+}
+
+/* ======== PRIVATE HELPER FUNCTIONS ======== */
+
+static bool parse_unsigned(const char *text, unsigned *value) {
+    char *end;
+    unsigned long parsed = strtoul(text, &end, 10);
+    if (end == text || *end != '\0' || parsed > 0xFFFFFFFFul) {
+        return false;
+    }
+    *value = (unsigned)parsed;
+    return true;
+}
+
+static bool write_output(const char *path, const WorkloadOptions *options, bool dataset,
+                         size_t rows, WorkloadFormat format) {
+    bool to_stdout = strcmp(path, "-") == 0;
+    FILE *output = to_stdout ? stdout : fopen(path, "w");
+    if (!output) {
+        LOG_ERROR("Cannot open %s for writing", path);
+        return false;
+    }
+
+    bool ok = dataset ? workload_write_dataset(output, options, rows, format)
+                      : workload_write_program(output, options);
+    if (!to_stdout && fclose(output) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        Error *error = error_get();
+        LOG_ERROR("Failed to generate %s: %s", path,
+                  error && error->message ? error->message : "write error");
+    }
+    return ok;
+}
+
+static void print_help() {
+    printf("Usage: reasons generate [options]\n");
+    printf("Generate a reproducible .reasons program and a matching input dataset.\n\n");
+    printf("Program:\n");
+    printf("  -o, --output <file>       Write the program to file ('-': stdout, default\n");
+    printf("                            when no dataset is requested)\n");
+    printf("  -s, --seed <n>            Random seed (default: 1)\n");
+    printf("  -n, --rules <n>           Top-level rules (default: 100)\n");
+    printf("  -d, --depth <n>           Sub-rule nesting per rule (default: 1)\n");
+    printf("  -F, --fanout <n>          Statements per rule body (default: 4)\n");
+    printf("  -V, --variables <n>       Input variables (default: 8)\n");
+    printf("  -c, --categorical <f>     Fraction of categorical variables (default: 0.25)\n");
+    printf("  -k, --categories <n>      Values per categorical variable (default: 5)\n");
+    printf("  -T, --terms <n>           Most comparisons per condition (default: 2)\n\n");
+    printf("Dataset:\n");
+    printf("  -D, --data <file>         Write rows binding every variable to file\n");
+    printf("  -r, --rows <n>            Rows to write (default: 10000)\n");
+    printf("  -f, --format <csv|jsonl>  Dataset format (default: from extension, else csv)\n");
+    printf("  -S, --skew <f>            Input skew in [0, 1): 0 is uniform, higher values\n");
+    printf("                            send most rows down the same branch (default: 0)\n\n");
+    printf("  -h, --help                Show this help message\n");
+}
@@ -3,7 +3,7 @@
  *
  * Features:
  * - Command-line argument parsing
- * - Subcommand dispatch (compile, run, debug, test)
+ * - Subcommand dispatch (compile, run, debug, test, bench, generate)
  * - Help system
  * - Version information
  * - Error handling
@@ -42,6 +42,8 @@ static Command commands[] = {
     {"run", cli_run, "Execute a Reasons DSL script"},
     {"debug", cli_debug, "Debug Reasons DSL programs interactively"},
     {"test", cli_test, "Run Reasons DSL test suites"},
+    {"bench", cli_bench, "Run performance benchmarks"},
+    {"generate", cli_generate, "Generate synthetic programs and datasets"},
     {NULL, NULL, NULL}
 };
 
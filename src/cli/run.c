@@ -3,32 +3,120 @@
  *
  * Features:
  * - Executes Reasons DSL scripts
+ * - Executes precompiled modules (.rsc) without lexing or parsing
  * - Command-line argument passing
  * - Environment variable access
  * - Runtime flags
  * - Error handling
  * - Execution time reporting
- * - Memory limits
+ * - Memory limits and per-subsystem budgets
  * - Sandbox mode
+ * - Streaming batch mode: one evaluation per CSV/JSONL row, results as
+ *   JSONL, on a worker pool with bounded memory (--batch)
  */
 
 #include "reasons/cli.h"
 #include "reasons/runtime.h"
 #include "reasons/vm.h"
+#include "reasons/eval.h"
+#include "reasons/module.h"
+#include "reasons/import.h"
+#include "reasons/lexer.h"
+#include "reasons/parser.h"
+#include "reasons/io.h"
 #include "utils/error.h"
 #include "utils/logger.h"
 #include "utils/memory.h"
+#include "utils/string_utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <math.h>
 #include <getopt.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 
+#define BATCH_ROWS 256              // Rows handed to a worker at a time
+#define BATCH_SLOTS_PER_THREAD 2    // Batches in flight per worker; bounds memory
+#define BATCH_PROGRESS_INTERVAL 1.0 // Seconds between progress lines
+
+/* ======== STRUCTURE DEFINITIONS ======== */
+
+typedef enum {
+    BATCH_CSV,
+    BATCH_JSONL
+} BatchFormat;
+
+typedef struct {
+    const char *input;
+    const char *output;
+    BatchFormat format;
+    int threads;
+    bool ordered;
+    bool progress;
+} BatchOptions;
+
+typedef struct {
+    BatchFormat format;
+    CsvParser *csv;
+    FILE *file;                     // JSONL input
+    char **columns;                 // CSV header, bound as variable names
+    size_t column_count;
+} BatchReader;
+
+typedef enum {
+    SLOT_FREE,                      // Owned by the main thread, may be refilled
+    SLOT_FILLED,                    // Rows read, waiting for a worker
+    SLOT_CLAIMED,                   // Being evaluated
+    SLOT_DONE                       // Results ready to write
+} SlotState;
+
+typedef struct {
+    SlotState state;
+    size_t sequence;                // Order in which the batch was read
+    size_t first_row;               // 1-based number of its first row
+    size_t count;
+    char **rows;                    // CSV: count * column_count fields; JSONL: count lines
+    char *output;                   // One JSON line per row
+    size_t output_length;
+    size_t errors;
+} BatchSlot;
+
+typedef struct {
+    const BatchReader *reader;
+    BatchSlot *slots;
+    size_t slot_count;
+    size_t next_sequence;           // Given to the next filled batch
+    size_t next_claim;              // Lowest sequence no worker has claimed
+    bool closing;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t slot_done;
+} BatchQueue;
+
+typedef struct {
+    BatchQueue *queue;
+    ast_node_t *program;            // Own clone: evaluation updates rule counters
+    bool owns_program;
+    runtime_env_t *env;
+    eval_context_t *ctx;
+    import_scope_t *imports;
+    pthread_t thread;
+} BatchWorker;
+
 /* ======== FUNCTION PROTOTYPES ======== */
 
 static void print_help();
 static double get_time();
+static bool parse_size(const char *text, size_t *size);
+static void report_budgets();
+static void script_base_dir(const char *path, char *base_dir, size_t size);
+static ast_node_t* load_module_program(const char *path, bool allow_imports);
+static RuntimeResult execute_module(const RuntimeOptions *options);
+static int run_batch(const char *script_file, const BatchOptions *options);
 
 /* ======== PUBLIC API IMPLEMENTATION ======== */
 
@@ -44,19 +132,31 @@ int cli_run(int argc, char **argv) {
     bool sandbox = false;
     size_t memory_limit = 0; // 0 = unlimited
     const char *script_file = NULL;
-    vector_t *script_args = vector_create(8);
+    const char *format_name = NULL;
+    BatchOptions batch = {
+        .output = "-",
+        .threads = 1,
+        .ordered = true
+    };
 
     static struct option long_options[] = {
         {"time", no_argument, 0, 't'},
         {"debug", no_argument, 0, 'd'},
         {"sandbox", no_argument, 0, 's'},
         {"memory-limit", required_argument, 0, 'm'},
+        {"budget", required_argument, 0, 'b'},
+        {"batch", required_argument, 0, 'B'},
+        {"out", required_argument, 0, 'o'},
+        {"format", required_argument, 0, 'f'},
+        {"threads", required_argument, 0, 'j'},
+        {"unordered", no_argument, 0, 'u'},
+        {"progress", no_argument, 0, 'p'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "tdsm:h", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "tdsm:b:B:o:f:j:uph", long_options, NULL)) != -1) {
         switch (opt) {
             case 't':
                 show_time = true;
@@ -67,16 +167,53 @@ int cli_run(int argc, char **argv) {
             case 's':
                 sandbox = true;
                 break;
-            case 'm': {
-                char *end;
-                memory_limit = strtoul(optarg, &end, 10);
-                if (*end == 'M' || *end == 'm') {
-                    memory_limit *= 1024 * 1024;
-                } else if (*end == 'K' || *end == 'k') {
-                    memory_limit *= 1024;
+            case 'm':
+                if (!parse_size(optarg, &memory_limit)) {
+                    LOG_ERROR("Invalid memory limit: %s", optarg);
+                    return EXIT_FAILURE;
                 }
                 break;
+            case 'b': {
+                // <subsystem>=<size>, e.g. trace=16M
+                char name[32];
+                const char *eq = strchr(optarg, '=');
+                size_t budget;
+                MemTag tag;
+                if (!eq || (size_t)(eq - optarg) >= sizeof(name)) {
+                    LOG_ERROR("Invalid budget (expected <subsystem>=<size>): %s", optarg);
+                    return EXIT_FAILURE;
+                }
+                memcpy(name, optarg, eq - optarg);
+                name[eq - optarg] = '\0';
+                if (!memory_tag_from_name(name, &tag) || !parse_size(eq + 1, &budget)) {
+                    LOG_ERROR("Invalid budget: %s", optarg);
+                    return EXIT_FAILURE;
+                }
+                memory_set_budget(tag, budget);
+                break;
             }
+            case 'B':
+                batch.input = optarg;
+                break;
+            case 'o':
+                batch.output = optarg;
+                break;
+            case 'f':
+                format_name = optarg;
+                break;
+            case 'j':
+                batch.threads = atoi(optarg);
+                if (batch.threads < 0) {
+                    LOG_ERROR("Invalid thread count: %s", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'u':
+                batch.ordered = false;
+                break;
+            case 'p':
+                batch.progress = true;
+                break;
             case 'h':
                 print_help();
                 return EXIT_SUCCESS;
@@ -94,13 +231,38 @@ int cli_run(int argc, char **argv) {
     }
     script_file = argv[optind++];
 
+    // Input format: explicit, else from the extension, else CSV
+    batch.format = BATCH_CSV;
+    if (format_name) {
+        if (strcmp(format_name, "jsonl") == 0) {
+            batch.format = BATCH_JSONL;
+        } else if (strcmp(format_name, "csv") != 0) {
+            LOG_ERROR("Unknown batch format: %s", format_name);
+            return EXIT_FAILURE;
+        }
+    } else if (batch.input) {
+        const char *extension = strrchr(batch.input, '.');
+        if (extension && (strcmp(extension, ".jsonl") == 0 || strcmp(extension, ".ndjson") == 0)) {
+            batch.format = BATCH_JSONL;
+        }
+    }
+    if (batch.threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        batch.threads = cpus > 0 ? (int)cpus : 1;
+    }
+
     // Collect script arguments
+    vector_t *script_args = vector_create(8);
     for (int i = optind; i < argc; i++) {
         vector_append(script_args, string_dup(argv[i]));
     }
 
     // Set memory limit if specified
     if (memory_limit > 0) {
+        // Diagnostic subsystems get budgets carved out of the limit so they
+        // degrade before the hard limit below is hit
+        memory_set_limit(memory_limit);
+        
         struct rlimit limit;
         limit.rlim_cur = memory_limit;
         limit.rlim_max = memory_limit;
@@ -109,6 +271,20 @@ int cli_run(int argc, char **argv) {
         }
     }
 
+    if (batch.input) {
+        if (vector_size(script_args) > 0) {
+            LOG_WARN("Script arguments are ignored in batch mode");
+        }
+        for (size_t i = 0; i < vector_size(script_args); i++) {
+            mem_free(vector_at(script_args, i));
+        }
+        vector_destroy(script_args);
+
+        int status = run_batch(script_file, &batch);
+        report_budgets();
+        return status;
+    }
+
     // Execute script
     RuntimeOptions options = {
         .script_file = script_file,
@@ -118,15 +294,18 @@ int cli_run(int argc, char **argv) {
     };
 
     double start_time = get_time();
-    RuntimeResult result = execute_script(&options);
+    RuntimeResult result = module_is_module_path(script_file) ?
+        execute_module(&options) : execute_script(&options);
     double end_time = get_time();
 
     if (result.success) {
         if (show_time) {
             printf("Execution time: %.3f seconds\n", end_time - start_time);
         }
+        report_budgets();
         LOG_INFO("Script executed successfully");
     } else {
+        report_budgets();
         LOG_ERROR("Script execution failed: %s", result.error_message);
         if (result.line > 0) {
             LOG_ERROR("Error occurred at %s:%d", script_file, result.line);
@@ -143,14 +322,160 @@ int cli_run(int argc, char **argv) {
 }
 
 static void print_help() {
-    printf("Usage: reasons run [options] <script> [arguments]\n");
-    printf("Execute a Reasons DSL script.\n\n");
+    printf("Usage: reasons run [options] <script|module%s> [arguments]\n", MODULE_EXTENSION);
+    printf("Execute a Reasons DSL script or a module built by `reasons compile -o x%s`.\n\n",
+           MODULE_EXTENSION);
     printf("Options:\n");
     printf("  -t, --time          Display execution time\n");
     printf("  -d, --debug         Enable debug mode\n");
     printf("  -s, --sandbox       Enable sandbox mode\n");
     printf("  -m, --memory-limit <size> Set memory limit (e.g., 100M, 1G)\n");
-    printf("  -h, --help          Show this help message\n");
+    printf("  -b, --budget <subsystem>=<size>\n");
+    printf("                      Set a subsystem memory budget (trace, explain,\n");
+    printf("                      coverage, history, profiler, ...)\n");
+    printf("  -h, --help          Show this help message\n\n");
+    printf("Batch mode:\n");
+    printf("  -B, --batch <file>  Evaluate the script once per input row ('-': stdin);\n");
+    printf("                      columns or keys are bound as variables\n");
+    printf("  -o, --out <file>    Write one JSON result line per row (default: stdout)\n");
+    printf("  -f, --format <csv|jsonl>\n");
+    printf("                      Input format (default: from extension, else csv)\n");
+    printf("  -j, --threads <n>   Worker threads, 0 for one per CPU (default: 1)\n");
+    printf("  -u, --unordered     Write results as batches finish, not in input order\n");
+    printf("  -p, --progress      Report rows and throughput on stderr while running\n");
+}
+
+static bool parse_size(const char *text, size_t *size) {
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text) return false;
+    
+    switch (*end) {
+        case 'G': case 'g': value *= 1024ULL * 1024 * 1024; end++; break;
+        case 'M': case 'm': value *= 1024ULL * 1024; end++; break;
+        case 'K': case 'k': value *= 1024ULL; end++; break;
+        default: break;
+    }
+    if (*end != '\0') return false;
+    
+    *size = (size_t)value;
+    return true;
+}
+
+static void report_budgets() {
+    // Only worth mentioning when a subsystem had to degrade
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        MemTagStats stats = memory_get_tag_stats((MemTag)i);
+        if (stats.denied == 0) continue;
+        LOG_WARN("Subsystem '%s' reached its %zu byte budget (peak %zu bytes, %zu allocations refused)",
+                 memory_tag_name((MemTag)i), stats.budget, stats.peak, stats.denied);
+    }
+}
+
+// `use` paths are relative to the script, not the working directory
+static void script_base_dir(const char *path, char *base_dir, size_t size) {
+    const char *slash = strrchr(path, '/');
+    size_t dir_length = slash ? (size_t)(slash - path) : 0;
+    if (dir_length == 0 || dir_length >= size) {
+        snprintf(base_dir, size, "%s", slash ? "/" : ".");
+    } else {
+        memcpy(base_dir, path, dir_length);
+        base_dir[dir_length] = '\0';
+    }
+}
+
+static bool module_has_imports(const ast_compact_t *tree) {
+    // The whole module is one preorder range, so this is a flat scan
+    size_t count = ast_compact_size(tree);
+    for (uint32_t i = 0; i < count; i++) {
+        if (ast_compact_node(tree, i)->type == AST_IMPORT) return true;
+    }
+    return false;
+}
+
+static ast_node_t* load_module_program(const char *path, bool allow_imports) {
+    CompiledModule *module = module_load(path);
+    if (!module) return NULL;
+    
+    if (!allow_imports && module_has_imports(module_tree(module))) {
+        LOG_ERROR("%s: `use` is not allowed in sandbox mode", path);
+        module_unload(module);
+        return NULL;
+    }
+    
+    // The evaluator walks the pointer form; building it from the mapped
+    // nodes replaces lexing and parsing the source but still allocates
+    // every node (about as long again as mapping and checking the module)
+    ast_node_t *program = ast_compact_to_ast(module_tree(module), 0);
+    module_unload(module);
+    return program;
+}
+
+// Script arguments are visible as argc and arg1..argN
+static void bind_script_args(runtime_env_t *env, vector_t *args) {
+    size_t count = args ? vector_size(args) : 0;
+    reasons_value_t value = {VALUE_NUMBER, .data.number_val = (double)count};
+    runtime_set_variable(env, "argc", value);
+    
+    for (size_t i = 0; i < count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "arg%zu", i + 1);
+        value.type = VALUE_STRING;
+        value.data.string_val = vector_at(args, i);
+        runtime_set_variable(env, name, value);
+    }
+}
+
+static RuntimeResult execute_module(const RuntimeOptions *options) {
+    // Outlives the evaluation context the message comes from
+    static char error_message[256];
+    RuntimeResult result;
+    memset(&result, 0, sizeof(result));
+    
+    ast_node_t *program = load_module_program(options->script_file, !options->sandbox_mode);
+    if (!program) {
+        result.error_message = "cannot load module";
+        return result;
+    }
+    
+    // A sandboxed module reads nothing beyond itself
+    import_scope_t *imports = NULL;
+    if (!options->sandbox_mode) {
+        char base_dir[1024];
+        script_base_dir(options->script_file, base_dir, sizeof(base_dir));
+        imports = import_scope_create(base_dir);
+    }
+    
+    runtime_env_t *env = runtime_create();
+    eval_context_t *ctx = env ? eval_context_create(env) : NULL;
+    if (!ctx) {
+        result.error_message = "cannot create runtime";
+    } else {
+        bind_script_args(env, options->args);
+        eval_set_imports(ctx, imports);
+        if (options->debug_mode) {
+            eval_set_tracing(ctx, true);
+            eval_set_explanation(ctx, true);
+        }
+        
+        reasons_value_t value = eval_tree(ctx, program);
+        result.success = !eval_had_error(ctx);
+        if (!result.success) {
+            snprintf(error_message, sizeof(error_message), "%s", eval_get_error(ctx));
+            result.error_message = error_message;
+        }
+        if (options->debug_mode) {
+            const char *explanation = eval_get_explanation(ctx);
+            if (explanation) fprintf(stderr, "%s\n", explanation);
+        }
+        reasons_value_free(&value);
+        eval_context_destroy(ctx);
+    }
+    
+    if (env) runtime_destroy(env);
+    import_scope_destroy(imports);
+    ast_destroy(program);
+    return result;
 }
 
 static double get_time() {
@@ -158,3 +483,543 @@ static double get_time() {
     gettimeofday(&tv, NULL);
     return tv.tv_sec + tv.tv_usec / 1000000.0;
 }
+
+/* ======== BATCH MODE ======== */
+
+static ast_node_t* load_program(const char *path) {
+    if (module_is_module_path(path)) {
+        return load_module_program(path, true);
+    }
+    
+    char *source = file_read_all(path, NULL);
+    if (!source) return NULL;
+    
+    lexer_t *lexer = lexer_create(source);
+    parser_t *parser = lexer ? parser_create(lexer) : NULL;
+    ast_node_t *program = parser ? parser_parse(parser) : NULL;
+    // A recovered parse would be evaluated against every input row
+    if (program && (parser_had_error(parser) || !ast_validate(program))) {
+        ast_destroy(program);
+        program = NULL;
+    }
+    
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+    mem_free(source);
+    return program;
+}
+
+static void write_json_string(FILE *output, const char *str) {
+    fputc('"', output);
+    for (const char *p = str ? str : ""; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(output, "\\%c", *p);
+        } else if ((unsigned char)*p < 0x20) {
+            fprintf(output, "\\u%04x", (unsigned char)*p);
+        } else {
+            fputc(*p, output);
+        }
+    }
+    fputc('"', output);
+}
+
+static void write_json_result(FILE *output, const reasons_value_t *value) {
+    switch (value->type) {
+        case VALUE_BOOL:
+            fputs(value->data.bool_val ? "true" : "false", output);
+            break;
+        case VALUE_NUMBER:
+            if (isfinite(value->data.number_val)) {
+                fprintf(output, "%.16g", value->data.number_val);
+            } else {
+                fputs("null", output);
+            }
+            break;
+        case VALUE_STRING:
+            write_json_string(output, value->data.string_val);
+            break;
+        default:
+            fputs("null", output);
+            break;
+    }
+}
+
+// CSV fields are untyped: numbers and true/false are bound as such, empty
+// fields as null and everything else as strings
+static reasons_value_t field_value(const char *field) {
+    reasons_value_t value = {VALUE_NULL};
+    if (*field == '\0') return value;
+    
+    char *end;
+    double number = strtod(field, &end);
+    if (*end == '\0') {
+        value.type = VALUE_NUMBER;
+        value.data.number_val = number;
+    } else if (strcasecmp(field, "true") == 0 || strcasecmp(field, "false") == 0) {
+        value.type = VALUE_BOOL;
+        value.data.bool_val = strcasecmp(field, "true") == 0;
+    } else {
+        value.type = VALUE_STRING;
+        value.data.string_val = (char*)field;   // Cloned by runtime_set_variable
+    }
+    return value;
+}
+
+static bool json_field_value(const JsonValue *json, reasons_value_t *value) {
+    memset(value, 0, sizeof(*value));
+    switch (json->type) {
+        case JSON_NUMBER:
+            value->type = VALUE_NUMBER;
+            value->data.number_val = json->number_value;
+            return true;
+        case JSON_INTEGER:
+            value->type = VALUE_NUMBER;
+            value->data.number_val = (double)json->integer_value;
+            return true;
+        case JSON_TRUE:
+        case JSON_FALSE:
+            value->type = VALUE_BOOL;
+            value->data.bool_val = json->type == JSON_TRUE;
+            return true;
+        case JSON_STRING:
+            value->type = VALUE_STRING;
+            value->data.string_val = json->string_value;
+            return true;
+        case JSON_NULL:
+            value->type = VALUE_NULL;
+            return true;
+        default:
+            return false;               // Nested objects and arrays are not bound
+    }
+}
+
+static void bind_csv_row(runtime_env_t *env, const BatchReader *reader, char **fields) {
+    for (size_t i = 0; i < reader->column_count; i++) {
+        if (fields[i]) {
+            runtime_set_variable(env, reader->columns[i], field_value(fields[i]));
+        }
+    }
+}
+
+static bool bind_json_row(runtime_env_t *env, const char *line, char *message, size_t size) {
+    Error *error = NULL;
+    JsonValue *json = json_parse(line, strlen(line), &error);
+    if (!json || json->type != JSON_OBJECT) {
+        snprintf(message, size, "%s", error && error->message ? error->message :
+                                      "expected a JSON object");
+        if (error) error_free(error);
+        json_value_free(json);
+        return false;
+    }
+    
+    JsonObjectIterator it;
+    json_object_iter_init(&it, json->object_value);
+    while (json_object_iter_next(&it)) {
+        reasons_value_t value;
+        if (json_field_value(it.value, &value)) {
+            runtime_set_variable(env, it.key, value);
+        }
+    }
+    json_value_free(json);
+    return true;
+}
+
+static void evaluate_row(BatchWorker *worker, BatchSlot *slot, size_t index, FILE *output) {
+    const BatchReader *reader = worker->queue->reader;
+    char message[256] = "";
+    bool failed = false;
+    reasons_value_t result = {VALUE_NULL};
+    
+    // Each row binds into a fresh scope, so nothing leaks into the next row
+    error_clear();
+    runtime_push_scope(worker->env);
+    if (reader->format == BATCH_CSV) {
+        bind_csv_row(worker->env, reader, slot->rows + index * reader->column_count);
+    } else {
+        failed = !bind_json_row(worker->env, slot->rows[index], message, sizeof(message));
+    }
+    if (!failed) {
+        result = eval_tree(worker->ctx, worker->program);
+        if (eval_had_error(worker->ctx)) {
+            snprintf(message, sizeof(message), "%s", eval_get_error(worker->ctx));
+            failed = true;
+        }
+    }
+    runtime_pop_scope(worker->env);
+    
+    fprintf(output, "{\"row\": %zu, ", slot->first_row + index);
+    if (failed) {
+        fputs("\"error\": ", output);
+        write_json_string(output, message);
+        slot->errors++;
+    } else {
+        fputs("\"result\": ", output);
+        write_json_result(output, &result);
+    }
+    fputs("}\n", output);
+    reasons_value_free(&result);
+}
+
+static void release_rows(const BatchReader *reader, BatchSlot *slot) {
+    size_t fields = reader->format == BATCH_CSV ? slot->count * reader->column_count : slot->count;
+    for (size_t i = 0; i < fields; i++) {
+        if (reader->format == BATCH_CSV) {
+            mem_free(slot->rows[i]);
+        } else {
+            free(slot->rows[i]);        // From getline
+        }
+        slot->rows[i] = NULL;
+    }
+}
+
+static void process_batch(BatchWorker *worker, BatchSlot *slot) {
+    FILE *output = open_memstream(&slot->output, &slot->output_length);
+    if (!output) {
+        LOG_ERROR("Cannot buffer results for rows %zu-%zu", slot->first_row,
+                  slot->first_row + slot->count - 1);
+        slot->errors = slot->count;
+    } else {
+        for (size_t i = 0; i < slot->count; i++) {
+            evaluate_row(worker, slot, i, output);
+        }
+        fclose(output);
+    }
+    
+    // Input goes as soon as it is evaluated; only results wait for the writer
+    release_rows(worker->queue->reader, slot);
+}
+
+// Claims filled batches in the order they were read; called with the lock held
+static BatchSlot* claim_slot(BatchQueue *queue) {
+    for (size_t i = 0; i < queue->slot_count; i++) {
+        BatchSlot *slot = &queue->slots[i];
+        if (slot->state == SLOT_FILLED && slot->sequence == queue->next_claim) {
+            slot->state = SLOT_CLAIMED;
+            queue->next_claim++;
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+static void* batch_worker(void *arg) {
+    BatchWorker *worker = arg;
+    BatchQueue *queue = worker->queue;
+    
+    pthread_mutex_lock(&queue->lock);
+    for (;;) {
+        BatchSlot *slot = claim_slot(queue);
+        if (!slot) {
+            if (queue->closing) break;
+            pthread_cond_wait(&queue->work_ready, &queue->lock);
+            continue;
+        }
+        
+        pthread_mutex_unlock(&queue->lock);
+        process_batch(worker, slot);
+        pthread_mutex_lock(&queue->lock);
+        
+        slot->state = SLOT_DONE;
+        pthread_cond_signal(&queue->slot_done);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+static bool worker_init(BatchWorker *worker, BatchQueue *queue, ast_node_t *program,
+                        bool clone, const char *base_dir) {
+    memset(worker, 0, sizeof(BatchWorker));
+    worker->queue = queue;
+    worker->program = clone ? ast_clone(program) : program;
+    worker->owns_program = clone;
+    worker->env = runtime_create();
+    worker->ctx = worker->env ? eval_context_create(worker->env) : NULL;
+    worker->imports = import_scope_create(base_dir);
+    if (!worker->program || !worker->ctx) return false;
+    
+    // Per-row traces and explanations are never read in batch mode
+    eval_set_tracing(worker->ctx, false);
+    eval_set_explanation(worker->ctx, false);
+    eval_set_imports(worker->ctx, worker->imports);
+    return true;
+}
+
+static void worker_cleanup(BatchWorker *worker) {
+    if (worker->ctx) eval_context_destroy(worker->ctx);
+    if (worker->env) runtime_destroy(worker->env);
+    if (worker->imports) import_scope_destroy(worker->imports);
+    if (worker->owns_program) ast_destroy(worker->program);
+}
+
+static bool reader_open(BatchReader *reader, const BatchOptions *options) {
+    memset(reader, 0, sizeof(BatchReader));
+    reader->format = options->format;
+    bool from_stdin = strcmp(options->input, "-") == 0;
+    
+    if (reader->format == BATCH_JSONL) {
+        reader->file = from_stdin ? stdin : fopen(options->input, "r");
+        if (!reader->file) {
+            LOG_ERROR("Cannot open batch input: %s", options->input);
+            return false;
+        }
+        return true;
+    }
+    
+    // The header is read here rather than by the parser so the column names
+    // can be bound as variables
+    CsvParseOptions csv_options;
+    memset(&csv_options, 0, sizeof(csv_options));
+    csv_options.delimiter = ',';
+    csv_options.has_header = false;
+    reader->csv = csv_parser_create(from_stdin ? "/dev/stdin" : options->input, &csv_options);
+    vector_t *header = reader->csv ? csv_parse_next_row(reader->csv) : NULL;
+    if (!header) {
+        LOG_ERROR("Cannot read CSV header from %s", options->input);
+        return false;
+    }
+    
+    reader->column_count = vector_size(header);
+    reader->columns = mem_alloc(reader->column_count * sizeof(char*));
+    if (!reader->columns) return false;
+    for (size_t i = 0; i < reader->column_count; i++) {
+        reader->columns[i] = string_dup(vector_at(header, i));
+    }
+    return true;
+}
+
+static void reader_close(BatchReader *reader) {
+    if (reader->csv) csv_parser_free(reader->csv);
+    if (reader->file && reader->file != stdin) fclose(reader->file);
+    for (size_t i = 0; i < reader->column_count; i++) {
+        mem_free(reader->columns[i]);
+    }
+    if (reader->columns) mem_free(reader->columns);
+}
+
+// Reads up to BATCH_ROWS rows into a free slot; false once the input is exhausted
+static bool reader_fill(BatchReader *reader, BatchSlot *slot, size_t first_row) {
+    slot->first_row = first_row;
+    slot->count = 0;
+    slot->errors = 0;
+    
+    while (slot->count < BATCH_ROWS) {
+        if (reader->format == BATCH_CSV) {
+            vector_t *row = csv_parse_next_row(reader->csv);
+            if (!row) break;
+            size_t fields = vector_size(row);
+            if (fields <= 1 && (fields == 0 || *(char*)vector_at(row, 0) == '\0')) {
+                continue;               // Blank line
+            }
+            
+            // Missing trailing fields stay unbound; extra fields are dropped
+            char **cells = slot->rows + slot->count * reader->column_count;
+            for (size_t i = 0; i < reader->column_count; i++) {
+                cells[i] = i < fields ? string_dup(vector_at(row, i)) : NULL;
+            }
+        } else {
+            char *line = NULL;
+            size_t capacity = 0;
+            ssize_t length = getline(&line, &capacity, reader->file);
+            if (length < 0) {
+                free(line);
+                break;
+            }
+            while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+                line[--length] = '\0';
+            }
+            if (strspn(line, " \t") == (size_t)length) {
+                free(line);
+                continue;               // Blank line
+            }
+            slot->rows[slot->count] = line;
+        }
+        slot->count++;
+    }
+    return slot->count > 0;
+}
+
+// Next batch whose results can be written; called with the lock held
+static BatchSlot* writable_slot(BatchQueue *queue, bool ordered, size_t next_write) {
+    for (size_t i = 0; i < queue->slot_count; i++) {
+        BatchSlot *slot = &queue->slots[i];
+        if (slot->state == SLOT_DONE && (!ordered || slot->sequence == next_write)) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+static BatchSlot* free_slot(BatchQueue *queue) {
+    for (size_t i = 0; i < queue->slot_count; i++) {
+        if (queue->slots[i].state == SLOT_FREE) return &queue->slots[i];
+    }
+    return NULL;
+}
+
+static int run_batch(const char *script_file, const BatchOptions *options) {
+    ast_node_t *program = load_program(script_file);
+    if (!program) {
+        LOG_ERROR("Cannot load %s", script_file);
+        return EXIT_FAILURE;
+    }
+    
+    BatchReader reader;
+    bool to_stdout = strcmp(options->output, "-") == 0;
+    FILE *output = to_stdout ? stdout : fopen(options->output, "w");
+    if (!output || !reader_open(&reader, options)) {
+        if (!output) LOG_ERROR("Cannot open %s for writing", options->output);
+        else reader_close(&reader);
+        if (output && !to_stdout) fclose(output);
+        ast_destroy(program);
+        return EXIT_FAILURE;
+    }
+    
+    // With one thread the main thread evaluates each batch itself; otherwise
+    // it only reads and writes while the workers evaluate
+    size_t threads = (size_t)options->threads;
+    bool inline_mode = threads <= 1;
+    size_t row_cells = reader.format == BATCH_CSV ? reader.column_count : 1;
+    
+    BatchQueue queue;
+    memset(&queue, 0, sizeof(queue));
+    queue.reader = &reader;
+    queue.slot_count = inline_mode ? 1 : threads * BATCH_SLOTS_PER_THREAD;
+    queue.slots = mem_alloc(queue.slot_count * sizeof(BatchSlot));
+    BatchWorker *workers = mem_alloc((inline_mode ? 1 : threads) * sizeof(BatchWorker));
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.work_ready, NULL);
+    pthread_cond_init(&queue.slot_done, NULL);
+    
+    char base_dir[1024];
+    script_base_dir(script_file, base_dir, sizeof(base_dir));
+    
+    bool ok = queue.slots && workers;
+    size_t slots_ready = 0;
+    for (; ok && slots_ready < queue.slot_count; slots_ready++) {
+        BatchSlot *slot = &queue.slots[slots_ready];
+        memset(slot, 0, sizeof(BatchSlot));
+        slot->rows = mem_alloc(BATCH_ROWS * row_cells * sizeof(char*));
+        if (!slot->rows) {
+            ok = false;
+            break;
+        }
+        memset(slot->rows, 0, BATCH_ROWS * row_cells * sizeof(char*));
+    }
+    
+    size_t workers_ready = 0;
+    size_t started = 0;
+    size_t worker_count = inline_mode ? 1 : threads;
+    for (; ok && workers_ready < worker_count; workers_ready++) {
+        if (!worker_init(&workers[workers_ready], &queue, program, !inline_mode, base_dir)) {
+            worker_cleanup(&workers[workers_ready]);
+            ok = false;
+            break;
+        }
+    }
+    if (ok && !inline_mode) {
+        while (started < worker_count &&
+               pthread_create(&workers[started].thread, NULL, batch_worker, &workers[started]) == 0) {
+            started++;
+        }
+        ok = started > 0;
+    }
+    if (!ok) {
+        LOG_ERROR("Cannot start batch evaluation");
+    }
+    
+    size_t rows_read = 0, rows = 0, errors = 0;
+    size_t next_write = 0;
+    bool eof = !ok;
+    bool write_failed = false;
+    double start = get_time();
+    double last_report = start;
+    
+    pthread_mutex_lock(&queue.lock);
+    for (;;) {
+        // Results first: they free slots and keep memory bounded
+        BatchSlot *slot = writable_slot(&queue, options->ordered, next_write);
+        if (slot) {
+            pthread_mutex_unlock(&queue.lock);
+            if (slot->output && fwrite(slot->output, 1, slot->output_length, output) != slot->output_length) {
+                write_failed = true;
+            }
+            free(slot->output);         // From open_memstream
+            slot->output = NULL;
+            rows += slot->count;
+            errors += slot->errors;
+            
+            double now = get_time();
+            if (options->progress && now - last_report >= BATCH_PROGRESS_INTERVAL) {
+                fprintf(stderr, "\r%zu rows, %zu failed, %.0f rows/s", rows, errors,
+                        rows / (now - start));
+                last_report = now;
+            }
+            
+            pthread_mutex_lock(&queue.lock);
+            slot->state = SLOT_FREE;
+            next_write++;
+            if (write_failed) eof = true;
+            continue;
+        }
+        
+        // Reading into a free slot needs no lock: only this thread touches it
+        slot = eof ? NULL : free_slot(&queue);
+        if (slot) {
+            pthread_mutex_unlock(&queue.lock);
+            bool filled = reader_fill(&reader, slot, rows_read + 1);
+            rows_read += slot->count;
+            if (filled && inline_mode) {
+                process_batch(&workers[0], slot);
+            }
+            pthread_mutex_lock(&queue.lock);
+            
+            if (!filled) {
+                eof = true;
+            } else {
+                slot->sequence = queue.next_sequence++;
+                slot->state = inline_mode ? SLOT_DONE : SLOT_FILLED;
+                pthread_cond_signal(&queue.work_ready);
+            }
+            continue;
+        }
+        
+        if (eof && next_write == queue.next_sequence) break;
+        pthread_cond_wait(&queue.slot_done, &queue.lock);
+    }
+    queue.closing = true;
+    pthread_cond_broadcast(&queue.work_ready);
+    pthread_mutex_unlock(&queue.lock);
+    
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    double elapsed = get_time() - start;
+    
+    if (options->progress) fputc('\n', stderr);
+    if (fflush(output) != 0) write_failed = true;
+    if (!to_stdout && fclose(output) != 0) write_failed = true;
+    if (write_failed) {
+        LOG_ERROR("Failed to write results to %s", options->output);
+    }
+    size_t used = inline_mode ? 1 : started;
+    LOG_INFO("Evaluated %zu rows (%zu failed) in %.3f seconds, %.0f rows/s on %zu thread%s",
+             rows, errors, elapsed, elapsed > 0 ? rows / elapsed : 0.0, used,
+             used == 1 ? "" : "s");
+    
+    for (size_t i = 0; i < workers_ready; i++) {
+        worker_cleanup(&workers[i]);
+    }
+    for (size_t i = 0; i < slots_ready; i++) {
+        release_rows(&reader, &queue.slots[i]);
+        mem_free(queue.slots[i].rows);
+    }
+    if (workers) mem_free(workers);
+    if (queue.slots) mem_free(queue.slots);
+    pthread_cond_destroy(&queue.slot_done);
+    pthread_cond_destroy(&queue.work_ready);
+    pthread_mutex_destroy(&queue.lock);
+    reader_close(&reader);
+    ast_destroy(program);
+    
+    return ok && !write_failed && errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -224,6 +224,29 @@ ast_node_t *ast_create_identifier(const char *name)
     return node;
 }
 
+ast_node_t *ast_create_import(const char *path)
+{
+    if (!path) {
+        error_set(ERROR_INVALID_ARGUMENT, "Import path cannot be null");
+        return NULL;
+    }
+
+    ast_node_t *node = ast_create_node(AST_IMPORT);
+    if (!node) {
+        return NULL;
+    }
+
+    /* Imports carry their path in the identifier payload */
+    node->data.identifier.name = string_duplicate(path);
+    if (!node->data.identifier.name) {
+        ast_destroy(node);
+        error_set(ERROR_MEMORY, "Failed to duplicate import path");
+        return NULL;
+    }
+
+    return node;
+}
+
 ast_node_t *ast_create_literal(const reasons_value_t *value)
 {
     if (!value) {
@@ -296,6 +319,30 @@ bool ast_add_child(ast_node_t *parent, ast_node_t *child)
     return true;
 }
 
+bool ast_insert_child(ast_node_t *parent, ast_node_t *after, ast_node_t *child)
+{
+    if (!parent || !child) {
+        error_set(ERROR_INVALID_ARGUMENT, "Parent and child cannot be null");
+        return false;
+    }
+    if (after && after->parent != parent) {
+        error_set(ERROR_INVALID_ARGUMENT, "Insertion point is not a child of parent");
+        return false;
+    }
+
+    child->parent = parent;
+
+    if (!after) {
+        child->next_sibling = parent->first_child;
+        parent->first_child = child;
+    } else {
+        child->next_sibling = after->next_sibling;
+        after->next_sibling = child;
+    }
+
+    return true;
+}
+
 bool ast_remove_child(ast_node_t *parent, ast_node_t *child)
 {
     if (!parent || !child) {
@@ -417,6 +464,7 @@ void ast_traverse_preorder(ast_node_t *root, ast_visitor_func_t visitor, void *u
 
         case AST_CONSEQUENCE:
         case AST_IDENTIFIER:
+        case AST_IMPORT:
         case AST_LITERAL:
             /* Leaf nodes - no children to traverse */
             break;
@@ -482,6 +530,7 @@ void ast_traverse_postorder(ast_node_t *root, ast_visitor_func_t visitor, void *
 
         case AST_CONSEQUENCE:
         case AST_IDENTIFIER:
+        case AST_IMPORT:
         case AST_LITERAL:
             /* Leaf nodes - no children to traverse */
             break;
@@ -570,6 +619,7 @@ ast_node_t *ast_find_node(ast_node_t *root, ast_predicate_func_t predicate, void
 
         case AST_CONSEQUENCE:
         case AST_IDENTIFIER:
+        case AST_IMPORT:
         case AST_LITERAL:
             /* Leaf nodes - already checked above */
             break;
@@ -689,6 +739,7 @@ ast_node_t *ast_clone(const ast_node_t *node)
             break;
 
         case AST_IDENTIFIER:
+        case AST_IMPORT:
             clone->data.identifier.name = string_duplicate(node->data.identifier.name);
             if (!clone->data.identifier.name) {
                 ast_destroy(clone);
@@ -802,6 +853,7 @@ bool ast_equals(const ast_node_t *a, const ast_node_t *b)
                    ast_equals(a->data.comparison.right, b->data.comparison.right);
 
         case AST_IDENTIFIER:
+        case AST_IMPORT:
             return strcmp(a->data.identifier.name, b->data.identifier.name) == 0;
 
         case AST_LITERAL:
@@ -926,6 +978,10 @@ static void ast_print_node_recursive(const ast_node_t *node, FILE *fp, int level
             fprintf(fp, "Identifier: \"%s\"\n", node->data.identifier.name);
             break;
 
+        case AST_IMPORT:
+            fprintf(fp, "Import: \"%s\"\n", node->data.identifier.name);
+            break;
+
         case AST_LITERAL:
             fprintf(fp, "Literal: ");
             reasons_value_print(&node->data.literal.value, fp);
@@ -1042,6 +1098,10 @@ void ast_print_compact(const ast_node_t *node, FILE *fp)
             fprintf(fp, "%s", node->data.identifier.name);
             break;
 
+        case AST_IMPORT:
+            fprintf(fp, "use \"%s\"", node->data.identifier.name);
+            break;
+
         case AST_LITERAL:
             reasons_value_print(&node->data.literal.value, fp);
             break;
@@ -1088,6 +1148,7 @@ const char *ast_node_type_name(ast_node_type_t type)
         case AST_LOGIC_OP: return "LogicOp";
         case AST_COMPARISON: return "Comparison";
         case AST_IDENTIFIER: return "Identifier";
+        case AST_IMPORT: return "Import";
         case AST_LITERAL: return "Literal";
         case AST_CHAIN: return "Chain";
         default: return "Unknown";
@@ -1278,6 +1339,7 @@ static size_t ast_calculate_depth(const ast_node_t *node)
 
         case AST_CONSEQUENCE:
         case AST_IDENTIFIER:
+        case AST_IMPORT:
         case AST_LITERAL:
             /* Leaf nodes */
             break;
@@ -1350,6 +1412,7 @@ size_t ast_count_nodes(const ast_node_t *root)
 
         case AST_CONSEQUENCE:
         case AST_IDENTIFIER:
+        case AST_IMPORT:
         case AST_LITERAL:
             /* Leaf nodes - already counted */
             break;
@@ -1467,6 +1530,7 @@ static bool ast_validate_node_recursive(const ast_node_t *node, int depth)
             break;
 
         case AST_IDENTIFIER:
+        case AST_IMPORT:
             if (!node->data.identifier.name) {
                 error_set(ERROR_INVALID_STATE, "Identifier node missing name");
                 return false;
@@ -1553,6 +1617,7 @@ static void ast_node_destroy_recursive(ast_node_t *node)
             break;
 
         case AST_IDENTIFIER:
+        case AST_IMPORT:
             memory_free(node->data.identifier.name);
             break;
 
@@ -0,0 +1,966 @@
+/*
+ * ast_compact.c - Compact Index-Based AST for Reasons DSL
+ *
+ * Features:
+ * - Nodes stored contiguously in preorder, linked by 32-bit indices
+ * - Subtrees as index ranges: linear preorder traversal, O(1) node counts
+ * - Interned strings: each distinct name, condition or action stored once
+ * - Conversion to and from the pointer-based AST
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reasons/ast_compact.h"
+#include "reasons/ast.h"
+#include "reasons/types.h"
+#include "utils/error.h"
+#include "utils/memory.h"
+#include "utils/logger.h"
+
+#define AST_COMPACT_INITIAL_NODES 64
+#define AST_COMPACT_INITIAL_STRINGS 1024
+#define AST_COMPACT_INITIAL_SLOTS 64
+
+struct ast_compact {
+    ast_compact_node_t *nodes;        /* Preorder; index 0 is the root */
+    size_t count;
+    size_t capacity;
+
+    char *strings;                    /* NUL-terminated interned strings */
+    size_t string_size;
+    size_t string_capacity;
+
+    uint32_t *slots;                  /* Open-addressing set of string offsets */
+    size_t slot_count;
+    size_t slot_capacity;
+
+    reasons_value_t *literals;        /* String values point into strings */
+    size_t literal_count;
+    size_t literal_capacity;
+
+    bool borrowed;                    /* Nodes and strings belong to the caller */
+};
+
+/* Forward declarations for internal functions */
+static ast_compact_t *ast_compact_create(void);
+static bool ast_compact_grow(void **array, size_t *capacity, size_t needed, size_t element_size,
+                             size_t initial);
+static uint32_t ast_compact_emit(ast_compact_t *tree, const ast_node_t *node, uint32_t parent,
+                                 int depth);
+static uint32_t ast_compact_intern(ast_compact_t *tree, const char *text);
+static bool ast_compact_rehash(ast_compact_t *tree, size_t capacity);
+static uint32_t ast_compact_hash(const char *text, size_t length);
+static void ast_compact_bind_literals(ast_compact_t *tree);
+static bool ast_compact_postorder(const ast_compact_t *tree, uint32_t index,
+                                  ast_compact_visitor_func_t visitor, void *user_data);
+static bool ast_compact_check_op(const ast_compact_node_t *node);
+static bool ast_compact_check(const ast_compact_t *tree);
+
+/* Creation and Destruction */
+ast_compact_t *ast_compact_from_ast(const ast_node_t *root)
+{
+    if (!root) {
+        error_set(ERROR_INVALID_ARGUMENT, "Root node cannot be null");
+        return NULL;
+    }
+
+    ast_compact_t *tree = ast_compact_create();
+    if (!tree) {
+        return NULL;
+    }
+
+    if (ast_compact_emit(tree, root, AST_COMPACT_NONE, 0) == AST_COMPACT_NONE) {
+        ast_compact_destroy(tree);
+        return NULL;
+    }
+    ast_compact_bind_literals(tree);
+
+    LOG_DEBUG("Compacted AST: %zu nodes, %zu strings (%zu bytes), %zu literals",
+              tree->count, tree->slot_count, tree->string_size, tree->literal_count);
+    return tree;
+}
+
+ast_node_t *ast_compact_to_ast(const ast_compact_t *tree, uint32_t index)
+{
+    if (!tree || index >= tree->count) {
+        return NULL;
+    }
+
+    const ast_compact_node_t *compact = &tree->nodes[index];
+    ast_node_t *node = ast_create_node((ast_node_type_t)compact->type);
+    if (!node) {
+        return NULL;
+    }
+
+    node->line = (int)compact->line;
+    node->column = (int)compact->column;
+
+    /* Strings are copied out of the intern table; the pointer form owns them */
+    char *text = NULL;
+    ast_node_t *left = NULL;
+    ast_node_t *right = NULL;
+    bool failed = false;
+
+    if (compact->text != AST_COMPACT_NONE && compact->type != AST_LITERAL) {
+        text = string_duplicate(tree->strings + compact->text);
+        failed = !text;
+    }
+    if (!failed && compact->operand[AST_COMPACT_LEFT] != AST_COMPACT_NONE) {
+        left = ast_compact_to_ast(tree, compact->operand[AST_COMPACT_LEFT]);
+        failed = !left;
+    }
+    if (!failed && compact->operand[AST_COMPACT_RIGHT] != AST_COMPACT_NONE) {
+        right = ast_compact_to_ast(tree, compact->operand[AST_COMPACT_RIGHT]);
+        failed = !right;
+    }
+    if (failed) {
+        memory_free(text);
+        ast_destroy(left);
+        ast_destroy(right);
+        ast_destroy(node);
+        return NULL;
+    }
+
+    switch (node->type) {
+        case AST_DECISION:
+            node->data.decision.condition = text;
+            node->data.decision.condition_type = (condition_type_t)compact->op;
+            node->data.decision.priority = (int)compact->value.integer;
+            node->data.decision.true_branch = left;
+            node->data.decision.false_branch = right;
+            break;
+
+        case AST_CONSEQUENCE:
+            node->data.consequence.action = text;
+            node->data.consequence.type = (consequence_type_t)compact->op;
+            node->data.consequence.weight = compact->value.weight;
+            node->data.consequence.executed = (compact->flags & AST_COMPACT_EXECUTED) != 0;
+            break;
+
+        case AST_RULE:
+            node->data.rule.name = text;
+            node->data.rule.is_active = (compact->flags & AST_COMPACT_ACTIVE) != 0;
+            node->data.rule.execution_count = compact->value.integer;
+            node->data.rule.body = left;
+            break;
+
+        case AST_LOGIC_OP:
+            node->data.logic_op.op = (logic_op_t)compact->op;
+            node->data.logic_op.left = left;
+            node->data.logic_op.right = right;
+            break;
+
+        case AST_COMPARISON:
+            node->data.comparison.op = (comparison_op_t)compact->op;
+            node->data.comparison.left = left;
+            node->data.comparison.right = right;
+            break;
+
+        case AST_IDENTIFIER:
+        case AST_IMPORT:
+            node->data.identifier.name = text;
+            break;
+
+        case AST_LITERAL:
+            node->data.literal.value = tree->literals[compact->literal];
+            if (node->data.literal.value.type == VALUE_STRING &&
+                node->data.literal.value.data.string_val) {
+                node->data.literal.value.data.string_val =
+                    string_duplicate(node->data.literal.value.data.string_val);
+            }
+            break;
+
+        case AST_CHAIN:
+            node->data.chain.chain_type = (chain_type_t)compact->op;
+            node->data.chain.first = left;
+            node->data.chain.second = right;
+            break;
+
+        default:
+            memory_free(text);
+            break;
+    }
+
+    if (left) {
+        left->parent = node;
+    }
+    if (right) {
+        right->parent = node;
+    }
+
+    /* Generic children */
+    ast_node_t *last = NULL;
+    for (uint32_t child = compact->first_child; child != AST_COMPACT_NONE;
+         child = tree->nodes[child].next_sibling) {
+        ast_node_t *converted = ast_compact_to_ast(tree, child);
+        if (!converted) {
+            ast_destroy(node);
+            return NULL;
+        }
+
+        converted->parent = node;
+        if (last) {
+            last->next_sibling = converted;
+        } else {
+            node->first_child = converted;
+        }
+        last = converted;
+    }
+
+    return node;
+}
+
+ast_compact_t *ast_compact_borrow(const ast_compact_node_t *nodes, size_t count,
+                                  const char *strings, size_t string_size,
+                                  reasons_value_t *literals, size_t literal_count)
+{
+    if (!nodes || count == 0 || count >= AST_COMPACT_NONE ||
+        (string_size > 0 && !strings) || string_size >= AST_COMPACT_NONE ||
+        (literal_count > 0 && !literals)) {
+        error_set(ERROR_INVALID_ARGUMENT, "Invalid compact AST sections");
+        return NULL;
+    }
+
+    ast_compact_t *tree = ast_compact_create();
+    if (!tree) {
+        return NULL;
+    }
+
+    /* Read-only: nothing is ever appended, so the capacities stay zero */
+    tree->nodes = (ast_compact_node_t *)nodes;
+    tree->count = count;
+    tree->strings = (char *)strings;
+    tree->string_size = string_size;
+    tree->literals = literals;
+    tree->literal_count = literal_count;
+    tree->borrowed = true;
+
+    if (!ast_compact_check(tree)) {
+        tree->literals = NULL;
+        ast_compact_destroy(tree);
+        error_set(ERROR_INVALID_STATE, "Corrupt compact AST");
+        return NULL;
+    }
+    ast_compact_bind_literals(tree);
+    return tree;
+}
+
+ast_compact_t *ast_compact_clone(const ast_compact_t *tree)
+{
+    if (!tree) {
+        return NULL;
+    }
+
+    ast_compact_t *clone = ast_compact_create();
+    if (!clone) {
+        return NULL;
+    }
+
+    /* Three block copies; no pointers to fix up apart from string literals */
+    if (!ast_compact_grow((void **)&clone->nodes, &clone->capacity, tree->count,
+                          sizeof(ast_compact_node_t), AST_COMPACT_INITIAL_NODES) ||
+        !ast_compact_grow((void **)&clone->strings, &clone->string_capacity, tree->string_size,
+                          1, AST_COMPACT_INITIAL_STRINGS) ||
+        !ast_compact_grow((void **)&clone->literals, &clone->literal_capacity,
+                          tree->literal_count, sizeof(reasons_value_t), 1) ||
+        (tree->slot_capacity && !ast_compact_rehash(clone, tree->slot_capacity))) {
+        ast_compact_destroy(clone);
+        return NULL;
+    }
+
+    memcpy(clone->nodes, tree->nodes, tree->count * sizeof(ast_compact_node_t));
+    if (tree->string_size > 0) {
+        memcpy(clone->strings, tree->strings, tree->string_size);
+    }
+    memcpy(clone->literals, tree->literals, tree->literal_count * sizeof(reasons_value_t));
+    memcpy(clone->slots, tree->slots, tree->slot_capacity * sizeof(uint32_t));
+    clone->count = tree->count;
+    clone->string_size = tree->string_size;
+    clone->literal_count = tree->literal_count;
+    clone->slot_count = tree->slot_count;
+
+    ast_compact_bind_literals(clone);
+    return clone;
+}
+
+void ast_compact_destroy(ast_compact_t *tree)
+{
+    if (!tree) {
+        return;
+    }
+
+    if (!tree->borrowed) {
+        memory_free(tree->nodes);
+        memory_free(tree->strings);
+    }
+    memory_free(tree->slots);
+    memory_free(tree->literals);
+    memory_free(tree);
+}
+
+/* Access Functions */
+size_t ast_compact_size(const ast_compact_t *tree)
+{
+    return tree ? tree->count : 0;
+}
+
+const ast_compact_node_t *ast_compact_node(const ast_compact_t *tree, uint32_t index)
+{
+    if (!tree || index >= tree->count) {
+        return NULL;
+    }
+
+    return &tree->nodes[index];
+}
+
+const char *ast_compact_strings(const ast_compact_t *tree, size_t *size)
+{
+    if (!tree) {
+        return NULL;
+    }
+
+    if (size) {
+        *size = tree->string_size;
+    }
+    return tree->strings;
+}
+
+const char *ast_compact_text(const ast_compact_t *tree, uint32_t index)
+{
+    if (!tree || index >= tree->count || tree->nodes[index].text == AST_COMPACT_NONE) {
+        return NULL;
+    }
+
+    return tree->strings + tree->nodes[index].text;
+}
+
+const reasons_value_t *ast_compact_literal(const ast_compact_t *tree, uint32_t index)
+{
+    if (!tree || index >= tree->count || tree->nodes[index].type != AST_LITERAL) {
+        return NULL;
+    }
+
+    return &tree->literals[tree->nodes[index].literal];
+}
+
+/* Traversal Functions */
+void ast_compact_traverse_preorder(const ast_compact_t *tree, uint32_t index,
+                                   ast_compact_visitor_func_t visitor, void *user_data)
+{
+    if (!tree || !visitor || index >= tree->count) {
+        return;
+    }
+
+    /* The subtree is laid out in preorder: a scan, no recursion */
+    uint32_t end = tree->nodes[index].end;
+    for (uint32_t i = index; i < end; i++) {
+        if (!visitor(tree, i, user_data)) {
+            return;
+        }
+    }
+}
+
+void ast_compact_traverse_postorder(const ast_compact_t *tree, uint32_t index,
+                                    ast_compact_visitor_func_t visitor, void *user_data)
+{
+    if (!tree || !visitor || index >= tree->count) {
+        return;
+    }
+
+    ast_compact_postorder(tree, index, visitor, user_data);
+}
+
+uint32_t ast_compact_find_node(const ast_compact_t *tree, uint32_t index,
+                               ast_compact_visitor_func_t predicate, void *user_data)
+{
+    if (!tree || !predicate || index >= tree->count) {
+        return AST_COMPACT_NONE;
+    }
+
+    uint32_t end = tree->nodes[index].end;
+    for (uint32_t i = index; i < end; i++) {
+        if (predicate(tree, i, user_data)) {
+            return i;
+        }
+    }
+
+    return AST_COMPACT_NONE;
+}
+
+/* Query Functions */
+size_t ast_compact_count_nodes(const ast_compact_t *tree, uint32_t index)
+{
+    if (!tree || index >= tree->count) {
+        return 0;
+    }
+
+    return tree->nodes[index].end - index;
+}
+
+size_t ast_compact_get_depth(const ast_compact_t *tree, uint32_t index)
+{
+    if (!tree || index >= tree->count) {
+        return 0;
+    }
+
+    /* Parents precede their children, so one forward pass fills in depths */
+    uint32_t end = tree->nodes[index].end;
+    size_t span = end - index;
+    uint32_t *depths = memory_allocate(span * sizeof(uint32_t));
+    if (!depths) {
+        error_set(ERROR_MEMORY, "Failed to allocate depth table");
+        return 0;
+    }
+
+    size_t max_depth = 1;
+    depths[0] = 1;
+    for (uint32_t i = index + 1; i < end; i++) {
+        uint32_t depth = depths[tree->nodes[i].parent - index] + 1;
+        depths[i - index] = depth;
+        if (depth > max_depth) {
+            max_depth = depth;
+        }
+    }
+
+    memory_free(depths);
+    return max_depth;
+}
+
+/* ast_validate over the flat form: one forward scan, with depths filled in
+ * from the parent links as in ast_compact_get_depth */
+bool ast_compact_validate(const ast_compact_t *tree, uint32_t index)
+{
+    if (!tree || index >= tree->count) {
+        return true;  /* Empty tree is valid */
+    }
+
+    uint32_t end = tree->nodes[index].end;
+    uint32_t *depths = memory_allocate((end - index) * sizeof(uint32_t));
+    if (!depths) {
+        error_set(ERROR_MEMORY, "Failed to allocate depth table");
+        return false;
+    }
+
+    const char *message = NULL;
+    for (uint32_t i = index; i < end && !message; i++) {
+        const ast_compact_node_t *node = &tree->nodes[i];
+        uint32_t depth = i == index ? 0 : depths[node->parent - index] + 1;
+        depths[i - index] = depth;
+
+        if (depth > AST_MAX_DEPTH) {
+            message = "AST exceeds maximum depth";
+        } else if (!ast_compact_check_op(node)) {
+            message = node->type >= AST_NODE_TYPE_COUNT ? "Invalid AST node type"
+                                                        : "Invalid AST node operation";
+        } else if (node->text == AST_COMPACT_NONE) {
+            switch (node->type) {
+                case AST_DECISION:
+                    message = "Decision node missing condition";
+                    break;
+                case AST_CONSEQUENCE:
+                    message = "Consequence node missing action";
+                    break;
+                case AST_RULE:
+                    message = "Rule node missing name";
+                    break;
+                case AST_IDENTIFIER:
+                case AST_IMPORT:
+                    message = "Identifier node missing name";
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    memory_free(depths);
+    if (message) {
+        error_set(ERROR_INVALID_STATE, message);
+        return false;
+    }
+    return true;
+}
+
+bool ast_compact_equals(const ast_compact_t *a, uint32_t index_a,
+                        const ast_compact_t *b, uint32_t index_b)
+{
+    if (!a || !b || index_a >= a->count || index_b >= b->count) {
+        return false;
+    }
+
+    uint32_t span = a->nodes[index_a].end - index_a;
+    if (b->nodes[index_b].end - index_b != span) {
+        return false;
+    }
+
+    /* Equal trees have identical preorder layouts; compare node by node,
+     * with links taken relative to each subtree's root */
+    for (uint32_t i = 0; i < span; i++) {
+        const ast_compact_node_t *na = &a->nodes[index_a + i];
+        const ast_compact_node_t *nb = &b->nodes[index_b + i];
+
+        if (na->type != nb->type || na->op != nb->op || na->end - index_a != nb->end - index_b) {
+            return false;
+        }
+        for (int slot = 0; slot < 2; slot++) {
+            bool has_a = na->operand[slot] != AST_COMPACT_NONE;
+            bool has_b = nb->operand[slot] != AST_COMPACT_NONE;
+            if (has_a != has_b) {
+                return false;
+            }
+        }
+        if ((na->first_child == AST_COMPACT_NONE) != (nb->first_child == AST_COMPACT_NONE) ||
+            (na->next_sibling == AST_COMPACT_NONE) != (nb->next_sibling == AST_COMPACT_NONE) ||
+            (i > 0 && na->parent - index_a != nb->parent - index_b)) {
+            return false;
+        }
+
+        /* Same fields ast_equals compares */
+        switch (na->type) {
+            case AST_DECISION:
+                if (na->value.integer != nb->value.integer) {
+                    return false;
+                }
+                break;
+            case AST_CONSEQUENCE:
+                if (na->value.weight != nb->value.weight) {
+                    return false;
+                }
+                break;
+            case AST_RULE:
+                if ((na->flags & AST_COMPACT_ACTIVE) != (nb->flags & AST_COMPACT_ACTIVE)) {
+                    return false;
+                }
+                break;
+            case AST_LITERAL:
+                if (!reasons_value_equals(&a->literals[na->literal], &b->literals[nb->literal])) {
+                    return false;
+                }
+                break;
+            default:
+                break;
+        }
+
+        if (na->type != AST_LITERAL) {
+            const char *text_a = na->text != AST_COMPACT_NONE ? a->strings + na->text : NULL;
+            const char *text_b = nb->text != AST_COMPACT_NONE ? b->strings + nb->text : NULL;
+            if (a == b) {
+                /* Interned: equal strings have equal offsets */
+                if (na->text != nb->text) {
+                    return false;
+                }
+            } else if (text_a != text_b && (!text_a || !text_b || strcmp(text_a, text_b) != 0)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+size_t ast_compact_memory_usage(const ast_compact_t *tree)
+{
+    if (!tree) {
+        return 0;
+    }
+
+    return sizeof(ast_compact_t) +
+           tree->capacity * sizeof(ast_compact_node_t) +
+           tree->string_capacity +
+           tree->slot_capacity * sizeof(uint32_t) +
+           tree->literal_capacity * sizeof(reasons_value_t);
+}
+
+/* Internal Helper Functions */
+static ast_compact_t *ast_compact_create(void)
+{
+    ast_compact_t *tree = memory_allocate(sizeof(ast_compact_t));
+    if (!tree) {
+        error_set(ERROR_MEMORY, "Failed to allocate compact AST");
+        return NULL;
+    }
+
+    memset(tree, 0, sizeof(ast_compact_t));
+    return tree;
+}
+
+static bool ast_compact_grow(void **array, size_t *capacity, size_t needed, size_t element_size,
+                             size_t initial)
+{
+    if (needed <= *capacity) {
+        return true;
+    }
+
+    size_t new_capacity = *capacity ? *capacity : initial;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+
+    void *grown = memory_reallocate(*array, new_capacity * element_size);
+    if (!grown) {
+        error_set(ERROR_MEMORY, "Failed to grow compact AST");
+        return false;
+    }
+
+    *array = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+/* Appends node and its subtree in preorder; returns its index */
+static uint32_t ast_compact_emit(ast_compact_t *tree, const ast_node_t *node, uint32_t parent,
+                                 int depth)
+{
+    if (depth > AST_MAX_DEPTH) {
+        error_set(ERROR_INVALID_STATE, "AST too deep to compact");
+        return AST_COMPACT_NONE;
+    }
+    if (tree->count >= AST_COMPACT_NONE - 1) {
+        error_set(ERROR_INVALID_STATE, "AST too large to compact");
+        return AST_COMPACT_NONE;
+    }
+    if (!ast_compact_grow((void **)&tree->nodes, &tree->capacity, tree->count + 1,
+                          sizeof(ast_compact_node_t), AST_COMPACT_INITIAL_NODES)) {
+        return AST_COMPACT_NONE;
+    }
+
+    uint32_t index = (uint32_t)tree->count++;
+    ast_compact_node_t compact;
+    memset(&compact, 0, sizeof(compact));
+    compact.type = (uint8_t)node->type;
+    compact.operand[AST_COMPACT_LEFT] = AST_COMPACT_NONE;
+    compact.operand[AST_COMPACT_RIGHT] = AST_COMPACT_NONE;
+    compact.first_child = AST_COMPACT_NONE;
+    compact.next_sibling = AST_COMPACT_NONE;
+    compact.parent = parent;
+    compact.line = (uint32_t)node->line;
+    compact.column = (uint32_t)node->column;
+    compact.text = AST_COMPACT_NONE;
+    compact.literal = AST_COMPACT_NONE;
+
+    const ast_node_t *left = NULL;
+    const ast_node_t *right = NULL;
+    const char *text = NULL;
+
+    switch (node->type) {
+        case AST_DECISION:
+            text = node->data.decision.condition;
+            compact.op = (uint8_t)node->data.decision.condition_type;
+            compact.value.integer = node->data.decision.priority;
+            left = node->data.decision.true_branch;
+            right = node->data.decision.false_branch;
+            break;
+
+        case AST_CONSEQUENCE:
+            text = node->data.consequence.action;
+            compact.op = (uint8_t)node->data.consequence.type;
+            compact.value.weight = node->data.consequence.weight;
+            if (node->data.consequence.executed) {
+                compact.flags |= AST_COMPACT_EXECUTED;
+            }
+            break;
+
+        case AST_RULE:
+            text = node->data.rule.name;
+            compact.value.integer = (int64_t)node->data.rule.execution_count;
+            if (node->data.rule.is_active) {
+                compact.flags |= AST_COMPACT_ACTIVE;
+            }
+            left = node->data.rule.body;
+            break;
+
+        case AST_LOGIC_OP:
+            compact.op = (uint8_t)node->data.logic_op.op;
+            left = node->data.logic_op.left;
+            right = node->data.logic_op.right;
+            break;
+
+        case AST_COMPARISON:
+            compact.op = (uint8_t)node->data.comparison.op;
+            left = node->data.comparison.left;
+            right = node->data.comparison.right;
+            break;
+
+        case AST_IDENTIFIER:
+        case AST_IMPORT:
+            text = node->data.identifier.name;
+            break;
+
+        case AST_LITERAL:
+            if (!ast_compact_grow((void **)&tree->literals, &tree->literal_capacity,
+                                  tree->literal_count + 1, sizeof(reasons_value_t),
+                                  AST_COMPACT_INITIAL_NODES)) {
+                return AST_COMPACT_NONE;
+            }
+            compact.literal = (uint32_t)tree->literal_count;
+            tree->literals[tree->literal_count++] = node->data.literal.value;
+            if (node->data.literal.value.type == VALUE_STRING) {
+                /* Bound to the intern table once it stops moving */
+                text = node->data.literal.value.data.string_val;
+                tree->literals[compact.literal].data.string_val = NULL;
+            }
+            break;
+
+        case AST_CHAIN:
+            compact.op = (uint8_t)node->data.chain.chain_type;
+            left = node->data.chain.first;
+            right = node->data.chain.second;
+            break;
+
+        default:
+            break;
+    }
+
+    if (text) {
+        compact.text = ast_compact_intern(tree, text);
+        if (compact.text == AST_COMPACT_NONE) {
+            return AST_COMPACT_NONE;
+        }
+    }
+
+    /* The array may move while children are appended; write through the index */
+    tree->nodes[index] = compact;
+
+    if (left) {
+        uint32_t child = ast_compact_emit(tree, left, index, depth + 1);
+        if (child == AST_COMPACT_NONE) {
+            return AST_COMPACT_NONE;
+        }
+        tree->nodes[index].operand[AST_COMPACT_LEFT] = child;
+    }
+    if (right) {
+        uint32_t child = ast_compact_emit(tree, right, index, depth + 1);
+        if (child == AST_COMPACT_NONE) {
+            return AST_COMPACT_NONE;
+        }
+        tree->nodes[index].operand[AST_COMPACT_RIGHT] = child;
+    }
+
+    uint32_t last = AST_COMPACT_NONE;
+    for (const ast_node_t *child = node->first_child; child; child = child->next_sibling) {
+        uint32_t emitted = ast_compact_emit(tree, child, index, depth + 1);
+        if (emitted == AST_COMPACT_NONE) {
+            return AST_COMPACT_NONE;
+        }
+
+        if (last == AST_COMPACT_NONE) {
+            tree->nodes[index].first_child = emitted;
+        } else {
+            tree->nodes[last].next_sibling = emitted;
+        }
+        last = emitted;
+    }
+
+    tree->nodes[index].end = (uint32_t)tree->count;
+    return index;
+}
+
+/* Returns the offset of text in the intern table, adding it if new */
+static uint32_t ast_compact_intern(ast_compact_t *tree, const char *text)
+{
+    if ((tree->slot_count + 1) * 4 > tree->slot_capacity * 3 &&
+        !ast_compact_rehash(tree, tree->slot_capacity ? tree->slot_capacity * 2 :
+                                                        AST_COMPACT_INITIAL_SLOTS)) {
+        return AST_COMPACT_NONE;
+    }
+
+    size_t length = strlen(text);
+    size_t mask = tree->slot_capacity - 1;
+    size_t slot = ast_compact_hash(text, length) & mask;
+
+    while (tree->slots[slot] != AST_COMPACT_NONE) {
+        const char *existing = tree->strings + tree->slots[slot];
+        if (strncmp(existing, text, length) == 0 && existing[length] == '\0') {
+            return tree->slots[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (tree->string_size + length + 1 >= AST_COMPACT_NONE) {
+        error_set(ERROR_INVALID_STATE, "Compact AST string table full");
+        return AST_COMPACT_NONE;
+    }
+    if (!ast_compact_grow((void **)&tree->strings, &tree->string_capacity,
+                          tree->string_size + length + 1, 1, AST_COMPACT_INITIAL_STRINGS)) {
+        return AST_COMPACT_NONE;
+    }
+
+    uint32_t offset = (uint32_t)tree->string_size;
+    memcpy(tree->strings + offset, text, length + 1);
+    tree->string_size += length + 1;
+    tree->slots[slot] = offset;
+    tree->slot_count++;
+    return offset;
+}
+
+static bool ast_compact_rehash(ast_compact_t *tree, size_t capacity)
+{
+    uint32_t *slots = memory_allocate(capacity * sizeof(uint32_t));
+    if (!slots) {
+        error_set(ERROR_MEMORY, "Failed to allocate intern table");
+        return false;
+    }
+    memset(slots, 0xff, capacity * sizeof(uint32_t));
+
+    for (size_t i = 0; i < tree->slot_capacity; i++) {
+        uint32_t offset = tree->slots[i];
+        if (offset == AST_COMPACT_NONE) {
+            continue;
+        }
+
+        const char *text = tree->strings + offset;
+        size_t slot = ast_compact_hash(text, strlen(text)) & (capacity - 1);
+        while (slots[slot] != AST_COMPACT_NONE) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        slots[slot] = offset;
+    }
+
+    memory_free(tree->slots);
+    tree->slots = slots;
+    tree->slot_capacity = capacity;
+    return true;
+}
+
+/* FNV-1a */
+static uint32_t ast_compact_hash(const char *text, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Points string literals at their interned text */
+static void ast_compact_bind_literals(ast_compact_t *tree)
+{
+    for (size_t i = 0; i < tree->count; i++) {
+        const ast_compact_node_t *node = &tree->nodes[i];
+        if (node->type == AST_LITERAL && node->text != AST_COMPACT_NONE) {
+            tree->literals[node->literal].data.string_val = tree->strings + node->text;
+        }
+    }
+}
+
+/* Postorder without recursion: the preorder layout puts every node's
+ * operands and children, in order, between it and its end.  A node is
+ * finished when a leaf closes its range, and so is each ancestor whose
+ * range closes at the same point; the parent links walk back up. */
+static bool ast_compact_postorder(const ast_compact_t *tree, uint32_t index,
+                                  ast_compact_visitor_func_t visitor, void *user_data)
+{
+    uint32_t end = tree->nodes[index].end;
+
+    for (uint32_t i = index; i < end; i++) {
+        if (tree->nodes[i].end != i + 1) {
+            continue;
+        }
+
+        uint32_t node = i;
+        for (;;) {
+            if (!visitor(tree, node, user_data)) {
+                return false;
+            }
+            if (node == index) {
+                return true;
+            }
+
+            uint32_t parent = tree->nodes[node].parent;
+            if (parent < index || tree->nodes[parent].end != tree->nodes[node].end) {
+                break;
+            }
+            node = parent;
+        }
+    }
+
+    return true;
+}
+
+/* Type known and op within the enum that type stores in it */
+static bool ast_compact_check_op(const ast_compact_node_t *node)
+{
+    switch (node->type) {
+        case AST_DECISION:
+            return node->op < CONDITION_TYPE_COUNT;
+        case AST_CONSEQUENCE:
+            return node->op < CONSEQUENCE_TYPE_COUNT;
+        case AST_LOGIC_OP:
+            return node->op < LOGIC_OP_COUNT;
+        case AST_COMPARISON:
+            return node->op < COMPARISON_OP_COUNT;
+        case AST_CHAIN:
+            return node->op < CHAIN_TYPE_COUNT;
+        case AST_PROGRAM:
+        case AST_RULE:
+        case AST_IDENTIFIER:
+        case AST_LITERAL:
+        case AST_IMPORT:
+            return node->op == 0;
+        default:
+            return false;
+    }
+}
+
+/* Every link in range and every subtree nested in its parent's, so that
+ * traversals of an untrusted tree stay inside it */
+static bool ast_compact_check(const ast_compact_t *tree)
+{
+    if (tree->string_size > 0 && tree->strings[tree->string_size - 1] != '\0') {
+        return false;
+    }
+    if (tree->nodes[0].parent != AST_COMPACT_NONE || tree->nodes[0].end != tree->count) {
+        return false;
+    }
+
+    for (size_t i = 0; i < tree->count; i++) {
+        const ast_compact_node_t *node = &tree->nodes[i];
+
+        if (!ast_compact_check_op(node)) {
+            return false;
+        }
+        if (node->end <= i || node->end > tree->count) {
+            return false;
+        }
+        if (i > 0 && (node->parent >= i || tree->nodes[node->parent].end < node->end)) {
+            return false;
+        }
+
+        uint32_t links[4] = { node->operand[0], node->operand[1], node->first_child,
+                              node->next_sibling };
+        for (int link = 0; link < 4; link++) {
+            if (links[link] == AST_COMPACT_NONE) {
+                continue;
+            }
+            if (links[link] <= i || links[link] >= tree->count) {
+                return false;
+            }
+            /* Children lie inside the subtree; siblings after it */
+            bool child = link < 3;
+            if (child ? links[link] >= node->end : links[link] < node->end) {
+                return false;
+            }
+        }
+
+        if (node->text != AST_COMPACT_NONE && node->text >= tree->string_size) {
+            return false;
+        }
+        if (node->type == AST_LITERAL) {
+            if (node->literal >= tree->literal_count) {
+                return false;
+            }
+            /* Only scalars survive compaction; a string needs its text */
+            ValueType type = tree->literals[node->literal].type;
+            if (type > VALUE_STRING || (type == VALUE_STRING && node->text == AST_COMPACT_NONE)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
@@ -22,29 +22,37 @@
 #include "reasons/ast.h"
 #include "reasons/trace.h"
 #include "reasons/explain.h"
+#include "reasons/import.h"
 #include "reasons/runtime.h"
 #include "reasons/types.h"
 #include "utils/error.h"
 #include "utils/memory.h"
 #include "utils/logger.h"
 #include "utils/collections.h"
+#include "utils/small_vector.h"
 #include "stdlib/math.h"
 #include "stdlib/string.h"
 #include "stdlib/stats.h"
 
+/* Active rule stack; rule nesting rarely exceeds the inline slots */
+SMALL_VECTOR_DEFINE(rule_stack_t, rule_stack, ast_node_t *, 16)
+
 /* Evaluation context structure */
 struct eval_context {
     runtime_env_t *env;             /* Runtime environment */
     trace_t *trace;                 /* Execution tracer */
     explain_engine_t *explainer;    /* Explanation engine */
     hash_table_t *cache;            /* Result cache for memoization */
-    vector_t *call_stack;           /* Function call stack */
+    rule_stack_t call_stack;        /* Function call stack */
     bool golf_mode;                 /* Enable golf optimizations */
     bool tracing_enabled;           /* Control tracing */
     bool explanation_mode;          /* Generate explanations */
     unsigned recursion_depth;       /* Current recursion depth */
     unsigned max_recursion_depth;   /* Maximum allowed depth */
     eval_stats_t stats;             /* Evaluation statistics */
+    import_scope_t *imports;        /* Rules from `use`d modules */
+    bool owns_imports;              /* Scope created by a `use` statement */
+    char *base_dir;                 /* Where that scope resolves paths */
 };
 
 /* Forward declarations */
@@ -56,6 +64,8 @@ static reasons_value_t eval_logic_op(eval_context_t *ctx, ast_node_t *node);
 static reasons_value_t eval_comparison(eval_context_t *ctx, ast_node_t *node);
 static reasons_value_t eval_chain(eval_context_t *ctx, ast_node_t *node);
 static reasons_value_t eval_ternary(eval_context_t *ctx, ast_node_t *node);
+static reasons_value_t eval_import(eval_context_t *ctx, ast_node_t *node);
+static reasons_value_t eval_identifier(eval_context_t *ctx, ast_node_t *node);
 static bool is_truthy(const reasons_value_t *value);
 static bool is_equal(const reasons_value_t *a, const reasons_value_t *b);
 
@@ -73,7 +83,7 @@ eval_context_t *eval_context_create(runtime_env_t *env)
     ctx->trace = trace_create();
     ctx->explainer = explain_create();
     ctx->cache = hash_create(64);
-    ctx->call_stack = vector_create(16);
+    rule_stack_init(&ctx->call_stack);
     ctx->max_recursion_depth = EVAL_MAX_RECURSION_DEPTH;
     ctx->tracing_enabled = true;
     ctx->explanation_mode = true;
@@ -95,7 +105,11 @@ void eval_context_destroy(eval_context_t *ctx)
     trace_destroy(ctx->trace);
     explain_destroy(ctx->explainer);
     hash_destroy(ctx->cache);
-    vector_destroy(ctx->call_stack);
+    rule_stack_destroy(&ctx->call_stack);
+    if (ctx->owns_imports) {
+        import_scope_destroy(ctx->imports);
+    }
+    memory_free(ctx->base_dir);
     memory_free(ctx);
 }
 
@@ -120,6 +134,35 @@ void eval_set_max_recursion(eval_context_t *ctx, unsigned max_depth)
     if (ctx) ctx->max_recursion_depth = max_depth;
 }
 
+void eval_set_imports(eval_context_t *ctx, import_scope_t *imports)
+{
+    if (!ctx) return;
+
+    if (ctx->owns_imports) {
+        import_scope_destroy(ctx->imports);
+    }
+    ctx->imports = imports;
+    ctx->owns_imports = false;
+}
+
+void eval_set_base_dir(eval_context_t *ctx, const char *dir)
+{
+    if (!ctx) return;
+
+    if (ctx->base_dir && dir && strcmp(ctx->base_dir, dir) == 0) {
+        return;
+    }
+
+    /* A scope resolving against the old directory is started over */
+    if (ctx->owns_imports) {
+        import_scope_destroy(ctx->imports);
+        ctx->imports = NULL;
+        ctx->owns_imports = false;
+    }
+    memory_free(ctx->base_dir);
+    ctx->base_dir = dir ? string_duplicate(dir) : NULL;
+}
+
 /* Main evaluation entry point */
 reasons_value_t eval_tree(eval_context_t *ctx, ast_node_t *root)
 {
@@ -191,7 +234,10 @@ static reasons_value_t eval_node(eval_context_t *ctx, ast_node_t *node)
             result = eval_comparison(ctx, node);
             break;
         case AST_IDENTIFIER:
-            result = runtime_get_variable(ctx->env, node->data.identifier.name);
+            result = eval_identifier(ctx, node);
+            break;
+        case AST_IMPORT:
+            result = eval_import(ctx, node);
             break;
         case AST_LITERAL:
             result = node->data.literal.value;
@@ -322,23 +368,30 @@ static reasons_value_t eval_rule(eval_context_t *ctx, ast_node_t *node)
     }
     
     /* Check recursion (prevent infinite loops) */
-    if (vector_contains(ctx->call_stack, node)) {
-        error_set(ERROR_EVAL_RECURSION, "Rule recursion detected");
-        reasons_value_t error_value = {VALUE_ERROR};
-        return error_value;
+    for (size_t i = 0; i < ctx->call_stack.size; i++) {
+        if (ctx->call_stack.data[i] == node) {
+            error_set(ERROR_EVAL_RECURSION, "Rule recursion detected");
+            reasons_value_t error_value = {VALUE_ERROR};
+            return error_value;
+        }
     }
     
     /* Add to call stack */
-    vector_push(ctx->call_stack, node);
+    if (!rule_stack_push(&ctx->call_stack, node)) {
+        error_set(ERROR_MEMORY, "Failed to grow rule call stack");
+        reasons_value_t error_value = {VALUE_ERROR};
+        return error_value;
+    }
     
     /* Execute rule body */
     reasons_value_t result = eval_node(ctx, node->data.rule.body);
     
     /* Remove from call stack */
-    vector_pop(ctx->call_stack);
+    rule_stack_pop(&ctx->call_stack);
     
-    /* Update rule stats */
-    node->data.rule.execution_count++;
+    /* Update rule stats; imported rules are shared by every context through
+     * the module cache, so the count is bumped atomically */
+    __atomic_fetch_add(&node->data.rule.execution_count, 1, __ATOMIC_RELAXED);
     ctx->stats.rules_executed++;
     
     /* Record execution */
@@ -494,6 +547,37 @@ static reasons_value_t eval_chain(eval_context_t *ctx, ast_node_t *node)
     return result;
 }
 
+/* Import statement evaluation: records the module, loads nothing yet */
+static reasons_value_t eval_import(eval_context_t *ctx, ast_node_t *node)
+{
+    reasons_value_t result = {VALUE_NULL};
+    
+    if (!ctx->imports) {
+        ctx->imports = import_scope_create(ctx->base_dir);
+        ctx->owns_imports = ctx->imports != NULL;
+    }
+    
+    if (!ctx->imports || !import_scope_add(ctx->imports, node->data.identifier.name)) {
+        result.type = VALUE_ERROR;
+    }
+    return result;
+}
+
+/* Identifier evaluation: variables first, then rules of imported modules */
+static reasons_value_t eval_identifier(eval_context_t *ctx, ast_node_t *node)
+{
+    const char *name = node->data.identifier.name;
+    
+    if (ctx->imports && !runtime_variable_exists(ctx->env, name)) {
+        ast_node_t *rule = import_scope_find_rule(ctx->imports, name);
+        if (rule) {
+            return eval_rule(ctx, rule);
+        }
+    }
+    
+    return runtime_get_variable(ctx->env, name);
+}
+
 /* Helper functions */
 static bool is_truthy(const reasons_value_t *value)
 {
@@ -499,7 +499,7 @@ static void explain_errors(explain_engine_t *engine)
 /* Helper functions */
 static void explain_append(explain_engine_t *engine, const char *format, ...)
 {
-    if (!engine) return;
+    if (!engine || engine->stats.truncated) return;
     
     va_list args;
     va_start(args, format);
@@ -515,8 +515,20 @@ static void explain_append(explain_engine_t *engine, const char *format, ...)
     size_t new_len = engine->output_len + needed + 2;  // +1 for \n, +1 for \0
     if (new_len > engine->output_size) {
         size_t new_size = (new_len * 3) / 2;  // 1.5x growth factor
-        char *new_output = memory_reallocate(engine->output, new_size);
+        
+        /* Over budget the explanation is cut short rather than grown */
+        if (!memory_budget_check(MEM_TAG_EXPLAIN, new_size)) {
+            engine->stats.truncated = true;
+            LOG_WARN("Explanation memory budget reached, output truncated");
+            va_end(args);
+            return;
+        }
+        
+        char *new_output = engine->output ?
+            memory_reallocate(engine->output, new_size) :
+            mem_alloc_tagged(new_size, MEM_TAG_EXPLAIN);
         if (!new_output) {
+            engine->stats.truncated = true;
             va_end(args);
             return;
         }
@@ -651,6 +663,10 @@ static const char *get_node_description(const ast_node_t *node)
             snprintf(buffer, sizeof(buffer), "Identifier: \"%s\"", 
                     node->data.identifier.name);
             break;
+        case AST_IMPORT:
+            snprintf(buffer, sizeof(buffer), "Import: \"%s\"", 
+                    node->data.identifier.name);
+            break;
         case AST_LITERAL:
             {
                 char value_str[128];
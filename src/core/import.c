@@ -0,0 +1,585 @@
+/*
+ * import.c - Module Imports for Reasons DSL
+ *
+ * Features:
+ * - Import scopes that resolve `use` paths lazily, on first reference
+ * - Process-wide module cache keyed by a hash of the module's contents
+ * - On-disk cache of precompiled modules (.rsc), mapped instead of parsed
+ * - Per-rule conversion: only rules that are referenced are built for the
+ *   evaluator, and each only once per process
+ */
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "reasons/import.h"
+#include "reasons/ast.h"
+#include "reasons/ast_compact.h"
+#include "reasons/lexer.h"
+#include "reasons/module.h"
+#include "reasons/parser.h"
+#include "utils/error.h"
+#include "utils/memory.h"
+#include "utils/logger.h"
+
+#define IMPORT_SOURCE_EXTENSION ".reasons"
+#define IMPORT_INITIAL_ENTRIES 8
+
+/* Rule exported by a module */
+typedef struct {
+    uint32_t index;                   /* Compact node of the rule */
+    const char *name;                 /* In the module's string table */
+    ast_node_t *node;                 /* Pointer form, built on first reference */
+} import_rule_t;
+
+/* Loaded module, shared by every scope that imports the same contents.
+ * Identical files in different directories share it, so where its own
+ * imports resolve is kept per scope entry, not here. */
+typedef struct import_module {
+    uint64_t hash;                    /* Of the file contents */
+    CompiledModule *mapped;           /* Loaded from a .rsc file, or */
+    ast_compact_t *owned;             /* parsed from source */
+    const ast_compact_t *tree;
+
+    import_rule_t *rules;
+    size_t rule_count;
+    const char **imports;             /* Paths the module itself uses */
+    size_t import_count;
+
+    struct import_module *next;
+} import_module_t;
+
+typedef struct {
+    char *path;                       /* As written */
+    char *dir;                        /* Directory it is relative to */
+    char *module_dir;                 /* Of the file it resolved to; base for its imports */
+    import_module_t *module;          /* NULL until loaded */
+    bool failed;                      /* Reported once, not retried */
+} import_entry_t;
+
+struct import_scope {
+    char *base_dir;
+    import_entry_t *entries;          /* In import order */
+    size_t count;
+    size_t capacity;
+};
+
+/* Process-wide module cache */
+static struct {
+    pthread_mutex_t lock;
+    import_module_t *modules;
+    char *cache_dir;
+    bool disk_disabled;
+    import_statistics_t stats;
+} g_imports = { PTHREAD_MUTEX_INITIALIZER, NULL, NULL, false, {0} };
+
+/* Forward declarations */
+static bool import_scope_append(import_scope_t *scope, const char *path, const char *dir);
+static import_module_t *import_load(const char *path, const char *dir, char **module_dir);
+static char *import_resolve(const char *path, const char *dir);
+static char *import_read_file(const char *path, size_t *length);
+static uint64_t import_hash(const char *data, size_t length);
+static const char *import_cache_dir(void);
+static ast_compact_t *import_parse(const char *source, const char *path);
+static bool import_index_module(import_module_t *module);
+static void import_module_destroy(import_module_t *module);
+static char *import_join(const char *dir, const char *name, const char *suffix);
+static char *import_dirname(const char *path);
+
+/* Scopes */
+
+import_scope_t *import_scope_create(const char *base_dir)
+{
+    import_scope_t *scope = memory_allocate(sizeof(import_scope_t));
+    if (!scope) {
+        error_set(ERROR_MEMORY, "Failed to allocate import scope");
+        return NULL;
+    }
+
+    memset(scope, 0, sizeof(import_scope_t));
+    scope->base_dir = string_duplicate(base_dir && *base_dir ? base_dir : ".");
+    if (!scope->base_dir) {
+        memory_free(scope);
+        return NULL;
+    }
+    return scope;
+}
+
+void import_scope_destroy(import_scope_t *scope)
+{
+    if (!scope) {
+        return;
+    }
+
+    /* Modules belong to the process cache */
+    for (size_t i = 0; i < scope->count; i++) {
+        memory_free(scope->entries[i].path);
+        memory_free(scope->entries[i].dir);
+        memory_free(scope->entries[i].module_dir);
+    }
+    memory_free(scope->entries);
+    memory_free(scope->base_dir);
+    memory_free(scope);
+}
+
+bool import_scope_add(import_scope_t *scope, const char *path)
+{
+    if (!scope || !path || !*path) {
+        error_set(ERROR_INVALID_ARGUMENT, "Import path cannot be empty");
+        return false;
+    }
+
+    return import_scope_append(scope, path, scope->base_dir);
+}
+
+ast_node_t *import_scope_find_rule(import_scope_t *scope, const char *name)
+{
+    if (!scope || !name) {
+        return NULL;
+    }
+
+    /* Entries appended by loading a module are searched in the same pass */
+    for (size_t i = 0; i < scope->count; i++) {
+        import_entry_t *entry = &scope->entries[i];
+        if (!entry->module && !entry->failed) {
+            entry->module = import_load(entry->path, entry->dir, &entry->module_dir);
+            entry->failed = !entry->module;
+            if (entry->module) {
+                /* Appending may move the entries; the strings stay put */
+                import_module_t *module = entry->module;
+                const char *module_dir = entry->module_dir;
+                for (size_t j = 0; j < module->import_count; j++) {
+                    import_scope_append(scope, module->imports[j], module_dir);
+                }
+                entry = &scope->entries[i];
+            }
+        }
+        if (!entry->module) {
+            continue;
+        }
+
+        import_module_t *module = entry->module;
+        for (size_t j = 0; j < module->rule_count; j++) {
+            import_rule_t *rule = &module->rules[j];
+            if (strcmp(rule->name, name) != 0) {
+                continue;
+            }
+
+            pthread_mutex_lock(&g_imports.lock);
+            if (!rule->node) {
+                rule->node = ast_compact_to_ast(module->tree, rule->index);
+                if (rule->node) {
+                    g_imports.stats.rules_materialized++;
+                }
+            }
+            ast_node_t *node = rule->node;
+            pthread_mutex_unlock(&g_imports.lock);
+            return node;
+        }
+    }
+
+    return NULL;
+}
+
+/* Process-wide cache */
+
+void import_set_cache_dir(const char *dir)
+{
+    pthread_mutex_lock(&g_imports.lock);
+    memory_free(g_imports.cache_dir);
+    g_imports.cache_dir = dir ? string_duplicate(dir) : NULL;
+    pthread_mutex_unlock(&g_imports.lock);
+}
+
+void import_set_disk_cache(bool enabled)
+{
+    pthread_mutex_lock(&g_imports.lock);
+    g_imports.disk_disabled = !enabled;
+    pthread_mutex_unlock(&g_imports.lock);
+}
+
+void import_cache_clear(void)
+{
+    pthread_mutex_lock(&g_imports.lock);
+    import_module_t *module = g_imports.modules;
+    while (module) {
+        import_module_t *next = module->next;
+        import_module_destroy(module);
+        module = next;
+    }
+    g_imports.modules = NULL;
+    memset(&g_imports.stats, 0, sizeof(g_imports.stats));
+    pthread_mutex_unlock(&g_imports.lock);
+}
+
+void import_get_statistics(import_statistics_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_imports.lock);
+    *stats = g_imports.stats;
+    pthread_mutex_unlock(&g_imports.lock);
+}
+
+/* Internal helper functions */
+
+static bool import_scope_append(import_scope_t *scope, const char *path, const char *dir)
+{
+    for (size_t i = 0; i < scope->count; i++) {
+        if (strcmp(scope->entries[i].path, path) == 0 && strcmp(scope->entries[i].dir, dir) == 0) {
+            return true;
+        }
+    }
+
+    if (scope->count == scope->capacity) {
+        size_t capacity = scope->capacity ? scope->capacity * 2 : IMPORT_INITIAL_ENTRIES;
+        import_entry_t *entries = memory_reallocate(scope->entries, capacity * sizeof(import_entry_t));
+        if (!entries) {
+            error_set(ERROR_MEMORY, "Failed to grow import scope");
+            return false;
+        }
+        scope->entries = entries;
+        scope->capacity = capacity;
+    }
+
+    import_entry_t *entry = &scope->entries[scope->count];
+    memset(entry, 0, sizeof(import_entry_t));
+    entry->path = string_duplicate(path);
+    entry->dir = string_duplicate(dir);
+    if (!entry->path || !entry->dir) {
+        memory_free(entry->path);
+        memory_free(entry->dir);
+        return false;
+    }
+
+    scope->count++;
+    return true;
+}
+
+/* Finds the module for path in the process cache, else maps it from the
+ * disk cache, else parses it (and stores it in the disk cache). The
+ * directory of the file path resolved to goes to *module_dir. */
+static import_module_t *import_load(const char *path, const char *dir, char **module_dir)
+{
+    char *resolved = import_resolve(path, dir);
+    if (!resolved) {
+        LOG_ERROR("Cannot find module '%s'", path);
+        return NULL;
+    }
+
+    size_t length = 0;
+    char *contents = import_read_file(resolved, &length);
+    if (!contents) {
+        LOG_ERROR("Cannot read module %s", resolved);
+        memory_free(resolved);
+        return NULL;
+    }
+    uint64_t hash = import_hash(contents, length);
+
+    /* Held across loading so two threads never parse the same module */
+    pthread_mutex_lock(&g_imports.lock);
+
+    import_module_t *module = g_imports.modules;
+    while (module && module->hash != hash) {
+        module = module->next;
+    }
+    if (module) {
+        g_imports.stats.memory_hits++;
+        pthread_mutex_unlock(&g_imports.lock);
+        memory_free(contents);
+        *module_dir = import_dirname(resolved);
+        memory_free(resolved);
+        return *module_dir ? module : NULL;
+    }
+
+    module = memory_allocate(sizeof(import_module_t));
+    if (!module) {
+        pthread_mutex_unlock(&g_imports.lock);
+        memory_free(contents);
+        memory_free(resolved);
+        return NULL;
+    }
+    memset(module, 0, sizeof(import_module_t));
+    module->hash = hash;
+
+    const char *cache_dir = g_imports.disk_disabled ? NULL : import_cache_dir();
+    char *cache_path = NULL;
+    if (cache_dir) {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+        cache_path = import_join(cache_dir, name, MODULE_EXTENSION);
+    }
+
+    if (module_is_module_path(resolved)) {
+        module->mapped = module_load(resolved);
+    } else {
+        if (cache_path && access(cache_path, R_OK) == 0) {
+            module->mapped = module_load(cache_path);
+            if (module->mapped) {
+                g_imports.stats.disk_hits++;
+            }
+        }
+        if (!module->mapped) {
+            module->owned = import_parse(contents, resolved);
+            if (module->owned) {
+                g_imports.stats.parses++;
+                if (cache_path && !module_write(cache_path, module->owned)) {
+                    LOG_DEBUG("Could not cache module %s as %s", resolved, cache_path);
+                }
+            }
+        }
+    }
+    module->tree = module->mapped ? module_tree(module->mapped) : module->owned;
+
+    memory_free(cache_path);
+    memory_free(contents);
+
+    if (!module->tree || !import_index_module(module)) {
+        pthread_mutex_unlock(&g_imports.lock);
+        LOG_ERROR("Cannot load module %s", resolved);
+        import_module_destroy(module);
+        memory_free(resolved);
+        return NULL;
+    }
+
+    module->next = g_imports.modules;
+    g_imports.modules = module;
+    g_imports.stats.modules_loaded++;
+    pthread_mutex_unlock(&g_imports.lock);
+
+    LOG_DEBUG("Loaded module %s: %zu rules, %zu imports",
+              resolved, module->rule_count, module->import_count);
+    *module_dir = import_dirname(resolved);
+    memory_free(resolved);
+    return *module_dir ? module : NULL;
+}
+
+/* First existing candidate: relative to dir, then each REASONS_PATH entry */
+static char *import_resolve(const char *path, const char *dir)
+{
+    const char *base = strrchr(path, '/');
+    const char *suffix = strchr(base ? base : path, '.') ? "" : IMPORT_SOURCE_EXTENSION;
+
+    if (path[0] == '/') {
+        char *candidate = import_join(NULL, path, suffix);
+        if (candidate && access(candidate, R_OK) == 0) {
+            return candidate;
+        }
+        memory_free(candidate);
+        return NULL;
+    }
+
+    char *candidate = import_join(dir, path, suffix);
+    if (candidate && access(candidate, R_OK) == 0) {
+        return candidate;
+    }
+    memory_free(candidate);
+
+    const char *search = getenv("REASONS_PATH");
+    while (search && *search) {
+        const char *end = strchr(search, ':');
+        size_t length = end ? (size_t)(end - search) : strlen(search);
+        if (length > 0 && length < PATH_MAX) {
+            char directory[PATH_MAX];
+            memcpy(directory, search, length);
+            directory[length] = '\0';
+
+            candidate = import_join(directory, path, suffix);
+            if (candidate && access(candidate, R_OK) == 0) {
+                return candidate;
+            }
+            memory_free(candidate);
+        }
+        search = end ? end + 1 : NULL;
+    }
+
+    return NULL;
+}
+
+static char *import_read_file(const char *path, size_t *length)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    if (size < 0) {
+        fclose(file);
+        return NULL;
+    }
+
+    char *data = memory_allocate((size_t)size + 1);
+    if (data && fread(data, 1, (size_t)size, file) != (size_t)size) {
+        memory_free(data);
+        data = NULL;
+    }
+    fclose(file);
+
+    if (data) {
+        data[size] = '\0';
+        *length = (size_t)size;
+    }
+    return data;
+}
+
+/* FNV-1a, 64-bit */
+static uint64_t import_hash(const char *data, size_t length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* Called with the lock held */
+static const char *import_cache_dir(void)
+{
+    if (g_imports.cache_dir) {
+        return g_imports.cache_dir;
+    }
+
+    const char *dir = getenv("REASONS_CACHE_DIR");
+    if (dir && *dir) {
+        g_imports.cache_dir = string_duplicate(dir);
+    } else if ((dir = getenv("XDG_CACHE_HOME")) && *dir) {
+        g_imports.cache_dir = import_join(dir, "reasons", "");
+    } else if ((dir = getenv("HOME")) && *dir) {
+        g_imports.cache_dir = import_join(dir, ".cache/reasons", "");
+    }
+    return g_imports.cache_dir;
+}
+
+static ast_compact_t *import_parse(const char *source, const char *path)
+{
+    lexer_t *lexer = lexer_create(source);
+    parser_t *parser = lexer ? parser_create(lexer) : NULL;
+    ast_node_t *program = parser ? parser_parse(parser) : NULL;
+
+    if (!program) {
+        LOG_ERROR("%s: parse failed", path);
+    } else if (parser_had_error(parser)) {
+        /* A recovered parse is partial; it must not be cached or imported */
+        LOG_ERROR("%s: syntax errors, module not loaded", path);
+        ast_destroy(program);
+        program = NULL;
+    }
+
+    ast_compact_t *tree = program ? ast_compact_from_ast(program) : NULL;
+    ast_destroy(program);
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+    return tree;
+}
+
+/* Collects the top-level rules and imports of a module */
+static bool import_index_module(import_module_t *module)
+{
+    const ast_compact_node_t *root = ast_compact_node(module->tree, 0);
+    size_t rules = 0;
+    size_t imports = 0;
+
+    for (uint32_t child = root->first_child; child != AST_COMPACT_NONE;
+         child = ast_compact_node(module->tree, child)->next_sibling) {
+        const ast_compact_node_t *node = ast_compact_node(module->tree, child);
+        if (node->type == AST_RULE && node->text != AST_COMPACT_NONE) rules++;
+        if (node->type == AST_IMPORT && node->text != AST_COMPACT_NONE) imports++;
+    }
+
+    module->rules = rules ? memory_allocate(rules * sizeof(import_rule_t)) : NULL;
+    module->imports = imports ? memory_allocate(imports * sizeof(const char *)) : NULL;
+    if ((rules && !module->rules) || (imports && !module->imports)) {
+        return false;
+    }
+
+    for (uint32_t child = root->first_child; child != AST_COMPACT_NONE;
+         child = ast_compact_node(module->tree, child)->next_sibling) {
+        const ast_compact_node_t *node = ast_compact_node(module->tree, child);
+        if (node->text == AST_COMPACT_NONE) {
+            continue;
+        }
+
+        if (node->type == AST_RULE) {
+            import_rule_t *rule = &module->rules[module->rule_count++];
+            rule->index = child;
+            rule->name = ast_compact_text(module->tree, child);
+            rule->node = NULL;
+        } else if (node->type == AST_IMPORT) {
+            module->imports[module->import_count++] = ast_compact_text(module->tree, child);
+        }
+    }
+
+    return true;
+}
+
+static void import_module_destroy(import_module_t *module)
+{
+    if (!module) {
+        return;
+    }
+
+    for (size_t i = 0; i < module->rule_count; i++) {
+        ast_destroy(module->rules[i].node);
+    }
+    memory_free(module->rules);
+    memory_free(module->imports);
+    module_unload(module->mapped);
+    ast_compact_destroy(module->owned);
+    memory_free(module);
+}
+
+/* dir + "/" + name + suffix; dir may be NULL */
+static char *import_join(const char *dir, const char *name, const char *suffix)
+{
+    size_t dir_length = dir ? strlen(dir) : 0;
+    size_t name_length = strlen(name);
+    size_t suffix_length = strlen(suffix);
+
+    char *path = memory_allocate(dir_length + name_length + suffix_length + 2);
+    if (!path) {
+        return NULL;
+    }
+
+    char *out = path;
+    if (dir_length > 0) {
+        memcpy(out, dir, dir_length);
+        out += dir_length;
+        if (dir[dir_length - 1] != '/') {
+            *out++ = '/';
+        }
+    }
+    memcpy(out, name, name_length);
+    memcpy(out + name_length, suffix, suffix_length + 1);
+    return path;
+}
+
+static char *import_dirname(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    if (!slash) {
+        return string_duplicate(".");
+    }
+    if (slash == path) {
+        return string_duplicate("/");
+    }
+
+    size_t length = (size_t)(slash - path);
+    char *dir = memory_allocate(length + 1);
+    if (dir) {
+        memcpy(dir, path, length);
+        dir[length] = '\0';
+    }
+    return dir;
+}
@@ -0,0 +1,433 @@
+/*
+ * incremental.c - Incremental Reparsing for Reasons DSL
+ *
+ * Keeps a document's token buffer and program between edits:
+ * - Re-lexes only the tokens around an edit (token_buffer_relex)
+ * - Re-parses only the top-level declarations the changed tokens touch,
+ *   growing the region while a reparse runs into the next declaration
+ * - Splices the new declarations into the existing program, keeping the
+ *   nodes of everything that did not change
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "reasons/incremental.h"
+#include "reasons/lexer.h"
+#include "reasons/parser.h"
+#include "reasons/ast.h"
+#include "utils/error.h"
+#include "utils/memory.h"
+#include "utils/logger.h"
+
+/* Re-lexing hands each edit's lexer to the token buffer; past this many the
+ * buffer is rebuilt from scratch so they don't pile up */
+#define INCREMENTAL_MAX_LEXERS 64
+#define INCREMENTAL_INITIAL_DECLS 64
+
+/* Top-level declaration and the source it was parsed from. Ranges tile
+ * the text: end is where the token after the declaration starts. */
+typedef struct {
+    size_t start;
+    size_t end;
+    ast_node_t *node;
+} incremental_decl_t;
+
+struct incremental_doc {
+    char *source;
+    size_t length;
+    token_buffer_t *tokens;
+    ast_node_t *program;
+
+    incremental_decl_t *decls;        /* In program order */
+    size_t decl_count;
+    size_t decl_capacity;
+
+    bool dirty;                       /* [dirty_start, dirty_end) failed to parse */
+    size_t dirty_start;
+    size_t dirty_end;
+
+    incremental_statistics_t stats;
+};
+
+/* Forward declarations */
+static bool incremental_reserve_decls(incremental_decl_t **decls, size_t *capacity,
+                                      size_t needed);
+static size_t incremental_find_token(const token_buffer_t *tokens, size_t offset);
+static double incremental_now_ms(void);
+
+/* Document creation and destruction */
+
+incremental_doc_t *incremental_create(const char *source)
+{
+    if (!source) {
+        error_set(ERROR_INVALID_ARGUMENT, "Source code cannot be null");
+        return NULL;
+    }
+
+    incremental_doc_t *doc = memory_allocate(sizeof(incremental_doc_t));
+    if (!doc) {
+        error_set(ERROR_MEMORY, "Failed to allocate incremental document");
+        return NULL;
+    }
+
+    memset(doc, 0, sizeof(incremental_doc_t));
+    doc->source = memory_allocate(1);
+    doc->tokens = lexer_tokenize_parallel("", NULL, 1);
+    doc->program = ast_create_node(AST_PROGRAM);
+    if (!doc->source || !doc->tokens || !doc->program) {
+        incremental_destroy(doc);
+        return NULL;
+    }
+    doc->source[0] = '\0';
+
+    /* The initial parse is an edit that inserts the whole text */
+    incremental_edit(doc, 0, 0, source, strlen(source));
+    doc->stats.edits = 0;
+
+    LOG_DEBUG("Created incremental document: %zu declarations, %zu tokens",
+              doc->decl_count, doc->tokens->count);
+    return doc;
+}
+
+void incremental_destroy(incremental_doc_t *doc)
+{
+    if (!doc) {
+        return;
+    }
+
+    ast_destroy(doc->program);
+    token_buffer_destroy(doc->tokens);
+    memory_free(doc->decls);
+    memory_free(doc->source);
+    memory_free(doc);
+}
+
+/* Editing */
+
+bool incremental_edit(incremental_doc_t *doc, size_t offset, size_t removed,
+                      const char *text, size_t length)
+{
+    if (!doc || (!text && length > 0) || offset > doc->length ||
+        removed > doc->length - offset) {
+        error_set(ERROR_INVALID_ARGUMENT, "Edit outside the document");
+        return false;
+    }
+
+    double start_ms = incremental_now_ms();
+
+    /* Apply the edit to the text */
+    size_t new_length = doc->length - removed + length;
+    char *source = memory_allocate(new_length + 1);
+    if (!source) {
+        error_set(ERROR_MEMORY, "Failed to allocate document text");
+        return false;
+    }
+    memcpy(source, doc->source, offset);
+    memcpy(source + offset, text, length);
+    memcpy(source + offset + length, doc->source + offset + removed,
+           doc->length - offset - removed);
+    source[new_length] = '\0';
+
+    /* Re-lex the damaged tokens */
+    size_t first_changed = 0;
+    size_t end_changed = 0;
+    token_buffer_t *tokens = token_buffer_relex(doc->tokens, source, offset, removed, length,
+                                                &first_changed, &end_changed);
+    if (!tokens) {
+        memory_free(source);
+        return false;
+    }
+
+    if (tokens->owner_count > INCREMENTAL_MAX_LEXERS) {
+        /* Same tokens at the same indices, one lexer */
+        token_buffer_t *fresh = lexer_tokenize_parallel(source, NULL, 1);
+        if (fresh) {
+            token_buffer_destroy(tokens);
+            tokens = fresh;
+        }
+    }
+
+    token_buffer_destroy(doc->tokens);
+    memory_free(doc->source);
+    doc->tokens = tokens;
+    doc->source = source;
+    doc->length = new_length;
+    doc->stats.tokens_relexed = end_changed - first_changed;
+    doc->stats.edits++;
+
+    /* Move declaration ranges into the new text; positions inside the
+     * removed bytes collapse onto the inserted ones */
+    size_t edit_end = offset + removed;
+    for (size_t i = 0; i < doc->decl_count; i++) {
+        incremental_decl_t *decl = &doc->decls[i];
+        if (decl->start >= edit_end) {
+            decl->start = decl->start - removed + length;
+        } else if (decl->start > offset) {
+            decl->start = offset;
+        }
+        if (decl->end >= edit_end) {
+            decl->end = decl->end - removed + length;
+        } else if (decl->end > offset) {
+            decl->end = offset + length;
+        }
+    }
+    if (doc->dirty) {
+        doc->dirty_start = doc->dirty_start >= edit_end ? doc->dirty_start - removed + length :
+                           doc->dirty_start > offset ? offset : doc->dirty_start;
+        doc->dirty_end = doc->dirty_end >= edit_end ? doc->dirty_end - removed + length :
+                         doc->dirty_end > offset ? offset + length : doc->dirty_end;
+    }
+
+    /* Bytes whose tokens changed; the last old token before the change may
+     * have been the parser's lookahead, so touching ranges count too */
+    size_t change_start = tokens->offsets[first_changed];
+    size_t change_end = end_changed < tokens->count ? tokens->offsets[end_changed] : new_length;
+    if (doc->dirty) {
+        if (doc->dirty_start < change_start) change_start = doc->dirty_start;
+        if (doc->dirty_end > change_end) change_end = doc->dirty_end;
+    }
+
+    size_t first_decl = 0;
+    while (first_decl < doc->decl_count && doc->decls[first_decl].end < change_start) {
+        first_decl++;
+    }
+    size_t next_decl = first_decl;
+    while (next_decl < doc->decl_count && doc->decls[next_decl].start <= change_end) {
+        next_decl++;
+    }
+
+    size_t region_start = change_start;
+    size_t region_end = change_end;
+    if (next_decl > first_decl) {
+        if (doc->decls[first_decl].start < region_start) {
+            region_start = doc->decls[first_decl].start;
+        }
+        if (doc->decls[next_decl - 1].end > region_end) {
+            region_end = doc->decls[next_decl - 1].end;
+        }
+    }
+
+    /* Re-parse declarations from the start of the region until the parser
+     * stops on the start of an untouched declaration (or EOF) past its end */
+    parser_t *parser = parser_create_from_tokens(tokens);
+    if (!parser) {
+        return false;
+    }
+    parser_seek(parser, incremental_find_token(tokens, region_start));
+
+    incremental_decl_t *parsed = NULL;
+    size_t parsed_count = 0;
+    size_t parsed_capacity = 0;
+    bool ok = true;
+    size_t position = parser_position(parser);
+
+    for (;;) {
+        size_t at = tokens->offsets[position];
+        if (tokens->types[position] == TOKEN_EOF) {
+            next_decl = doc->decl_count;
+            break;
+        }
+        if (at >= region_end) {
+            while (next_decl < doc->decl_count && doc->decls[next_decl].start < at) {
+                next_decl++;
+            }
+            if (next_decl < doc->decl_count && doc->decls[next_decl].start == at) {
+                break;
+            }
+        }
+
+        /* Rule bodies recover from a bad statement and still return the
+         * rule, minus that statement; that is a failure here too */
+        ast_node_t *node = parser_parse_declaration(parser);
+        size_t end = parser_position(parser);
+        if (!node || end == position || parser_had_error(parser) ||
+            !incremental_reserve_decls(&parsed, &parsed_capacity, parsed_count + 1)) {
+            ast_destroy(node);
+            region_end = tokens->offsets[end] > region_end ? tokens->offsets[end] : region_end;
+            ok = false;
+            break;
+        }
+
+        parsed[parsed_count].start = at;
+        parsed[parsed_count].end = tokens->offsets[end];
+        parsed[parsed_count].node = node;
+        parsed_count++;
+        position = end;
+    }
+    parser_destroy(parser);
+
+    /* Reserve the range table before touching the program, so a failure
+     * leaves both as they were */
+    size_t replaced = next_decl - first_decl;
+    size_t new_count = doc->decl_count - replaced + parsed_count;
+    if (ok && !incremental_reserve_decls(&doc->decls, &doc->decl_capacity, new_count)) {
+        ok = false;
+    }
+
+    if (!ok) {
+        /* Keep the old declarations; parse this region again next time */
+        for (size_t i = 0; i < parsed_count; i++) {
+            ast_destroy(parsed[i].node);
+        }
+        memory_free(parsed);
+
+        if (!doc->dirty || region_start < doc->dirty_start) doc->dirty_start = region_start;
+        if (!doc->dirty || region_end > doc->dirty_end) doc->dirty_end = region_end;
+        doc->dirty = true;
+        doc->stats.declarations_reparsed = 0;
+        doc->stats.declarations_reused = 0;
+        doc->stats.tokens_total = tokens->count;
+        doc->stats.update_ms = incremental_now_ms() - start_ms;
+        LOG_DEBUG("Incremental reparse failed in bytes %zu..%zu", region_start, region_end);
+        return false;
+    }
+
+    /* Declarations [first_decl, next_decl) are replaced by the parsed ones;
+     * a parsed one equal to the old one in its slot keeps the old node */
+    size_t reused = 0;
+    ast_node_t *after = first_decl > 0 ? doc->decls[first_decl - 1].node : NULL;
+
+    for (size_t i = 0; i < replaced; i++) {
+        ast_node_t *old = doc->decls[first_decl + i].node;
+        ast_remove_child(doc->program, old);
+
+        if (i < parsed_count && ast_equals(old, parsed[i].node)) {
+            ast_destroy(parsed[i].node);
+            parsed[i].node = old;
+            reused++;
+        } else {
+            ast_destroy(old);
+        }
+    }
+    for (size_t i = 0; i < parsed_count; i++) {
+        ast_insert_child(doc->program, after, parsed[i].node);
+        after = parsed[i].node;
+    }
+
+    memmove(doc->decls + first_decl + parsed_count, doc->decls + next_decl,
+            (doc->decl_count - next_decl) * sizeof(incremental_decl_t));
+    if (parsed_count > 0) {
+        memcpy(doc->decls + first_decl, parsed, parsed_count * sizeof(incremental_decl_t));
+    }
+    doc->decl_count = new_count;
+    memory_free(parsed);
+
+    doc->dirty = false;
+    doc->stats.declarations_reparsed = parsed_count;
+    doc->stats.declarations_reused = reused;
+    doc->stats.declarations_total = doc->decl_count;
+    doc->stats.tokens_total = tokens->count;
+    doc->stats.update_ms = incremental_now_ms() - start_ms;
+
+    LOG_DEBUG("Incremental update: %zu tokens re-lexed, %zu declarations reparsed "
+              "(%zu unchanged) in %.3f ms", doc->stats.tokens_relexed, parsed_count,
+              reused, doc->stats.update_ms);
+    return true;
+}
+
+bool incremental_update(incremental_doc_t *doc, const char *source)
+{
+    if (!doc || !source) {
+        error_set(ERROR_INVALID_ARGUMENT, "Document and source cannot be null");
+        return false;
+    }
+
+    /* Common prefix and suffix; whatever differs in between is the edit */
+    size_t length = strlen(source);
+    size_t limit = length < doc->length ? length : doc->length;
+    size_t prefix = 0;
+    while (prefix < limit && source[prefix] == doc->source[prefix]) {
+        prefix++;
+    }
+
+    size_t suffix = 0;
+    while (suffix < limit - prefix &&
+           source[length - 1 - suffix] == doc->source[doc->length - 1 - suffix]) {
+        suffix++;
+    }
+
+    if (prefix == length && length == doc->length) {
+        /* Unchanged text; still retry a region that failed to parse */
+        return doc->dirty ? incremental_edit(doc, 0, 0, "", 0) : true;
+    }
+
+    return incremental_edit(doc, prefix, doc->length - prefix - suffix, source + prefix,
+                            length - prefix - suffix);
+}
+
+/* Accessors */
+
+ast_node_t *incremental_program(const incremental_doc_t *doc)
+{
+    return doc ? doc->program : NULL;
+}
+
+const char *incremental_source(const incremental_doc_t *doc)
+{
+    return doc ? doc->source : NULL;
+}
+
+bool incremental_has_errors(const incremental_doc_t *doc)
+{
+    return doc && doc->dirty;
+}
+
+void incremental_get_statistics(const incremental_doc_t *doc, incremental_statistics_t *stats)
+{
+    if (!doc || !stats) {
+        return;
+    }
+
+    *stats = doc->stats;
+}
+
+/* Internal helper functions */
+
+static bool incremental_reserve_decls(incremental_decl_t **decls, size_t *capacity,
+                                      size_t needed)
+{
+    if (needed <= *capacity) {
+        return true;
+    }
+
+    size_t new_capacity = *capacity ? *capacity : INCREMENTAL_INITIAL_DECLS;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+
+    incremental_decl_t *grown = memory_reallocate(*decls, new_capacity * sizeof(incremental_decl_t));
+    if (!grown) {
+        error_set(ERROR_MEMORY, "Failed to grow declaration table");
+        return false;
+    }
+    *decls = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+/* Index of the first token starting at or after offset (EOF if none) */
+static size_t incremental_find_token(const token_buffer_t *tokens, size_t offset)
+{
+    size_t low = 0;
+    size_t high = tokens->count - 1;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (tokens->offsets[mid] < offset) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static double incremental_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
@@ -12,6 +12,12 @@
  * - Error recovery and detailed error reporting
  * - Lookahead support for parser disambiguation
  * - Comments and whitespace handling
+ * - Zero-copy tokens: slices of the source, with escape-processed string
+ *   literals interned once in lexer-owned storage
+ * - Vectorized (SSE2) skipping of whitespace, comments, identifiers and
+ *   digit runs with a table-driven scalar fallback
+ * - Whole-input tokenization into structure-of-arrays token buffers,
+ *   optionally split at safe line boundaries across threads
  */
 
 #include <assert.h>
@@ -20,6 +26,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include "reasons/lexer.h"
 #include "reasons/types.h"
@@ -28,6 +36,55 @@
 #include "utils/logger.h"
 #include "utils/string_utils.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LEXER_USE_SSE2 1
+#endif
+
+/* Character classes for the scanning fast paths */
+#define LEXER_CHAR_SPACE 0x01   /* isspace() in the C locale */
+#define LEXER_CHAR_IDENT 0x02   /* [A-Za-z0-9_] */
+#define LEXER_CHAR_DIGIT 0x04   /* [0-9] */
+#define LEXER_CHAR_HEX   0x08   /* [0-9A-Fa-f] */
+
+static const unsigned char g_char_class[256] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00,  /* 00 */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* 10 */
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* 20 */
+    0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* 30 */
+    0x00, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,  /* 40 */
+    0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00, 0x02,  /* 50 */
+    0x00, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,  /* 60 */
+    0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00,  /* 70 */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* 80 */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* 90 */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* a0 */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* b0 */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* c0 */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* d0 */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* e0 */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00  /* f0 */
+};
+
+/* Literal storage configuration */
+#define LEXER_LITERAL_CHUNK_SIZE 4096
+#define LEXER_INTERN_INITIAL_CAPACITY 64
+
+/* Chunk of lexer-owned literal text; chunks never move once allocated */
+typedef struct lexer_chunk {
+    struct lexer_chunk *next;
+    size_t used;
+    size_t capacity;
+    char data[];
+} lexer_chunk_t;
+
+/* Interned literal table entry */
+typedef struct {
+    const char *text;
+    size_t length;
+    unsigned hash;
+} lexer_literal_t;
+
 /* Lexer state structure */
 struct lexer_state {
     const char *input;          /* Input source code */
@@ -47,6 +104,13 @@ struct lexer_state {
     size_t lookahead_count;
     size_t lookahead_pos;
     
+    /* Interned literals: escape-processed strings and error messages */
+    lexer_chunk_t *literal_chunks;
+    lexer_literal_t *literals;
+    size_t literal_count;
+    size_t literal_capacity;
+    size_t literal_bytes;
+    
     /* Statistics */
     size_t tokens_produced;
     size_t errors_encountered;
@@ -55,74 +119,24 @@ struct lexer_state {
     lexer_options_t options;
 };
 
-/* Golf-optimized keyword table */
-static const struct {
-    const char *text;
-    token_type_t type;
-    size_t length;
-} g_keywords[] = {
-    /* Core decision keywords - ultra short for golf */
-    {"if", TOKEN_IF, 2},
-    {"?", TOKEN_QUESTION, 1},      /* Ternary conditional */
-    {":", TOKEN_COLON, 1},         /* Ternary else */
-    {"then", TOKEN_THEN, 4},
-    {"else", TOKEN_ELSE, 4},
-    {"end", TOKEN_END, 3},
-    
-    /* Rule keywords */
-    {"rule", TOKEN_RULE, 4},
-    {"when", TOKEN_WHEN, 4},
-    {"do", TOKEN_DO, 2},
-    
-    /* Consequence keywords */
-    {"win", TOKEN_WIN, 3},         /* Golf: positive outcome */
-    {"lose", TOKEN_LOSE, 4},       /* Golf: negative outcome */
-    {"draw", TOKEN_DRAW, 4},       /* Golf: neutral outcome */
-    {"skip", TOKEN_SKIP, 4},       /* Golf: no-op consequence */
-    {"fail", TOKEN_FAIL, 4},       /* Golf: failure consequence */
-    {"pass", TOKEN_PASS, 4},       /* Golf: success consequence */
-    
-    /* Logic operators - single chars for golf */
-    {"and", TOKEN_AND, 3},
-    {"or", TOKEN_OR, 2},
-    {"not", TOKEN_NOT, 3},
-    {"&&", TOKEN_LOGICAL_AND, 2},
-    {"||", TOKEN_LOGICAL_OR, 2},
-    {"!", TOKEN_LOGICAL_NOT, 1},
-    
-    /* Boolean literals */
-    {"true", TOKEN_TRUE, 4},
-    {"false", TOKEN_FALSE, 5},
-    {"T", TOKEN_TRUE, 1},          /* Golf: short true */
-    {"F", TOKEN_FALSE, 1},         /* Golf: short false */
-    
-    /* Chain operators */
-    {"seq", TOKEN_SEQUENCE, 3},    /* Sequential execution */
-    {"par", TOKEN_PARALLEL, 3},    /* Parallel execution */
-    {">>", TOKEN_CHAIN, 2},        /* Chain operator */
-    
-    /* Import/module keywords */
-    {"use", TOKEN_USE, 3},
-    {"mod", TOKEN_MODULE, 3},
-    
-    /* Type keywords */
-    {"num", TOKEN_NUMBER_TYPE, 3},
-    {"str", TOKEN_STRING_TYPE, 3},
-    {"bool", TOKEN_BOOL_TYPE, 4},
-    
-    /* Control flow */
-    {"ret", TOKEN_RETURN, 3},      /* Golf: return */
-    {"brk", TOKEN_BREAK, 3},       /* Golf: break */
-    {"cont", TOKEN_CONTINUE, 4},   /* Golf: continue */
-    
-    /* Special golf constructs */
-    {"_", TOKEN_WILDCARD, 1},      /* Wildcard/don't care */
-    {"def", TOKEN_DEFAULT, 3},     /* Default case */
-    {"any", TOKEN_ANY, 3},         /* Any match */
-    {"all", TOKEN_ALL, 3},         /* All match */
-};
-
-#define KEYWORD_COUNT (sizeof(g_keywords) / sizeof(g_keywords[0]))
+/* Golf-optimized keywords
+ *
+ * Recognized by lexer_identify_keyword with a switch on length and first
+ * character, so classifying an identifier costs at most a couple of short
+ * compares. Only identifier-shaped words can reach it; operator spellings
+ * such as "&&", ">>" or "?" are handled by lexer_next_token.
+ *
+ *   decisions:     if then else end
+ *   rules:         rule when do
+ *   consequences:  win lose draw skip fail pass
+ *   logic:         and or not
+ *   booleans:      true false T F
+ *   chaining:      seq par
+ *   modules:       use mod
+ *   types:         num str bool
+ *   control flow:  ret brk cont
+ *   golf:          _ def any all
+ */
 
 /* Forward declarations */
 static void lexer_advance(lexer_t *lexer);
@@ -132,15 +146,21 @@ static void lexer_skip_comment(lexer_t *lexer);
 static token_t lexer_make_token(const lexer_t *lexer, token_type_t type);
 static token_t lexer_make_string_token(const lexer_t *lexer, const char *value, size_t length);
 static token_t lexer_make_error_token(const lexer_t *lexer, const char *message);
+static char *lexer_literal_reserve(lexer_t *lexer, size_t size);
+static const char *lexer_intern(lexer_t *lexer, char *text, size_t length);
 static token_t lexer_scan_string(lexer_t *lexer);
 static token_t lexer_scan_number(lexer_t *lexer);
 static token_t lexer_scan_identifier(lexer_t *lexer);
 static token_type_t lexer_identify_keyword(const char *text, size_t length);
 static bool lexer_is_alpha(char c);
 static bool lexer_is_digit(char c);
-static bool lexer_is_alnum(char c);
 static bool lexer_match_char(lexer_t *lexer, char expected);
 static void lexer_mark_token_start(lexer_t *lexer);
+static size_t lexer_span_class(const char *text, size_t length, unsigned char cls);
+static void lexer_skip_span(lexer_t *lexer, size_t end);
+static void lexer_skip_digits(lexer_t *lexer, unsigned char cls);
+static void lexer_skip_lines(lexer_t *lexer, size_t end);
+static size_t lexer_count_newlines(const char *text, size_t length, size_t *last);
 
 /* Lexer initialization and cleanup */
 
@@ -201,6 +221,13 @@ void lexer_destroy(lexer_t *lexer)
     LOG_DEBUG("Destroying lexer (produced %zu tokens, %zu errors)", 
               lexer->tokens_produced, lexer->errors_encountered);
     
+    lexer_chunk_t *chunk = lexer->literal_chunks;
+    while (chunk) {
+        lexer_chunk_t *next = chunk->next;
+        memory_free(chunk);
+        chunk = next;
+    }
+    memory_free(lexer->literals);
     memory_free(lexer);
 }
 
@@ -222,7 +249,8 @@ token_t lexer_next_token(lexer_t *lexer)
     
     /* Skip whitespace and comments if enabled */
     while (!lexer->at_eof) {
-        if (lexer->options.skip_whitespace && isspace(lexer->current_char)) {
+        if (lexer->options.skip_whitespace && 
+            (g_char_class[(unsigned char)lexer->current_char] & LEXER_CHAR_SPACE)) {
             lexer_skip_whitespace(lexer);
             continue;
         }
@@ -242,6 +270,7 @@ token_t lexer_next_token(lexer_t *lexer)
     }
     
     if (lexer->at_eof) {
+        lexer_mark_token_start(lexer);
         lexer->tokens_produced++;
         return lexer_make_token(lexer, TOKEN_EOF);
     }
@@ -367,9 +396,14 @@ token_t lexer_next_token(lexer_t *lexer)
             } else {
                 /* Unknown character */
                 char error_msg[64];
-                snprintf(error_msg, sizeof(error_msg), 
-                         "Unexpected character '%c' (0x%02x)", c, (unsigned char)c);
-                token = lexer_make_error_token(lexer, error_msg);
+                int msg_len = snprintf(error_msg, sizeof(error_msg), 
+                                       "Unexpected character '%c' (0x%02x)", c, (unsigned char)c);
+                char *stored = lexer_literal_reserve(lexer, msg_len + 1);
+                if (stored) {
+                    memcpy(stored, error_msg, msg_len + 1);
+                }
+                token = lexer_make_error_token(lexer, 
+                    stored ? lexer_intern(lexer, stored, msg_len) : "Unexpected character");
                 lexer->errors_encountered++;
             }
             break;
@@ -560,7 +594,7 @@ void lexer_print_token(const token_t *token, FILE *fp)
     fprintf(fp, "Token{type=%s", lexer_token_name(token->type));
     
     if (token->value) {
-        fprintf(fp, ", value='%s'", token->value);
+        fprintf(fp, ", value='%.*s'", (int)token->length, token->value);
     }
     
     if (token->length > 0) {
@@ -572,15 +606,25 @@ void lexer_print_token(const token_t *token, FILE *fp)
 
 void token_free(token_t *token)
 {
+    /* Token text belongs to the lexer; only the handle is cleared */
     if (!token) {
         return;
     }
     
-    memory_free((void*)token->value);
     token->value = NULL;
     token->length = 0;
 }
 
+bool token_text_equals(const token_t *token, const char *text)
+{
+    if (!token || !token->value || !text) {
+        return false;
+    }
+    
+    size_t length = strlen(text);
+    return token->length == length && memcmp(token->value, text, length) == 0;
+}
+
 /* Lexer state and error handling */
 
 lexer_position_t lexer_get_position(const lexer_t *lexer)
@@ -626,6 +670,8 @@ void lexer_get_statistics(const lexer_t *lexer, lexer_statistics_t *stats)
     stats->current_column = lexer->column;
     stats->bytes_processed = lexer->position;
     stats->total_bytes = lexer->input_length;
+    stats->literals_interned = lexer->literal_count;
+    stats->literal_bytes = lexer->literal_bytes;
 }
 
 bool lexer_has_errors(const lexer_t *lexer)
@@ -641,6 +687,620 @@ void lexer_reset_errors(lexer_t *lexer)
     }
 }
 
+/* Whole-input tokenization */
+
+/* Inputs smaller than this per thread are not worth splitting */
+#define LEXER_PARALLEL_MIN_BYTES (64 * 1024)
+#define TOKEN_BUFFER_INITIAL_CAPACITY 256
+
+/* One piece of a parallel tokenization */
+typedef struct {
+    lexer_t *lexer;
+    token_buffer_t *tokens;
+    pthread_t thread;
+    bool threaded;
+} lexer_piece_t;
+
+static token_buffer_t *token_buffer_create(const char *source)
+{
+    token_buffer_t *buffer = memory_allocate(sizeof(token_buffer_t));
+    if (!buffer) {
+        error_set(ERROR_MEMORY, "Failed to allocate token buffer");
+        return NULL;
+    }
+    
+    memset(buffer, 0, sizeof(token_buffer_t));
+    buffer->source = source;
+    return buffer;
+}
+
+static bool token_buffer_grow_array(void **array, size_t capacity, size_t element_size)
+{
+    void *grown = memory_reallocate(*array, capacity * element_size);
+    if (!grown) {
+        return false;
+    }
+    *array = grown;
+    return true;
+}
+
+static bool token_buffer_reserve(token_buffer_t *buffer, size_t capacity)
+{
+    if (capacity <= buffer->capacity) {
+        return true;
+    }
+    
+    size_t new_capacity = buffer->capacity ? buffer->capacity : TOKEN_BUFFER_INITIAL_CAPACITY;
+    while (new_capacity < capacity) {
+        new_capacity *= 2;
+    }
+    
+    /* Arrays that grew before a failure just keep the extra room */
+    if (!token_buffer_grow_array((void **)&buffer->types, new_capacity, sizeof(uint8_t)) ||
+        !token_buffer_grow_array((void **)&buffer->offsets, new_capacity, sizeof(uint32_t)) ||
+        !token_buffer_grow_array((void **)&buffer->lengths, new_capacity, sizeof(uint32_t)) ||
+        !token_buffer_grow_array((void **)&buffer->lines, new_capacity, sizeof(uint32_t)) ||
+        !token_buffer_grow_array((void **)&buffer->columns, new_capacity, sizeof(uint32_t))) {
+        error_set(ERROR_MEMORY, "Failed to grow token buffer");
+        return false;
+    }
+    
+    buffer->capacity = new_capacity;
+    return true;
+}
+
+static bool token_buffer_add_literal(token_buffer_t *buffer, size_t index, const char *text)
+{
+    if (buffer->literal_count == buffer->literal_capacity) {
+        size_t capacity = buffer->literal_capacity ? buffer->literal_capacity * 2 : 16;
+        if (!token_buffer_grow_array((void **)&buffer->literals, capacity, 
+                                     sizeof(token_literal_t))) {
+            error_set(ERROR_MEMORY, "Failed to grow token buffer");
+            return false;
+        }
+        buffer->literal_capacity = capacity;
+    }
+    
+    buffer->literals[buffer->literal_count].token = (uint32_t)index;
+    buffer->literals[buffer->literal_count].text = text;
+    buffer->literal_count++;
+    return true;
+}
+
+static bool token_buffer_append(token_buffer_t *buffer, const token_t *token)
+{
+    if (buffer->count == buffer->capacity && !token_buffer_reserve(buffer, buffer->count + 1)) {
+        return false;
+    }
+    
+    size_t index = buffer->count;
+    uint32_t length = (uint32_t)token->length;
+    
+    /* Anything that is not the slice token_buffer_text would compute is
+     * kept by pointer: escape-processed strings and error messages */
+    const char *slice = buffer->source + token->offset + (token->type == TOKEN_STRING);
+    if (token->value && token->value != slice) {
+        if (!token_buffer_add_literal(buffer, index, token->value)) {
+            return false;
+        }
+        length |= TOKEN_BUFFER_LITERAL;
+    }
+    
+    buffer->types[index] = (uint8_t)token->type;
+    buffer->offsets[index] = (uint32_t)token->offset;
+    buffer->lengths[index] = length;
+    buffer->lines[index] = (uint32_t)token->line;
+    buffer->columns[index] = (uint32_t)token->column;
+    buffer->count++;
+    return true;
+}
+
+/* Lexer over source[start, end) of a larger input; offsets stay absolute */
+static lexer_t *lexer_create_range(const char *source, size_t start, size_t end, size_t line,
+                                   const lexer_options_t *options)
+{
+    lexer_t *lexer = lexer_create_with_options("", options);
+    if (!lexer) {
+        return NULL;
+    }
+    
+    lexer->input = source;
+    lexer->input_length = end;
+    lexer->position = start;
+    lexer->line = line;
+    lexer->at_eof = (start >= end);
+    lexer->current_char = lexer->at_eof ? '\0' : source[start];
+    return lexer;
+}
+
+/* Finds up to pieces - 1 split points near evenly spaced targets. A split
+ * is the start of a line that begins outside any string or comment, so
+ * every token falls entirely inside one piece. starts/lines receive the
+ * offset and line number of each split; returns how many were found. */
+static size_t lexer_find_splits(const char *input, size_t length, size_t pieces,
+                                size_t *starts, size_t *lines)
+{
+    size_t found = 0;
+    size_t line = 1;
+    size_t target = length / pieces;
+    size_t last = 0;
+    size_t i = 0;
+    
+    while (i < length && found + 1 < pieces) {
+        char c = input[i];
+        
+        if (c == '\n') {
+            line++;
+            i++;
+            if (i >= target && i < length) {
+                starts[found] = i;
+                lines[found] = line;
+                found++;
+                target = length / pieces * (found + 1);
+            }
+        } else if (c == '"' || c == '\'') {
+            /* String literal, escapes included; may span lines */
+            for (i++; i < length && input[i] != c; i++) {
+                if (input[i] == '\\' && i + 1 < length) {
+                    i++;
+                }
+                if (input[i] == '\n') {
+                    line++;
+                }
+            }
+            i++;
+        } else if (c == '#' || (c == '/' && i + 1 < length && input[i + 1] == '/')) {
+            /* Line comment; its newline is an ordinary split candidate */
+            const char *newline = memchr(input + i, '\n', length - i);
+            i = newline ? (size_t)(newline - input) : length;
+        } else if (c == '/' && i + 1 < length && input[i + 1] == '*') {
+            size_t end = length;
+            for (size_t j = i + 2; j + 1 < length; j++) {
+                if (input[j] == '*' && input[j + 1] == '/') {
+                    end = j + 2;
+                    break;
+                }
+            }
+            line += lexer_count_newlines(input + i, end - i, &last);
+            i = end;
+        } else {
+            i++;
+        }
+    }
+    
+    return found;
+}
+
+static void *lexer_tokenize_piece(void *arg)
+{
+    lexer_piece_t *piece = arg;
+    piece->tokens = lexer_tokenize_all(piece->lexer);
+    return NULL;
+}
+
+/* Concatenates the pieces' buffers (dropping all but the final EOF) and
+ * takes ownership of their lexers */
+static token_buffer_t *lexer_merge_pieces(const char *source, lexer_piece_t *pieces, size_t count)
+{
+    size_t total = 1;
+    size_t literal_total = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!pieces[i].tokens) {
+            return NULL;
+        }
+        total += pieces[i].tokens->count - 1;
+        literal_total += pieces[i].tokens->literal_count;
+    }
+    
+    token_buffer_t *buffer = token_buffer_create(source);
+    if (!buffer) {
+        return NULL;
+    }
+    
+    buffer->owners = memory_allocate(count * sizeof(lexer_t *));
+    if (!buffer->owners || !token_buffer_reserve(buffer, total) ||
+        (literal_total > 0 && !token_buffer_grow_array((void **)&buffer->literals, literal_total,
+                                                       sizeof(token_literal_t)))) {
+        error_set(ERROR_MEMORY, "Failed to allocate token buffer");
+        token_buffer_destroy(buffer);
+        return NULL;
+    }
+    buffer->literal_capacity = literal_total;
+    
+    for (size_t i = 0; i < count; i++) {
+        const token_buffer_t *piece = pieces[i].tokens;
+        size_t n = (i + 1 < count) ? piece->count - 1 : piece->count;
+        size_t base = buffer->count;
+        
+        memcpy(buffer->types + base, piece->types, n * sizeof(uint8_t));
+        memcpy(buffer->offsets + base, piece->offsets, n * sizeof(uint32_t));
+        memcpy(buffer->lengths + base, piece->lengths, n * sizeof(uint32_t));
+        memcpy(buffer->lines + base, piece->lines, n * sizeof(uint32_t));
+        memcpy(buffer->columns + base, piece->columns, n * sizeof(uint32_t));
+        buffer->count += n;
+        
+        for (size_t j = 0; j < piece->literal_count; j++) {
+            token_literal_t *literal = &buffer->literals[buffer->literal_count++];
+            literal->token = (uint32_t)(piece->literals[j].token + base);
+            literal->text = piece->literals[j].text;
+        }
+        
+        buffer->owners[buffer->owner_count++] = pieces[i].lexer;
+        pieces[i].lexer = NULL;
+    }
+    
+    return buffer;
+}
+
+token_buffer_t *lexer_tokenize_all(lexer_t *lexer)
+{
+    if (!lexer) {
+        error_set(ERROR_INVALID_ARGUMENT, "Lexer cannot be null");
+        return NULL;
+    }
+    if (lexer->input_length >= TOKEN_BUFFER_LITERAL) {
+        error_set(ERROR_INVALID_ARGUMENT, "Input too large to pre-tokenize");
+        return NULL;
+    }
+    
+    token_buffer_t *buffer = token_buffer_create(lexer->input);
+    if (!buffer) {
+        return NULL;
+    }
+    
+    /* About one token per four bytes of typical source */
+    if (!token_buffer_reserve(buffer, (lexer->input_length - lexer->position) / 4 + 1)) {
+        token_buffer_destroy(buffer);
+        return NULL;
+    }
+    
+    token_t token;
+    do {
+        token = lexer_next_token(lexer);
+        if (!token_buffer_append(buffer, &token)) {
+            token_buffer_destroy(buffer);
+            return NULL;
+        }
+    } while (token.type != TOKEN_EOF);
+    
+    LOG_DEBUG("Pre-tokenized %zu tokens", buffer->count);
+    return buffer;
+}
+
+token_buffer_t *lexer_tokenize_parallel(const char *source, const lexer_options_t *options,
+                                        size_t jobs)
+{
+    if (!source) {
+        error_set(ERROR_INVALID_ARGUMENT, "Source code cannot be null");
+        return NULL;
+    }
+    
+    size_t length = strlen(source);
+    if (length >= TOKEN_BUFFER_LITERAL) {
+        error_set(ERROR_INVALID_ARGUMENT, "Input too large to pre-tokenize");
+        return NULL;
+    }
+    
+    if (jobs == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = cpus > 0 ? (size_t)cpus : 1;
+    }
+    if (jobs > length / LEXER_PARALLEL_MIN_BYTES) {
+        jobs = length / LEXER_PARALLEL_MIN_BYTES;
+    }
+    /* Split points assume comments and whitespace are skipped */
+    if (jobs < 1 || (options && (!options->skip_whitespace || !options->skip_comments))) {
+        jobs = 1;
+    }
+    
+    size_t *starts = memory_allocate((jobs + 1) * sizeof(size_t));
+    size_t *lines = memory_allocate((jobs + 1) * sizeof(size_t));
+    lexer_piece_t *pieces = memory_allocate(jobs * sizeof(lexer_piece_t));
+    token_buffer_t *buffer = NULL;
+    
+    if (!starts || !lines || !pieces) {
+        error_set(ERROR_MEMORY, "Failed to allocate tokenizer pieces");
+        goto cleanup;
+    }
+    memset(pieces, 0, jobs * sizeof(lexer_piece_t));
+    
+    starts[0] = 0;
+    lines[0] = 1;
+    size_t count = 1 + lexer_find_splits(source, length, jobs, starts + 1, lines + 1);
+    starts[count] = length;
+    
+    for (size_t i = 0; i < count; i++) {
+        pieces[i].lexer = lexer_create_range(source, starts[i], starts[i + 1], lines[i], options);
+        if (!pieces[i].lexer) {
+            goto cleanup;
+        }
+    }
+    
+    /* Piece 0 runs on the calling thread, as does any piece whose thread
+     * could not be started */
+    for (size_t i = 1; i < count; i++) {
+        pieces[i].threaded = (pthread_create(&pieces[i].thread, NULL, 
+                                             lexer_tokenize_piece, &pieces[i]) == 0);
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!pieces[i].threaded) {
+            lexer_tokenize_piece(&pieces[i]);
+        }
+    }
+    for (size_t i = 1; i < count; i++) {
+        if (pieces[i].threaded) {
+            pthread_join(pieces[i].thread, NULL);
+        }
+    }
+    
+    buffer = lexer_merge_pieces(source, pieces, count);
+    LOG_DEBUG("Pre-tokenized %zu bytes in %zu pieces", length, count);
+    
+cleanup:
+    if (pieces) {
+        for (size_t i = 0; i < jobs; i++) {
+            token_buffer_destroy(pieces[i].tokens);
+            lexer_destroy(pieces[i].lexer);
+        }
+    }
+    memory_free(pieces);
+    memory_free(lines);
+    memory_free(starts);
+    return buffer;
+}
+
+/* True if the freshly lexed token is the old token at index, moved by delta */
+static bool token_buffer_same_token(const token_buffer_t *buffer, size_t index,
+                                    const token_t *token, size_t delta_offset)
+{
+    if (buffer->types[index] != (uint8_t)token->type ||
+        buffer->offsets[index] + delta_offset != token->offset) {
+        return false;
+    }
+    
+    size_t length = 0;
+    const char *text = token_buffer_text(buffer, index, &length);
+    if (length != token->length) {
+        return false;
+    }
+    
+    /* Slices at the same (shifted) offset hold the same bytes unless the
+     * edit touched them, and those are never compared; literals may not */
+    if (!(buffer->lengths[index] & TOKEN_BUFFER_LITERAL)) {
+        return true;
+    }
+    return token->value && memcmp(text, token->value, length) == 0;
+}
+
+token_buffer_t *token_buffer_relex(token_buffer_t *tokens, const char *source, size_t offset,
+                                   size_t removed, size_t inserted, size_t *first_changed,
+                                   size_t *end_changed)
+{
+    if (!tokens || !source || tokens->count == 0) {
+        error_set(ERROR_INVALID_ARGUMENT, "Token buffer and source are required");
+        return NULL;
+    }
+    
+    /* Restart at the last token starting before the edit: it may grow into
+     * the inserted text, and token starts are always outside strings and
+     * comments, so the lexer state there is clean */
+    size_t first = 0;
+    size_t low = 0;
+    size_t high = tokens->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (tokens->offsets[mid] < offset) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    first = low > 0 ? low - 1 : 0;
+    
+    lexer_t *lexer = lexer_create(source);
+    if (!lexer) {
+        return NULL;
+    }
+    if (lexer->input_length >= TOKEN_BUFFER_LITERAL) {
+        error_set(ERROR_INVALID_ARGUMENT, "Input too large to pre-tokenize");
+        lexer_destroy(lexer);
+        return NULL;
+    }
+    
+    if (low > 0) {
+        lexer_position_t position = {
+            .offset = tokens->offsets[first],
+            .line = tokens->lines[first],
+            .column = tokens->columns[first]
+        };
+        lexer_set_position(lexer, &position);
+    }
+    
+    token_buffer_t *buffer = token_buffer_create(source);
+    if (!buffer || !token_buffer_reserve(buffer, tokens->count + 16)) {
+        token_buffer_destroy(buffer);
+        lexer_destroy(lexer);
+        return NULL;
+    }
+    
+    /* Unchanged prefix */
+    memcpy(buffer->types, tokens->types, first * sizeof(uint8_t));
+    memcpy(buffer->offsets, tokens->offsets, first * sizeof(uint32_t));
+    memcpy(buffer->lengths, tokens->lengths, first * sizeof(uint32_t));
+    memcpy(buffer->lines, tokens->lines, first * sizeof(uint32_t));
+    memcpy(buffer->columns, tokens->columns, first * sizeof(uint32_t));
+    buffer->count = first;
+    
+    size_t literal = 0;
+    for (; literal < tokens->literal_count && tokens->literals[literal].token < first; literal++) {
+        if (!token_buffer_add_literal(buffer, tokens->literals[literal].token,
+                                      tokens->literals[literal].text)) {
+            goto fail;
+        }
+    }
+    
+    /* Re-lex until a token past the edit lines up with an old one; EOF
+     * always does, so this terminates */
+    size_t edit_end = offset + inserted;
+    size_t delta = inserted - removed;  /* Modular: offsets shift by inserted - removed */
+    size_t sync = tokens->count;
+    token_t token;
+    
+    for (;;) {
+        token = lexer_next_token(lexer);
+        
+        if (token.offset >= edit_end) {
+            size_t old_offset = token.offset - delta;
+            while (low < tokens->count && tokens->offsets[low] < old_offset) {
+                low++;
+            }
+            if (low < tokens->count && token_buffer_same_token(tokens, low, &token, delta)) {
+                sync = low;
+                break;
+            }
+        }
+        
+        if (!token_buffer_append(buffer, &token)) {
+            goto fail;
+        }
+        if (token.type == TOKEN_EOF) {
+            break;
+        }
+    }
+    
+    *first_changed = first;
+    *end_changed = buffer->count;
+    
+    /* Shifted suffix: lines move by the line delta, and tokens still on the
+     * synchronizing token's line also move sideways */
+    if (sync < tokens->count) {
+        size_t suffix = tokens->count - sync;
+        if (!token_buffer_reserve(buffer, buffer->count + suffix)) {
+            goto fail;
+        }
+        
+        uint32_t sync_line = tokens->lines[sync];
+        uint32_t line_delta = (uint32_t)token.line - sync_line;
+        uint32_t column_delta = (uint32_t)token.column - tokens->columns[sync];
+        size_t base = buffer->count;
+        
+        memcpy(buffer->types + base, tokens->types + sync, suffix * sizeof(uint8_t));
+        memcpy(buffer->lengths + base, tokens->lengths + sync, suffix * sizeof(uint32_t));
+        for (size_t i = 0; i < suffix; i++) {
+            uint32_t line = tokens->lines[sync + i];
+            buffer->offsets[base + i] = tokens->offsets[sync + i] + (uint32_t)delta;
+            buffer->lines[base + i] = line + line_delta;
+            buffer->columns[base + i] = tokens->columns[sync + i] + 
+                                        (line == sync_line ? column_delta : 0);
+        }
+        buffer->count += suffix;
+        
+        for (; literal < tokens->literal_count; literal++) {
+            size_t index = tokens->literals[literal].token;
+            if (index >= sync && 
+                !token_buffer_add_literal(buffer, index - sync + base,
+                                          tokens->literals[literal].text)) {
+                goto fail;
+            }
+        }
+    }
+    
+    /* Retained literal texts live in the old buffer's lexers: take them */
+    lexer_t **owners = memory_reallocate(tokens->owners, 
+                                         (tokens->owner_count + 1) * sizeof(lexer_t *));
+    if (!owners) {
+        error_set(ERROR_MEMORY, "Failed to grow token buffer");
+        goto fail;
+    }
+    owners[tokens->owner_count] = lexer;
+    buffer->owners = owners;
+    buffer->owner_count = tokens->owner_count + 1;
+    tokens->owners = NULL;
+    tokens->owner_count = 0;
+    
+    LOG_DEBUG("Re-lexed tokens %zu..%zu, reused %zu", first, *end_changed, 
+              tokens->count - sync);
+    return buffer;
+    
+fail:
+    token_buffer_destroy(buffer);
+    lexer_destroy(lexer);
+    return NULL;
+}
+
+void token_buffer_destroy(token_buffer_t *buffer)
+{
+    if (!buffer) {
+        return;
+    }
+    
+    for (size_t i = 0; i < buffer->owner_count; i++) {
+        lexer_destroy(buffer->owners[i]);
+    }
+    memory_free(buffer->owners);
+    memory_free(buffer->literals);
+    memory_free(buffer->types);
+    memory_free(buffer->offsets);
+    memory_free(buffer->lengths);
+    memory_free(buffer->lines);
+    memory_free(buffer->columns);
+    memory_free(buffer);
+}
+
+const char *token_buffer_text(const token_buffer_t *buffer, size_t index, size_t *length)
+{
+    if (!buffer || index >= buffer->count) {
+        if (length) {
+            *length = 0;
+        }
+        return NULL;
+    }
+    
+    uint32_t raw = buffer->lengths[index];
+    if (length) {
+        *length = raw & ~TOKEN_BUFFER_LITERAL;
+    }
+    
+    if (!(raw & TOKEN_BUFFER_LITERAL)) {
+        /* String text starts after the opening quote */
+        return buffer->source + buffer->offsets[index] + (buffer->types[index] == TOKEN_STRING);
+    }
+    
+    /* Literal entries are sorted by token index */
+    size_t low = 0;
+    size_t high = buffer->literal_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (buffer->literals[mid].token < index) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return buffer->literals[low].text;
+}
+
+token_t token_buffer_get(const token_buffer_t *buffer, size_t index)
+{
+    token_t token;
+    memset(&token, 0, sizeof(token));
+    
+    if (!buffer || index >= buffer->count) {
+        token.type = TOKEN_EOF;
+        return token;
+    }
+    
+    token.type = (token_type_t)buffer->types[index];
+    token.offset = buffer->offsets[index];
+    token.line = buffer->lines[index];
+    token.column = buffer->columns[index];
+    token.value = token_buffer_text(buffer, index, &token.length);
+    if (token.length == 0 && token.type != TOKEN_STRING) {
+        token.value = NULL;
+    }
+    return token;
+}
+
 /* Internal helper functions */
 
 static void lexer_advance(lexer_t *lexer)
@@ -680,44 +1340,190 @@ static char lexer_peek(const lexer_t *lexer, size_t offset)
     return lexer->input[pos];
 }
 
-static void lexer_skip_whitespace(lexer_t *lexer)
+/* Scanning fast paths
+ *
+ * Runs of whitespace, comment bodies, identifier characters and digits are
+ * measured in one pass (16 bytes at a time with SSE2) and then consumed in a
+ * single step, instead of going through lexer_advance byte by byte. Line and
+ * column bookkeeping is done once per run by counting newlines. */
+
+#ifdef LEXER_USE_SSE2
+/* Bytes v[i] - low <= range (unsigned), as a byte mask */
+static inline __m128i lexer_simd_in_range(__m128i v, char low, char range)
 {
-    while (!lexer->at_eof && isspace(lexer->current_char)) {
-        lexer_advance(lexer);
+    __m128i offset = _mm_sub_epi8(v, _mm_set1_epi8(low));
+    return _mm_cmpeq_epi8(_mm_subs_epu8(offset, _mm_set1_epi8(range)), _mm_setzero_si128());
+}
+
+static inline unsigned lexer_simd_class_mask(__m128i v, unsigned char cls)
+{
+    __m128i match;
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    
+    switch (cls) {
+        case LEXER_CHAR_SPACE:
+            match = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                 lexer_simd_in_range(v, '\t', '\r' - '\t'));
+            break;
+        case LEXER_CHAR_IDENT:
+            match = _mm_or_si128(_mm_or_si128(lexer_simd_in_range(lower, 'a', 'z' - 'a'),
+                                              lexer_simd_in_range(v, '0', 9)),
+                                 _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+            break;
+        case LEXER_CHAR_HEX:
+            match = _mm_or_si128(lexer_simd_in_range(lower, 'a', 'f' - 'a'),
+                                 lexer_simd_in_range(v, '0', 9));
+            break;
+        default:
+            match = lexer_simd_in_range(v, '0', 9);
+            break;
     }
+    
+    return (unsigned)_mm_movemask_epi8(match);
 }
+#endif
 
-static void lexer_skip_comment(lexer_t *lexer)
+/* Length of the leading run of bytes in class cls */
+static inline size_t lexer_span_class(const char *text, size_t length, unsigned char cls)
 {
-    if (lexer->current_char == '#') {
-        /* Line comment - skip to end of line */
-        while (!lexer->at_eof && lexer->current_char != '\n') {
-            lexer_advance(lexer);
+    size_t i = 0;
+    
+#ifdef LEXER_USE_SSE2
+    while (i + 16 <= length) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+        unsigned outside = lexer_simd_class_mask(v, cls) ^ 0xFFFFu;
+        if (outside) {
+            return i + __builtin_ctz(outside);
         }
-    } else if (lexer->current_char == '/' && lexer_peek(lexer, 1) == '/') {
-        /* Line comment - skip to end of line */
-        lexer_advance(lexer);  /* Skip first '/' */
-        lexer_advance(lexer);  /* Skip second '/' */
-        
-        while (!lexer->at_eof && lexer->current_char != '\n') {
-            lexer_advance(lexer);
+        i += 16;
+    }
+#endif
+    
+    while (i < length && (g_char_class[(unsigned char)text[i]] & cls)) {
+        i++;
+    }
+    return i;
+}
+
+/* Number of newlines in text; *last receives the index of the final one */
+static size_t lexer_count_newlines(const char *text, size_t length, size_t *last)
+{
+    size_t count = 0;
+    size_t i = 0;
+    
+#ifdef LEXER_USE_SSE2
+    __m128i newline = _mm_set1_epi8('\n');
+    while (i + 16 <= length) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+        if (mask) {
+            count += __builtin_popcount(mask);
+            *last = i + 31 - __builtin_clz(mask);
+        }
+        i += 16;
+    }
+#endif
+    
+    for (; i < length; i++) {
+        if (text[i] == '\n') {
+            count++;
+            *last = i;
         }
+    }
+    return count;
+}
+
+static void lexer_set_offset(lexer_t *lexer, size_t end)
+{
+    lexer->position = end;
+    if (end >= lexer->input_length) {
+        lexer->position = lexer->input_length;
+        lexer->at_eof = true;
+        lexer->current_char = '\0';
+    } else {
+        lexer->current_char = lexer->input[end];
+    }
+}
+
+/* Consumes input up to end; the span must not contain a newline */
+static void lexer_skip_span(lexer_t *lexer, size_t end)
+{
+    if (end <= lexer->position) {
+        return;
+    }
+    
+    lexer->column += end - lexer->position;
+    lexer_set_offset(lexer, end);
+}
+
+/* Consumes input up to end, which may span several lines */
+static void lexer_skip_lines(lexer_t *lexer, size_t end)
+{
+    if (end <= lexer->position) {
+        return;
+    }
+    
+    size_t length = end - lexer->position;
+    size_t last_newline = 0;
+    size_t newlines = lexer_count_newlines(lexer->input + lexer->position, length, &last_newline);
+    
+    if (newlines > 0) {
+        lexer->line += newlines;
+        lexer->column = length - last_newline;
+    } else {
+        lexer->column += length;
+    }
+    lexer_set_offset(lexer, end);
+}
+
+static void lexer_skip_whitespace(lexer_t *lexer)
+{
+    size_t start = lexer->position;
+    size_t span = lexer_span_class(lexer->input + start, lexer->input_length - start, 
+                                   LEXER_CHAR_SPACE);
+    lexer_skip_lines(lexer, start + span);
+}
+
+static void lexer_skip_comment(lexer_t *lexer)
+{
+    const char *input = lexer->input;
+    size_t start = lexer->position;
+    size_t remaining = lexer->input_length - start;
+    
+    if (lexer->current_char == '#' || 
+        (lexer->current_char == '/' && lexer_peek(lexer, 1) == '/')) {
+        /* Line comment - skip to end of line (the newline is whitespace) */
+        const char *newline = memchr(input + start, '\n', remaining);
+        lexer_skip_span(lexer, newline ? (size_t)(newline - input) : lexer->input_length);
     } else if (lexer->current_char == '/' && lexer_peek(lexer, 1) == '*') {
-        /* Block comment - skip to */ */
-        lexer_advance(lexer);  /* Skip '/' */
-        lexer_advance(lexer);  /* Skip '*' */
+        /* Block comment - skip past the closing delimiter */
+        size_t end = lexer->input_length;
+        const char *scan = input + start + 2;
+        const char *limit = input + lexer->input_length;
         
-        while (!lexer->at_eof) {
-            if (lexer->current_char == '*' && lexer_peek(lexer, 1) == '/') {
-                lexer_advance(lexer);  /* Skip '*' */
-                lexer_advance(lexer);  /* Skip '/' */
+        while (scan < limit) {
+            const char *star = memchr(scan, '*', limit - scan);
+            if (!star) {
                 break;
             }
-            lexer_advance(lexer);
+            if (star + 1 < limit && star[1] == '/') {
+                end = (size_t)(star - input) + 2;
+                break;
+            }
+            scan = star + 1;
         }
+        
+        lexer_skip_lines(lexer, end);
     }
 }
 
+static void lexer_skip_digits(lexer_t *lexer, unsigned char cls)
+{
+    size_t start = lexer->position;
+    lexer_skip_span(lexer, start + lexer_span_class(lexer->input + start,
+                                                    lexer->input_length - start, cls));
+}
+
 static void lexer_mark_token_start(lexer_t *lexer)
 {
     lexer->token_start = lexer->position;
@@ -731,18 +1537,14 @@ static token_t lexer_make_token(const lexer_t *lexer, token_type_t type)
     memset(&token, 0, sizeof(token));
     
     token.type = type;
+    token.offset = lexer->token_start;
     token.line = lexer->token_line;
     token.column = lexer->token_column;
     token.length = lexer->position - lexer->token_start;
     
+    /* Token text is a slice of the source */
     if (token.length > 0 && lexer->token_start < lexer->input_length) {
-        /* Extract token text */
-        char *value = memory_allocate(token.length + 1);
-        if (value) {
-            memcpy(value, lexer->input + lexer->token_start, token.length);
-            value[token.length] = '\0';
-            token.value = value;
-        }
+        token.value = lexer->input + lexer->token_start;
     }
     
     return token;
@@ -754,44 +1556,117 @@ static token_t lexer_make_string_token(const lexer_t *lexer, const char *value,
     memset(&token, 0, sizeof(token));
     
     token.type = TOKEN_STRING;
+    token.offset = lexer->token_start;
     token.line = lexer->token_line;
     token.column = lexer->token_column;
     token.length = length;
-    
-    if (value && length > 0) {
-        char *token_value = memory_allocate(length + 1);
-        if (token_value) {
-            memcpy(token_value, value, length);
-            token_value[length] = '\0';
-            token.value = token_value;
-        }
-    }
+    token.value = value;  /* Source slice or interned literal */
     
     return token;
 }
 
 static token_t lexer_make_error_token(const lexer_t *lexer, const char *message)
 {
+    /* message must outlive the token: a string literal or interned text */
     token_t token;
     memset(&token, 0, sizeof(token));
     
     token.type = TOKEN_ERROR;
-    token.line = lexer->token_line;
-    token.column = lexer->token_column;
+    if (lexer) {
+        token.offset = lexer->token_start;
+        token.line = lexer->token_line;
+        token.column = lexer->token_column;
+    }
     
     if (message) {
-        size_t msg_len = strlen(message);
-        char *error_msg = memory_allocate(msg_len + 1);
-        if (error_msg) {
-            strcpy(error_msg, message);
-            token.value = error_msg;
-            token.length = msg_len;
-        }
+        token.value = message;
+        token.length = strlen(message);
     }
     
     return token;
 }
 
+/* Bump-allocates literal storage; chunks are freed with the lexer */
+static char *lexer_literal_reserve(lexer_t *lexer, size_t size)
+{
+    lexer_chunk_t *chunk = lexer->literal_chunks;
+    if (!chunk || chunk->capacity - chunk->used < size) {
+        size_t capacity = size > LEXER_LITERAL_CHUNK_SIZE ? size : LEXER_LITERAL_CHUNK_SIZE;
+        chunk = memory_allocate(sizeof(lexer_chunk_t) + capacity);
+        if (!chunk) {
+            error_set(ERROR_MEMORY, "Failed to allocate literal storage");
+            return NULL;
+        }
+        chunk->next = lexer->literal_chunks;
+        chunk->used = 0;
+        chunk->capacity = capacity;
+        lexer->literal_chunks = chunk;
+        lexer->literal_bytes += capacity;
+    }
+    
+    char *text = chunk->data + chunk->used;
+    chunk->used += size;
+    return text;
+}
+
+/* Interns text just written by lexer_literal_reserve (length + 1 bytes).
+ * A duplicate gives its reservation back and returns the existing copy. */
+static const char *lexer_intern(lexer_t *lexer, char *text, size_t length)
+{
+    text[length] = '\0';
+    
+    /* FNV-1a */
+    unsigned hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    
+    /* Keep the table at most half full */
+    if ((lexer->literal_count + 1) * 2 > lexer->literal_capacity) {
+        size_t capacity = lexer->literal_capacity ? 
+            lexer->literal_capacity * 2 : LEXER_INTERN_INITIAL_CAPACITY;
+        lexer_literal_t *table = memory_allocate(capacity * sizeof(lexer_literal_t));
+        if (!table) {
+            return text;  /* Still valid, just not shared */
+        }
+        memset(table, 0, capacity * sizeof(lexer_literal_t));
+        
+        for (size_t i = 0; i < lexer->literal_capacity; i++) {
+            lexer_literal_t *entry = &lexer->literals[i];
+            if (!entry->text) continue;
+            size_t slot = entry->hash & (capacity - 1);
+            while (table[slot].text) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            table[slot] = *entry;
+        }
+        
+        memory_free(lexer->literals);
+        lexer->literals = table;
+        lexer->literal_capacity = capacity;
+    }
+    
+    size_t mask = lexer->literal_capacity - 1;
+    size_t slot = hash & mask;
+    while (lexer->literals[slot].text) {
+        lexer_literal_t *entry = &lexer->literals[slot];
+        if (entry->hash == hash && entry->length == length &&
+            memcmp(entry->text, text, length) == 0) {
+            /* text is the most recent reservation in the head chunk */
+            lexer->literal_chunks->used -= length + 1;
+            return entry->text;
+        }
+        slot = (slot + 1) & mask;
+    }
+    
+    lexer->literals[slot].text = text;
+    lexer->literals[slot].length = length;
+    lexer->literals[slot].hash = hash;
+    lexer->literal_count++;
+    return text;
+}
+
 static token_t lexer_scan_string(lexer_t *lexer)
 {
     char quote_char = lexer->current_char;
@@ -800,6 +1675,7 @@ static token_t lexer_scan_string(lexer_t *lexer)
     size_t start_pos = lexer->position;
     size_t string_length = 0;
     bool escaped = false;
+    bool has_escapes = false;
     
     /* Scan string content */
     while (!lexer->at_eof && (lexer->current_char != quote_char || escaped)) {
@@ -807,6 +1683,7 @@ static token_t lexer_scan_string(lexer_t *lexer)
             escaped = false;
         } else if (lexer->current_char == '\\') {
             escaped = true;
+            has_escapes = true;
         }
         
         string_length++;
@@ -817,14 +1694,20 @@ static token_t lexer_scan_string(lexer_t *lexer)
         return lexer_make_error_token(lexer, "Unterminated string literal");
     }
     
-    /* Extract string content (without quotes) */
-    char *string_value = memory_allocate(string_length + 1);
+    const char *src = lexer->input + start_pos;
+    
+    /* Without escapes the content (between the quotes) is a source slice */
+    if (!has_escapes) {
+        lexer_advance(lexer);  /* Skip closing quote */
+        return lexer_make_string_token(lexer, src, string_length);
+    }
+    
+    /* Process escape sequences once into lexer-owned storage */
+    char *string_value = lexer_literal_reserve(lexer, string_length + 1);
     if (!string_value) {
         return lexer_make_error_token(lexer, "Out of memory");
     }
     
-    /* Process escape sequences */
-    const char *src = lexer->input + start_pos;
     char *dst = string_value;
     size_t i = 0;
     
@@ -854,14 +1737,12 @@ static token_t lexer_scan_string(lexer_t *lexer)
             i++;
         }
     }
-    *dst = '\0';
     
     lexer_advance(lexer);  /* Skip closing quote */
     
-    token_t token = lexer_make_string_token(lexer, string_value, dst - string_value);
-    memory_free(string_value);
-    
-    return token;
+    size_t value_length = dst - string_value;
+    return lexer_make_string_token(lexer, lexer_intern(lexer, string_value, value_length), 
+                                   value_length);
 }
 
 static token_t lexer_scan_number(lexer_t *lexer)
@@ -888,12 +1769,7 @@ static token_t lexer_scan_number(lexer_t *lexer)
     
     if (is_hex) {
         /* Hexadecimal number */
-        while (!lexer->at_eof && 
-               (lexer_is_digit(lexer->current_char) ||
-                (lexer->current_char >= 'a' && lexer->current_char <= 'f') ||
-                (lexer->current_char >= 'A' && lexer->current_char <= 'F'))) {
-            lexer_advance(lexer);
-        }
+        lexer_skip_digits(lexer, LEXER_CHAR_HEX);
     } else if (is_binary) {
         /* Binary number */
         while (!lexer->at_eof && 
@@ -902,19 +1778,14 @@ static token_t lexer_scan_number(lexer_t *lexer)
         }
     } else {
         /* Decimal number */
-        while (!lexer->at_eof && lexer_is_digit(lexer->current_char)) {
-            lexer_advance(lexer);
-        }
+        lexer_skip_digits(lexer, LEXER_CHAR_DIGIT);
         
         /* Check for decimal point */
         if (!lexer->at_eof && lexer->current_char == '.' && 
             lexer_is_digit(lexer_peek(lexer, 1))) {
             has_dot = true;
             lexer_advance(lexer);  /* Skip '.' */
-            
-            while (!lexer->at_eof && lexer_is_digit(lexer->current_char)) {
-                lexer_advance(lexer);
-            }
+            lexer_skip_digits(lexer, LEXER_CHAR_DIGIT);
         }
         
         /* Check for scientific notation */
@@ -930,9 +1801,7 @@ static token_t lexer_scan_number(lexer_t *lexer)
                     lexer_advance(lexer);  /* Skip sign */
                 }
                 
-                while (!lexer->at_eof && lexer_is_digit(lexer->current_char)) {
-                    lexer_advance(lexer);
-                }
+                lexer_skip_digits(lexer, LEXER_CHAR_DIGIT);
             }
         }
     }
@@ -958,9 +1827,9 @@ static token_t lexer_scan_identifier(lexer_t *lexer)
     }
     
     /* Scan identifier characters */
-    while (!lexer->at_eof && lexer_is_alnum(lexer->current_char)) {
-        lexer_advance(lexer);
-    }
+    lexer_skip_span(lexer, start_pos + lexer_span_class(lexer->input + start_pos,
+                                                        lexer->input_length - start_pos,
+                                                        LEXER_CHAR_IDENT));
     
     size_t length = lexer->position - start_pos;
     if (length == 0) {
@@ -984,14 +1853,81 @@ static token_type_t lexer_identify_keyword(const char *text, size_t length)
         return TOKEN_IDENTIFIER;
     }
     
-    /* Binary search through keyword table */
-    for (size_t i = 0; i < KEYWORD_COUNT; i++) {
-        if (g_keywords[i].length == length &&
-            memcmp(text, g_keywords[i].text, length) == 0) {
-            return g_keywords[i].type;
-        }
+#define KEYWORD(word, type) \
+    if (memcmp(text, word, length) == 0) return type
+    
+    /* Dispatch on length, then first character */
+    switch (length) {
+        case 1:
+            switch (text[0]) {
+                case 'T': return TOKEN_TRUE;       /* Golf: short true */
+                case 'F': return TOKEN_FALSE;      /* Golf: short false */
+                case '_': return TOKEN_WILDCARD;   /* Wildcard/don't care */
+            }
+            break;
+            
+        case 2:
+            switch (text[0]) {
+                case 'i': KEYWORD("if", TOKEN_IF); break;
+                case 'd': KEYWORD("do", TOKEN_DO); break;
+                case 'o': KEYWORD("or", TOKEN_OR); break;
+            }
+            break;
+            
+        case 3:
+            switch (text[0]) {
+                case 'a':
+                    KEYWORD("and", TOKEN_AND);
+                    KEYWORD("any", TOKEN_ANY);
+                    KEYWORD("all", TOKEN_ALL);
+                    break;
+                case 'b': KEYWORD("brk", TOKEN_BREAK); break;
+                case 'd': KEYWORD("def", TOKEN_DEFAULT); break;
+                case 'e': KEYWORD("end", TOKEN_END); break;
+                case 'm': KEYWORD("mod", TOKEN_MODULE); break;
+                case 'n':
+                    KEYWORD("not", TOKEN_NOT);
+                    KEYWORD("num", TOKEN_NUMBER_TYPE);
+                    break;
+                case 'p': KEYWORD("par", TOKEN_PARALLEL); break;
+                case 'r': KEYWORD("ret", TOKEN_RETURN); break;
+                case 's':
+                    KEYWORD("seq", TOKEN_SEQUENCE);
+                    KEYWORD("str", TOKEN_STRING_TYPE);
+                    break;
+                case 'u': KEYWORD("use", TOKEN_USE); break;
+                case 'w': KEYWORD("win", TOKEN_WIN); break;
+            }
+            break;
+            
+        case 4:
+            switch (text[0]) {
+                case 'b': KEYWORD("bool", TOKEN_BOOL_TYPE); break;
+                case 'c': KEYWORD("cont", TOKEN_CONTINUE); break;
+                case 'd': KEYWORD("draw", TOKEN_DRAW); break;
+                case 'e': KEYWORD("else", TOKEN_ELSE); break;
+                case 'f': KEYWORD("fail", TOKEN_FAIL); break;
+                case 'l': KEYWORD("lose", TOKEN_LOSE); break;
+                case 'p': KEYWORD("pass", TOKEN_PASS); break;
+                case 'r': KEYWORD("rule", TOKEN_RULE); break;
+                case 's': KEYWORD("skip", TOKEN_SKIP); break;
+                case 't':
+                    KEYWORD("then", TOKEN_THEN);
+                    KEYWORD("true", TOKEN_TRUE);
+                    break;
+                case 'w': KEYWORD("when", TOKEN_WHEN); break;
+            }
+            break;
+            
+        case 5:
+            if (text[0] == 'f') {
+                KEYWORD("false", TOKEN_FALSE);
+            }
+            break;
     }
     
+#undef KEYWORD
+    
     return TOKEN_IDENTIFIER;
 }
 
@@ -1005,11 +1941,6 @@ static bool lexer_is_digit(char c)
     return c >= '0' && c <= '9';
 }
 
-static bool lexer_is_alnum(char c)
-{
-    return lexer_is_alpha(c) || lexer_is_digit(c);
-}
-
 static bool lexer_match_char(lexer_t *lexer, char expected)
 {
     if (lexer->at_eof || lexer->current_char != expected) {
@@ -1169,12 +2100,12 @@ token_t lexer_next_context_token(lexer_t *lexer)
             /* In consequence context, bare identifiers might be actions */
             if (token.type == TOKEN_IDENTIFIER && lexer->options.golf_mode) {
                 /* Convert common patterns */
-                if (token.value) {
-                    if (strcmp(token.value, "w") == 0) {
+                if (token.length == 1) {
+                    if (token.value[0] == 'w') {
                         token.type = TOKEN_WIN;
-                    } else if (strcmp(token.value, "l") == 0) {
+                    } else if (token.value[0] == 'l') {
                         token.type = TOKEN_LOSE;
-                    } else if (strcmp(token.value, "d") == 0) {
+                    } else if (token.value[0] == 'd') {
                         token.type = TOKEN_DRAW;
                     }
                 }
@@ -7,6 +7,9 @@
  * - Guard pages for buffer overflow detection
  * - Custom allocators (arena, pool)
  * - Statistics and reporting
+ * - Thread-safe bookkeeping
+ * - Per-subsystem accounting with enforced budgets
+ * - Sampling heap profiler with pprof/speedscope output
  * - Garbage collection integration
  */
 
@@ -17,9 +20,18 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <math.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/mman.h>
 #include <errno.h>
+#include <time.h>
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#define HAVE_BACKTRACE 1
+#endif
 
 /* Allocation metadata header */
 typedef struct MemHeader {
@@ -29,6 +41,9 @@ typedef struct MemHeader {
     unsigned magic;             // Magic number for validation
     struct MemHeader *next;     // Next in allocation list
     struct MemHeader *prev;     // Previous in allocation list
+    unsigned tag;               // Subsystem the allocation is charged to
+    unsigned heap_site;         // Heap profiler site index + 1 (0 if unsampled)
+    unsigned heap_epoch;        // Heap profiler epoch of the sample
 } MemHeader;
 
 /* Allocation footer for overflow detection */
@@ -74,13 +89,63 @@ static struct {
     size_t guard_page_size;     // System page size
     vector_t *arenas;           // Active memory arenas
     vector_t *pools;            // Active memory pools
+    MemTagStats tags[MEM_TAG_COUNT]; // Per-subsystem accounting
+    bool budget_explicit[MEM_TAG_COUNT]; // Budget set by memory_set_budget
+    size_t limit;               // Overall memory limit (0 = unlimited)
 } g_memory = {0};
 
+/* Guards the allocation list, statistics and heap profile; allocations
+ * only take it while tracking or heap sampling is on. Subsystem counters
+ * are atomic. Logging may allocate, so nothing logs while holding it. */
+static pthread_mutex_t g_memory_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *g_tag_names[MEM_TAG_COUNT] = {
+    "general", "parser", "runtime", "trace", "explain", "coverage", "history", "profiler"
+};
+
+/* Share of the overall limit given to each diagnostic subsystem, in 1/64ths */
+static const unsigned g_default_budget_share[MEM_TAG_COUNT] = {
+    [MEM_TAG_TRACE] = 8,
+    [MEM_TAG_EXPLAIN] = 2,
+    [MEM_TAG_COVERAGE] = 2,
+    [MEM_TAG_HISTORY] = 8,
+    [MEM_TAG_PROFILER] = 2
+};
+
 /* Constants */
 #define MEM_MAGIC 0xABCD1234
 #define GUARD_MAGIC 0xDEADBEEF
 #define DEFAULT_ARENA_SIZE (2 * 1024 * 1024) // 2MB
 #define POOL_GROW_SIZE 32
+#define HEAP_MAX_FRAMES 16
+#define HEAP_MAX_SITES 4096             // Must be a power of 2
+
+/* Heap profiler call site (one per distinct sampled stack) */
+typedef struct {
+    uint64_t key;               // Stack hash, 0 marks an empty slot
+    void *frames[HEAP_MAX_FRAMES]; // Return addresses, innermost first
+    int depth;                  // Number of valid frames
+    const char *file;           // Allocation source file
+    int line;                   // Allocation source line
+    size_t alloc_count;         // Sampled allocations
+    size_t alloc_bytes;         // Sampled bytes
+    size_t live_count;          // Sampled allocations not yet freed
+    size_t live_bytes;          // Sampled bytes not yet freed
+    double est_alloc_bytes;     // Estimated total bytes allocated
+    double est_live_bytes;      // Estimated bytes still live
+} HeapSite;
+
+/* Heap profiler state */
+static struct {
+    HeapSite *sites;            // Open-addressed site table
+    size_t site_count;          // Occupied slots
+    size_t interval;            // Mean bytes between samples
+    int64_t bytes_until_sample; // Countdown to the next sample
+    uint64_t rng;               // xorshift64 state
+    unsigned epoch;             // Bumped on start/reset to orphan old samples
+    size_t dropped;             // Samples lost to a full site table
+    bool active;                // Sampling enabled
+} g_heap = {0};
 
 /* Forward declarations */
 static void memory_track_allocation(MemHeader *header, size_t size, 
@@ -94,6 +159,11 @@ static MemPool* pool_create_internal(size_t block_size, size_t initial_blocks,
                                     const char *name);
 static void* pool_alloc_internal(MemPool *pool, const char *file, int line);
 static void pool_free_internal(MemPool *pool, void *block);
+static void heap_record_sample(MemHeader *header, void *caller);
+static void heap_release_sample(MemHeader *header);
+static size_t heap_next_interval(void);
+static int heap_site_compare(const void *a, const void *b);
+static void heap_write_json_string(FILE *output, const char *str);
 
 /* Initialization */
 void memory_init(void) {
@@ -107,10 +177,31 @@ void memory_init(void) {
     vector_append(g_memory.arenas, arena_create_internal(DEFAULT_ARENA_SIZE, "default"));
     vector_append(g_memory.arenas, arena_create_internal(DEFAULT_ARENA_SIZE, "temp"));
     
+    // Heap profiling for long runs without a REPL
+    const char *sample_env = getenv("REASONS_HEAP_SAMPLE");
+    if (sample_env && *sample_env) {
+        memory_heap_profile_start((size_t)strtoull(sample_env, NULL, 10));
+    }
+    
     LOG_INFO("Memory system initialized, page size: %zu", g_memory.guard_page_size);
 }
 
 void memory_shutdown(void) {
+    // Write the heap profile requested through the environment
+    const char *profile_path = getenv("REASONS_HEAP_PROFILE");
+    if (g_heap.active && profile_path && *profile_path) {
+        FILE *out = fopen(profile_path, "w");
+        if (out) {
+            size_t len = strlen(profile_path);
+            bool json = len > 5 && strcmp(profile_path + len - 5, ".json") == 0;
+            memory_heap_profile_dump(out, json ? HEAP_PROFILE_SPEEDSCOPE : HEAP_PROFILE_PPROF);
+            fclose(out);
+        } else {
+            LOG_WARN("Cannot write heap profile to %s: %s", profile_path, strerror(errno));
+        }
+    }
+    memory_heap_profile_stop();
+    
     // Report leaks before cleanup
     memory_report_leaks(stderr);
     
@@ -135,8 +226,35 @@ void memory_shutdown(void) {
 }
 
 /* Core allocation functions */
-void* memory_allocate(size_t size, const char *file, int line) {
+static inline __attribute__((always_inline))
+void* memory_allocate_impl(size_t size, MemTag tag, size_t released, const char *file, int line,
+                           void *caller) {
     if (size == 0) return NULL;
+    if ((unsigned)tag >= MEM_TAG_COUNT) tag = MEM_TAG_GENERAL;
+    
+    // Enforce the subsystem budget before touching the system allocator,
+    // reserving the bytes with a CAS so concurrent callers cannot overshoot
+    // it. A reallocation is only checked for its growth: the block it
+    // replaces (released) is freed straight after
+    MemTagStats *tag_stats = &g_memory.tags[tag];
+    size_t budget = __atomic_load_n(&tag_stats->budget, __ATOMIC_RELAXED);
+    size_t current = __atomic_load_n(&tag_stats->current, __ATOMIC_RELAXED);
+    size_t reserved;
+    do {
+        reserved = current + size;
+        if (budget && reserved - released > budget) {
+            __atomic_fetch_add(&tag_stats->denied, 1, __ATOMIC_RELAXED);
+            LOG_DEBUG("Budget of '%s' exhausted: %zu bytes requested at %s:%d",
+                     g_tag_names[tag], size, file, line);
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&tag_stats->current, &current, reserved, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    size_t peak = __atomic_load_n(&tag_stats->peak, __ATOMIC_RELAXED);
+    while (reserved > peak &&
+           !__atomic_compare_exchange_n(&tag_stats->peak, &peak, reserved, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
     
     // Calculate total size with header and footer
     size_t total_size = sizeof(MemHeader) + size + (g_memory.guard_pages_enabled ? sizeof(MemFooter) : 0);
@@ -151,6 +269,7 @@ void* memory_allocate(size_t size, const char *file, int line) {
         char *mem = mmap(NULL, allocate_size, PROT_READ | PROT_WRITE, 
                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
         if (mem == MAP_FAILED) {
+            __atomic_fetch_sub(&tag_stats->current, size, __ATOMIC_RELAXED);
             LOG_ERROR("mmap failed: %s", strerror(errno));
             return NULL;
         }
@@ -165,6 +284,7 @@ void* memory_allocate(size_t size, const char *file, int line) {
     }
     
     if (!block) {
+        __atomic_fetch_sub(&tag_stats->current, size, __ATOMIC_RELAXED);
         LOG_ERROR("Allocation failed: %zu bytes", size);
         return NULL;
     }
@@ -175,6 +295,9 @@ void* memory_allocate(size_t size, const char *file, int line) {
     header->file = file;
     header->line = line;
     header->magic = MEM_MAGIC;
+    header->tag = tag;
+    header->heap_site = 0;
+    header->heap_epoch = 0;
     
     // Set up footer if enabled
     if (g_memory.guard_pages_enabled) {
@@ -182,15 +305,40 @@ void* memory_allocate(size_t size, const char *file, int line) {
         footer->guard = GUARD_MAGIC;
     }
     
-    // Track allocation
-    if (g_memory.tracking_enabled) {
-        memory_track_allocation(header, size, file, line);
+    // The lock is only for the bookkeeping below; with neither tracking
+    // nor sampling on, allocating threads never meet here
+    if (__atomic_load_n(&g_heap.active, __ATOMIC_RELAXED) ||
+        __atomic_load_n(&g_memory.tracking_enabled, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&g_memory_lock);
+        
+        // Sample for the heap profiler once enough bytes have gone by
+        if (g_heap.active) {
+            g_heap.bytes_until_sample -= (int64_t)size;
+            if (g_heap.bytes_until_sample < 0) {
+                heap_record_sample(header, caller);
+            }
+        }
+        
+        // Track allocation
+        if (g_memory.tracking_enabled) {
+            memory_track_allocation(header, size, file, line);
+        }
+        
+        pthread_mutex_unlock(&g_memory_lock);
     }
     
     // Return pointer after header
     return (void*)((char*)block + sizeof(MemHeader));
 }
 
+void* memory_allocate(size_t size, const char *file, int line) {
+    return memory_allocate_impl(size, MEM_TAG_GENERAL, 0, file, line, __builtin_return_address(0));
+}
+
+void* memory_allocate_tagged(size_t size, MemTag tag, const char *file, int line) {
+    return memory_allocate_impl(size, tag, 0, file, line, __builtin_return_address(0));
+}
+
 void* memory_reallocate(void *ptr, size_t new_size, const char *file, int line) {
     if (!ptr) return memory_allocate(new_size, file, line);
     if (new_size == 0) {
@@ -213,8 +361,10 @@ void* memory_reallocate(void *ptr, size_t new_size, const char *file, int line)
         memory_check_guard(footer);
     }
     
-    // Allocate new block
-    void *new_ptr = memory_allocate(new_size, file, line);
+    // Allocate new block, charged to the same subsystem; the old block's
+    // bytes are credited so shrinking never runs into the budget
+    void *new_ptr = memory_allocate_impl(new_size, (MemTag)header->tag, header->size, file, line,
+                                         __builtin_return_address(0));
     if (!new_ptr) return NULL;
     
     // Copy data
@@ -225,7 +375,7 @@ void* memory_reallocate(void *ptr, size_t new_size, const char *file, int line)
     memory_free(ptr, file, line);
     
     // Update statistics
-    g_memory.stats.realloc_count++;
+    __atomic_fetch_add(&g_memory.stats.realloc_count, 1, __ATOMIC_RELAXED);
     
     return new_ptr;
 }
@@ -248,9 +398,23 @@ void memory_free(void *ptr, const char *file, int line) {
         memory_check_guard(footer);
     }
     
-    // Untrack allocation
-    if (g_memory.tracking_enabled) {
-        memory_untrack_allocation(header);
+    if (header->tag < MEM_TAG_COUNT) {
+        __atomic_fetch_sub(&g_memory.tags[header->tag].current, header->size, __ATOMIC_RELAXED);
+    }
+    
+    if (header->heap_site || __atomic_load_n(&g_memory.tracking_enabled, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&g_memory_lock);
+        
+        // Untrack allocation
+        if (g_memory.tracking_enabled) {
+            memory_untrack_allocation(header);
+        }
+        
+        if (header->heap_site) {
+            heap_release_sample(header);
+        }
+        
+        pthread_mutex_unlock(&g_memory_lock);
     }
     
     // Actually free memory
@@ -308,7 +472,45 @@ void pool_free(MemPool *pool, void *block) {
 
 /* Statistics and reporting */
 MemStats memory_get_stats(void) {
-    return g_memory.stats;
+    pthread_mutex_lock(&g_memory_lock);
+    MemStats stats = g_memory.stats;
+    pthread_mutex_unlock(&g_memory_lock);
+    return stats;
+}
+
+size_t memory_current_usage(void) {
+    pthread_mutex_lock(&g_memory_lock);
+    size_t current = g_memory.stats.current_allocated;
+    pthread_mutex_unlock(&g_memory_lock);
+    return current;
+}
+
+MemTagStats memory_get_tag_stats(MemTag tag) {
+    MemTagStats stats = {0};
+    if ((unsigned)tag >= MEM_TAG_COUNT) return stats;
+    
+    MemTagStats *tag_stats = &g_memory.tags[tag];
+    stats.current = __atomic_load_n(&tag_stats->current, __ATOMIC_RELAXED);
+    stats.peak = __atomic_load_n(&tag_stats->peak, __ATOMIC_RELAXED);
+    stats.budget = __atomic_load_n(&tag_stats->budget, __ATOMIC_RELAXED);
+    stats.denied = __atomic_load_n(&tag_stats->denied, __ATOMIC_RELAXED);
+    return stats;
+}
+
+const char* memory_tag_name(MemTag tag) {
+    return (unsigned)tag < MEM_TAG_COUNT ? g_tag_names[tag] : "unknown";
+}
+
+bool memory_tag_from_name(const char *name, MemTag *tag) {
+    if (!name) return false;
+    
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        if (strcmp(name, g_tag_names[i]) == 0) {
+            if (tag) *tag = (MemTag)i;
+            return true;
+        }
+    }
+    return false;
 }
 
 void memory_report_leaks(FILE *output) {
@@ -317,6 +519,7 @@ void memory_report_leaks(FILE *output) {
         return;
     }
     
+    pthread_mutex_lock(&g_memory_lock);
     MemHeader *current = g_memory.allocations;
     size_t leak_count = 0;
     size_t leak_bytes = 0;
@@ -330,10 +533,13 @@ void memory_report_leaks(FILE *output) {
         leak_bytes += current->size;
         current = current->next;
     }
+    if (leak_count > 0) {
+        g_memory.stats.leak_count = leak_count;
+    }
+    pthread_mutex_unlock(&g_memory_lock);
     
     if (leak_count > 0) {
         fprintf(output, "Total leaks: %zu (%zu bytes)\n", leak_count, leak_bytes);
-        g_memory.stats.leak_count = leak_count;
     } else {
         fprintf(output, "No memory leaks detected\n");
     }
@@ -350,6 +556,27 @@ void memory_report(FILE *output) {
     fprintf(output, "Peak blocks:       %zu\n", stats.peak_allocation);
     fprintf(output, "Reallocations:     %zu\n", stats.realloc_count);
     fprintf(output, "Detected leaks:    %zu\n", stats.leak_count);
+    if (g_memory.limit > 0) {
+        fprintf(output, "Memory limit:      %zu bytes\n", g_memory.limit);
+    }
+    
+    // Subsystem usage
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        MemTagStats snapshot = memory_get_tag_stats((MemTag)i);
+        MemTagStats *tag = &snapshot;
+        if (tag->peak == 0 && tag->budget == 0) continue;
+        
+        fprintf(output, "Subsystem '%s': %zu bytes (peak %zu)", 
+                g_tag_names[i], tag->current, tag->peak);
+        if (tag->budget > 0) {
+            fprintf(output, ", budget %zu (%.2f%%)", tag->budget,
+                    (double)tag->current / tag->budget * 100.0);
+        }
+        if (tag->denied > 0) {
+            fprintf(output, ", %zu denied", tag->denied);
+        }
+        fprintf(output, "\n");
+    }
     
     // Arena usage
     for (size_t i = 0; i < vector_size(g_memory.arenas); i++) {
@@ -374,13 +601,228 @@ void memory_report(FILE *output) {
 
 /* Configuration */
 void memory_set_tracking(bool enabled) {
-    g_memory.tracking_enabled = enabled;
+    __atomic_store_n(&g_memory.tracking_enabled, enabled, __ATOMIC_RELAXED);
 }
 
 void memory_set_guard_pages(bool enabled) {
     g_memory.guard_pages_enabled = enabled;
 }
 
+void memory_set_budget(MemTag tag, size_t budget) {
+    if ((unsigned)tag >= MEM_TAG_COUNT) return;
+    
+    pthread_mutex_lock(&g_memory_lock);
+    __atomic_store_n(&g_memory.tags[tag].budget, budget, __ATOMIC_RELAXED);
+    g_memory.budget_explicit[tag] = true;
+    pthread_mutex_unlock(&g_memory_lock);
+    LOG_DEBUG("Budget of '%s' set to %zu bytes", g_tag_names[tag], budget);
+}
+
+bool memory_budget_check(MemTag tag, size_t size) {
+    if ((unsigned)tag >= MEM_TAG_COUNT) return true;
+    
+    MemTagStats *tag_stats = &g_memory.tags[tag];
+    size_t budget = __atomic_load_n(&tag_stats->budget, __ATOMIC_RELAXED);
+    return budget == 0 || __atomic_load_n(&tag_stats->current, __ATOMIC_RELAXED) + size <= budget;
+}
+
+void memory_set_limit(size_t limit) {
+    pthread_mutex_lock(&g_memory_lock);
+    g_memory.limit = limit;
+    
+    // Diagnostics must never be what pushes a run over its limit
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        if (g_memory.budget_explicit[i] || g_default_budget_share[i] == 0) continue;
+        __atomic_store_n(&g_memory.tags[i].budget, limit / 64 * g_default_budget_share[i],
+                         __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&g_memory_lock);
+}
+
+size_t memory_get_limit(void) {
+    return g_memory.limit;
+}
+
+/* Heap profiling */
+void memory_heap_profile_start(size_t sample_interval) {
+    // The site table uses the system allocator so sampling never recurses
+    HeapSite *sites = calloc(HEAP_MAX_SITES, sizeof(HeapSite));
+    if (!sites) {
+        LOG_ERROR("Heap profiler: cannot allocate site table");
+        return;
+    }
+    
+    pthread_mutex_lock(&g_memory_lock);
+    free(g_heap.sites);
+    g_heap.sites = sites;
+    g_heap.interval = sample_interval ? sample_interval : HEAP_PROFILE_DEFAULT_INTERVAL;
+    g_heap.site_count = 0;
+    g_heap.dropped = 0;
+    g_heap.epoch++;
+    if (!g_heap.rng) {
+        g_heap.rng = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32) ^ 0x9E3779B97F4A7C15ULL;
+    }
+    g_heap.bytes_until_sample = (int64_t)heap_next_interval();
+    __atomic_store_n(&g_heap.active, true, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&g_memory_lock);
+    
+    LOG_INFO("Heap profiler started, sampling every ~%zu bytes", g_heap.interval);
+}
+
+void memory_heap_profile_stop(void) {
+    pthread_mutex_lock(&g_memory_lock);
+    HeapSite *sites = g_heap.sites;
+    __atomic_store_n(&g_heap.active, false, __ATOMIC_RELAXED);
+    g_heap.sites = NULL;
+    g_heap.site_count = 0;
+    pthread_mutex_unlock(&g_memory_lock);
+    
+    if (!sites) return;
+    free(sites);
+    
+    LOG_INFO("Heap profiler stopped");
+}
+
+bool memory_heap_profile_active(void) {
+    return __atomic_load_n(&g_heap.active, __ATOMIC_RELAXED);
+}
+
+void memory_heap_profile_reset(void) {
+    pthread_mutex_lock(&g_memory_lock);
+    if (g_heap.sites) {
+        // Samples from the old epoch are ignored when freed
+        memset(g_heap.sites, 0, HEAP_MAX_SITES * sizeof(HeapSite));
+        g_heap.site_count = 0;
+        g_heap.dropped = 0;
+        g_heap.epoch++;
+    }
+    pthread_mutex_unlock(&g_memory_lock);
+}
+
+bool memory_heap_profile_dump(FILE *output, HeapProfileFormat format) {
+    if (!output) return false;
+    
+    pthread_mutex_lock(&g_memory_lock);
+    if (!g_heap.sites) {
+        pthread_mutex_unlock(&g_memory_lock);
+        return false;
+    }
+    
+    // Collect occupied sites, largest live footprint first
+    HeapSite **sorted = malloc((g_heap.site_count + 1) * sizeof(HeapSite*));
+    if (!sorted) {
+        pthread_mutex_unlock(&g_memory_lock);
+        return false;
+    }
+    
+    size_t count = 0;
+    HeapSite total = {0};
+    for (size_t i = 0; i < HEAP_MAX_SITES; i++) {
+        HeapSite *site = &g_heap.sites[i];
+        if (!site->key) continue;
+        sorted[count++] = site;
+        total.alloc_count += site->alloc_count;
+        total.alloc_bytes += site->alloc_bytes;
+        total.live_count += site->live_count;
+        total.live_bytes += site->live_bytes;
+        total.est_alloc_bytes += site->est_alloc_bytes;
+        total.est_live_bytes += site->est_live_bytes;
+    }
+    qsort(sorted, count, sizeof(HeapSite*), heap_site_compare);
+    
+    switch (format) {
+        case HEAP_PROFILE_TEXT:
+            fprintf(output, "\n===== Heap Profile (1 sample per ~%zu bytes) =====\n",
+                    g_heap.interval);
+            fprintf(output, "Estimated live:      %.0f bytes\n", total.est_live_bytes);
+            fprintf(output, "Estimated allocated: %.0f bytes\n", total.est_alloc_bytes);
+            fprintf(output, "Samples:             %zu live / %zu total",
+                    total.live_count, total.alloc_count);
+            if (g_heap.dropped > 0) {
+                fprintf(output, " (%zu dropped)", g_heap.dropped);
+            }
+            fprintf(output, "\n\n%14s %7s %14s  %s\n", "live bytes", "live%", "alloc bytes", "site");
+            for (size_t i = 0; i < count; i++) {
+                HeapSite *site = sorted[i];
+                double share = total.est_live_bytes > 0 ?
+                    site->est_live_bytes / total.est_live_bytes * 100.0 : 0.0;
+                fprintf(output, "%14.0f %6.2f%% %14.0f  %s:%d\n",
+                        site->est_live_bytes, share, site->est_alloc_bytes,
+                        site->file ? site->file : "?", site->line);
+            }
+            fprintf(output, "================================\n");
+            break;
+            
+        case HEAP_PROFILE_PPROF:
+            // Raw sampled counts; pprof unsamples them using the period in the header
+            fprintf(output, "heap profile: %zu: %zu [%zu: %zu] @ heap_v2/%zu\n",
+                    total.live_count, total.live_bytes,
+                    total.alloc_count, total.alloc_bytes, g_heap.interval);
+            for (size_t i = 0; i < count; i++) {
+                HeapSite *site = sorted[i];
+                fprintf(output, "%8zu: %8zu [%8zu: %8zu] @",
+                        site->live_count, site->live_bytes,
+                        site->alloc_count, site->alloc_bytes);
+                for (int f = 0; f < site->depth; f++) {
+                    fprintf(output, " %p", site->frames[f]);
+                }
+                fprintf(output, "\n");
+            }
+            
+            // Mappings let pprof symbolize the return addresses
+            fprintf(output, "\nMAPPED_LIBRARIES:\n");
+            FILE *maps = fopen("/proc/self/maps", "r");
+            if (maps) {
+                char buffer[4096];
+                size_t n;
+                while ((n = fread(buffer, 1, sizeof(buffer), maps)) > 0) {
+                    fwrite(buffer, 1, n, output);
+                }
+                fclose(maps);
+            }
+            break;
+            
+        case HEAP_PROFILE_SPEEDSCOPE:
+            // One frame per allocation site, weighted by estimated bytes
+            fprintf(output, "{\"$schema\":\"https://www.speedscope.app/file-format-schema.json\",");
+            fprintf(output, "\"name\":\"reasons heap\",\"exporter\":\"reasons\",");
+            fprintf(output, "\"shared\":{\"frames\":[");
+            for (size_t i = 0; i < count; i++) {
+                char name[512];
+                snprintf(name, sizeof(name), "%s:%d",
+                         sorted[i]->file ? sorted[i]->file : "?", sorted[i]->line);
+                fprintf(output, "%s{\"name\":", i ? "," : "");
+                heap_write_json_string(output, name);
+                fprintf(output, ",\"file\":");
+                heap_write_json_string(output, sorted[i]->file ? sorted[i]->file : "?");
+                fprintf(output, ",\"line\":%d}", sorted[i]->line);
+            }
+            fprintf(output, "]},\"profiles\":[");
+            for (int p = 0; p < 2; p++) {
+                bool live = (p == 0);
+                double end = live ? total.est_live_bytes : total.est_alloc_bytes;
+                fprintf(output, "%s{\"type\":\"sampled\",\"name\":\"%s\",\"unit\":\"bytes\","
+                        "\"startValue\":0,\"endValue\":%.0f,\"samples\":[",
+                        p ? "," : "", live ? "live bytes" : "allocated bytes", end);
+                for (size_t i = 0; i < count; i++) {
+                    fprintf(output, "%s[%zu]", i ? "," : "", i);
+                }
+                fprintf(output, "],\"weights\":[");
+                for (size_t i = 0; i < count; i++) {
+                    fprintf(output, "%s%.0f", i ? "," : "",
+                            live ? sorted[i]->est_live_bytes : sorted[i]->est_alloc_bytes);
+                }
+                fprintf(output, "]}");
+            }
+            fprintf(output, "]}\n");
+            break;
+    }
+    
+    free(sorted);
+    pthread_mutex_unlock(&g_memory_lock);
+    return true;
+}
+
 /* Internal functions */
 static void memory_track_allocation(MemHeader *header, size_t size, 
                                    const char *file, int line) {
@@ -485,9 +927,11 @@ static void* arena_alloc_internal(MemArena *arena, size_t size,
     arena->offset = aligned_offset + size;
     
     // Update statistics
+    pthread_mutex_lock(&g_memory_lock);
     g_memory.stats.total_allocated += size;
     g_memory.stats.current_allocated += size;
     g_memory.stats.allocation_count++;
+    pthread_mutex_unlock(&g_memory_lock);
     
     return ptr;
 }
@@ -565,9 +1009,11 @@ static void* pool_alloc_internal(MemPool *pool, const char *file, int line) {
     void *block = vector_pop(pool->free_list);
     
     // Update statistics
+    pthread_mutex_lock(&g_memory_lock);
     g_memory.stats.total_allocated += pool->block_size;
     g_memory.stats.current_allocated += pool->block_size;
     g_memory.stats.allocation_count++;
+    pthread_mutex_unlock(&g_memory_lock);
     
     return block;
 }
@@ -586,7 +1032,134 @@ static void pool_free_internal(MemPool *pool, void *block) {
     vector_append(pool->free_list, block);
     
     // Update statistics
+    pthread_mutex_lock(&g_memory_lock);
     g_memory.stats.total_freed += pool->block_size;
     g_memory.stats.current_allocated -= pool->block_size;
     g_memory.stats.allocation_count--;
+    pthread_mutex_unlock(&g_memory_lock);
+}
+
+/* Heap profiler internals */
+static uint64_t heap_random(void) {
+    // xorshift64*: cheap and good enough for sample spacing
+    g_heap.rng ^= g_heap.rng >> 12;
+    g_heap.rng ^= g_heap.rng << 25;
+    g_heap.rng ^= g_heap.rng >> 27;
+    return g_heap.rng * 0x2545F4914F6CDD1DULL;
+}
+
+static size_t heap_next_interval(void) {
+    // Exponentially distributed gaps make every byte equally likely to be sampled
+    double u = ((heap_random() >> 11) + 1) * (1.0 / 9007199254740993.0);
+    double gap = -log(u) * (double)g_heap.interval;
+    return gap < 1.0 ? 1 : (size_t)gap;
+}
+
+static double heap_sample_weight(size_t size) {
+    // An allocation of size s is sampled with probability 1 - e^(-s/interval)
+    double p = 1.0 - exp(-(double)size / (double)g_heap.interval);
+    return p > 0.0 ? (double)size / p : (double)size;
+}
+
+static HeapSite* heap_find_site(void **frames, int depth, const char *file, int line) {
+    // FNV-1a over the return addresses, or the source location without a stack
+    uint64_t key = 0xcbf29ce484222325ULL;
+    if (depth > 0) {
+        for (int i = 0; i < depth; i++) {
+            key = (key ^ (uint64_t)(uintptr_t)frames[i]) * 0x100000001b3ULL;
+        }
+    } else {
+        key = (key ^ (uint64_t)(uintptr_t)file) * 0x100000001b3ULL;
+        key = (key ^ (uint64_t)line) * 0x100000001b3ULL;
+    }
+    if (key == 0) key = 1;
+    
+    size_t mask = HEAP_MAX_SITES - 1;
+    for (size_t probe = 0; probe < HEAP_MAX_SITES; probe++) {
+        HeapSite *site = &g_heap.sites[(key + probe) & mask];
+        if (site->key == key) return site;
+        if (site->key == 0) {
+            // Keep the table at most 3/4 full so probes stay short
+            if (g_heap.site_count >= HEAP_MAX_SITES / 4 * 3) return NULL;
+            site->key = key;
+            site->depth = depth;
+            memcpy(site->frames, frames, depth * sizeof(void*));
+            site->file = file;
+            site->line = line;
+            g_heap.site_count++;
+            return site;
+        }
+    }
+    return NULL;
+}
+
+static __attribute__((noinline)) void heap_record_sample(MemHeader *header, void *caller) {
+    g_heap.bytes_until_sample = (int64_t)heap_next_interval();
+    
+    void *frames[HEAP_MAX_FRAMES + 2];
+    int depth = 0;
+#ifdef HAVE_BACKTRACE
+    // Skip this function and memory_allocate
+    depth = backtrace(frames, HEAP_MAX_FRAMES + 2) - 2;
+    if (depth > 0) {
+        memmove(frames, frames + 2, depth * sizeof(void*));
+    }
+#endif
+    if (depth <= 0) {
+        frames[0] = caller;
+        depth = 1;
+    }
+    
+    HeapSite *site = heap_find_site(frames, depth, header->file, header->line);
+    if (!site) {
+        g_heap.dropped++;
+        return;
+    }
+    
+    double weight = heap_sample_weight(header->size);
+    site->alloc_count++;
+    site->alloc_bytes += header->size;
+    site->live_count++;
+    site->live_bytes += header->size;
+    site->est_alloc_bytes += weight;
+    site->est_live_bytes += weight;
+    
+    header->heap_site = (unsigned)(site - g_heap.sites) + 1;
+    header->heap_epoch = g_heap.epoch;
+}
+
+static void heap_release_sample(MemHeader *header) {
+    // Samples taken before the last start/reset no longer have a site
+    if (!g_heap.sites || header->heap_epoch != g_heap.epoch) return;
+    
+    HeapSite *site = &g_heap.sites[header->heap_site - 1];
+    site->live_count--;
+    site->live_bytes -= header->size;
+    site->est_live_bytes -= heap_sample_weight(header->size);
+    if (site->est_live_bytes < 0.0) site->est_live_bytes = 0.0;
+}
+
+static int heap_site_compare(const void *a, const void *b) {
+    const HeapSite *sa = *(const HeapSite* const*)a;
+    const HeapSite *sb = *(const HeapSite* const*)b;
+    if (sa->est_live_bytes != sb->est_live_bytes) {
+        return sa->est_live_bytes < sb->est_live_bytes ? 1 : -1;
+    }
+    return sa->est_alloc_bytes < sb->est_alloc_bytes ? 1 :
+           sa->est_alloc_bytes > sb->est_alloc_bytes ? -1 : 0;
+}
+
+static void heap_write_json_string(FILE *output, const char *str) {
+    fputc('"', output);
+    for (const char *p = str; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', output);
+            fputc(*p, output);
+        } else if ((unsigned char)*p < 0x20) {
+            fprintf(output, "\\u%04x", (unsigned char)*p);
+        } else {
+            fputc(*p, output);
+        }
+    }
+    fputc('"', output);
 }
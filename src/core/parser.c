@@ -3,6 +3,8 @@
  * 
  * Implements a predictive parser with error recovery and golf syntax support.
  * Uses a recursive descent approach with Pratt parsing for expressions.
+ * Works over a pre-tokenized structure-of-arrays token buffer, walking it
+ * by index: lookahead is an index offset and no token structs are copied.
  */
 
 #include <assert.h>
@@ -22,15 +24,19 @@
 
 /* Parser state structure */
 struct parser_state {
-    lexer_t *lexer;             /* Lexer instance */
-    token_t current_token;      /* Current token being processed */
-    token_t previous_token;     /* Previous consumed token */
+    const token_buffer_t *tokens;   /* Token stream being parsed */
+    token_buffer_t *owned_tokens;   /* Set when parser_create tokenized the input */
+    size_t current;             /* Index of the current token */
+    size_t previous;            /* Index of the previous consumed token */
+    bool golf_mode;             /* Newline tokens are skipped */
     bool had_error;             /* True if any error occurred */
     bool panic_mode;            /* Error recovery flag */
     bool in_condition_context;  /* Context-aware parsing */
     bool in_consequence_context;
     ast_node_t *current_rule;   /* Current rule being parsed */
     size_t recursion_depth;     /* Prevent stack overflow */
+    char *text_buffer;          /* Scratch for NUL-terminated token text */
+    size_t text_capacity;       /* Size of text_buffer */
 };
 
 /* Operator precedence levels */
@@ -50,15 +56,33 @@ typedef enum {
 } precedence_t;
 
 /* Forward declarations */
+static ast_node_t *parse_import(parser_t *parser);
+static ast_node_t *parse_rule_declaration(parser_t *parser);
+static ast_node_t *parse_statement(parser_t *parser);
+static ast_node_t *parse_decision(parser_t *parser);
+static ast_node_t *parse_when_statement(parser_t *parser);
+static ast_node_t *parse_consequence(parser_t *parser);
 static ast_node_t *parse_expression(parser_t *parser, precedence_t precedence);
 static void parser_synchronize(parser_t *parser);
 static void parser_advance(parser_t *parser);
-static void parser_error_at(parser_t *parser, token_t *token, const char *message);
+static void parser_error_at(parser_t *parser, size_t token, const char *message);
 static void parser_error_current(parser_t *parser, const char *message);
 static bool parser_match(parser_t *parser, token_type_t type);
 static bool parser_check(parser_t *parser, token_type_t type);
 static bool parser_consume(parser_t *parser, token_type_t type, const char *message);
 static precedence_t get_precedence(token_type_t type);
+static const char *parser_token_text(parser_t *parser, size_t token);
+
+/* Type of the token at index; the buffer always ends with TOKEN_EOF */
+static inline token_type_t parser_type_at(const parser_t *parser, size_t index)
+{
+    return (token_type_t)parser->tokens->types[index];
+}
+
+static inline bool parser_at_end(const parser_t *parser)
+{
+    return parser_type_at(parser, parser->current) == TOKEN_EOF;
+}
 
 /* Parser creation/destruction */
 parser_t *parser_create(lexer_t *lexer)
@@ -68,6 +92,31 @@ parser_t *parser_create(lexer_t *lexer)
         return NULL;
     }
 
+    token_buffer_t *tokens = lexer_tokenize_all(lexer);
+    if (!tokens) {
+        return NULL;
+    }
+
+    parser_t *parser = parser_create_from_tokens(tokens);
+    if (!parser) {
+        token_buffer_destroy(tokens);
+        return NULL;
+    }
+
+    lexer_options_t options;
+    lexer_get_options(lexer, &options);
+    parser->golf_mode = options.golf_mode;
+    parser->owned_tokens = tokens;
+    return parser;
+}
+
+parser_t *parser_create_from_tokens(const token_buffer_t *tokens)
+{
+    if (!tokens || tokens->count == 0) {
+        error_set(ERROR_INVALID_ARGUMENT, "Token buffer cannot be empty");
+        return NULL;
+    }
+
     parser_t *parser = memory_allocate(sizeof(parser_t));
     if (!parser) {
         error_set(ERROR_MEMORY, "Failed to allocate parser");
@@ -75,7 +124,8 @@ parser_t *parser_create(lexer_t *lexer)
     }
 
     memset(parser, 0, sizeof(parser_t));
-    parser->lexer = lexer;
+    parser->tokens = tokens;
+    parser->golf_mode = true;
     parser->had_error = false;
     parser->panic_mode = false;
     parser->in_condition_context = false;
@@ -83,8 +133,11 @@ parser_t *parser_create(lexer_t *lexer)
     parser->current_rule = NULL;
     parser->recursion_depth = 0;
 
-    /* Load first token */
-    parser_advance(parser);
+    /* Start on the first token (skipping a leading newline in golf mode) */
+    parser->current = 0;
+    if (parser_type_at(parser, 0) == TOKEN_NEWLINE) {
+        parser_advance(parser);
+    }
 
     LOG_DEBUG("Parser created successfully");
     return parser;
@@ -94,8 +147,8 @@ void parser_destroy(parser_t *parser)
 {
     if (!parser) return;
     
-    token_free(&parser->current_token);
-    token_free(&parser->previous_token);
+    token_buffer_destroy(parser->owned_tokens);
+    memory_free(parser->text_buffer);
     memory_free(parser);
     
     LOG_DEBUG("Parser destroyed");
@@ -109,21 +162,15 @@ ast_node_t *parser_parse(parser_t *parser)
     ast_node_t *program = ast_create_node(AST_PROGRAM);
     if (!program) return NULL;
 
-    while (!lexer_at_end(parser->lexer) {
+    while (!parser_at_end(parser)) {
         if (parser->had_error) break;
 
-        ast_node_t *declaration = parse_rule_declaration(parser);
+        ast_node_t *declaration = parser_parse_declaration(parser);
         if (declaration) {
             ast_add_child(program, declaration);
         } else {
-            /* Try to parse as a top-level decision */
-            declaration = parse_decision(parser);
-            if (declaration) {
-                ast_add_child(program, declaration);
-            } else {
-                /* Skip to next declaration */
-                parser_synchronize(parser);
-            }
+            /* Skip to next declaration */
+            parser_synchronize(parser);
         }
     }
 
@@ -135,24 +182,81 @@ ast_node_t *parser_parse(parser_t *parser)
     return program;
 }
 
+ast_node_t *parser_parse_declaration(parser_t *parser)
+{
+    if (!parser || parser_at_end(parser)) return NULL;
+
+    if (parser_check(parser, TOKEN_USE)) {
+        return parse_import(parser);
+    }
+
+    ast_node_t *declaration = parse_rule_declaration(parser);
+    if (!declaration) {
+        /* Try to parse as a top-level decision */
+        declaration = parse_decision(parser);
+    }
+    return declaration;
+}
+
+size_t parser_position(const parser_t *parser)
+{
+    return parser ? parser->current : 0;
+}
+
+void parser_seek(parser_t *parser, size_t token)
+{
+    if (!parser) return;
+
+    /* Clamp to the terminating EOF */
+    if (token >= parser->tokens->count) {
+        token = parser->tokens->count - 1;
+    }
+    parser->current = token;
+    parser->previous = token;
+    parser->had_error = false;
+    parser->panic_mode = false;
+}
+
+/* use "path" | use name */
+static ast_node_t *parse_import(parser_t *parser)
+{
+    parser_advance(parser);
+
+    size_t path_token = parser->current;
+    if (!parser_match(parser, TOKEN_STRING) && !parser_match(parser, TOKEN_IDENTIFIER)) {
+        parser_error_current(parser, "Expected module path after 'use'");
+        return NULL;
+    }
+
+    ast_node_t *import = ast_create_import(parser_token_text(parser, path_token));
+    if (import) {
+        import->line = (int)parser->tokens->lines[path_token];
+        import->column = (int)parser->tokens->columns[path_token];
+    }
+    parser_match(parser, TOKEN_SEMICOLON);
+    return import;
+}
+
 static ast_node_t *parse_rule_declaration(parser_t *parser)
 {
     if (!parser_match(parser, TOKEN_RULE)) {
         return NULL;
     }
 
-    token_t name_token = parser->previous_token;
+    size_t name_token = parser->current;
     if (!parser_consume(parser, TOKEN_IDENTIFIER, "Expected rule name")) {
         return NULL;
     }
 
     /* Create rule node */
-    ast_node_t *rule = ast_create_rule(name_token.value, NULL);
+    ast_node_t *rule = ast_create_rule(parser_token_text(parser, name_token), NULL);
     if (!rule) return NULL;
+    ast_node_t *enclosing = parser->current_rule;
     parser->current_rule = rule;
 
     /* Parse rule body */
     if (!parser_consume(parser, TOKEN_LBRACE, "Expected '{' before rule body")) {
+        parser->current_rule = enclosing;
         ast_destroy(rule);
         return NULL;
     }
@@ -167,11 +271,12 @@ static ast_node_t *parse_rule_declaration(parser_t *parser)
     }
 
     if (!parser_consume(parser, TOKEN_RBRACE, "Expected '}' after rule body")) {
+        parser->current_rule = enclosing;
         ast_destroy(rule);
         return NULL;
     }
 
-    parser->current_rule = NULL;
+    parser->current_rule = enclosing;
     return rule;
 }
 
@@ -179,7 +284,8 @@ static ast_node_t *parse_statement(parser_t *parser)
 {
     if (parser_match(parser, TOKEN_IF)) {
         return parse_decision(parser);
-    } else if (parser_match(parser, TOKEN_RULE)) {
+    } else if (parser_check(parser, TOKEN_RULE)) {
+        /* Nested rule; parse_rule_declaration consumes the keyword itself */
         return parse_rule_declaration(parser);
     } else if (parser_match(parser, TOKEN_WHEN)) {
         return parse_when_statement(parser);
@@ -263,7 +369,7 @@ static ast_node_t *parse_decision(parser_t *parser)
 
 static ast_node_t *parse_when_statement(parser_t *parser)
 {
-    token_t condition = parser->current_token;
+    size_t condition = parser->current;
     if (!parser_consume(parser, TOKEN_IDENTIFIER, "Expected condition identifier")) {
         return NULL;
     }
@@ -275,7 +381,7 @@ static ast_node_t *parse_when_statement(parser_t *parser)
     ast_node_t *consequence = parse_consequence(parser);
     if (!consequence) return NULL;
     
-    return ast_create_decision(condition.value, consequence, NULL);
+    return ast_create_decision(parser_token_text(parser, condition), consequence, NULL);
 }
 
 static ast_node_t *parse_consequence(parser_t *parser)
@@ -289,14 +395,15 @@ static ast_node_t *parse_consequence(parser_t *parser)
             parser_match(parser, TOKEN_PASS) ||
             parser_match(parser, TOKEN_FAIL)) {
             
+            token_type_t matched = parser_type_at(parser, parser->previous);
             consequence_type_t type = 
-                (parser->previous_token.type == TOKEN_WIN) ? CONSEQUENCE_WIN :
-                (parser->previous_token.type == TOKEN_LOSE) ? CONSEQUENCE_LOSE :
-                (parser->previous_token.type == TOKEN_DRAW) ? CONSEQUENCE_DRAW :
-                (parser->previous_token.type == TOKEN_SKIP) ? CONSEQUENCE_SKIP :
-                (parser->previous_token.type == TOKEN_PASS) ? CONSEQUENCE_PASS : CONSEQUENCE_FAIL;
+                (matched == TOKEN_WIN) ? CONSEQUENCE_WIN :
+                (matched == TOKEN_LOSE) ? CONSEQUENCE_LOSE :
+                (matched == TOKEN_DRAW) ? CONSEQUENCE_DRAW :
+                (matched == TOKEN_SKIP) ? CONSEQUENCE_SKIP :
+                (matched == TOKEN_PASS) ? CONSEQUENCE_PASS : CONSEQUENCE_FAIL;
             
-            return ast_create_consequence(parser->previous_token.value, type);
+            return ast_create_consequence(parser_token_text(parser, parser->previous), type);
         }
     }
     
@@ -326,45 +433,46 @@ static ast_node_t *parse_expression(parser_t *parser, precedence_t precedence)
     
     /* Parse prefix expression */
     ast_node_t *left;
-    switch (parser->current_token.type) {
+    switch (parser_type_at(parser, parser->current)) {
         case TOKEN_TRUE:
         case TOKEN_FALSE: {
-            token_t token = parser->current_token;
+            size_t token = parser->current;
             parser_advance(parser);
             
             reasons_value_t value;
             value.type = VALUE_BOOL;
-            value.data.bool_val = (token.type == TOKEN_TRUE);
+            value.data.bool_val = (parser_type_at(parser, token) == TOKEN_TRUE);
             left = ast_create_literal(&value);
             break;
         }
         
         case TOKEN_NUMBER: {
-            token_t token = parser->current_token;
+            size_t token = parser->current;
             parser_advance(parser);
             
+            const char *text = parser_token_text(parser, token);
             reasons_value_t value;
             value.type = VALUE_NUMBER;
-            value.data.number_val = atof(token.value);
+            value.data.number_val = text ? atof(text) : 0.0;
             left = ast_create_literal(&value);
             break;
         }
         
         case TOKEN_STRING: {
-            token_t token = parser->current_token;
+            size_t token = parser->current;
             parser_advance(parser);
             
             reasons_value_t value;
             value.type = VALUE_STRING;
-            value.data.string_val = token.value;
+            value.data.string_val = parser_token_text(parser, token);
             left = ast_create_literal(&value);
             break;
         }
         
         case TOKEN_IDENTIFIER: {
-            token_t token = parser->current_token;
+            size_t token = parser->current;
             parser_advance(parser);
-            left = ast_create_identifier(token.value);
+            left = ast_create_identifier(parser_token_text(parser, token));
             break;
         }
         
@@ -380,7 +488,7 @@ static ast_node_t *parse_expression(parser_t *parser, precedence_t precedence)
         
         case TOKEN_LOGICAL_NOT:
         case TOKEN_MINUS: {
-            token_t op_token = parser->current_token;
+            token_type_t op_type = parser_type_at(parser, parser->current);
             parser_advance(parser);
             
             ast_node_t *right = parse_expression(parser, PREC_UNARY);
@@ -389,7 +497,7 @@ static ast_node_t *parse_expression(parser_t *parser, precedence_t precedence)
                 break;
             }
             
-            logic_op_t op = (op_token.type == TOKEN_LOGICAL_NOT) ? LOGIC_NOT : LOGIC_NEGATE;
+            logic_op_t op = (op_type == TOKEN_LOGICAL_NOT) ? LOGIC_NOT : LOGIC_NEGATE;
             left = ast_create_logic_op(op, right, NULL);
             break;
         }
@@ -401,15 +509,15 @@ static ast_node_t *parse_expression(parser_t *parser, precedence_t precedence)
     }
     
     /* Parse infix expressions */
-    while (left && precedence <= get_precedence(parser->current_token.type)) {
-        token_t operator = parser->current_token;
+    while (left && precedence <= get_precedence(parser_type_at(parser, parser->current))) {
+        token_type_t operator = parser_type_at(parser, parser->current);
         parser_advance(parser);
         
-        switch (operator.type) {
+        switch (operator) {
             case TOKEN_LOGICAL_AND:
             case TOKEN_LOGICAL_OR: {
-                logic_op_t op = (operator.type == TOKEN_LOGICAL_AND) ? LOGIC_AND : LOGIC_OR;
-                ast_node_t *right = parse_expression(parser, get_precedence(operator.type) + 1);
+                logic_op_t op = (operator == TOKEN_LOGICAL_AND) ? LOGIC_AND : LOGIC_OR;
+                ast_node_t *right = parse_expression(parser, get_precedence(operator) + 1);
                 left = ast_create_logic_op(op, left, right);
                 break;
             }
@@ -421,13 +529,13 @@ static ast_node_t *parse_expression(parser_t *parser, precedence_t precedence)
             case TOKEN_GREATER:
             case TOKEN_GREATER_EQUAL: {
                 comparison_op_t op = 
-                    (operator.type == TOKEN_EQUAL) ? CMP_EQ :
-                    (operator.type == TOKEN_NOT_EQUAL) ? CMP_NE :
-                    (operator.type == TOKEN_LESS) ? CMP_LT :
-                    (operator.type == TOKEN_LESS_EQUAL) ? CMP_LE :
-                    (operator.type == TOKEN_GREATER) ? CMP_GT : CMP_GE;
+                    (operator == TOKEN_EQUAL) ? CMP_EQ :
+                    (operator == TOKEN_NOT_EQUAL) ? CMP_NE :
+                    (operator == TOKEN_LESS) ? CMP_LT :
+                    (operator == TOKEN_LESS_EQUAL) ? CMP_LE :
+                    (operator == TOKEN_GREATER) ? CMP_GT : CMP_GE;
                 
-                ast_node_t *right = parse_expression(parser, get_precedence(operator.type) + 1);
+                ast_node_t *right = parse_expression(parser, get_precedence(operator) + 1);
                 left = ast_create_comparison(op, left, right);
                 break;
             }
@@ -437,7 +545,7 @@ static ast_node_t *parse_expression(parser_t *parser, precedence_t precedence)
             case TOKEN_MULTIPLY:
             case TOKEN_DIVIDE: {
                 /* Handle arithmetic operators */
-                ast_node_t *right = parse_expression(parser, get_precedence(operator.type) + 1);
+                ast_node_t *right = parse_expression(parser, get_precedence(operator) + 1);
                 /* Create appropriate AST node (implementation specific) */
                 break;
             }
@@ -473,30 +581,30 @@ static void parser_advance(parser_t *parser)
 {
     if (!parser) return;
     
-    token_free(&parser->previous_token);
-    parser->previous_token = parser->current_token;
+    parser->previous = parser->current;
     
     if (parser->panic_mode) {
         /* Skip tokens until synchronization point */
-        while (!lexer_at_end(parser->lexer)) {
-            token_t token = lexer_next_token(parser->lexer);
-            if (token.type == TOKEN_SEMICOLON || 
-                token.type == TOKEN_END ||
-                token.type == TOKEN_RBRACE) {
+        while (!parser_at_end(parser)) {
+            token_type_t type = parser_type_at(parser, ++parser->current);
+            if (type == TOKEN_SEMICOLON || 
+                type == TOKEN_END ||
+                type == TOKEN_RBRACE) {
                 parser->panic_mode = false;
-                parser->current_token = token;
                 return;
             }
-            token_free(&token);
         }
+        return;
     }
     
-    parser->current_token = lexer_next_token(parser->lexer);
+    /* Never move past the terminating EOF */
+    if (!parser_at_end(parser)) {
+        parser->current++;
+    }
     
     /* Handle newlines as statement terminators in golf mode */
-    if (parser->current_token.type == TOKEN_NEWLINE && 
-        parser->lexer->options.golf_mode) {
-        parser_advance(parser);
+    while (parser->golf_mode && parser_type_at(parser, parser->current) == TOKEN_NEWLINE) {
+        parser->current++;
     }
 }
 
@@ -513,8 +621,8 @@ static bool parser_match(parser_t *parser, token_type_t type)
 
 static bool parser_check(parser_t *parser, token_type_t type)
 {
-    if (lexer_at_end(parser->lexer)) return false;
-    return parser->current_token.type == type;
+    if (parser_at_end(parser)) return false;
+    return parser_type_at(parser, parser->current) == type;
 }
 
 static bool parser_consume(parser_t *parser, token_type_t type, const char *message)
@@ -528,16 +636,49 @@ static bool parser_consume(parser_t *parser, token_type_t type, const char *mess
     return false;
 }
 
+/* Token text as a NUL-terminated string. Tokens are slices of the source,
+ * so the text is copied into a scratch buffer that the next call reuses;
+ * the AST constructors duplicate whatever they keep. */
+static const char *parser_token_text(parser_t *parser, size_t token)
+{
+    size_t length = 0;
+    const char *text = token_buffer_text(parser->tokens, token, &length);
+    if (!text || (length == 0 && parser_type_at(parser, token) != TOKEN_STRING)) {
+        return NULL;
+    }
+    
+    size_t needed = length + 1;
+    if (needed > parser->text_capacity) {
+        size_t capacity = parser->text_capacity ? parser->text_capacity : 64;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        
+        char *buffer = memory_reallocate(parser->text_buffer, capacity);
+        if (!buffer) {
+            error_set(ERROR_MEMORY, "Failed to allocate token text buffer");
+            return NULL;
+        }
+        parser->text_buffer = buffer;
+        parser->text_capacity = capacity;
+    }
+    
+    memcpy(parser->text_buffer, text, length);
+    parser->text_buffer[length] = '\0';
+    return parser->text_buffer;
+}
+
 /* Error handling */
-static void parser_error_at(parser_t *parser, token_t *token, const char *message)
+static void parser_error_at(parser_t *parser, size_t token, const char *message)
 {
     if (parser->panic_mode) return;
     parser->panic_mode = true;
     parser->had_error = true;
     
     char error_msg[256];
-    snprintf(error_msg, sizeof(error_msg), "[Line %zu, Col %zu] Parser error: %s",
-             token->line, token->column, message);
+    snprintf(error_msg, sizeof(error_msg), "[Line %u, Col %u] Parser error: %s",
+             (unsigned)parser->tokens->lines[token], (unsigned)parser->tokens->columns[token],
+             message);
     
     LOG_ERROR("%s", error_msg);
     error_set(ERROR_SYNTAX, error_msg);
@@ -545,20 +686,20 @@ static void parser_error_at(parser_t *parser, token_t *token, const char *messag
 
 static void parser_error_current(parser_t *parser, const char *message)
 {
-    parser_error_at(parser, &parser->current_token, message);
+    parser_error_at(parser, parser->current, message);
 }
 
 static void parser_synchronize(parser_t *parser)
 {
     parser->panic_mode = true;
     
-    while (!lexer_at_end(parser->lexer)) {
-        if (parser->previous_token.type == TOKEN_SEMICOLON ||
-            parser->previous_token.type == TOKEN_END) {
+    while (!parser_at_end(parser)) {
+        if (parser_type_at(parser, parser->previous) == TOKEN_SEMICOLON ||
+            parser_type_at(parser, parser->previous) == TOKEN_END) {
             return;
         }
         
-        switch (parser->current_token.type) {
+        switch (parser_type_at(parser, parser->current)) {
             case TOKEN_RULE:
             case TOKEN_IF:
             case TOKEN_WHEN:
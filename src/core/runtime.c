@@ -3,7 +3,8 @@
  * 
  * Features:
  * - Scoped variable management
- * - Function registry with built-in/stdlib support
+ * - Function registry with built-in/stdlib support, on a sharded table so
+ *   concurrent lookups only take shared locks
  * - Consequence execution with side effects
  * - Execution context management
  * - Error handling and stack traces
@@ -22,6 +23,7 @@
 #include "utils/memory.h"
 #include "utils/logger.h"
 #include "utils/collections.h"
+#include "utils/concurrent_hash.h"
 #include "utils/error.h"
 #include <string.h>
 #include <time.h>
@@ -32,10 +34,10 @@ typedef struct Scope {
     struct Scope *parent;      // Parent scope
 } Scope;
 
-/* Function registry entry */
+/* Function registry entry, stored and looked up by value */
 typedef struct {
     runtime_function_t function;
-    char *description;
+    const char *description;   // Owned by function_descriptions
     unsigned min_args;
     unsigned max_args;
 } FunctionEntry;
@@ -43,7 +45,8 @@ typedef struct {
 /* Runtime environment structure */
 struct runtime_env {
     Scope *current_scope;      // Current variable scope
-    hash_table_t *functions;   // Registered functions
+    ConcurrentHashTable *functions; // Registered functions by name
+    vector_t *function_descriptions; // Outlive re-registration; freed on destroy
     vector_t *call_stack;      // Function call stack
     vector_t *consequence_handlers; // Consequence handlers
     config_t config;           // Runtime configuration
@@ -80,12 +83,8 @@ static void scope_destroy(Scope *scope) {
     mem_free(scope);
 }
 
-static void free_function_entry(void *entry) {
-    FunctionEntry *fe = (FunctionEntry*)entry;
-    if (fe) {
-        if (fe->description) mem_free(fe->description);
-        mem_free(fe);
-    }
+static void free_description(void *description) {
+    mem_free(description);
 }
 
 static void free_consequence_handler(void *handler) {
@@ -205,7 +204,8 @@ runtime_env_t* runtime_create() {
         env->current_scope = scope_create(NULL);
         
         // Initialize collections
-        env->functions = hash_create(64);
+        env->functions = concurrent_hashtable_create(64, 0, NULL);
+        env->function_descriptions = vector_create(16);
         env->call_stack = vector_create(16);
         env->consequence_handlers = vector_create(8);
         
@@ -248,7 +248,8 @@ void runtime_destroy(runtime_env_t *env) {
     }
     
     // Destroy function registry
-    hash_destroy_custom(env->functions, free_function_entry);
+    concurrent_hashtable_destroy(env->functions);
+    vector_destroy_custom(env->function_descriptions, free_description);
     
     // Destroy consequence handlers
     vector_destroy_custom(env->consequence_handlers, free_consequence_handler);
@@ -346,26 +347,24 @@ bool runtime_register_function(runtime_env_t *env, const char *name,
                               unsigned min_args, unsigned max_args) {
     if (!env || !name || !function) return false;
     
-    FunctionEntry *entry = mem_alloc(sizeof(FunctionEntry));
-    if (!entry) return false;
-    
-    entry->function = function;
-    entry->min_args = min_args;
-    entry->max_args = max_args;
-    entry->description = description ? string_duplicate(description) : NULL;
-    
-    const char *key = string_duplicate(name);
-    if (!key) {
-        free_function_entry(entry);
-        return false;
-    }
-    
-    if (!hash_set(env->functions, key, entry)) {
-        mem_free((void*)key);
-        free_function_entry(entry);
-        return false;
+    FunctionEntry entry;
+    entry.function = function;
+    entry.min_args = min_args;
+    entry.max_args = max_args;
+    entry.description = NULL;
+    
+    // A replaced entry's description may still be held by a concurrent
+    // lookup's copy, so descriptions live as long as the environment
+    if (description) {
+        char *copy = string_duplicate(description);
+        if (!copy || !vector_append(env->function_descriptions, copy)) {
+            if (copy) mem_free(copy);
+            return false;
+        }
+        entry.description = copy;
     }
     
+    concurrent_hashtable_set(env->functions, name, strlen(name), &entry, sizeof(entry));
     return true;
 }
 
@@ -384,15 +383,15 @@ reasons_value_t runtime_call_function(runtime_env_t *env, const char *name,
     }
     
     // Get function entry
-    FunctionEntry *entry = hash_get(env->functions, name);
-    if (!entry) {
+    FunctionEntry entry;
+    if (!concurrent_hashtable_get(env->functions, name, strlen(name), &entry, sizeof(entry))) {
         // Check built-in functions
         return execute_builtin(env, name, args, num_args);
     }
     
     // Validate arguments
-    if (num_args < entry->min_args || 
-        (entry->max_args != VAR_ARGS && num_args > entry->max_args)) {
+    if (num_args < entry.min_args || 
+        (entry.max_args != VAR_ARGS && num_args > entry.max_args)) {
         runtime_set_error(env, ERROR_ARGUMENT, "Invalid number of arguments");
         return result;
     }
@@ -401,7 +400,7 @@ reasons_value_t runtime_call_function(runtime_env_t *env, const char *name,
     vector_push(env->call_stack, (void*)name);
     
     // Call the function
-    result = entry->function(env, args, num_args);
+    result = entry.function(env, args, num_args);
     
     // Pop from call stack
     vector_pop(env->call_stack);
@@ -531,6 +530,10 @@ runtime_stats_t runtime_get_stats(runtime_env_t *env) {
     if (env) {
         // Calculate current memory usage
         env->stats.memory_allocated = memory_current_usage();
+        env->stats.memory_limit = memory_get_limit();
+        for (int i = 0; i < MEM_TAG_COUNT; i++) {
+            env->stats.subsystem_memory[i] = memory_get_tag_stats((MemTag)i);
+        }
         
         // Calculate uptime
         clock_t now = clock();
@@ -26,12 +26,14 @@
 #include "utils/memory.h"
 #include "utils/logger.h"
 #include "utils/collections.h"
+#include "utils/small_vector.h"
 #include "utils/string_utils.h"
 
 /* Maximum trace entry depth and size limits */
 #define TRACE_MAX_DEPTH 1000
 #define TRACE_MAX_ENTRIES 10000
 #define TRACE_MAX_MESSAGE_LEN 512
+#define TRACE_BUDGET_HEADROOM 64    /* Entries kept free under the trace budget */
 #define TRACE_TIMESTAMP_BUFFER_SIZE 32
 
 /* Trace entry types */
@@ -62,6 +64,9 @@ typedef struct trace_entry {
     struct trace_entry *next;       /* For linked list */
 } trace_entry_t;
 
+/* Open node stack; inline slots cover typical tree depths */
+SMALL_VECTOR_DEFINE(node_stack_t, node_stack, ast_node_t *, 32)
+
 /* Trace session structure */
 struct trace {
     trace_entry_t *first_entry;     /* First entry in trace */
@@ -76,7 +81,7 @@ struct trace {
     bool timestamp_mode;            /* Include timestamps */
     struct timespec start_time;     /* Trace session start time */
     trace_stats_t stats;            /* Trace statistics */
-    vector_t *node_stack;           /* Node execution stack */
+    node_stack_t node_stack;        /* Node execution stack */
     hash_table_t *node_counts;      /* Node execution counts */
     FILE *output_file;              /* Optional output file */
 };
@@ -86,6 +91,7 @@ static trace_entry_t *trace_entry_create(trace_entry_type_t type, int depth,
                                          ast_node_t *node, const char *message);
 static void trace_entry_destroy(trace_entry_t *entry);
 static void trace_add_entry(trace_t *trace, trace_entry_t *entry);
+static void trace_drop_oldest(trace_t *trace);
 static void format_timestamp(char *buffer, size_t size, struct timespec *time);
 static unsigned long calculate_elapsed_ns(const struct timespec *start, 
                                          const struct timespec *current);
@@ -106,7 +112,7 @@ trace_t *trace_create(void)
     trace->detailed_mode = true;
     trace->timestamp_mode = true;
     trace->max_entries = TRACE_MAX_ENTRIES;
-    trace->node_stack = vector_create(32);
+    node_stack_init(&trace->node_stack);
     trace->node_counts = hash_create(128);
     
     /* Record start time */
@@ -129,7 +135,7 @@ void trace_destroy(trace_t *trace)
     }
     
     /* Free resources */
-    vector_destroy(trace->node_stack);
+    node_stack_destroy(&trace->node_stack);
     hash_destroy(trace->node_counts);
     
     /* Close output file if open */
@@ -207,7 +213,7 @@ void trace_clear(trace_t *trace)
     memset(&trace->stats, 0, sizeof(trace_stats_t));
     
     /* Clear collections */
-    vector_clear(trace->node_stack);
+    node_stack_clear(&trace->node_stack);
     hash_clear(trace->node_counts);
     
     /* Reset start time */
@@ -297,13 +303,15 @@ void trace_enter_node(trace_t *trace, ast_node_t *node)
         if (count) {
             (*count)++;
         } else {
-            size_t *new_count = memory_allocate(sizeof(size_t));
-            *new_count = 1;
-            hash_set(trace->node_counts, node_key, new_count);
+            size_t *new_count = mem_alloc_tagged(sizeof(size_t), MEM_TAG_TRACE);
+            if (new_count) {
+                *new_count = 1;
+                hash_set(trace->node_counts, node_key, new_count);
+            }
         }
         
         /* Push onto node stack */
-        vector_push(trace->node_stack, node);
+        node_stack_push(&trace->node_stack, node);
         
         trace->stats.nodes_entered++;
     }
@@ -339,8 +347,8 @@ void trace_exit_node(trace_t *trace, ast_node_t *node, const reasons_value_t *re
         trace_add_entry(trace, entry);
         
         /* Pop from node stack */
-        if (vector_size(trace->node_stack) > 0) {
-            vector_pop(trace->node_stack);
+        if (trace->node_stack.size > 0) {
+            node_stack_pop(&trace->node_stack);
         }
         
         trace->stats.nodes_exited++;
@@ -666,11 +674,11 @@ bool trace_has_more(const trace_t *trace)
 /* Stack trace generation */
 char *trace_get_stack_trace(const trace_t *trace)
 {
-    if (!trace || vector_size(trace->node_stack) == 0) {
+    if (!trace || trace->node_stack.size == 0) {
         return string_duplicate("(empty stack)");
     }
     
-    size_t stack_size = vector_size(trace->node_stack);
+    size_t stack_size = trace->node_stack.size;
     size_t buffer_size = stack_size * 256;  /* Estimate */
     char *buffer = memory_allocate(buffer_size);
     if (!buffer) return NULL;
@@ -678,7 +686,7 @@ char *trace_get_stack_trace(const trace_t *trace)
     buffer[0] = '\0';
     
     for (size_t i = 0; i < stack_size; i++) {
-        ast_node_t *node = vector_get(trace->node_stack, i);
+        ast_node_t *node = trace->node_stack.data[i];
         if (node) {
             char line[256];
             const char *type_name = ast_node_type_name(node->type);
@@ -846,9 +854,12 @@ bool trace_export_csv(const trace_t *trace, const char *filename)
 static trace_entry_t *trace_entry_create(trace_entry_type_t type, int depth, 
                                          ast_node_t *node, const char *message)
 {
-    trace_entry_t *entry = memory_allocate(sizeof(trace_entry_t));
+    trace_entry_t *entry = mem_alloc_tagged(sizeof(trace_entry_t), MEM_TAG_TRACE);
     if (!entry) {
-        error_set(ERROR_MEMORY, "Failed to allocate trace entry");
+        /* An exhausted trace budget just loses the entry */
+        if (memory_budget_check(MEM_TAG_TRACE, sizeof(trace_entry_t))) {
+            error_set(ERROR_MEMORY, "Failed to allocate trace entry");
+        }
         return NULL;
     }
     
@@ -884,6 +895,23 @@ static void trace_entry_destroy(trace_entry_t *entry)
     memory_free(entry);
 }
 
+static void trace_drop_oldest(trace_t *trace)
+{
+    trace_entry_t *old_first = trace->first_entry;
+    if (!old_first) return;
+    
+    trace->first_entry = old_first->next;
+    if (trace->first_entry == NULL) {
+        trace->last_entry = NULL;
+    }
+    if (trace->current_entry == old_first) {
+        trace->current_entry = trace->first_entry;
+    }
+    trace_entry_destroy(old_first);
+    trace->entry_count--;
+    trace->stats.entries_evicted++;
+}
+
 static void trace_add_entry(trace_t *trace, trace_entry_t *entry)
 {
     if (!trace || !entry) return;
@@ -891,14 +919,19 @@ static void trace_add_entry(trace_t *trace, trace_entry_t *entry)
     /* Check entry limit */
     if (trace->entry_count >= trace->max_entries) {
         /* Remove oldest entry to make room */
-        if (trace->first_entry) {
-            trace_entry_t *old_first = trace->first_entry;
-            trace->first_entry = old_first->next;
-            if (trace->first_entry == NULL) {
-                trace->last_entry = NULL;
-            }
-            trace_entry_destroy(old_first);
-            trace->entry_count--;
+        trace_drop_oldest(trace);
+    }
+    
+    /* Stay within the trace memory budget: shed detail first, then old entries */
+    const size_t headroom = TRACE_BUDGET_HEADROOM * sizeof(trace_entry_t);
+    if (!memory_budget_check(MEM_TAG_TRACE, headroom)) {
+        if (trace->detailed_mode) {
+            trace->detailed_mode = false;
+            trace->stats.budget_degraded = true;
+            LOG_WARN("Trace memory budget reached, dropping detailed values");
+        }
+        while (trace->first_entry && !memory_budget_check(MEM_TAG_TRACE, headroom)) {
+            trace_drop_oldest(trace);
         }
     }
     
@@ -1117,7 +1150,9 @@ size_t trace_get_memory_usage(const trace_t *trace)
     
     size_t base_size = sizeof(trace_t);
     size_t entries_size = trace->entry_count * sizeof(trace_entry_t);
-    size_t stack_size = vector_capacity(trace->node_stack) * sizeof(void*);
+    /* Inline slots are already counted in sizeof(trace_t) */
+    size_t stack_size = trace->node_stack.data != trace->node_stack.inline_buf ?
+                        trace->node_stack.capacity * sizeof(ast_node_t *) : 0;
     size_t counts_size = hash_capacity(trace->node_counts) * sizeof(size_t);
     
     return base_size + entries_size + stack_size + counts_size;
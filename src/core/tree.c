@@ -5,9 +5,11 @@
  * - Multi-type tree nodes (condition, action, outcome)
  * - Node metadata for debugging/explanation
  * - Tree optimization capabilities
- * - Parent pointers for traversal
- * - Execution statistics tracking
+ * - Root-to-node paths from the tree's index, valid for shared nodes
+ * - Execution statistics tracking, sharded per thread and folded on demand
  * - Path-sensitive analysis
+ * - Persistent versions: clones share nodes and edits copy only the path
+ *   from the root to the edited node
  * - Integration with AST and evaluation components
  */
 
@@ -19,25 +21,47 @@
 #include "utils/logger.h"
 #include "utils/collections.h"
 #include "stdlib/stats.h"
+#include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <math.h>
+#include <pthread.h>
+
+#define TREE_STAT_SHARDS 8              // Counter shards per node (power of two)
+#define TREE_STAT_ALPHA 0.2             // EMA smoothing factor per execution
+
+/* Hot-path counters; one cache line each so threads on different shards
+ * never write the same line */
+typedef struct {
+    uint64_t count;
+    uint64_t true_count;                // Condition true / action succeeded
+    uint64_t time_ns;                   // Only advanced with timing enabled
+    char padding[64 - 3 * sizeof(uint64_t)];
+} NodeStatShard;                        // Shard arrays are 64-byte aligned
 
 /* Tree node structure */
 struct TreeNode {
     NodeType type;
     char *id;           // Unique identifier
+    unsigned ref_count; // Trees and parents holding this node
     char *description;  // Human-readable description
     int line;           // Source line number
     int column;         // Source column number
     
-    // Execution statistics
+    // Execution statistics, as of the last fold
     unsigned execution_count;
     double true_probability;
     double false_probability;
     double avg_exec_time;
     
-    // Tree relationships
-    TreeNode *parent;
+    // Unfolded counters, allocated on first execution
+    NodeStatShard *stat_shards;
+    uint64_t folded_count;
+    uint64_t folded_true;
+    uint64_t folded_time_ns;
+    
+    // Tree relationships; parents are per tree (DecisionTree.node_parents),
+    // since a shared node has one in each version
     TreeNode *true_branch;
     TreeNode *false_branch;
     
@@ -64,8 +88,19 @@ struct DecisionTree {
     TreeNode *root;
     char *name;             // Tree name/identifier
     Vector *variables;       // Context variables
-    Vector *node_registry;   // All nodes for fast access
     bool is_optimized;      // Optimization status
+    TreeOptimizationReport optimization; // What the last tree_optimize did
+    bool timing_enabled;    // Clock reads per executed node
+    
+    // Node index, rebuilt on demand after the tree changes shape; nodes
+    // can be shared with other versions, so dense IDs live here
+    Vector *node_registry;   // All nodes in pre-order, indexed by dense ID
+    uint32_t *node_parents;  // Dense ID of each node's parent
+    size_t parents_capacity;
+    HashTable *node_ids;     // String ID -> dense ID
+    HashTable *node_numbers; // TreeNode* -> dense ID
+    bool index_valid;
+    bool repeated_nodes;     // Some node occurs at several positions (merged)
     
     // Statistics
     unsigned total_nodes;
@@ -73,10 +108,25 @@ struct DecisionTree {
     double avg_exec_time;
 };
 
+// Serializes folds; one lock covers nodes shared between versions
+static pthread_mutex_t stats_fold_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void node_fold_stats(TreeNode *node);
+
 /* ======== PRIVATE HELPER FUNCTIONS ======== */
 
-static void node_free(TreeNode *node) {
+static TreeNode* node_retain(TreeNode *node) {
+    if (node) __atomic_fetch_add(&node->ref_count, 1, __ATOMIC_RELAXED);
+    return node;
+}
+
+static bool node_is_shared(const TreeNode *node) {
+    return __atomic_load_n(&node->ref_count, __ATOMIC_ACQUIRE) > 1;
+}
+
+static void node_release(TreeNode *node) {
     if (!node) return;
+    if (__atomic_sub_fetch(&node->ref_count, 1, __ATOMIC_ACQ_REL) > 0) return;
     
     switch (node->type) {
         case NODE_CONDITION:
@@ -98,32 +148,54 @@ static void node_free(TreeNode *node) {
             break;
     }
     
+    node_release(node->true_branch);
+    node_release(node->false_branch);
+    free(node->stat_shards);
     if (node->id) mem_free(node->id);
     if (node->description) mem_free(node->description);
     mem_free(node);
 }
 
-static TreeNode* node_clone(const TreeNode *src) {
-    if (!src) return NULL;
-    
+// Private copy of one node for path copying; the children are shared
+static TreeNode* node_copy(const TreeNode *src) {
     TreeNode *node = mem_alloc(sizeof(TreeNode));
     if (!node) return NULL;
     
-    // Copy basic fields
-    *node = *src;
+    // Copy basic fields one by one: live readers of src may be bumping its
+    // reference count or installing its counter shards
+    memset(node, 0, sizeof(TreeNode));
+    node->type = src->type;
+    node->ref_count = 1;
+    node->line = src->line;
+    node->column = src->column;
+    node->true_branch = src->true_branch;
+    node->false_branch = src->false_branch;
+    
+    // The copy starts with src's whole history, so from here on each version
+    // counts its own executions of this node; src is folded first so no
+    // unfolded counts stay behind with it
+    pthread_mutex_lock(&stats_fold_lock);
+    node_fold_stats((TreeNode*)src);
+    node->execution_count = src->execution_count;
+    node->true_probability = src->true_probability;
+    node->false_probability = src->false_probability;
+    node->avg_exec_time = src->avg_exec_time;
+    pthread_mutex_unlock(&stats_fold_lock);
+    
     node->id = src->id ? string_duplicate(src->id) : NULL;
     node->description = src->description ? string_duplicate(src->description) : NULL;
-    node->parent = NULL;
-    node->true_branch = NULL;
-    node->false_branch = NULL;
+    node_retain(node->true_branch);
+    node_retain(node->false_branch);
 
     // Deep copy type-specific data
     switch (src->type) {
         case NODE_CONDITION:
             node->cond.condition = ast_clone(src->cond.condition);
+            node->cond.weight = src->cond.weight;
             break;
             
         case NODE_ACTION:
+            node->action.type = src->action.type;
             if (src->action.actions) {
                 node->action.actions = vector_create();
                 for (size_t i = 0; i < vector_size(src->action.actions); i++) {
@@ -140,85 +212,1072 @@ static TreeNode* node_clone(const TreeNode *src) {
             break;
     }
     
-    // Recursively clone branches
-    if (src->true_branch) {
-        node->true_branch = node_clone(src->true_branch);
-        node->true_branch->parent = node;
+    return node;
+}
+
+static void tree_build_registry(DecisionTree *tree, TreeNode *node, uint32_t parent) {
+    if (!node) return;
+    
+    uint32_t index = (uint32_t)vector_size(tree->node_registry);
+    if (index == tree->parents_capacity) {
+        size_t capacity = tree->parents_capacity ? tree->parents_capacity * 2 : 64;
+        uint32_t *parents = mem_realloc(tree->node_parents, capacity * sizeof(uint32_t));
+        if (!parents) {
+            LOG_ERROR("Failed to grow node index of tree '%s'", tree->name ? tree->name : "");
+            return;
+        }
+        tree->node_parents = parents;
+        tree->parents_capacity = capacity;
+    }
+    
+    tree->node_parents[index] = parent;
+    vector_append(tree->node_registry, node);
+    // A merged node occurs more than once; its first occurrence stands for it
+    if (!hashtable_get(tree->node_numbers, &node, sizeof(TreeNode*))) {
+        hashtable_set(tree->node_numbers, &node, sizeof(TreeNode*), &index, sizeof(uint32_t));
+    } else {
+        tree->repeated_nodes = true;
     }
     
-    if (src->false_branch) {
-        node->false_branch = node_clone(src->false_branch);
-        node->false_branch->parent = node;
+    // First node in pre-order wins, as with the old linear scan
+    if (node->id && !hashtable_get(tree->node_ids, node->id, strlen(node->id))) {
+        hashtable_set(tree->node_ids, node->id, strlen(node->id), &index, sizeof(uint32_t));
     }
     
+    if (node->type == NODE_CONDITION) {
+        tree_build_registry(tree, node->true_branch, index);
+        tree_build_registry(tree, node->false_branch, index);
+    }
+}
+
+// The index is a cache of the tree's shape; shape changes only mark it stale
+static void tree_ensure_index(DecisionTree *tree) {
+    if (tree->index_valid) return;
+    
+    vector_clear(tree->node_registry);
+    hashtable_clear(tree->node_ids);
+    hashtable_clear(tree->node_numbers);
+    tree->repeated_nodes = false;
+    tree_build_registry(tree, tree->root, TREE_NODE_NO_INDEX);
+    tree->total_nodes = vector_size(tree->node_registry);
+    tree->index_valid = true;
+}
+
+void tree_build_index(DecisionTree *tree) {
+    if (tree) tree_ensure_index(tree);
+}
+
+static uint32_t tree_lookup_index(DecisionTree *tree, const TreeNode *node) {
+    tree_ensure_index(tree);
+    uint32_t *index = hashtable_get(tree->node_numbers, &node, sizeof(TreeNode*));
+    return index ? *index : TREE_NODE_NO_INDEX;
+}
+
+// Dense IDs from the root down to index, from the parent index; the caller
+// frees the array
+static uint32_t* tree_path_indices(const DecisionTree *tree, uint32_t index, size_t *depth) {
+    *depth = 0;
+    for (uint32_t i = index; i != TREE_NODE_NO_INDEX; i = tree->node_parents[i]) (*depth)++;
+    
+    uint32_t *path = mem_alloc(*depth * sizeof(uint32_t));
+    if (!path) return NULL;
+    size_t k = *depth;
+    for (uint32_t i = index; i != TREE_NODE_NO_INDEX; i = tree->node_parents[i]) path[--k] = i;
+    return path;
+}
+
+// Gives the tree its own copy of every node from the root down to target
+// that is still shared with another version, and returns the tree's target.
+// The shape is unchanged, so the index is patched rather than rebuilt.
+static TreeNode* tree_edit_path(DecisionTree *tree, const TreeNode *target) {
+    uint32_t target_index = tree_lookup_index(tree, target);
+    if (target_index == TREE_NODE_NO_INDEX) return NULL;
+    
+    size_t depth = 0;
+    uint32_t *path = tree_path_indices(tree, target_index, &depth);
+    if (!path) return NULL;
+    
+    size_t k;
+    TreeNode **link = &tree->root;
+    TreeNode *node = NULL;
+    bool copied = false;
+    for (k = 0; k < depth; k++) {
+        node = *link;
+        if (node_is_shared(node)) {
+            TreeNode *copy = node_copy(node);
+            if (!copy) {
+                mem_free(path);
+                return NULL;
+            }
+            hashtable_remove(tree->node_numbers, &node, sizeof(TreeNode*));
+            hashtable_set(tree->node_numbers, &copy, sizeof(TreeNode*), &path[k], sizeof(uint32_t));
+            vector_set(tree->node_registry, path[k], copy);
+            
+            *link = copy;
+            node_release(node);
+            node = copy;
+            copied = true;
+        }
+        
+        if (k + 1 < depth) {
+            TreeNode *next = vector_at(tree->node_registry, path[k + 1]);
+            link = node->true_branch == next ? &node->true_branch : &node->false_branch;
+        }
+    }
+    
+    mem_free(path);
+    
+    // A node merged into several positions of this tree is still reached
+    // at the others, but its entry above now names the copy; rebuild
+    if (copied && tree->repeated_nodes) tree->index_valid = false;
     return node;
 }
 
-static void tree_build_registry(DecisionTree *tree, TreeNode *node) {
-    if (!node) return;
+static unsigned next_stat_shard = 0;
+static __thread unsigned thread_stat_shard = UINT32_MAX;
+
+static NodeStatShard* node_stat_shards(TreeNode *node) {
+    NodeStatShard *shards = __atomic_load_n(&node->stat_shards, __ATOMIC_ACQUIRE);
+    if (shards) return shards;
     
-    vector_append(tree->node_registry, node);
+    // The padding only keeps shards apart on cache-line boundaries, which
+    // mem_alloc does not give; the system allocator can
+    void *block = NULL;
+    if (posix_memalign(&block, sizeof(NodeStatShard), TREE_STAT_SHARDS * sizeof(NodeStatShard)) != 0) {
+        return NULL;
+    }
+    shards = block;
+    memset(shards, 0, TREE_STAT_SHARDS * sizeof(NodeStatShard));
     
-    if (node->type == NODE_CONDITION) {
-        tree_build_registry(tree, node->true_branch);
-        tree_build_registry(tree, node->false_branch);
+    // Another thread may have raced us to the first execution
+    NodeStatShard *expected = NULL;
+    if (!__atomic_compare_exchange_n(&node->stat_shards, &expected, shards, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(shards);
+        shards = expected;
     }
+    return shards;
 }
 
-static void node_update_stats(TreeNode *node, bool branch_taken, double exec_time) {
-    const double alpha = 0.2; // Smoothing factor
+// Hot path: a few relaxed adds on this thread's shard, no shared cache line
+// unless more threads than shards evaluate the same node
+static void node_record(TreeNode *node, bool branch_taken, uint64_t time_ns) {
+    if (thread_stat_shard == UINT32_MAX) {
+        thread_stat_shard = __atomic_fetch_add(&next_stat_shard, 1, __ATOMIC_RELAXED) &
+                            (TREE_STAT_SHARDS - 1);
+    }
+    
+    NodeStatShard *shards = node_stat_shards(node);
+    if (!shards) return;
+    
+    NodeStatShard *shard = &shards[thread_stat_shard];
+    __atomic_fetch_add(&shard->count, 1, __ATOMIC_RELAXED);
+    if (branch_taken) __atomic_fetch_add(&shard->true_count, 1, __ATOMIC_RELAXED);
+    if (time_ns) __atomic_fetch_add(&shard->time_ns, time_ns, __ATOMIC_RELAXED);
+}
+
+// Applies the executions since the last fold to the moving averages as one
+// batch: k executions decay the old value by (1 - alpha)^k
+static void node_fold_stats(TreeNode *node) {
+    NodeStatShard *shards = __atomic_load_n(&node->stat_shards, __ATOMIC_ACQUIRE);
+    if (!shards) return;
+    
+    uint64_t count = 0, true_count = 0, time_ns = 0;
+    for (int i = 0; i < TREE_STAT_SHARDS; i++) {
+        count += __atomic_load_n(&shards[i].count, __ATOMIC_RELAXED);
+        true_count += __atomic_load_n(&shards[i].true_count, __ATOMIC_RELAXED);
+        time_ns += __atomic_load_n(&shards[i].time_ns, __ATOMIC_RELAXED);
+    }
+    
+    uint64_t executions = count - node->folded_count;
+    if (executions == 0) return;
     
-    node->execution_count++;
-    node->avg_exec_time = (1 - alpha) * node->avg_exec_time + alpha * exec_time;
+    // Counters are read one by one, so clamp a true count that got ahead
+    uint64_t taken = true_count - node->folded_true;
+    if (taken > executions) taken = executions;
+    double decay = pow(1 - TREE_STAT_ALPHA, (double)executions);
+    
+    node->execution_count += (unsigned)executions;
+    if (time_ns > node->folded_time_ns) {
+        double mean = (double)(time_ns - node->folded_time_ns) / executions / 1e9;
+        node->avg_exec_time = decay * node->avg_exec_time + (1 - decay) * mean;
+    }
     
     if (node->type == NODE_CONDITION) {
-        if (branch_taken) {
-            node->true_probability = (1 - alpha) * node->true_probability + alpha;
-            node->false_probability *= (1 - alpha);
-        } else {
-            node->false_probability = (1 - alpha) * node->false_probability + alpha;
-            node->true_probability *= (1 - alpha);
+        double rate = (double)taken / executions;
+        node->true_probability = decay * node->true_probability + (1 - decay) * rate;
+        node->false_probability = decay * node->false_probability + (1 - decay) * (1 - rate);
+    }
+    
+    node->folded_count += executions;
+    node->folded_true += taken;
+    node->folded_time_ns = time_ns;
+}
+
+// Elapsed time since *last in nanoseconds, advancing *last: one clock read
+// per executed node, and none with timing off
+static uint64_t tree_elapsed_ns(const DecisionTree *tree, runtime_env_t *env, double *last) {
+    if (!tree->timing_enabled) return 0;
+    
+    double now = runtime_current_time(env);
+    double elapsed = now - *last;
+    *last = now;
+    return elapsed > 0 ? (uint64_t)(elapsed * 1e9) : 0;
+}
+
+// Known range of a numeric variable on the current path
+typedef struct {
+    const char *name;
+    double low, high;
+    bool low_open, high_open;
+} VariableRange;
+
+typedef enum {
+    CONDITION_UNKNOWN,
+    CONDITION_ALWAYS_TRUE,
+    CONDITION_ALWAYS_FALSE
+} ConditionOutcome;
+
+// State of one optimizer pass: ranges implied by the tests above the node
+// being visited (innermost last) and what the pass has done so far
+typedef struct {
+    VariableRange *ranges;
+    size_t range_count;
+    size_t range_capacity;
+    TreeOptimizationReport *report;
+} OptimizeContext;
+
+// Hash-consing table: one canonical node per structure
+typedef struct {
+    TreeNode **nodes;
+    uint64_t *hashes;
+    size_t capacity;
+    size_t count;
+    HashTable *visited;                 // TreeNode* -> canonical TreeNode*
+} DedupTable;
+
+static inline uint64_t hash_mix(uint64_t hash, uint64_t value) {
+    hash ^= value + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+static uint64_t hash_string(uint64_t hash, const char *str) {
+    if (!str) return hash_mix(hash, 0);
+    
+    uint64_t h = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char*)str; *p; p++) {
+        h = (h ^ *p) * 1099511628211ULL;
+    }
+    return hash_mix(hash, h);
+}
+
+static uint64_t hash_value(uint64_t hash, const reasons_value_t *value) {
+    hash = hash_mix(hash, value->type);
+    switch (value->type) {
+        case VALUE_BOOL:
+            return hash_mix(hash, value->data.bool_val);
+        case VALUE_NUMBER: {
+            double number = value->data.number_val == 0 ? 0 : value->data.number_val;
+            uint64_t bits;
+            memcpy(&bits, &number, sizeof(bits));
+            return hash_mix(hash, bits);
         }
+        case VALUE_STRING:
+            return hash_string(hash, value->data.string_val);
+        default:
+            return hash;                // Equality decides
     }
 }
 
-static bool optimize_condition(TreeNode *node) {
-    // Optimize constant conditions
-    if (node->cond.condition && node->cond.condition->type == AST_LITERAL) {
-        reasons_value_t val = node->cond.condition->data.literal.value;
-        
-        if (val.type == VALUE_BOOL) {
-            TreeNode *target = val.data.bool_val ? node->true_branch : node->false_branch;
-            
-            if (target) {
-                // Replace condition with target branch
-                node_free(val.data.bool_val ? node->false_branch : node->true_branch);
-                *node = *target;
-                mem_free(target);
-                return true;
+static uint64_t hash_ast(uint64_t hash, const AST_Node *ast) {
+    if (!ast) return hash_mix(hash, 0);
+    
+    hash = hash_mix(hash, (uint64_t)ast->type + 1);
+    switch (ast->type) {
+        case AST_COMPARISON:
+            hash = hash_mix(hash, ast->data.comparison.op);
+            hash = hash_ast(hash, ast->data.comparison.left);
+            return hash_ast(hash, ast->data.comparison.right);
+        case AST_LOGIC_OP:
+            hash = hash_mix(hash, ast->data.logic_op.op);
+            hash = hash_ast(hash, ast->data.logic_op.left);
+            return hash_ast(hash, ast->data.logic_op.right);
+        case AST_IDENTIFIER:
+        case AST_IMPORT:
+            return hash_string(hash, ast->data.identifier.name);
+        case AST_LITERAL:
+            return hash_value(hash, &ast->data.literal.value);
+        case AST_CONSEQUENCE:
+            return hash_string(hash, ast->data.consequence.action);
+        case AST_CHAIN:
+            hash = hash_ast(hash, ast->data.chain.first);
+            return hash_ast(hash, ast->data.chain.second);
+        default:
+            for (const AST_Node *child = ast->first_child; child; child = child->next_sibling) {
+                hash = hash_ast(hash, child);
             }
-        }
+            return hash;
     }
-    return false;
 }
 
-static void optimize_tree_recursive(TreeNode *node) {
-    if (!node) return;
+// Children are canonical by the time a node is hashed, so they hash and
+// compare by address
+static uint64_t node_hash(const TreeNode *node) {
+    uint64_t hash = hash_mix(0, (uint64_t)node->type + 1);
+    hash = hash_string(hash, node->id);
+    hash = hash_string(hash, node->description);
+    hash = hash_mix(hash, (uint64_t)(uintptr_t)node->true_branch);
+    hash = hash_mix(hash, (uint64_t)(uintptr_t)node->false_branch);
     
     switch (node->type) {
         case NODE_CONDITION:
-            optimize_condition(node);
-            optimize_tree_recursive(node->true_branch);
-            optimize_tree_recursive(node->false_branch);
-            break;
-            
+            return hash_ast(hash, node->cond.condition);
         case NODE_ACTION:
+            hash = hash_mix(hash, node->action.type);
+            for (size_t i = 0; i < vector_size(node->action.actions); i++) {
+                hash = hash_ast(hash, vector_at(node->action.actions, i));
+            }
+            return hash;
         case NODE_OUTCOME:
-            // Leaf nodes - nothing to optimize
+            return hash_value(hash, &node->outcome.value);
+    }
+    return hash;
+}
+
+static bool strings_equal(const char *a, const char *b) {
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+// Everything but the children
+static bool node_payload_equal(const TreeNode *a, const TreeNode *b) {
+    if (a->type != b->type ||
+        !strings_equal(a->id, b->id) || !strings_equal(a->description, b->description)) {
+        return false;
+    }
+    
+    switch (a->type) {
+        case NODE_CONDITION:
+            return a->cond.weight == b->cond.weight &&
+                   ast_equals(a->cond.condition, b->cond.condition);
+        case NODE_ACTION: {
+            size_t count = vector_size(a->action.actions);
+            if (a->action.type != b->action.type || count != vector_size(b->action.actions)) {
+                return false;
+            }
+            for (size_t i = 0; i < count; i++) {
+                if (!ast_equals(vector_at(a->action.actions, i), vector_at(b->action.actions, i))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case NODE_OUTCOME:
+            return reasons_value_equals(&a->outcome.value, &b->outcome.value);
+    }
+    return false;
+}
+
+static bool nodes_equal(const TreeNode *a, const TreeNode *b) {
+    return a->true_branch == b->true_branch && a->false_branch == b->false_branch &&
+           node_payload_equal(a, b);
+}
+
+static bool subtrees_equal(const TreeNode *a, const TreeNode *b) {
+    if (a == b) return true;
+    if (!a || !b || !node_payload_equal(a, b)) return false;
+    return subtrees_equal(a->true_branch, b->true_branch) &&
+           subtrees_equal(a->false_branch, b->false_branch);
+}
+
+// Takes over the references to node, true_branch and false_branch and
+// returns node with those children, copied first if other trees share it
+static TreeNode* node_relink(TreeNode *node, TreeNode *true_branch, TreeNode *false_branch) {
+    if (true_branch == node->true_branch && false_branch == node->false_branch) {
+        node_release(true_branch);
+        node_release(false_branch);
+        return node;
+    }
+    
+    TreeNode *result = node;
+    if (node_is_shared(node)) {
+        result = node_copy(node);
+        if (!result) {
+            node_release(true_branch);
+            node_release(false_branch);
+            return node;
+        }
+        node_release(node);
+    }
+    
+    node_release(result->true_branch);
+    node_release(result->false_branch);
+    result->true_branch = true_branch;
+    result->false_branch = false_branch;
+    return result;
+}
+
+/* Range analysis. A comparison that held proves its variable is a number
+ * (a type mismatch evaluates to false), so ranges start on true branches;
+ * a false branch narrows a range only once the variable is known numeric. */
+
+static const VariableRange* range_find(const OptimizeContext *ctx, const char *name) {
+    for (size_t i = ctx->range_count; i > 0; i--) {
+        if (strcmp(ctx->ranges[i - 1].name, name) == 0) return &ctx->ranges[i - 1];
+    }
+    return NULL;
+}
+
+// Splits `x op c` or `c op x` into variable, operator and constant
+static bool comparison_bound(const AST_Node *ast, const char **name, comparison_op_t *op,
+                             double *constant) {
+    if (!ast || ast->type != AST_COMPARISON) return false;
+    
+    const AST_Node *left = ast->data.comparison.left;
+    const AST_Node *right = ast->data.comparison.right;
+    if (!left || !right) return false;
+    
+    comparison_op_t cmp = ast->data.comparison.op;
+    if (left->type == AST_IDENTIFIER && right->type == AST_LITERAL &&
+        right->data.literal.value.type == VALUE_NUMBER) {
+        *name = left->data.identifier.name;
+        *constant = right->data.literal.value.data.number_val;
+    } else if (right->type == AST_IDENTIFIER && left->type == AST_LITERAL &&
+               left->data.literal.value.type == VALUE_NUMBER) {
+        *name = right->data.identifier.name;
+        *constant = left->data.literal.value.data.number_val;
+        switch (cmp) {
+            case CMP_LT: cmp = CMP_GT; break;
+            case CMP_LE: cmp = CMP_GE; break;
+            case CMP_GT: cmp = CMP_LT; break;
+            case CMP_GE: cmp = CMP_LE; break;
+            default: break;
+        }
+    } else {
+        return false;
+    }
+    
+    if (isnan(*constant)) return false;
+    *op = cmp;
+    return true;
+}
+
+static comparison_op_t comparison_negate(comparison_op_t op) {
+    switch (op) {
+        case CMP_EQ: return CMP_NE;
+        case CMP_NE: return CMP_EQ;
+        case CMP_LT: return CMP_GE;
+        case CMP_LE: return CMP_GT;
+        case CMP_GT: return CMP_LE;
+        case CMP_GE: return CMP_LT;
+        default: return op;
+    }
+}
+
+static bool range_below(const VariableRange *range, double c) {   // every x < c
+    return range->high < c || (range->high == c && range->high_open);
+}
+
+static bool range_above(const VariableRange *range, double c) {   // every x > c
+    return range->low > c || (range->low == c && range->low_open);
+}
+
+static ConditionOutcome range_decide(const VariableRange *range, comparison_op_t op, double c) {
+    bool always = false, never = false;
+    switch (op) {
+        case CMP_LT: always = range_below(range, c); never = range->low >= c; break;
+        case CMP_LE: always = range->high <= c; never = range_above(range, c); break;
+        case CMP_GT: always = range_above(range, c); never = range->high <= c; break;
+        case CMP_GE: always = range->low >= c; never = range_below(range, c); break;
+        case CMP_EQ:
+            always = range->low == c && range->high == c && !range->low_open && !range->high_open;
+            never = range_below(range, c) || range_above(range, c);
+            break;
+        case CMP_NE:
+            always = range_below(range, c) || range_above(range, c);
+            never = range->low == c && range->high == c && !range->low_open && !range->high_open;
+            break;
+        default: break;
+    }
+    return always ? CONDITION_ALWAYS_TRUE : never ? CONDITION_ALWAYS_FALSE : CONDITION_UNKNOWN;
+}
+
+// Variable reads, literals, comparisons and logic only: no calls, chains
+// or consequences that could observe or change evaluation order
+static bool condition_is_pure(const AST_Node *ast) {
+    if (!ast) return false;
+    
+    switch (ast->type) {
+        case AST_LITERAL:
+        case AST_IDENTIFIER:
+            return true;
+        case AST_COMPARISON:
+            return condition_is_pure(ast->data.comparison.left) &&
+                   condition_is_pure(ast->data.comparison.right);
+        case AST_LOGIC_OP:
+            return condition_is_pure(ast->data.logic_op.left) &&
+                   (ast->data.logic_op.op == LOGIC_NOT || condition_is_pure(ast->data.logic_op.right));
+        default:
+            return false;
+    }
+}
+
+static ConditionOutcome condition_decide(const OptimizeContext *ctx, const AST_Node *ast) {
+    if (!ast) return CONDITION_UNKNOWN;
+    
+    const char *name;
+    comparison_op_t op;
+    double constant;
+    if (comparison_bound(ast, &name, &op, &constant)) {
+        const VariableRange *range = range_find(ctx, name);
+        return range ? range_decide(range, op, constant) : CONDITION_UNKNOWN;
+    }
+    
+    if (ast->type != AST_LOGIC_OP) return CONDITION_UNKNOWN;
+    
+    ConditionOutcome left = condition_decide(ctx, ast->data.logic_op.left);
+    if (ast->data.logic_op.op == LOGIC_NOT) {
+        return left == CONDITION_ALWAYS_TRUE ? CONDITION_ALWAYS_FALSE :
+               left == CONDITION_ALWAYS_FALSE ? CONDITION_ALWAYS_TRUE : CONDITION_UNKNOWN;
+    }
+    
+    ConditionOutcome right = condition_decide(ctx, ast->data.logic_op.right);
+    ConditionOutcome absorbing = ast->data.logic_op.op == LOGIC_AND ? 
+        CONDITION_ALWAYS_FALSE : CONDITION_ALWAYS_TRUE;
+    if (left == absorbing || right == absorbing) return absorbing;
+    if (left != CONDITION_UNKNOWN && left == right) return left;
+    return CONDITION_UNKNOWN;
+}
+
+// Narrows range to the values where `x op c` holds; false when the
+// result is not a single range (x != c)
+static bool range_narrow(VariableRange *range, comparison_op_t op, double c) {
+    switch (op) {
+        case CMP_LT:
+        case CMP_LE:
+            if (c < range->high || (c == range->high && op == CMP_LT)) {
+                range->high = c;
+                range->high_open = op == CMP_LT;
+            }
+            return true;
+        case CMP_GT:
+        case CMP_GE:
+            if (c > range->low || (c == range->low && op == CMP_GT)) {
+                range->low = c;
+                range->low_open = op == CMP_GT;
+            }
+            return true;
+        case CMP_EQ:
+            range->low = range->high = c;
+            range->low_open = range->high_open = false;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void range_push(OptimizeContext *ctx, const char *name, comparison_op_t op, double c) {
+    const VariableRange *known = range_find(ctx, name);
+    VariableRange range = { name, -INFINITY, INFINITY, true, true };
+    if (known) {
+        range = *known;
+        range.name = name;
+    } else if (op == CMP_NE) {
+        return;                         // Proves nothing about the type
+    }
+    
+    if (!range_narrow(&range, op, c)) return;
+    
+    if (ctx->range_count == ctx->range_capacity) {
+        size_t capacity = ctx->range_capacity ? ctx->range_capacity * 2 : 16;
+        VariableRange *ranges = mem_realloc(ctx->ranges, capacity * sizeof(VariableRange));
+        if (!ranges) return;            // Less pruning, never a wrong one
+        ctx->ranges = ranges;
+        ctx->range_capacity = capacity;
+    }
+    ctx->ranges[ctx->range_count++] = range;
+}
+
+// Records what holds on the branch where ast evaluated to outcome
+static void range_assume(OptimizeContext *ctx, const AST_Node *ast, bool outcome) {
+    if (!ast) return;
+    
+    const char *name;
+    comparison_op_t op;
+    double constant;
+    if (comparison_bound(ast, &name, &op, &constant)) {
+        if (outcome) {
+            range_push(ctx, name, op, constant);
+        } else if (range_find(ctx, name)) {
+            range_push(ctx, name, comparison_negate(op), constant);
+        }
+        return;
+    }
+    
+    if (ast->type != AST_LOGIC_OP) return;
+    
+    switch (ast->data.logic_op.op) {
+        case LOGIC_NOT:
+            range_assume(ctx, ast->data.logic_op.left, !outcome);
+            break;
+        case LOGIC_AND:                 // Both held
+            if (outcome) {
+                range_assume(ctx, ast->data.logic_op.left, true);
+                range_assume(ctx, ast->data.logic_op.right, true);
+            }
+            break;
+        case LOGIC_OR:                  // Neither held
+            if (!outcome) {
+                range_assume(ctx, ast->data.logic_op.left, false);
+                range_assume(ctx, ast->data.logic_op.right, false);
+            }
+            break;
+        default:
             break;
     }
 }
 
+// Takes over the caller's reference to node and returns a reference to
+// the optimized subtree; shared nodes are copied only where something
+// below them changed
+static TreeNode* optimize_node(TreeNode *node, OptimizeContext *ctx) {
+    if (!node || node->type != NODE_CONDITION) return node;
+    
+    // Constant conditions, and conditions the tests above already decide,
+    // collapse into the branch they select
+    AST_Node *condition = node->cond.condition;
+    ConditionOutcome outcome = CONDITION_UNKNOWN;
+    bool constant = false;
+    if (condition && condition->type == AST_LITERAL) {
+        reasons_value_t val = condition->data.literal.value;
+        if (val.type == VALUE_BOOL) {
+            outcome = val.data.bool_val ? CONDITION_ALWAYS_TRUE : CONDITION_ALWAYS_FALSE;
+            constant = true;
+        }
+    } else if (condition_is_pure(condition)) {
+        // A test with a side effect has to run even when its result is known
+        outcome = condition_decide(ctx, condition);
+    }
+    
+    if (outcome != CONDITION_UNKNOWN) {
+        TreeNode *target = outcome == CONDITION_ALWAYS_TRUE ? node->true_branch : node->false_branch;
+        if (target) {
+            if (constant) ctx->report->conditions_folded++;
+            else ctx->report->branches_pruned++;
+            
+            node_retain(target);
+            node_release(node);
+            return optimize_node(target, ctx);
+        }
+    }
+    
+    size_t depth = ctx->range_count;
+    range_assume(ctx, condition, true);
+    TreeNode *true_branch = optimize_node(node_retain(node->true_branch), ctx);
+    ctx->range_count = depth;
+    
+    range_assume(ctx, condition, false);
+    TreeNode *false_branch = optimize_node(node_retain(node->false_branch), ctx);
+    ctx->range_count = depth;
+    
+    return node_relink(node, true_branch, false_branch);
+}
+
+static TreeNode* dedup_insert(DedupTable *table, TreeNode *node, uint64_t hash) {
+    if ((table->count + 1) * 10 > table->capacity * 7) {
+        size_t capacity = table->capacity ? table->capacity * 2 : 64;
+        TreeNode **nodes = mem_calloc(capacity, sizeof(TreeNode*));
+        uint64_t *hashes = mem_calloc(capacity, sizeof(uint64_t));
+        if (!nodes || !hashes) {
+            mem_free(nodes);
+            mem_free(hashes);
+            return node;                // Unmerged, still correct
+        }
+        
+        for (size_t i = 0; i < table->capacity; i++) {
+            if (!table->nodes[i]) continue;
+            size_t slot = table->hashes[i] & (capacity - 1);
+            while (nodes[slot]) slot = (slot + 1) & (capacity - 1);
+            nodes[slot] = table->nodes[i];
+            hashes[slot] = table->hashes[i];
+        }
+        mem_free(table->nodes);
+        mem_free(table->hashes);
+        table->nodes = nodes;
+        table->hashes = hashes;
+        table->capacity = capacity;
+    }
+    
+    size_t slot = hash & (table->capacity - 1);
+    while (table->nodes[slot]) {
+        if (table->hashes[slot] == hash && nodes_equal(table->nodes[slot], node)) {
+            return table->nodes[slot];
+        }
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+    
+    // The table holds its own reference, so canonical nodes outlive the pass
+    table->nodes[slot] = node_retain(node);
+    table->hashes[slot] = hash;
+    table->count++;
+    return node;
+}
+
+static void release_visited(const void *key, size_t key_size, void *value, void *user_data) {
+    (void)key_size;
+    (void)user_data;
+    node_release(*(TreeNode* const*)key);
+    node_release(*(TreeNode**)value);
+}
+
+// Same ownership as optimize_node; identical subtrees come back as one node
+static TreeNode* dedup_node(TreeNode *node, DedupTable *table, TreeOptimizationReport *report) {
+    if (!node) return NULL;
+    
+    // Only a node with other holders can be reached again: through another
+    // parent after a merge, or from another version. Those are pinned with
+    // their canonical form until the pass ends, so addresses stay unique.
+    TreeNode **seen = hashtable_get(table->visited, &node, sizeof(TreeNode*));
+    if (seen) {
+        TreeNode *canonical = node_retain(*seen);
+        node_release(node);
+        return canonical;
+    }
+    TreeNode *original = node_is_shared(node) ? node_retain(node) : NULL;
+    
+    TreeNode *true_branch = dedup_node(node_retain(node->true_branch), table, report);
+    TreeNode *false_branch = dedup_node(node_retain(node->false_branch), table, report);
+    node = node_relink(node, true_branch, false_branch);
+    
+    TreeNode *canonical = dedup_insert(table, node, node_hash(node));
+    if (canonical != node) {
+        node_retain(canonical);
+        node_release(node);
+        report->subtrees_merged++;
+    }
+    
+    if (original) {
+        TreeNode *pinned = node_retain(canonical);
+        hashtable_set(table->visited, &original, sizeof(TreeNode*), &pinned, sizeof(TreeNode*));
+    }
+    return canonical;
+}
+
+static void dedup_destroy(DedupTable *table) {
+    for (size_t i = 0; i < table->capacity; i++) {
+        node_release(table->nodes[i]);
+    }
+    mem_free(table->nodes);
+    mem_free(table->hashes);
+    hashtable_iterate(table->visited, release_visited, NULL);
+    hashtable_destroy(table->visited);
+}
+
+static void count_distinct(const TreeNode *node, HashTable *seen, unsigned *count) {
+    if (!node || hashtable_get(seen, &node, sizeof(TreeNode*))) return;
+    
+    bool present = true;
+    hashtable_set(seen, &node, sizeof(TreeNode*), &present, sizeof(bool));
+    (*count)++;
+    count_distinct(node->true_branch, seen, count);
+    count_distinct(node->false_branch, seen, count);
+}
+
+static unsigned tree_distinct_nodes(const TreeNode *root) {
+    unsigned count = 0;
+    HashTable *seen = hashtable_create(64, NULL);
+    if (!seen) return 0;
+    
+    count_distinct(root, seen, &count);
+    hashtable_destroy(seen);
+    return count;
+}
+
+/* Profile-guided reordering. A cascade is a run of condition nodes whose
+ * order does not matter to the result:
+ * - all-of: each test's false branch is the same exit (guards)
+ * - any-of: each test's true branch is the same exit
+ * - exclusive: an else-if chain whose tests can never hold together
+ * Only conditions without side effects qualify, so evaluating them in
+ * another order, or skipping some, cannot change what the others see. */
+
+typedef enum {
+    CASCADE_ALL,
+    CASCADE_ANY,
+    CASCADE_EXCLUSIVE
+} CascadeKind;
+
+typedef struct {
+    CascadeKind kind;
+    TreeNode **nodes;                   // Conditions, top to bottom
+    double *keys;                       // Sort keys, smallest first
+    size_t *order;
+    size_t count;
+    size_t capacity;
+} Cascade;
+
+static bool node_is_pure_condition(const TreeNode *node) {
+    return node && node->type == NODE_CONDITION && condition_is_pure(node->cond.condition);
+}
+
+// Whether a and b can never both hold
+static bool conditions_exclusive(const AST_Node *a, const AST_Node *b) {
+    const char *name_a, *name_b;
+    comparison_op_t op_a, op_b;
+    double c_a, c_b;
+    if (comparison_bound(a, &name_a, &op_a, &c_a) && comparison_bound(b, &name_b, &op_b, &c_b)) {
+        if (strcmp(name_a, name_b) != 0) return false;
+        
+        VariableRange range = { name_a, -INFINITY, INFINITY, true, true };
+        return range_narrow(&range, op_a, c_a) &&
+               range_decide(&range, op_b, c_b) == CONDITION_ALWAYS_FALSE;
+    }
+    
+    // x == "gold" and x == "silver"
+    if (a->type != AST_COMPARISON || b->type != AST_COMPARISON ||
+        a->data.comparison.op != CMP_EQ || b->data.comparison.op != CMP_EQ) {
+        return false;
+    }
+    const AST_Node *var_a = a->data.comparison.left, *lit_a = a->data.comparison.right;
+    const AST_Node *var_b = b->data.comparison.left, *lit_b = b->data.comparison.right;
+    if (!var_a || !lit_a || !var_b || !lit_b) return false;
+    if (var_a->type == AST_LITERAL) { const AST_Node *t = var_a; var_a = lit_a; lit_a = t; }
+    if (var_b->type == AST_LITERAL) { const AST_Node *t = var_b; var_b = lit_b; lit_b = t; }
+    
+    return var_a->type == AST_IDENTIFIER && var_b->type == AST_IDENTIFIER &&
+           lit_a->type == AST_LITERAL && lit_b->type == AST_LITERAL &&
+           strcmp(var_a->data.identifier.name, var_b->data.identifier.name) == 0 &&
+           lit_a->data.literal.value.type == lit_b->data.literal.value.type &&
+           !reasons_value_equals(&lit_a->data.literal.value, &lit_b->data.literal.value);
+}
+
+static bool cascade_append(Cascade *cascade, TreeNode *node) {
+    if (cascade->count == cascade->capacity) {
+        size_t capacity = cascade->capacity ? cascade->capacity * 2 : 8;
+        TreeNode **nodes = mem_realloc(cascade->nodes, capacity * sizeof(TreeNode*));
+        if (!nodes) return false;
+        cascade->nodes = nodes;
+        double *keys = mem_realloc(cascade->keys, capacity * sizeof(double));
+        if (!keys) return false;
+        cascade->keys = keys;
+        size_t *order = mem_realloc(cascade->order, capacity * sizeof(size_t));
+        if (!order) return false;
+        cascade->order = order;
+        cascade->capacity = capacity;
+    }
+    cascade->nodes[cascade->count++] = node;
+    return true;
+}
+
+static TreeNode* cascade_next(CascadeKind kind, const TreeNode *node) {
+    return kind == CASCADE_ALL ? node->true_branch : node->false_branch;
+}
+
+static TreeNode* cascade_other(CascadeKind kind, const TreeNode *node) {
+    return kind == CASCADE_ALL ? node->false_branch : node->true_branch;
+}
+
+// Longest cascade of the given kind starting at node
+static size_t cascade_collect(Cascade *cascade, CascadeKind kind, TreeNode *node) {
+    cascade->kind = kind;
+    cascade->count = 0;
+    if (!node_is_pure_condition(node) || !cascade_append(cascade, node)) return 0;
+    
+    for (TreeNode *next = cascade_next(kind, node); node_is_pure_condition(next);
+         next = cascade_next(kind, next)) {
+        bool fits = true;
+        if (kind == CASCADE_EXCLUSIVE) {
+            for (size_t i = 0; i < cascade->count && fits; i++) {
+                fits = conditions_exclusive(cascade->nodes[i]->cond.condition, next->cond.condition);
+            }
+        } else {
+            fits = subtrees_equal(cascade_other(kind, next), cascade_other(kind, node));
+        }
+        if (!fits || !cascade_append(cascade, next)) break;
+    }
+    return cascade->count;
+}
+
+// Smith's rule: order by cost per unit of the chance that a test ends the
+// cascade. Rates are as recorded at each test's current position, which
+// for independent tests is the rate anywhere; untested nodes keep their
+// relative order at the end.
+static bool cascade_sort(Cascade *cascade) {
+    bool timed = true;
+    for (size_t i = 0; i < cascade->count; i++) {
+        if (cascade->nodes[i]->avg_exec_time <= 0) timed = false;
+    }
+    
+    for (size_t i = 0; i < cascade->count; i++) {
+        const TreeNode *node = cascade->nodes[i];
+        double cost = timed ? node->avg_exec_time : 1.0;
+        double p = node->true_probability;
+        double ends;
+        switch (cascade->kind) {
+            case CASCADE_ALL: ends = 1.0 - p; break;
+            case CASCADE_ANY: ends = p; break;
+            default: ends = node->execution_count * p; break;   // Arm frequency
+        }
+        cascade->keys[i] = node->execution_count > 0 && ends > 0 ? cost / ends : INFINITY;
+        cascade->order[i] = i;
+    }
+    
+    bool moved = false;
+    for (size_t i = 1; i < cascade->count; i++) {
+        size_t current = cascade->order[i];
+        size_t j = i;
+        while (j > 0 && cascade->keys[cascade->order[j - 1]] > cascade->keys[current]) {
+            cascade->order[j] = cascade->order[j - 1];
+            j--;
+            moved = true;
+        }
+        cascade->order[j] = current;
+    }
+    return moved;
+}
+
+static TreeNode* reorder_node(TreeNode *node, Cascade *scratch, TreeReorderReport *report);
+
+// Takes over the reference to the cascade's head and rebuilds the cascade
+// in sorted order
+static TreeNode* cascade_rebuild(TreeNode *head, Cascade *cascade, TreeReorderReport *report) {
+    CascadeKind kind = cascade->kind;
+    size_t count = cascade->count;
+    TreeNode **tests = mem_alloc(count * sizeof(TreeNode*));
+    TreeNode **others = mem_alloc(count * sizeof(TreeNode*));
+    size_t *order = mem_alloc(count * sizeof(size_t));
+    if (!tests || !others || !order) {
+        mem_free(tests);
+        mem_free(others);
+        mem_free(order);
+        return head;
+    }
+    memcpy(order, cascade->order, count * sizeof(size_t));
+    
+    // Unlink the tests top-down, holding one reference to each part, so a
+    // test nothing else shares is relinked in place rather than copied
+    TreeNode *current = head;
+    for (size_t i = 0; i < count; i++) {
+        TreeNode *next = node_retain(cascade_next(kind, current));
+        others[i] = node_retain(cascade_other(kind, current));
+        tests[i] = node_relink(current, NULL, NULL);
+        current = next;
+    }
+    TreeNode *rest = reorder_node(current, cascade, report);
+    
+    // Shared exits are equal, so one optimized copy serves every test
+    if (kind != CASCADE_EXCLUSIVE) {
+        others[0] = reorder_node(others[0], cascade, report);
+        for (size_t i = 1; i < count; i++) {
+            node_release(others[i]);
+            others[i] = node_retain(others[0]);
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            others[i] = reorder_node(others[i], cascade, report);
+        }
+    }
+    
+    // Re-base the folded statistics on the new positions, so the expected
+    // depth and later reorderings see each test where it now is. Every
+    // test is this tree's own after unlinking.
+    double reach = tests[0]->execution_count;
+    for (size_t i = 0; i < count; i++) {
+        TreeNode *test = tests[order[i]];
+        if (test->execution_count == 0) continue;
+        
+        double p = test->true_probability;
+        double arm = test->execution_count * p;
+        test->execution_count = (unsigned)(reach + 0.5);
+        switch (kind) {
+            case CASCADE_ALL: reach *= p; break;
+            case CASCADE_ANY: reach *= 1.0 - p; break;
+            case CASCADE_EXCLUSIVE:
+                test->true_probability = reach > 0 ? fmin(arm / reach, 1.0) : 0.0;
+                test->false_probability = 1.0 - test->true_probability;
+                reach = fmax(reach - arm, 0.0);
+                break;
+        }
+    }
+    
+    for (size_t i = count; i > 0; i--) {
+        size_t k = order[i - 1];
+        if (k != i - 1) report->conditions_moved++;
+        rest = kind == CASCADE_ALL ? node_relink(tests[k], rest, others[k]) :
+                                     node_relink(tests[k], others[k], rest);
+    }
+    report->cascades_reordered++;
+    
+    mem_free(tests);
+    mem_free(others);
+    mem_free(order);
+    return rest;
+}
+
+// Same ownership as optimize_node
+static TreeNode* reorder_node(TreeNode *node, Cascade *scratch, TreeReorderReport *report) {
+    if (!node || node->type != NODE_CONDITION) return node;
+    
+    static const CascadeKind kinds[] = { CASCADE_ALL, CASCADE_ANY, CASCADE_EXCLUSIVE };
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        if (cascade_collect(scratch, kinds[i], node) >= 2 && cascade_sort(scratch)) {
+            return cascade_rebuild(node, scratch, report);
+        }
+    }
+    
+    TreeNode *true_branch = reorder_node(node_retain(node->true_branch), scratch, report);
+    TreeNode *false_branch = reorder_node(node_retain(node->false_branch), scratch, report);
+    return node_relink(node, true_branch, false_branch);
+}
+
+// Condition tests per evaluation under the recorded branch probabilities
+static double expected_tests(const TreeNode *node) {
+    if (!node || node->type != NODE_CONDITION) return 0.0;
+    
+    double p = node->execution_count > 0 ? node->true_probability : 0.5;
+    return 1.0 + p * expected_tests(node->true_branch) + (1.0 - p) * expected_tests(node->false_branch);
+}
+
+static unsigned condition_depth(const TreeNode *node) {
+    if (!node || node->type != NODE_CONDITION) return 0;
+    
+    unsigned t = condition_depth(node->true_branch);
+    unsigned f = condition_depth(node->false_branch);
+    return 1 + (t > f ? t : f);
+}
+
+static void sum_condition_counts(const TreeNode *node, HashTable *seen, uint64_t *sum) {
+    if (!node || node->type != NODE_CONDITION || hashtable_get(seen, &node, sizeof(TreeNode*))) return;
+    
+    bool present = true;
+    hashtable_set(seen, &node, sizeof(TreeNode*), &present, sizeof(bool));
+    *sum += node->execution_count;
+    sum_condition_counts(node->true_branch, seen, sum);
+    sum_condition_counts(node->false_branch, seen, sum);
+}
+
+// Most tests on a path through conditions that ran
+static unsigned observed_depth(const TreeNode *node) {
+    if (!node || node->type != NODE_CONDITION || node->execution_count == 0) return 0;
+    
+    unsigned t = observed_depth(node->true_branch);
+    unsigned f = observed_depth(node->false_branch);
+    return 1 + (t > f ? t : f);
+}
+
+// Condition tests per evaluation as counted; a merged node's counts cover
+// all its occurrences, so each node is counted once
+static double observed_tests(const TreeNode *root) {
+    if (!root || root->type != NODE_CONDITION || root->execution_count == 0) return 0.0;
+    
+    uint64_t sum = 0;
+    HashTable *seen = hashtable_create(64, NULL);
+    if (!seen) return 0.0;
+    
+    sum_condition_counts(root, seen, &sum);
+    hashtable_destroy(seen);
+    return (double)sum / root->execution_count;
+}
+
 /* ======== PUBLIC API IMPLEMENTATION ======== */
 
 /* Tree creation/destruction */
@@ -228,8 +1287,16 @@ DecisionTree* tree_create(const char *name) {
         tree->root = NULL;
         tree->name = name ? string_duplicate(name) : NULL;
         tree->variables = vector_create();
-        tree->node_registry = vector_create();
         tree->is_optimized = false;
+        memset(&tree->optimization, 0, sizeof(TreeOptimizationReport));
+        tree->timing_enabled = false;
+        tree->node_registry = vector_create();
+        tree->node_parents = NULL;
+        tree->parents_capacity = 0;
+        tree->node_ids = hashtable_create(64, NULL);
+        tree->node_numbers = hashtable_create(64, NULL);
+        tree->index_valid = true;
+        tree->repeated_nodes = false;
         tree->total_nodes = 0;
         tree->max_depth = 0;
         tree->avg_exec_time = 0.0;
@@ -240,7 +1307,7 @@ DecisionTree* tree_create(const char *name) {
 void tree_destroy(DecisionTree *tree) {
     if (!tree) return;
     
-    node_free(tree->root);
+    node_release(tree->root);
     if (tree->name) mem_free(tree->name);
     
     // Free variables
@@ -253,6 +1320,9 @@ void tree_destroy(DecisionTree *tree) {
     vector_free(tree->variables);
     
     vector_free(tree->node_registry);
+    mem_free(tree->node_parents);
+    hashtable_destroy(tree->node_ids);
+    hashtable_destroy(tree->node_numbers);
     mem_free(tree);
 }
 
@@ -266,6 +1336,7 @@ TreeNode* tree_create_condition_node(AST_Node *condition, double weight) {
         node->type = NODE_CONDITION;
         node->cond.condition = condition;
         node->cond.weight = weight;
+        node->ref_count = 1;
     }
     return node;
 }
@@ -279,6 +1350,7 @@ TreeNode* tree_create_action_node(Vector *actions, consequence_type_t type) {
         node->type = NODE_ACTION;
         node->action.actions = actions;
         node->action.type = type;
+        node->ref_count = 1;
     }
     return node;
 }
@@ -289,22 +1361,30 @@ TreeNode* tree_create_outcome_node(const reasons_value_t *value) {
         memset(node, 0, sizeof(TreeNode));
         node->type = NODE_OUTCOME;
         node->outcome.value = reasons_value_clone(value);
+        node->ref_count = 1;
     }
     return node;
 }
 
+// Builder for nodes not yet in a tree
+bool tree_node_set_branches(TreeNode *node, TreeNode *true_branch, TreeNode *false_branch) {
+    if (!node || node->type != NODE_CONDITION || node_is_shared(node)) return false;
+    
+    node_release(node->true_branch);
+    node_release(node->false_branch);
+    node->true_branch = true_branch;
+    node->false_branch = false_branch;
+    return true;
+}
+
 /* Tree manipulation */
 void tree_set_root(DecisionTree *tree, TreeNode *root) {
     if (!tree) return;
     
-    if (tree->root) node_free(tree->root);
+    node_release(tree->root);
     tree->root = root;
     tree->is_optimized = false;
-    
-    // Rebuild registry
-    vector_clear(tree->node_registry);
-    tree_build_registry(tree, root);
-    tree->total_nodes = vector_size(tree->node_registry);
+    tree->index_valid = false;
 }
 
 void tree_add_variable(DecisionTree *tree, const char *name, reasons_value_t value) {
@@ -330,15 +1410,135 @@ void tree_add_variable(DecisionTree *tree, const char *name, reasons_value_t val
 }
 
 TreeNode* tree_find_node(DecisionTree *tree, const char *id) {
-    if (!tree || !id) return NULL;
+    if (!tree || !id || !*id) return NULL;
     
-    for (size_t i = 0; i < vector_size(tree->node_registry); i++) {
-        TreeNode *node = vector_at(tree->node_registry, i);
-        if (node->id && strcmp(node->id, id) == 0) {
-            return node;
-        }
+    tree_ensure_index(tree);
+    uint32_t *index = hashtable_get(tree->node_ids, id, strlen(id));
+    return index ? vector_at(tree->node_registry, *index) : NULL;
+}
+
+TreeNode* tree_node_at(DecisionTree *tree, uint32_t index) {
+    if (!tree) return NULL;
+    
+    tree_ensure_index(tree);
+    return index < vector_size(tree->node_registry) ? vector_at(tree->node_registry, index) : NULL;
+}
+
+uint32_t tree_node_index(DecisionTree *tree, const TreeNode *node) {
+    if (!tree || !node) return TREE_NODE_NO_INDEX;
+    return tree_lookup_index(tree, node);
+}
+
+size_t tree_node_count(DecisionTree *tree) {
+    if (!tree) return 0;
+    
+    tree_ensure_index(tree);
+    return vector_size(tree->node_registry);
+}
+
+/* Versioned edits */
+bool tree_replace_subtree(DecisionTree *tree, const TreeNode *target, TreeNode *replacement) {
+    if (!tree || !target) return false;
+    
+    uint32_t index = tree_lookup_index(tree, target);
+    if (index == TREE_NODE_NO_INDEX) return false;
+    
+    if (index == 0) {
+        tree_set_root(tree, replacement);
+        return true;
     }
-    return NULL;
+    
+    const TreeNode *old_parent = vector_at(tree->node_registry, tree->node_parents[index]);
+    TreeNode *parent = tree_edit_path(tree, old_parent);
+    if (!parent) return false;
+    
+    TreeNode **link = parent->true_branch == target ? &parent->true_branch : &parent->false_branch;
+    node_release(*link);
+    *link = replacement;
+    
+    tree->is_optimized = false;
+    tree->index_valid = false;
+    return true;
+}
+
+bool tree_set_condition(DecisionTree *tree, const TreeNode *target, AST_Node *condition, double weight) {
+    if (!tree || !target || !condition || target->type != NODE_CONDITION) return false;
+    
+    TreeNode *node = tree_edit_path(tree, target);
+    if (!node) return false;
+    
+    if (node->cond.condition) ast_destroy(node->cond.condition);
+    node->cond.condition = condition;
+    node->cond.weight = weight;
+    tree->is_optimized = false;
+    return true;
+}
+
+bool tree_set_node_id(DecisionTree *tree, const TreeNode *target, const char *id) {
+    if (!tree || !target) return false;
+    
+    char *copy = NULL;
+    if (id) {
+        copy = string_duplicate(id);
+        if (!copy) return false;
+    }
+    
+    TreeNode *node = tree_edit_path(tree, target);
+    if (!node) {
+        if (copy) mem_free(copy);
+        return false;
+    }
+    
+    if (node->id) mem_free(node->id);
+    node->id = copy;
+    
+    // Renaming can uncover a shadowed duplicate, so re-index rather than patch
+    tree->index_valid = false;
+    return true;
+}
+
+/* Node access */
+TreeNode* tree_root(const DecisionTree *tree) {
+    return tree ? tree->root : NULL;
+}
+
+NodeType tree_node_type(const TreeNode *node) {
+    return node->type;
+}
+
+const char* tree_node_id(const TreeNode *node) {
+    return node ? node->id : NULL;
+}
+
+const char* tree_node_description(const TreeNode *node) {
+    return node ? node->description : NULL;
+}
+
+void tree_node_location(const TreeNode *node, int *line, int *column) {
+    if (line) *line = node ? node->line : 0;
+    if (column) *column = node ? node->column : 0;
+}
+
+TreeNode* tree_node_branch(const TreeNode *node, bool branch) {
+    if (!node || node->type != NODE_CONDITION) return NULL;
+    return branch ? node->true_branch : node->false_branch;
+}
+
+const AST_Node* tree_node_condition(const TreeNode *node, double *weight) {
+    if (!node || node->type != NODE_CONDITION) return NULL;
+    if (weight) *weight = node->cond.weight;
+    return node->cond.condition;
+}
+
+Vector* tree_node_actions(const TreeNode *node, consequence_type_t *type) {
+    if (!node || node->type != NODE_ACTION) return NULL;
+    if (type) *type = node->action.type;
+    return node->action.actions;
+}
+
+const reasons_value_t* tree_node_outcome(const TreeNode *node) {
+    if (!node || node->type != NODE_OUTCOME) return NULL;
+    return &node->outcome.value;
 }
 
 /* Tree traversal */
@@ -354,20 +1554,20 @@ void tree_traverse(TreeNode *root, TreeVisitor visit, void *context) {
     }
 }
 
-void tree_traverse_path(TreeNode *node, PathVisitor visit, void *context) {
-    if (!node || !visit) return;
+void tree_traverse_path(DecisionTree *tree, const TreeNode *node, PathVisitor visit, void *context) {
+    if (!tree || !node || !visit) return;
     
-    Vector *path = vector_create();
-    while (node) {
-        vector_insert(path, 0, node);
-        node = node->parent;
-    }
+    uint32_t index = tree_lookup_index(tree, node);
+    if (index == TREE_NODE_NO_INDEX) return;
     
-    for (size_t i = 0; i < vector_size(path); i++) {
-        visit(vector_at(path, i), i, context);
-    }
+    size_t depth = 0;
+    uint32_t *path = tree_path_indices(tree, index, &depth);
+    if (!path) return;
     
-    vector_free(path);
+    for (size_t i = 0; i < depth; i++) {
+        visit(vector_at(tree->node_registry, path[i]), i, context);
+    }
+    mem_free(path);
 }
 
 /* Tree evaluation */
@@ -376,11 +1576,9 @@ reasons_value_t tree_evaluate(DecisionTree *tree, runtime_env_t *env,
     reasons_value_t result = {VALUE_NULL};
     if (!tree || !tree->root) return result;
     
+    double last_time = tree->timing_enabled ? runtime_current_time(env) : 0.0;
     TreeNode *current = tree->root;
     while (current) {
-        // Update execution statistics
-        double start_time = runtime_current_time(env);
-        
         switch (current->type) {
             case NODE_CONDITION: {
                 // Evaluate condition
@@ -389,8 +1587,7 @@ reasons_value_t tree_evaluate(DecisionTree *tree, runtime_env_t *env,
                 bool cond_result = is_truthy(&cond_val);
                 
                 // Update statistics
-                double exec_time = runtime_current_time(env) - start_time;
-                node_update_stats(current, cond_result, exec_time);
+                node_record(current, cond_result, tree_elapsed_ns(tree, env, &last_time));
                 
                 // Trace and explain
                 if (trace) trace_condition(trace, current, cond_result);
@@ -419,8 +1616,7 @@ reasons_value_t tree_evaluate(DecisionTree *tree, runtime_env_t *env,
                     }
                     
                     // Update statistics
-                    double exec_time = runtime_current_time(env) - start_time;
-                    node_update_stats(current, cr.success, exec_time);
+                    node_record(current, cr.success, tree_elapsed_ns(tree, env, &last_time));
                     
                     // Trace and explain
                     if (trace) trace_consequence(trace, current, cr.success);
@@ -439,8 +1635,7 @@ reasons_value_t tree_evaluate(DecisionTree *tree, runtime_env_t *env,
                 }
                 
                 // Update statistics
-                double exec_time = runtime_current_time(env) - start_time;
-                node_update_stats(current, true, exec_time);
+                node_record(current, true, tree_elapsed_ns(tree, env, &last_time));
                 
                 // Trace
                 if (trace) trace_outcome(trace, current);
@@ -460,17 +1655,18 @@ DecisionTree* tree_clone(const DecisionTree *src) {
     
     DecisionTree *tree = tree_create(src->name);
     if (tree) {
-        tree->root = node_clone(src->root);
+        // Versions share every node until one of them edits it
+        tree->root = node_retain(src->root);
         tree->is_optimized = src->is_optimized;
+        tree->optimization = src->optimization;
+        tree->timing_enabled = src->timing_enabled;
+        tree->index_valid = false;
         
         // Clone variables
         for (size_t i = 0; i < vector_size(src->variables); i++) {
             Variable *var_src = vector_at(src->variables, i);
             tree_add_variable(tree, var_src->name, var_src->value);
         }
-        
-        // Rebuild registry
-        tree_build_registry(tree, tree->root);
     }
     return tree;
 }
@@ -479,13 +1675,104 @@ DecisionTree* tree_clone(const DecisionTree *src) {
 void tree_optimize(DecisionTree *tree) {
     if (!tree || tree->is_optimized) return;
     
-    optimize_tree_recursive(tree->root);
+    TreeOptimizationReport report = {0};
+    report.nodes_before = tree_distinct_nodes(tree->root);
+    
+    OptimizeContext ctx = { NULL, 0, 0, &report };
+    tree->root = optimize_node(tree->root, &ctx);
+    mem_free(ctx.ranges);
+    
+    DedupTable table = { NULL, NULL, 0, 0, hashtable_create(64, NULL) };
+    if (table.visited) {
+        tree->root = dedup_node(tree->root, &table, &report);
+        dedup_destroy(&table);
+    }
+    
+    report.nodes_after = tree_distinct_nodes(tree->root);
+    tree->optimization = report;
     tree->is_optimized = true;
+    tree->index_valid = false;
     
-    // Rebuild registry after optimization
-    vector_clear(tree->node_registry);
-    tree_build_registry(tree, tree->root);
-    tree->total_nodes = vector_size(tree->node_registry);
+    LOG_INFO("Optimized tree '%s': %u -> %u nodes (%u folded, %u pruned, %u merged)",
+             tree->name ? tree->name : "", report.nodes_before, report.nodes_after,
+             report.conditions_folded, report.branches_pruned, report.subtrees_merged);
+}
+
+TreeOptimizationReport tree_get_optimization_report(const DecisionTree *tree) {
+    TreeOptimizationReport report = {0};
+    return tree ? tree->optimization : report;
+}
+
+bool tree_reorder(DecisionTree *tree, TreeReorderReport *report) {
+    TreeReorderReport local = {0};
+    if (!report) report = &local;
+    memset(report, 0, sizeof(TreeReorderReport));
+    if (!tree || !tree->root) return false;
+    
+    tree_fold_statistics(tree);
+    report->expected_tests_before = expected_tests(tree->root);
+    report->observed_tests_before = observed_tests(tree->root);
+    report->max_depth_before = condition_depth(tree->root);
+    report->observed_depth_before = observed_depth(tree->root);
+    
+    Cascade scratch = {0};
+    tree->root = reorder_node(tree->root, &scratch, report);
+    mem_free(scratch.nodes);
+    mem_free(scratch.keys);
+    mem_free(scratch.order);
+    
+    report->expected_tests_after = expected_tests(tree->root);
+    report->max_depth_after = condition_depth(tree->root);
+    if (report->cascades_reordered > 0) tree->index_valid = false;
+    
+    LOG_INFO("Reordered tree '%s': %u cascades, expected tests %.3f -> %.3f (observed %.3f)",
+             tree->name ? tree->name : "", report->cascades_reordered,
+             report->expected_tests_before, report->expected_tests_after,
+             report->observed_tests_before);
+    return report->cascades_reordered > 0;
+}
+
+void tree_reorder_observe(DecisionTree *tree, TreeReorderReport *report) {
+    if (!tree || !report) return;
+    
+    tree_fold_statistics(tree);
+    report->observed_tests_after = observed_tests(tree->root);
+    report->observed_depth_after = observed_depth(tree->root);
+    
+    LOG_INFO("Reordered tree '%s': observed tests %.3f -> %.3f, depth %u -> %u",
+             tree->name ? tree->name : "", report->observed_tests_before,
+             report->observed_tests_after, report->observed_depth_before,
+             report->observed_depth_after);
+}
+
+/* Execution statistics */
+void tree_set_timing(DecisionTree *tree, bool enabled) {
+    if (tree) tree->timing_enabled = enabled;
+}
+
+void tree_fold_statistics(DecisionTree *tree) {
+    if (!tree) return;
+    
+    // Folds are rare; one lock covers nodes shared between versions
+    pthread_mutex_lock(&stats_fold_lock);
+    tree_ensure_index(tree);
+    for (size_t i = 0; i < vector_size(tree->node_registry); i++) {
+        node_fold_stats(vector_at(tree->node_registry, i));
+    }
+    pthread_mutex_unlock(&stats_fold_lock);
+}
+
+void tree_reset_counts(DecisionTree *tree) {
+    if (!tree) return;
+    
+    pthread_mutex_lock(&stats_fold_lock);
+    tree_ensure_index(tree);
+    for (size_t i = 0; i < vector_size(tree->node_registry); i++) {
+        TreeNode *node = vector_at(tree->node_registry, i);
+        node_fold_stats(node);
+        node->execution_count = 0;
+    }
+    pthread_mutex_unlock(&stats_fold_lock);
 }
 
 /* Tree statistics */
@@ -493,6 +1780,9 @@ TreeStatistics tree_get_statistics(const DecisionTree *tree) {
     TreeStatistics stats = {0};
     if (!tree) return stats;
     
+    // The index is a cache; building it does not change the tree
+    tree_ensure_index((DecisionTree*)tree);
+    
     stats.total_nodes = tree->total_nodes;
     stats.condition_nodes = 0;
     stats.action_nodes = 0;
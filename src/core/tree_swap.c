@@ -0,0 +1,382 @@
+/*
+ * tree_swap.c - Hot-Swappable Trees for Reasons DSL
+ *
+ * Features:
+ * - Atomic publication of new tree versions under live evaluators
+ * - Epoch-based reclamation: readers announce the epoch they entered in,
+ *   retired versions are freed once no reader from an older epoch remains
+ * - One padded record per reading thread; enter and exit are a store each
+ * - Records of exited threads are handed to the next new reader
+ * - Each version's node index is built before it is published, so readers
+ *   never rebuild it concurrently
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "reasons/tree_swap.h"
+#include "reasons/tree.h"
+#include "utils/error.h"
+#include "utils/memory.h"
+#include "utils/logger.h"
+
+#define TREE_SLOT_CACHE_LINE 64
+
+/* Reader record; only its owner writes depth, only its owner stores epoch */
+typedef struct tree_slot_reader {
+    uint64_t epoch;                   /* Epoch entered in, 0 when outside */
+    uint64_t owner;                   /* Atomic; token of the owning thread, 0 when free */
+    unsigned depth;                   /* Nesting of enter/exit pairs */
+    struct tree_slot_reader *next;
+    char padding[TREE_SLOT_CACHE_LINE - 2 * sizeof(uint64_t) - sizeof(unsigned)
+                 - sizeof(void *)];
+} tree_slot_reader_t;
+
+/* Version waiting for the readers that may still hold it */
+typedef struct tree_slot_retired {
+    DecisionTree *tree;
+    uint64_t epoch;                   /* Slot epoch when it was replaced */
+    struct tree_slot_retired *next;
+} tree_slot_retired_t;
+
+struct tree_slot {
+    DecisionTree *current;            /* Atomic */
+    struct tree_slot *next;           /* In g_slots */
+    uint64_t epoch;                   /* Atomic, advanced by each publication */
+    tree_slot_reader_t *readers;      /* Atomic, push-only */
+    uint64_t serial;                  /* Distinguishes slots at reused addresses */
+
+    pthread_mutex_t writer_lock;      /* Publication and reclamation */
+    tree_slot_retired_t *retired;
+    size_t retired_count;
+    size_t reclaimed;
+};
+
+static uint64_t g_next_serial = 1;
+static uint64_t g_next_token = 1;
+
+/* Live slots, so an exiting thread can free its records in each */
+static pthread_mutex_t g_slots_lock = PTHREAD_MUTEX_INITIALIZER;
+static tree_slot_t *g_slots;
+static pthread_once_t g_exit_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_exit_key;
+
+/* Last slot this thread read, so repeated reads skip the record lookup */
+static __thread uint64_t t_token;
+static __thread uint64_t t_cached_serial;
+static __thread tree_slot_reader_t *t_cached_reader;
+
+/* Forward declarations */
+static tree_slot_reader_t *tree_slot_reader(tree_slot_t *slot);
+static tree_slot_reader_t *tree_slot_claim_reader(tree_slot_t *slot);
+static size_t tree_slot_reclaim_locked(tree_slot_t *slot);
+static void tree_slot_create_exit_key(void);
+static void tree_slot_thread_exit(void *token);
+
+/* Slots */
+
+tree_slot_t *tree_slot_create(DecisionTree *tree)
+{
+    tree_slot_t *slot = memory_allocate(sizeof(tree_slot_t));
+    if (!slot) {
+        error_set(ERROR_MEMORY, "Failed to allocate tree slot");
+        return NULL;
+    }
+
+    memset(slot, 0, sizeof(tree_slot_t));
+    slot->current = tree;
+    slot->epoch = 1;
+    slot->serial = __atomic_fetch_add(&g_next_serial, 1, __ATOMIC_RELAXED);
+    pthread_mutex_init(&slot->writer_lock, NULL);
+    if (tree) {
+        tree_build_index(tree);
+    }
+
+    pthread_mutex_lock(&g_slots_lock);
+    slot->next = g_slots;
+    g_slots = slot;
+    pthread_mutex_unlock(&g_slots_lock);
+    return slot;
+}
+
+void tree_slot_destroy(tree_slot_t *slot)
+{
+    if (!slot) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_slots_lock);
+    tree_slot_t **link = &g_slots;
+    while (*link && *link != slot) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = slot->next;
+    }
+    pthread_mutex_unlock(&g_slots_lock);
+
+    tree_slot_retired_t *retired = slot->retired;
+    while (retired) {
+        tree_slot_retired_t *next = retired->next;
+        tree_destroy(retired->tree);
+        memory_free(retired);
+        retired = next;
+    }
+
+    tree_slot_reader_t *reader = slot->readers;
+    while (reader) {
+        tree_slot_reader_t *next = reader->next;
+        memory_free(reader);
+        reader = next;
+    }
+
+    tree_destroy(slot->current);
+    pthread_mutex_destroy(&slot->writer_lock);
+    memory_free(slot);
+}
+
+/* Readers */
+
+DecisionTree *tree_slot_enter(tree_slot_t *slot)
+{
+    if (!slot) {
+        return NULL;
+    }
+
+    tree_slot_reader_t *reader = tree_slot_reader(slot);
+    if (!reader) {
+        return NULL;
+    }
+
+    if (reader->depth++ == 0) {
+        /* The announcement must be visible before the root is read: a
+         * writer that misses it has already swapped the root, so this
+         * reader cannot see the version that writer retires */
+        uint64_t epoch = __atomic_load_n(&slot->epoch, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&reader->epoch, epoch, __ATOMIC_SEQ_CST);
+    }
+    return __atomic_load_n(&slot->current, __ATOMIC_SEQ_CST);
+}
+
+void tree_slot_exit(tree_slot_t *slot)
+{
+    if (!slot) {
+        return;
+    }
+
+    tree_slot_reader_t *reader = tree_slot_reader(slot);
+    if (!reader || reader->depth == 0) {
+        LOG_WARN("tree_slot_exit without a matching tree_slot_enter");
+        return;
+    }
+
+    if (--reader->depth == 0) {
+        __atomic_store_n(&reader->epoch, 0, __ATOMIC_RELEASE);
+    }
+}
+
+/* Writers */
+
+bool tree_slot_publish(tree_slot_t *slot, DecisionTree *tree)
+{
+    if (!slot || !tree) {
+        error_set(ERROR_INVALID_ARGUMENT, "Cannot publish a NULL tree");
+        return false;
+    }
+
+    tree_slot_retired_t *retired = memory_allocate(sizeof(tree_slot_retired_t));
+    if (!retired) {
+        error_set(ERROR_MEMORY, "Failed to allocate retired tree record");
+        return false;
+    }
+
+    /* Readers only look the index up; it must not be built under them */
+    tree_build_index(tree);
+
+    pthread_mutex_lock(&slot->writer_lock);
+
+    /* Readers entering after the epoch advances see the new root; those
+     * announced at the old epoch or earlier may hold the old one */
+    retired->tree = __atomic_exchange_n(&slot->current, tree, __ATOMIC_SEQ_CST);
+    retired->epoch = __atomic_fetch_add(&slot->epoch, 1, __ATOMIC_SEQ_CST);
+    retired->next = slot->retired;
+    slot->retired = retired;
+    slot->retired_count++;
+
+    tree_slot_reclaim_locked(slot);
+
+    pthread_mutex_unlock(&slot->writer_lock);
+    return true;
+}
+
+size_t tree_slot_reclaim(tree_slot_t *slot)
+{
+    if (!slot) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&slot->writer_lock);
+    size_t freed = tree_slot_reclaim_locked(slot);
+    pthread_mutex_unlock(&slot->writer_lock);
+    return freed;
+}
+
+void tree_slot_synchronize(tree_slot_t *slot)
+{
+    if (!slot) {
+        return;
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&slot->writer_lock);
+        tree_slot_reclaim_locked(slot);
+        bool done = slot->retired == NULL;
+        pthread_mutex_unlock(&slot->writer_lock);
+
+        if (done) {
+            return;
+        }
+        sched_yield();
+    }
+}
+
+void tree_slot_get_statistics(tree_slot_t *slot, tree_slot_statistics_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(tree_slot_statistics_t));
+    if (!slot) {
+        return;
+    }
+
+    pthread_mutex_lock(&slot->writer_lock);
+    stats->version = __atomic_load_n(&slot->epoch, __ATOMIC_RELAXED);
+    stats->retired = slot->retired_count;
+    stats->reclaimed = slot->reclaimed;
+    for (tree_slot_reader_t *reader = __atomic_load_n(&slot->readers, __ATOMIC_ACQUIRE);
+         reader; reader = reader->next) {
+        stats->readers++;
+    }
+    pthread_mutex_unlock(&slot->writer_lock);
+}
+
+/* Private helpers */
+
+static tree_slot_reader_t *tree_slot_reader(tree_slot_t *slot)
+{
+    if (t_cached_serial == slot->serial) {
+        return t_cached_reader;
+    }
+
+    if (t_token == 0) {
+        t_token = __atomic_fetch_add(&g_next_token, 1, __ATOMIC_RELAXED);
+        pthread_once(&g_exit_once, tree_slot_create_exit_key);
+        pthread_setspecific(g_exit_key, (void *)(uintptr_t)t_token);
+    }
+
+    tree_slot_reader_t *reader = __atomic_load_n(&slot->readers, __ATOMIC_ACQUIRE);
+    while (reader && __atomic_load_n(&reader->owner, __ATOMIC_RELAXED) != t_token) {
+        reader = reader->next;
+    }
+
+    if (!reader) {
+        reader = tree_slot_claim_reader(slot);
+    }
+    if (!reader) {
+        reader = memory_allocate(sizeof(tree_slot_reader_t));
+        if (!reader) {
+            error_set(ERROR_MEMORY, "Failed to allocate tree slot reader");
+            return NULL;
+        }
+
+        memset(reader, 0, sizeof(tree_slot_reader_t));
+        reader->owner = t_token;
+        reader->next = __atomic_load_n(&slot->readers, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&slot->readers, &reader->next, reader, true,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+
+    t_cached_serial = slot->serial;
+    t_cached_reader = reader;
+    return reader;
+}
+
+/* A record freed by an exiting thread, taken over by this one */
+static tree_slot_reader_t *tree_slot_claim_reader(tree_slot_t *slot)
+{
+    for (tree_slot_reader_t *reader = __atomic_load_n(&slot->readers, __ATOMIC_ACQUIRE);
+         reader; reader = reader->next) {
+        uint64_t free_owner = 0;
+        if (__atomic_load_n(&reader->owner, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(&reader->owner, &free_owner, t_token, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return reader;
+        }
+    }
+    return NULL;
+}
+
+static void tree_slot_create_exit_key(void)
+{
+    pthread_key_create(&g_exit_key, tree_slot_thread_exit);
+}
+
+/* Runs as a reading thread exits: its idle records in every live slot
+ * become free for the next new reader */
+static void tree_slot_thread_exit(void *token)
+{
+    uint64_t owner = (uint64_t)(uintptr_t)token;
+
+    pthread_mutex_lock(&g_slots_lock);
+    for (tree_slot_t *slot = g_slots; slot; slot = slot->next) {
+        for (tree_slot_reader_t *reader = __atomic_load_n(&slot->readers, __ATOMIC_ACQUIRE);
+             reader; reader = reader->next) {
+            /* One left inside an enter is still pinning; keep it owned */
+            if (__atomic_load_n(&reader->owner, __ATOMIC_RELAXED) == owner &&
+                reader->depth == 0) {
+                __atomic_store_n(&reader->owner, 0, __ATOMIC_RELEASE);
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_slots_lock);
+}
+
+static size_t tree_slot_reclaim_locked(tree_slot_t *slot)
+{
+    /* Oldest epoch any reader is still inside */
+    uint64_t oldest = UINT64_MAX;
+    for (tree_slot_reader_t *reader = __atomic_load_n(&slot->readers, __ATOMIC_ACQUIRE);
+         reader; reader = reader->next) {
+        uint64_t epoch = __atomic_load_n(&reader->epoch, __ATOMIC_SEQ_CST);
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+
+    size_t freed = 0;
+    tree_slot_retired_t **link = &slot->retired;
+    while (*link) {
+        tree_slot_retired_t *retired = *link;
+        if (retired->epoch < oldest) {
+            *link = retired->next;
+            tree_destroy(retired->tree);
+            memory_free(retired);
+            freed++;
+        } else {
+            link = &retired->next;
+        }
+    }
+
+    slot->retired_count -= freed;
+    slot->reclaimed += freed;
+    if (freed > 0) {
+        LOG_DEBUG("Reclaimed %zu tree versions, %zu still pinned", freed, slot->retired_count);
+    }
+    return freed;
+}
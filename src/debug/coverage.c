@@ -51,7 +51,7 @@ struct CoverageData {
 /* ======== PRIVATE HELPER FUNCTIONS ======== */
 
 static NodeCoverage* create_node_coverage(const char *node_id) {
-    NodeCoverage *nc = mem_alloc(sizeof(NodeCoverage));
+    NodeCoverage *nc = mem_alloc_tagged(sizeof(NodeCoverage), MEM_TAG_COVERAGE);
     if (nc) {
         nc->node_id = string_duplicate(node_id);
         nc->visit_count = 0;
@@ -69,7 +69,7 @@ static void destroy_node_coverage(void *data) {
 }
 
 static BranchCoverage* create_branch_coverage(const char *from_node, const char *to_node) {
-    BranchCoverage *bc = mem_alloc(sizeof(BranchCoverage));
+    BranchCoverage *bc = mem_alloc_tagged(sizeof(BranchCoverage), MEM_TAG_COVERAGE);
     if (bc) {
         bc->from_node = string_duplicate(from_node);
         bc->to_node = string_duplicate(to_node);
@@ -242,7 +242,9 @@ void coverage_record_branch(CoverageData *cov, TreeNode *from_node, TreeNode *to
         }
     }
     
-    // If we get here, the branch wasn't pre-registered - create new entry
+    // If we get here, the branch wasn't pre-registered - create new entry,
+    // unless the coverage budget is spent (existing entries keep counting)
+    if (!memory_budget_check(MEM_TAG_COVERAGE, sizeof(BranchCoverage))) return;
     BranchCoverage *bc = create_branch_coverage(from_node->id, to_node->id);
     if (bc) {
         bc->covered = true;
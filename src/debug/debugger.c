@@ -10,6 +10,8 @@
  * - Decision history tracking
  * - Branch coverage analysis
  * - Integration with explanation engine
+ * - Tree optimization with a report of what it saved
+ * - Profile-guided test reordering, measured before and after
  */
 
 #include "reasons/debugger.h"
@@ -46,6 +48,8 @@ struct DebuggerState {
     unsigned current_node;          // Current node in trace
     
     coverage_data_t coverage;       // Branch coverage data
+    TreeReorderReport reorder;      // Last reorder, observed by 'reorder observe'
+    bool reordered;
 };
 
 /* Breakpoint structure */
@@ -87,6 +91,8 @@ static void cmd_backtrace(DebuggerState *dbg, const char *args);
 static void cmd_coverage(DebuggerState *dbg, const char *args);
 static void cmd_explain(DebuggerState *dbg, const char *args);
 static void cmd_history(DebuggerState *dbg, const char *args);
+static void cmd_optimize(DebuggerState *dbg, const char *args);
+static void cmd_reorder(DebuggerState *dbg, const char *args);
 static void cmd_quit(DebuggerState *dbg, const char *args);
 
 /* Command table */
@@ -103,6 +109,8 @@ static const DebuggerCommand commands[] = {
     {"coverage", cmd_coverage, "Show coverage info", "coverage"},
     {"explain", cmd_explain, "Explain current decision", "explain"},
     {"history", cmd_history, "Show decision history", "history"},
+    {"optimize", cmd_optimize, "Optimize the tree and report savings", "optimize"},
+    {"reorder", cmd_reorder, "Reorder tests by the runs so far", "reorder [observe]"},
     {"quit", cmd_quit, "Exit debugger", "quit"},
     {NULL, NULL, NULL, NULL} // Sentinel
 };
@@ -523,6 +531,57 @@ static void cmd_history(DebuggerState *dbg, const char *args) {
     debugger_print_history(dbg, max_entries);
 }
 
+static void cmd_optimize(DebuggerState *dbg, const char *args) {
+    tree_optimize(dbg->tree);
+    TreeOptimizationReport report = tree_get_optimization_report(dbg->tree);
+    
+    unsigned saved = report.nodes_before > report.nodes_after ?
+        report.nodes_before - report.nodes_after : 0;
+    printf("Optimization Report:\n");
+    printf("  Nodes:              %u -> %u (%u saved, %.2f%%)\n",
+           report.nodes_before, report.nodes_after, saved,
+           report.nodes_before > 0 ? (double)saved / report.nodes_before * 100.0 : 0.0);
+    printf("  Conditions folded:  %u\n", report.conditions_folded);
+    printf("  Branches pruned:    %u\n", report.branches_pruned);
+    printf("  Subtrees merged:    %u\n", report.subtrees_merged);
+}
+
+// 'reorder' moves the tests and starts the counts over; after more runs,
+// 'reorder observe' shows what the new order actually tested
+static void cmd_reorder(DebuggerState *dbg, const char *args) {
+    TreeReorderReport *report = &dbg->reorder;
+    if (args && strcmp(args, "observe") == 0) {
+        if (!dbg->reordered) {
+            printf("Tree not reordered. Use 'reorder' first.\n");
+            return;
+        }
+        tree_reorder_observe(dbg->tree, report);
+        printf("Observed Tests:\n");
+        printf("  Per evaluation: %.3f -> %.3f\n",
+               report->observed_tests_before, report->observed_tests_after);
+        printf("  Deepest path:   %u -> %u\n",
+               report->observed_depth_before, report->observed_depth_after);
+        return;
+    }
+    
+    dbg->reordered = tree_reorder(dbg->tree, report);
+    if (!dbg->reordered) {
+        printf("No tests moved\n");
+        return;
+    }
+    tree_reset_counts(dbg->tree);
+    
+    printf("Reorder Report:\n");
+    printf("  Cascades reordered: %u (%u tests moved)\n",
+           report->cascades_reordered, report->conditions_moved);
+    printf("  Expected tests:     %.3f -> %.3f\n",
+           report->expected_tests_before, report->expected_tests_after);
+    printf("  Deepest path:       %u -> %u\n",
+           report->max_depth_before, report->max_depth_after);
+    printf("  Observed tests:     %.3f (run again, then 'reorder observe')\n",
+           report->observed_tests_before);
+}
+
 static void cmd_quit(DebuggerState *dbg, const char *args) {
     dbg->is_running = false;
     printf("Exiting debugger\n");
@@ -7,10 +7,12 @@
  * - Supports history filtering and querying
  * - Provides detailed history inspection
  * - Implements history export functionality
+ * - Rolls over oldest records when the history memory budget is reached
  * - Integrates with debugger and runtime
  */
 
 #include "reasons/debugger.h"
+#include "reasons/history.h"
 #include "reasons/tree.h"
 #include "reasons/runtime.h"
 #include "utils/logger.h"
@@ -24,7 +26,7 @@
 
 /* ======== STRUCTURE DEFINITIONS ======== */
 
-typedef struct DecisionRecord {
+struct DecisionRecord {
     char *node_id;              // Node identifier
     char *node_description;     // Human-readable description
     reasons_value_t decision;    // Value at decision point
@@ -34,29 +36,49 @@ typedef struct DecisionRecord {
     bool is_condition;          // Is this a condition node?
     unsigned depth;             // Depth in decision tree
     unsigned sequence;          // Execution sequence number
-} DecisionRecord;
+};
 
 struct DecisionHistory {
     vector_t *records;          // Vector of DecisionRecord pointers
     unsigned sequence_counter;  // Global execution sequence
     bool enabled;               // Tracking enabled state
     bool detailed;              // Record detailed information
+    size_t rolled_over;         // Records dropped to stay within budget
 };
 
+// Fraction of records discarded on each budget rollover
+#define HISTORY_ROLLOVER_DIVISOR 4
+
 /* ======== PRIVATE HELPER FUNCTIONS ======== */
 
-static DecisionRecord* create_record(TreeNode *node, reasons_value_t decision) {
+static char* history_strdup(const char *str) {
+    if (!str) return NULL;
+    
+    size_t len = strlen(str);
+    char *copy = mem_alloc_tagged(len + 1, MEM_TAG_HISTORY);
+    if (copy) memcpy(copy, str, len + 1);
+    return copy;
+}
+
+static size_t record_footprint(TreeNode *node, bool detailed) {
+    size_t size = sizeof(DecisionRecord);
+    if (node->id) size += strlen(node->id) + 1;
+    if (detailed && node->description) size += strlen(node->description) + 1;
+    return size;
+}
+
+static DecisionRecord* create_record(TreeNode *node, reasons_value_t decision, bool detailed) {
     if (!node) return NULL;
     
-    DecisionRecord *record = mem_alloc(sizeof(DecisionRecord));
+    DecisionRecord *record = mem_alloc_tagged(sizeof(DecisionRecord), MEM_TAG_HISTORY);
     if (!record) {
         LOG_ERROR("Failed to allocate memory for decision record");
         return NULL;
     }
     
     // Initialize basic information
-    record->node_id = node->id ? string_duplicate(node->id) : NULL;
-    record->node_description = node->description ? string_duplicate(node->description) : NULL;
+    record->node_id = history_strdup(node->id);
+    record->node_description = detailed ? history_strdup(node->description) : NULL;
     record->decision = reasons_value_clone(&decision);
     record->timestamp = time(NULL);
     record->execution_time = 0.0;
@@ -95,6 +117,30 @@ static void update_depth_info(DecisionHistory *history, TreeNode *node) {
     }
 }
 
+static void rollover_records(DecisionHistory *history) {
+    size_t count = vector_size(history->records);
+    size_t drop = count / HISTORY_ROLLOVER_DIVISOR;
+    if (drop == 0) drop = count;
+    
+    // Rebuild rather than shift one by one so a rollover stays O(n)
+    vector_t *kept = vector_create(count - drop + 32);
+    if (!kept) return;
+    
+    for (size_t i = 0; i < count; i++) {
+        DecisionRecord *record = vector_at(history->records, i);
+        if (i < drop) {
+            destroy_record(record);
+        } else {
+            vector_append(kept, record);
+        }
+    }
+    vector_destroy(history->records);
+    history->records = kept;
+    history->rolled_over += drop;
+    
+    LOG_DEBUG("History budget reached, rolled over %zu oldest records", drop);
+}
+
 /* ======== PUBLIC API IMPLEMENTATION ======== */
 
 DecisionHistory* history_create() {
@@ -104,6 +150,7 @@ DecisionHistory* history_create() {
         history->sequence_counter = 0;
         history->enabled = true;
         history->detailed = true;
+        history->rolled_over = 0;
     }
     return history;
 }
@@ -124,7 +171,14 @@ void history_record_decision(DecisionHistory *history, TreeNode *node,
                             reasons_value_t decision, double exec_time) {
     if (!history || !history->enabled || !node) return;
     
-    DecisionRecord *record = create_record(node, decision);
+    // Keep within the history budget by discarding the oldest records
+    size_t footprint = record_footprint(node, history->detailed);
+    while (!memory_budget_check(MEM_TAG_HISTORY, footprint) &&
+           vector_size(history->records) > 0) {
+        rollover_records(history);
+    }
+    
+    DecisionRecord *record = create_record(node, decision, history->detailed);
     if (!record) return;
     
     record->execution_time = exec_time;
@@ -154,6 +208,10 @@ size_t history_count(DecisionHistory *history) {
     return history ? vector_size(history->records) : 0;
 }
 
+size_t history_rolled_over(DecisionHistory *history) {
+    return history ? history->rolled_over : 0;
+}
+
 void history_set_enabled(DecisionHistory *history, bool enabled) {
     if (history) history->enabled = enabled;
 }
@@ -19,6 +19,7 @@
 #include "utils/logger.h"
 #include "utils/collections.h"
 #include "utils/memory.h"
+#include "utils/small_vector.h"
 #include "utils/string_utils.h"
 #include "stdlib/stats.h"
 #include <stdio.h>
@@ -41,7 +42,13 @@ typedef enum {
     PROFILE_BLOCK
 } ProfileEntryType;
 
-typedef struct ProfileEntry {
+typedef struct ProfileEntry ProfileEntry;
+
+// Most entries have a handful of children; the call stack tracks nesting depth
+SMALL_VECTOR_DEFINE(ProfileChildren, profile_children, ProfileEntry*, 4)
+SMALL_VECTOR_DEFINE(ProfileStack, profile_stack, ProfileEntry*, 32)
+
+struct ProfileEntry {
     const char *id;             // Node ID or function name
     ProfileEntryType type;      // Entry type
     unsigned call_count;        // Number of calls
@@ -52,12 +59,12 @@ typedef struct ProfileEntry {
     unsigned depth;             // Call depth
     bool is_active;             // Is currently being profiled?
     struct ProfileEntry *parent;// Parent in call tree
-    vector_t *children;         // Child entries
-} ProfileEntry;
+    ProfileChildren children;   // Child entries
+};
 
 struct Profiler {
     hash_table_t *entries;      // Profile entries (key: id)
-    vector_t *call_stack;       // Current call stack
+    ProfileStack call_stack;    // Current call stack
     vector_t *entry_list;       // All entries in order of first appearance
     ProfileEntry *current;      // Current active entry
     unsigned depth;             // Current call depth
@@ -88,7 +95,7 @@ static double get_current_time() {
 }
 
 static ProfileEntry* create_profile_entry(const char *id, ProfileEntryType type) {
-    ProfileEntry *entry = mem_alloc(sizeof(ProfileEntry));
+    ProfileEntry *entry = mem_alloc_tagged(sizeof(ProfileEntry), MEM_TAG_PROFILER);
     if (entry) {
         entry->id = string_duplicate(id);
         entry->type = type;
@@ -100,7 +107,7 @@ static ProfileEntry* create_profile_entry(const char *id, ProfileEntryType type)
         entry->depth = 0;
         entry->is_active = false;
         entry->parent = NULL;
-        entry->children = vector_create(4);
+        profile_children_init(&entry->children);
     }
     return entry;
 }
@@ -109,7 +116,7 @@ static void destroy_profile_entry(void *data) {
     ProfileEntry *entry = (ProfileEntry*)data;
     if (entry) {
         if (entry->id) mem_free((void*)entry->id);
-        if (entry->children) vector_destroy(entry->children);
+        profile_children_destroy(&entry->children);
         mem_free(entry);
     }
 }
@@ -121,7 +128,8 @@ static ProfileEntry* get_or_create_entry(Profiler *prof, const char *id, Profile
     ProfileEntry *entry = hash_get(prof->entries, id);
     if (entry) return entry;
     
-    // Create new entry
+    // Create new entry; over budget, new ids simply go unprofiled
+    if (!memory_budget_check(MEM_TAG_PROFILER, sizeof(ProfileEntry))) return NULL;
     entry = create_profile_entry(id, type);
     if (entry) {
         hash_set(prof->entries, entry->id, entry);
@@ -140,15 +148,15 @@ static void update_call_hierarchy(Profiler *prof, ProfileEntry *entry) {
         
         // Add to parent's children if not already present
         bool found = false;
-        for (size_t i = 0; i < vector_size(prof->current->children); i++) {
-            if (vector_at(prof->current->children, i) == entry) {
+        for (size_t i = 0; i < prof->current->children.size; i++) {
+            if (prof->current->children.data[i] == entry) {
                 found = true;
                 break;
             }
         }
         
         if (!found) {
-            vector_append(prof->current->children, entry);
+            profile_children_push(&prof->current->children, entry);
         }
     }
 }
@@ -168,7 +176,7 @@ Profiler* profiler_create(bool enable_memory_tracking) {
     Profiler *prof = mem_alloc(sizeof(Profiler));
     if (prof) {
         prof->entries = hash_create(128, destroy_profile_entry);
-        prof->call_stack = vector_create(32);
+        profile_stack_init(&prof->call_stack);
         prof->entry_list = vector_create(64);
         prof->current = NULL;
         prof->depth = 0;
@@ -189,7 +197,7 @@ void profiler_destroy(Profiler *prof) {
     if (!prof) return;
     
     hash_destroy(prof->entries);
-    vector_destroy(prof->call_stack);
+    profile_stack_destroy(&prof->call_stack);
     vector_destroy(prof->entry_list);
     mem_free(prof);
 }
@@ -217,7 +225,7 @@ void profiler_reset(Profiler *prof) {
     
     // Clear all entries
     hash_clear(prof->entries);
-    vector_clear(prof->call_stack);
+    profile_stack_clear(&prof->call_stack);
     vector_clear(prof->entry_list);
     
     // Reset state
@@ -237,7 +245,7 @@ void profiler_begin_node(Profiler *prof, const char *node_id) {
     if (!entry) return;
     
     // Update call stack
-    vector_append(prof->call_stack, prof->current);
+    profile_stack_push(&prof->call_stack, prof->current);
     prof->current = entry;
     prof->depth++;
     
@@ -271,9 +279,8 @@ void profiler_end_node(Profiler *prof, const char *node_id) {
     entry->is_active = false;
     
     // Restore call stack
-    if (vector_size(prof->call_stack)) {
-        prof->current = vector_back(prof->call_stack);
-        vector_pop(prof->call_stack);
+    if (prof->call_stack.size) {
+        prof->current = profile_stack_pop(&prof->call_stack);
     } else {
         prof->current = NULL;
     }
@@ -290,7 +297,7 @@ void profiler_begin_function(Profiler *prof, const char *func_name) {
     if (!entry) return;
     
     // Update call stack
-    vector_append(prof->call_stack, prof->current);
+    profile_stack_push(&prof->call_stack, prof->current);
     prof->current = entry;
     prof->depth++;
     
@@ -431,12 +438,12 @@ void profiler_export_json(Profiler *prof, FILE *output) {
         fprintf(output, "        \"percentage\": %.1f", percent);
         
         // Children hierarchy
-        if (vector_size(entry->children)) {
+        if (entry->children.size) {
             fprintf(output, ",\n        \"children\": [");
-            for (size_t j = 0; j < vector_size(entry->children); j++) {
-                ProfileEntry *child = vector_at(entry->children, j);
+            for (size_t j = 0; j < entry->children.size; j++) {
+                ProfileEntry *child = entry->children.data[j];
                 fprintf(output, "\"%s\"%s", child->id, 
-                        j < vector_size(entry->children)-1 ? ", " : "");
+                        j < entry->children.size-1 ? ", " : "");
             }
             fprintf(output, "]");
         }
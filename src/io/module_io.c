@@ -0,0 +1,368 @@
+/*
+ * module_io.c - Precompiled Module (.rsc) Files for Reasons DSL
+ *
+ * Features:
+ * - Versioned, position-independent binary format for compiled programs
+ * - Compact AST node array, interned strings and literals as sections
+ * - CRC32 per section and over the header
+ * - Memory-mapped loading without lexing or parsing
+ * - Encoding to and opening from memory, for modules embedded in other files
+ * - Range checks on every link, so a damaged module cannot be walked
+ *   out of bounds
+ */
+
+#include "reasons/io.h"
+#include "reasons/module.h"
+#include "reasons/ast_compact.h"
+#include "utils/error.h"
+#include "utils/logger.h"
+#include "utils/memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+/* ======== CONSTANTS ======== */
+
+#define MODULE_MAGIC "RSC"
+#define MODULE_BYTE_ORDER 0x01020304u
+#define MODULE_ALIGNMENT 8
+
+typedef enum {
+    MODULE_SECTION_NODES,
+    MODULE_SECTION_STRINGS,
+    MODULE_SECTION_LITERALS,
+    MODULE_SECTION_COUNT
+} ModuleSectionKind;
+
+/* ======== STRUCTURE DEFINITIONS ======== */
+
+typedef struct {
+    uint32_t kind;              // ModuleSectionKind
+    uint32_t crc;               // CRC32 of the section bytes
+    uint64_t offset;            // From the start of the file, aligned
+    uint64_t size;              // In bytes
+} ModuleSection;
+
+typedef struct {
+    char magic[4];              // "RSC\0"
+    uint16_t version;           // MODULE_FORMAT_VERSION
+    uint16_t header_size;       // sizeof(ModuleHeader)
+    uint32_t byte_order;        // MODULE_BYTE_ORDER as stored by the writer
+    uint32_t node_size;         // sizeof(ast_compact_node_t) of the writer
+    uint32_t section_count;
+    uint32_t header_crc;        // CRC32 of the header with this field zero
+    ModuleSection sections[MODULE_SECTION_COUNT];
+} ModuleHeader;
+
+// Literal table entry; string literals take their text from the node
+typedef struct {
+    uint32_t type;              // ValueType
+    uint32_t boolean;
+    double number;
+} ModuleLiteral;
+
+struct CompiledModule {
+    MappedFile mapped;          // Unmapped on unload; empty when opened from memory
+    size_t size;                // Of the image
+    ast_compact_t *tree;        // Borrows the image's nodes and strings
+};
+
+/* ======== PRIVATE HELPER FUNCTIONS ======== */
+
+static uint32_t module_crc32(const void *data, size_t len) {
+    uint32_t crc = crc32(0L, Z_NULL, 0);
+    return crc32(crc, (const Bytef*)data, len);
+}
+
+static size_t align_up(size_t value) {
+    return (value + MODULE_ALIGNMENT - 1) & ~(size_t)(MODULE_ALIGNMENT - 1);
+}
+
+static uint32_t header_crc(const ModuleHeader *header) {
+    ModuleHeader copy = *header;
+    copy.header_crc = 0;
+    return module_crc32(&copy, sizeof(copy));
+}
+
+static bool is_literal_type_supported(uint32_t type) {
+    return type == VALUE_NULL || type == VALUE_BOOL || type == VALUE_NUMBER ||
+           type == VALUE_STRING || type == VALUE_VOID;
+}
+
+static const ModuleSection* find_section(const ModuleHeader *header, ModuleSectionKind kind) {
+    for (uint32_t i = 0; i < header->section_count; i++) {
+        if (header->sections[i].kind == (uint32_t)kind) return &header->sections[i];
+    }
+    return NULL;
+}
+
+static bool check_header(const ModuleHeader *header, size_t file_size, const char *path) {
+    if (memcmp(header->magic, MODULE_MAGIC, 4) != 0) {
+        LOG_ERROR("%s: not a compiled module", path);
+        return false;
+    }
+    if (header->byte_order != MODULE_BYTE_ORDER || header->version != MODULE_FORMAT_VERSION ||
+        header->header_size != sizeof(ModuleHeader) ||
+        header->node_size != sizeof(ast_compact_node_t)) {
+        LOG_ERROR("%s: module was compiled by an incompatible build (version %u)",
+                  path, (unsigned)header->version);
+        return false;
+    }
+    if (header->section_count != MODULE_SECTION_COUNT || header->header_crc != header_crc(header)) {
+        LOG_ERROR("%s: corrupt module header", path);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header->section_count; i++) {
+        const ModuleSection *section = &header->sections[i];
+        if (section->offset % MODULE_ALIGNMENT != 0 || section->offset > file_size ||
+            section->size > file_size - section->offset) {
+            LOG_ERROR("%s: module section %u out of bounds", path, (unsigned)i);
+            return false;
+        }
+    }
+    return true;
+}
+
+static char* encode_image(const ast_compact_t *tree, size_t *image_size, const char *path) {
+
+    size_t node_count = ast_compact_size(tree);
+    size_t string_size = 0;
+    const char *strings = ast_compact_strings(tree, &string_size);
+
+    // Literal indices are dense, one per literal node
+    size_t literal_count = 0;
+    for (uint32_t i = 0; i < node_count; i++) {
+        if (ast_compact_node(tree, i)->type == AST_LITERAL) literal_count++;
+    }
+
+    size_t sizes[MODULE_SECTION_COUNT] = {
+        node_count * sizeof(ast_compact_node_t),
+        string_size,
+        literal_count * sizeof(ModuleLiteral)
+    };
+
+    ModuleHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MODULE_MAGIC, 4);
+    header.version = MODULE_FORMAT_VERSION;
+    header.header_size = sizeof(ModuleHeader);
+    header.byte_order = MODULE_BYTE_ORDER;
+    header.node_size = sizeof(ast_compact_node_t);
+    header.section_count = MODULE_SECTION_COUNT;
+
+    size_t offset = align_up(sizeof(ModuleHeader));
+    for (int i = 0; i < MODULE_SECTION_COUNT; i++) {
+        header.sections[i].kind = (uint32_t)i;
+        header.sections[i].offset = offset;
+        header.sections[i].size = sizes[i];
+        offset = align_up(offset + sizes[i]);
+    }
+
+    char *image = mem_alloc(offset);
+    if (!image) {
+        error_set(ERROR_MEMORY, "Failed to allocate module image");
+        return NULL;
+    }
+    memset(image, 0, offset);
+
+    char *nodes = image + header.sections[MODULE_SECTION_NODES].offset;
+    memcpy(nodes, ast_compact_node(tree, 0), sizes[MODULE_SECTION_NODES]);
+    if (string_size > 0) {
+        memcpy(image + header.sections[MODULE_SECTION_STRINGS].offset, strings, string_size);
+    }
+
+    ModuleLiteral *literals = (ModuleLiteral*)(image + header.sections[MODULE_SECTION_LITERALS].offset);
+    for (uint32_t i = 0; i < node_count; i++) {
+        const ast_compact_node_t *node = ast_compact_node(tree, i);
+        if (node->type != AST_LITERAL) continue;
+
+        const reasons_value_t *value = ast_compact_literal(tree, i);
+        if (node->literal >= literal_count || !is_literal_type_supported(value->type)) {
+            LOG_ERROR("%s: literal at line %u cannot be stored in a module",
+                      path, (unsigned)node->line);
+            mem_free(image);
+            return NULL;
+        }
+
+        ModuleLiteral *literal = &literals[node->literal];
+        literal->type = (uint32_t)value->type;
+        if (value->type == VALUE_BOOL) literal->boolean = value->data.bool_val ? 1 : 0;
+        if (value->type == VALUE_NUMBER) literal->number = value->data.number_val;
+    }
+
+    for (int i = 0; i < MODULE_SECTION_COUNT; i++) {
+        header.sections[i].crc = module_crc32(image + header.sections[i].offset, sizes[i]);
+    }
+    header.header_crc = header_crc(&header);
+    memcpy(image, &header, sizeof(header));
+
+    LOG_DEBUG("Encoded module %s: %zu nodes, %zu string bytes, %zu literals, %zu bytes",
+              path, node_count, string_size, literal_count, offset);
+    *image_size = offset;
+    return image;
+}
+
+// Checks an image and wraps its sections; the image must outlive the module
+static CompiledModule* open_image(const char *base, size_t size, const char *path) {
+    const ModuleHeader *header = (const ModuleHeader*)base;
+    if (size < sizeof(ModuleHeader) || !check_header(header, size, path)) {
+        return NULL;
+    }
+
+    const ModuleSection *sections[MODULE_SECTION_COUNT];
+    for (int i = 0; i < MODULE_SECTION_COUNT; i++) {
+        sections[i] = find_section(header, (ModuleSectionKind)i);
+        if (!sections[i] ||
+            module_crc32(base + sections[i]->offset, sections[i]->size) != sections[i]->crc) {
+            LOG_ERROR("%s: module checksum mismatch", path);
+            return NULL;
+        }
+    }
+
+    const ModuleSection *nodes = sections[MODULE_SECTION_NODES];
+    const ModuleSection *strings = sections[MODULE_SECTION_STRINGS];
+    const ModuleSection *literal_section = sections[MODULE_SECTION_LITERALS];
+    if (nodes->size % sizeof(ast_compact_node_t) != 0 ||
+        literal_section->size % sizeof(ModuleLiteral) != 0) {
+        LOG_ERROR("%s: malformed module sections", path);
+        return NULL;
+    }
+
+    // The only copy: literal values, whose strings are then pointed into
+    // the image's string table
+    size_t literal_count = literal_section->size / sizeof(ModuleLiteral);
+    const ModuleLiteral *stored = (const ModuleLiteral*)(base + literal_section->offset);
+    reasons_value_t *literals = NULL;
+    if (literal_count > 0) {
+        literals = mem_alloc(literal_count * sizeof(reasons_value_t));
+        if (!literals) return NULL;
+        memset(literals, 0, literal_count * sizeof(reasons_value_t));
+    }
+
+    for (size_t i = 0; i < literal_count; i++) {
+        if (!is_literal_type_supported(stored[i].type)) {
+            LOG_ERROR("%s: unknown literal type %u", path, (unsigned)stored[i].type);
+            mem_free(literals);
+            return NULL;
+        }
+        literals[i].type = (ValueType)stored[i].type;
+        if (literals[i].type == VALUE_BOOL) literals[i].data.bool_val = stored[i].boolean != 0;
+        if (literals[i].type == VALUE_NUMBER) literals[i].data.number_val = stored[i].number;
+    }
+
+    ast_compact_t *tree = ast_compact_borrow(
+        (const ast_compact_node_t*)(base + nodes->offset), nodes->size / sizeof(ast_compact_node_t),
+        base + strings->offset, strings->size, literals, literal_count);
+    if (!tree) {
+        LOG_ERROR("%s: corrupt module", path);
+        mem_free(literals);
+        return NULL;
+    }
+
+    // Semantic checks on the mapped nodes themselves, so nothing that walks
+    // the module (ast_compact_to_ast recurses) sees an unbounded depth
+    if (!ast_compact_validate(tree, 0)) {
+        LOG_ERROR("%s: invalid module program", path);
+        ast_compact_destroy(tree);
+        return NULL;
+    }
+
+    CompiledModule *module = mem_alloc(sizeof(CompiledModule));
+    if (!module) {
+        ast_compact_destroy(tree);
+        return NULL;
+    }
+    memset(module, 0, sizeof(CompiledModule));
+    module->size = size;
+    module->tree = tree;
+    return module;
+}
+
+/* ======== PUBLIC API IMPLEMENTATION ======== */
+
+bool module_write(const char *path, const ast_compact_t *tree) {
+    if (!path || !tree || ast_compact_size(tree) == 0) {
+        error_set(ERROR_INVALID_ARGUMENT, "Module path and tree are required");
+        return false;
+    }
+
+    size_t size = 0;
+    char *image = encode_image(tree, &size, path);
+    if (!image) return false;
+
+    bool written = file_write_all(path, image, size, true);
+    mem_free(image);
+    if (written) {
+        LOG_DEBUG("Wrote module %s: %zu bytes", path, size);
+    }
+    return written;
+}
+
+void* module_encode(const ast_compact_t *tree, size_t *size) {
+    if (!tree || !size || ast_compact_size(tree) == 0) {
+        error_set(ERROR_INVALID_ARGUMENT, "Module tree and size are required");
+        return NULL;
+    }
+    return encode_image(tree, size, "(memory)");
+}
+
+bool module_write_program(const char *path, const ast_node_t *program) {
+    ast_compact_t *tree = ast_compact_from_ast(program);
+    if (!tree) return false;
+
+    bool written = module_write(path, tree);
+    ast_compact_destroy(tree);
+    return written;
+}
+
+CompiledModule* module_load(const char *path) {
+    if (!path) return NULL;
+
+    MappedFile mapped = file_mmap(path);
+    if (!mapped.data) {
+        LOG_ERROR("Cannot map module: %s", path);
+        return NULL;
+    }
+
+    CompiledModule *module = open_image(mapped.data, mapped.size, path);
+    if (!module) {
+        file_munmap(&mapped);
+        return NULL;
+    }
+    module->mapped = mapped;
+
+    LOG_DEBUG("Loaded module %s: %zu nodes, %zu bytes mapped",
+              path, ast_compact_size(module->tree), mapped.size);
+    return module;
+}
+
+CompiledModule* module_open(const void *data, size_t size, const char *name) {
+    if (!data) return NULL;
+    return open_image(data, size, name ? name : "(memory)");
+}
+
+void module_unload(CompiledModule *module) {
+    if (!module) return;
+
+    ast_compact_destroy(module->tree);
+    file_munmap(&module->mapped);
+    mem_free(module);
+}
+
+const ast_compact_t* module_tree(const CompiledModule *module) {
+    return module ? module->tree : NULL;
+}
+
+size_t module_file_size(const CompiledModule *module) {
+    return module ? module->size : 0;
+}
+
+bool module_is_module_path(const char *path) {
+    if (!path) return false;
+
+    size_t length = strlen(path);
+    size_t extension = strlen(MODULE_EXTENSION);
+    return length > extension && strcmp(path + length - extension, MODULE_EXTENSION) == 0;
+}
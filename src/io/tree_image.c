@@ -0,0 +1,872 @@
+/*
+ * tree_image.c - Binary Decision Tree Images for Reasons DSL
+ *
+ * Features:
+ * - Relocatable node array, threshold array and string pool
+ * - Conditions, actions and outcomes as an embedded precompiled module
+ * - CRC32 per section and over the header
+ * - Memory-mapped, read-only loading shared through the page cache
+ * - Every link range-checked on load, so a damaged image cannot be walked
+ *   out of bounds or in a cycle
+ * - Evaluation in place, without rebuilding the tree
+ */
+
+#include "reasons/tree_image.h"
+#include "reasons/io.h"
+#include "reasons/module.h"
+#include "reasons/ast_compact.h"
+#include "reasons/eval.h"
+#include "utils/collections.h"
+#include "utils/error.h"
+#include "utils/logger.h"
+#include "utils/memory.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+/* ======== CONSTANTS ======== */
+
+#define IMAGE_MAGIC "RTI"
+#define IMAGE_BYTE_ORDER 0x01020304u
+#define IMAGE_ALIGNMENT 8
+
+typedef enum {
+    IMAGE_SECTION_NODES,
+    IMAGE_SECTION_THRESHOLDS,
+    IMAGE_SECTION_STRINGS,
+    IMAGE_SECTION_EXPRESSIONS,
+    IMAGE_SECTION_COUNT
+} ImageSectionKind;
+
+/* ======== STRUCTURE DEFINITIONS ======== */
+
+typedef struct {
+    uint32_t kind;              // ImageSectionKind
+    uint32_t crc;               // CRC32 of the section bytes
+    uint64_t offset;            // From the start of the file, aligned
+    uint64_t size;              // In bytes
+} ImageSection;
+
+typedef struct {
+    char magic[4];              // "RTI\0"
+    uint16_t version;           // TREE_IMAGE_FORMAT_VERSION
+    uint16_t header_size;       // sizeof(ImageHeader)
+    uint32_t byte_order;        // IMAGE_BYTE_ORDER as stored by the writer
+    uint32_t node_size;         // sizeof(ImageNode) of the writer
+    uint32_t section_count;
+    uint32_t header_crc;        // CRC32 of the header with this field zero
+    ImageSection sections[IMAGE_SECTION_COUNT];
+} ImageHeader;
+
+// Each node precedes its branches (preorder for a tree, topological for a
+// DAG), so branches always point forward
+typedef struct {
+    uint8_t type;               // NodeType
+    uint8_t action_type;        // consequence_type_t of action nodes
+    uint16_t reserved;
+    uint32_t branch[2];         // True and false branch, or TREE_IMAGE_NONE
+    uint32_t id;                // String pool offsets, or TREE_IMAGE_NONE
+    uint32_t description;
+    int32_t line;
+    int32_t column;
+    uint32_t expression;        // Condition, first action or outcome literal
+    uint32_t expression_count;  // Actions, chained as siblings
+    uint32_t threshold;         // Threshold index of condition nodes
+} ImageNode;
+
+struct TreeImage {
+    MappedFile mapped;
+    const ImageNode *nodes;
+    size_t node_count;
+    const double *thresholds;
+    size_t threshold_count;
+    const char *strings;
+    CompiledModule *expressions;
+    const ast_compact_t *tree;  // Of the expressions module
+
+    // Pointer ASTs for what cannot run on the mapped form, indexed by
+    // expression; built at load, read-only afterwards; process-private
+    ast_node_t **materialized;
+};
+
+// Writer state
+typedef struct {
+    TreeNode **nodes;
+    uint32_t *branches;         // Two per node
+    size_t count;
+    size_t capacity;
+    HashTable *visited;         // TreeNode* -> position, one per distinct node
+    bool failed;
+} NodeList;
+
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+    HashTable *offsets;         // String -> offset, so repeats are stored once
+    bool failed;
+} StringPool;
+
+// Evaluation context for conditions the mapped form cannot run, one per
+// thread, rebuilt only when the thread switches environments
+static pthread_once_t condition_ctx_once = PTHREAD_ONCE_INIT;
+static pthread_key_t condition_ctx_key;
+static __thread eval_context_t *condition_ctx;
+static __thread runtime_env_t *condition_env;
+
+/* ======== PRIVATE HELPER FUNCTIONS ======== */
+
+static uint32_t image_crc32(const void *data, size_t len) {
+    uint32_t crc = crc32(0L, Z_NULL, 0);
+    return crc32(crc, (const Bytef*)data, len);
+}
+
+static size_t align_up(size_t value) {
+    return (value + IMAGE_ALIGNMENT - 1) & ~(size_t)(IMAGE_ALIGNMENT - 1);
+}
+
+static uint32_t header_crc(const ImageHeader *header) {
+    ImageHeader copy = *header;
+    copy.header_crc = 0;
+    return image_crc32(&copy, sizeof(copy));
+}
+
+// Appends the distinct nodes under node in postorder, false branch first,
+// and returns node's position. A node shared by several parents (merged by
+// tree_optimize) is stored once and every parent links to it.
+static uint32_t collect_postorder(NodeList *list, TreeNode *node) {
+    if (!node || list->failed) return TREE_IMAGE_NONE;
+
+    uint32_t *seen = hashtable_get(list->visited, &node, sizeof(TreeNode*));
+    if (seen) return *seen;
+
+    uint32_t false_index = collect_postorder(list, tree_node_branch(node, false));
+    uint32_t true_index = collect_postorder(list, tree_node_branch(node, true));
+    if (list->failed) return TREE_IMAGE_NONE;
+
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        TreeNode **nodes = mem_realloc(list->nodes, capacity * sizeof(TreeNode*));
+        uint32_t *branches = nodes ? mem_realloc(list->branches, capacity * 2 * sizeof(uint32_t)) : NULL;
+        if (nodes) list->nodes = nodes;
+        if (!nodes || !branches) {
+            list->failed = true;
+            return TREE_IMAGE_NONE;
+        }
+        list->branches = branches;
+        list->capacity = capacity;
+    }
+
+    uint32_t index = (uint32_t)list->count++;
+    list->nodes[index] = node;
+    list->branches[index * 2] = true_index;
+    list->branches[index * 2 + 1] = false_index;
+    hashtable_set(list->visited, &node, sizeof(TreeNode*), &index, sizeof(uint32_t));
+    return index;
+}
+
+// Reversed postorder puts every node before its branches; with the false
+// branch visited first, a tree without shared nodes comes out in preorder
+static void collect_nodes(NodeList *list, TreeNode *root) {
+    list->visited = hashtable_create(64, NULL);
+    if (!list->visited) {
+        list->failed = true;
+        return;
+    }
+
+    collect_postorder(list, root);
+    hashtable_destroy(list->visited);
+    list->visited = NULL;
+    if (list->failed) return;
+
+    size_t last = list->count - 1;
+    for (size_t i = 0, j = last; i < j; i++, j--) {
+        TreeNode *node = list->nodes[i];
+        list->nodes[i] = list->nodes[j];
+        list->nodes[j] = node;
+        for (int b = 0; b < 2; b++) {
+            uint32_t branch = list->branches[i * 2 + b];
+            list->branches[i * 2 + b] = list->branches[j * 2 + b];
+            list->branches[j * 2 + b] = branch;
+        }
+    }
+    for (size_t i = 0; i < list->count * 2; i++) {
+        if (list->branches[i] != TREE_IMAGE_NONE) {
+            list->branches[i] = (uint32_t)(last - list->branches[i]);
+        }
+    }
+}
+
+static uint32_t pool_add(StringPool *pool, const char *text) {
+    if (!text || pool->failed) return TREE_IMAGE_NONE;
+
+    size_t length = strlen(text);
+    uint32_t *existing = hashtable_get(pool->offsets, text, length + 1);
+    if (existing) return *existing;
+
+    if (pool->size + length + 1 > pool->capacity) {
+        size_t capacity = pool->capacity ? pool->capacity : 256;
+        while (capacity < pool->size + length + 1) capacity *= 2;
+        char *data = mem_realloc(pool->data, capacity);
+        if (!data) {
+            pool->failed = true;
+            return TREE_IMAGE_NONE;
+        }
+        pool->data = data;
+        pool->capacity = capacity;
+    }
+
+    uint32_t offset = (uint32_t)pool->size;
+    memcpy(pool->data + offset, text, length + 1);
+    pool->size += length + 1;
+    hashtable_set(pool->offsets, text, length + 1, &offset, sizeof(offset));
+    return offset;
+}
+
+// Adds each node's condition, actions or outcome to program, recording the
+// position of its first expression among program's children
+static bool collect_expressions(const NodeList *list, ImageNode *image_nodes, double *thresholds,
+                                ast_node_t *program, uint32_t *first_child) {
+    uint32_t child = 0;
+    uint32_t threshold = 0;
+
+    for (size_t i = 0; i < list->count; i++) {
+        TreeNode *node = list->nodes[i];
+        ImageNode *image_node = &image_nodes[i];
+        first_child[i] = child;
+
+        switch (tree_node_type(node)) {
+            case NODE_CONDITION: {
+                double weight = 0.0;
+                ast_node_t *condition = ast_clone((ast_node_t*)tree_node_condition(node, &weight));
+                if (!condition || !ast_add_child(program, condition)) {
+                    ast_destroy(condition);
+                    return false;
+                }
+                thresholds[threshold] = weight;
+                image_node->threshold = threshold++;
+                image_node->expression_count = 1;
+                child++;
+                break;
+            }
+
+            case NODE_ACTION: {
+                consequence_type_t type = 0;
+                Vector *actions = tree_node_actions(node, &type);
+                image_node->action_type = (uint8_t)type;
+                for (size_t k = 0; k < vector_size(actions); k++) {
+                    ast_node_t *action = ast_clone(vector_at(actions, k));
+                    if (!action || !ast_add_child(program, action)) {
+                        ast_destroy(action);
+                        return false;
+                    }
+                    child++;
+                }
+                image_node->expression_count = (uint32_t)vector_size(actions);
+                break;
+            }
+
+            case NODE_OUTCOME: {
+                ast_node_t *literal = ast_create_literal(tree_node_outcome(node));
+                if (!literal || !ast_add_child(program, literal)) {
+                    ast_destroy(literal);
+                    return false;
+                }
+                image_node->expression_count = 1;
+                child++;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+static bool check_header(const ImageHeader *header, size_t file_size, const char *path) {
+    if (memcmp(header->magic, IMAGE_MAGIC, 4) != 0) {
+        LOG_ERROR("%s: not a tree image", path);
+        return false;
+    }
+    if (header->byte_order != IMAGE_BYTE_ORDER || header->version != TREE_IMAGE_FORMAT_VERSION ||
+        header->header_size != sizeof(ImageHeader) || header->node_size != sizeof(ImageNode)) {
+        LOG_ERROR("%s: tree image was written by an incompatible build (version %u)",
+                  path, (unsigned)header->version);
+        return false;
+    }
+    if (header->section_count != IMAGE_SECTION_COUNT || header->header_crc != header_crc(header)) {
+        LOG_ERROR("%s: corrupt tree image header", path);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header->section_count; i++) {
+        const ImageSection *section = &header->sections[i];
+        if (section->kind != i || section->offset % IMAGE_ALIGNMENT != 0 ||
+            section->offset > file_size || section->size > file_size - section->offset) {
+            LOG_ERROR("%s: tree image section %u out of bounds", path, (unsigned)i);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool check_string(uint32_t offset, size_t string_size) {
+    return offset == TREE_IMAGE_NONE || offset < string_size;
+}
+
+// Branches must point forward, so evaluation always terminates
+static bool check_nodes(const TreeImage *image, size_t string_size) {
+    size_t expression_count = ast_compact_size(image->tree);
+
+    for (size_t i = 0; i < image->node_count; i++) {
+        const ImageNode *node = &image->nodes[i];
+        if (!check_string(node->id, string_size) || !check_string(node->description, string_size)) {
+            return false;
+        }
+
+        for (int b = 0; b < 2; b++) {
+            uint32_t branch = node->branch[b];
+            if (branch == TREE_IMAGE_NONE) continue;
+            if (node->type != NODE_CONDITION || branch <= i || branch >= image->node_count) {
+                return false;
+            }
+        }
+
+        switch (node->type) {
+            case NODE_CONDITION:
+                if (node->threshold >= image->threshold_count ||
+                    node->expression >= expression_count) {
+                    return false;
+                }
+                break;
+
+            case NODE_ACTION: {
+                uint32_t expression = node->expression;
+                for (uint32_t k = 0; k < node->expression_count; k++) {
+                    if (expression >= expression_count) return false;
+                    expression = ast_compact_node(image->tree, expression)->next_sibling;
+                }
+                break;
+            }
+
+            case NODE_OUTCOME:
+                if (node->expression >= expression_count ||
+                    ast_compact_node(image->tree, node->expression)->type != AST_LITERAL) {
+                    return false;
+                }
+                break;
+
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool value_is_truthy(const reasons_value_t *value) {
+    switch (value->type) {
+        case VALUE_BOOL:   return value->data.bool_val;
+        case VALUE_NUMBER: return value->data.number_val != 0.0;
+        case VALUE_STRING: return value->data.string_val && value->data.string_val[0] != '\0';
+        case VALUE_NULL:   return false;
+        case VALUE_ERROR:  return false;
+        default:           return true;
+    }
+}
+
+// Same rules as the evaluator's comparisons
+static reasons_value_t compare_values(uint8_t op, const reasons_value_t *left,
+                                      const reasons_value_t *right) {
+    reasons_value_t result = {VALUE_BOOL, .data.bool_val = false};
+    int cmp = 0;
+
+    if (left->type == VALUE_NUMBER && right->type == VALUE_NUMBER) {
+        double l = left->data.number_val;
+        double r = right->data.number_val;
+        cmp = l < r ? -1 : (l > r ? 1 : 0);
+        if (l != l || r != r) {
+            // NaN compares unequal to everything
+            result.data.bool_val = op == CMP_NE;
+            return result;
+        }
+    } else if (left->type == VALUE_STRING && right->type == VALUE_STRING) {
+        cmp = strcmp(left->data.string_val, right->data.string_val);
+    } else if (left->type == VALUE_BOOL && right->type == VALUE_BOOL) {
+        if (op != CMP_EQ && op != CMP_NE) {
+            error_set(ERROR_EVAL_TYPE, "Invalid operation for booleans");
+            result.type = VALUE_ERROR;
+            return result;
+        }
+        cmp = left->data.bool_val == right->data.bool_val ? 0 : 1;
+    } else {
+        error_set(ERROR_EVAL_TYPE, "Type mismatch in comparison");
+        result.type = VALUE_ERROR;
+        return result;
+    }
+
+    switch (op) {
+        case CMP_EQ: result.data.bool_val = cmp == 0; break;
+        case CMP_NE: result.data.bool_val = cmp != 0; break;
+        case CMP_LT: result.data.bool_val = cmp < 0; break;
+        case CMP_LE: result.data.bool_val = cmp <= 0; break;
+        case CMP_GT: result.data.bool_val = cmp > 0; break;
+        case CMP_GE: result.data.bool_val = cmp >= 0; break;
+        default: break;
+    }
+    return result;
+}
+
+// Evaluates a condition on the mapped nodes. Values are borrowed from the
+// image or the environment. Returns false for node types only the full
+// evaluator handles.
+static bool eval_mapped(const ast_compact_t *tree, uint32_t index, runtime_env_t *env,
+                        reasons_value_t *out) {
+    if (index == AST_COMPACT_NONE) {
+        out->type = VALUE_NULL;
+        return true;
+    }
+
+    const ast_compact_node_t *node = ast_compact_node(tree, index);
+    switch (node->type) {
+        case AST_LITERAL:
+            *out = *ast_compact_literal(tree, index);
+            return true;
+
+        case AST_IDENTIFIER:
+            *out = runtime_get_variable(env, ast_compact_text(tree, index));
+            return true;
+
+        case AST_COMPARISON: {
+            reasons_value_t left, right;
+            if (!eval_mapped(tree, node->operand[AST_COMPACT_LEFT], env, &left) ||
+                !eval_mapped(tree, node->operand[AST_COMPACT_RIGHT], env, &right)) {
+                return false;
+            }
+            *out = compare_values(node->op, &left, &right);
+            return true;
+        }
+
+        case AST_LOGIC_OP: {
+            if (node->op != LOGIC_AND && node->op != LOGIC_OR && node->op != LOGIC_NOT) {
+                return false;
+            }
+
+            reasons_value_t left;
+            if (!eval_mapped(tree, node->operand[AST_COMPACT_LEFT], env, &left)) return false;
+
+            out->type = VALUE_BOOL;
+            bool truthy = value_is_truthy(&left);
+            if (node->op == LOGIC_NOT || (node->op == LOGIC_AND) != truthy) {
+                // NOT, or a short circuit: false AND x, true OR x
+                out->data.bool_val = node->op == LOGIC_NOT ? !truthy : truthy;
+                return true;
+            }
+
+            reasons_value_t right;
+            if (!eval_mapped(tree, node->operand[AST_COMPACT_RIGHT], env, &right)) return false;
+            out->data.bool_val = value_is_truthy(&right);
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+// The node types eval_mapped handles, checked once at load
+static bool runs_mapped(const ast_compact_t *tree, uint32_t index) {
+    if (index == AST_COMPACT_NONE) return true;
+
+    const ast_compact_node_t *node = ast_compact_node(tree, index);
+    switch (node->type) {
+        case AST_LITERAL:
+        case AST_IDENTIFIER:
+            return true;
+
+        case AST_COMPARISON:
+            return runs_mapped(tree, node->operand[AST_COMPACT_LEFT]) &&
+                   runs_mapped(tree, node->operand[AST_COMPACT_RIGHT]);
+
+        case AST_LOGIC_OP:
+            return (node->op == LOGIC_AND || node->op == LOGIC_OR || node->op == LOGIC_NOT) &&
+                   runs_mapped(tree, node->operand[AST_COMPACT_LEFT]) &&
+                   runs_mapped(tree, node->operand[AST_COMPACT_RIGHT]);
+
+        default:
+            return false;
+    }
+}
+
+static bool materialize(TreeImage *image, uint32_t index) {
+    // Nodes shared between parents reach the same expression twice
+    if (image->materialized[index]) return true;
+    image->materialized[index] = ast_compact_to_ast(image->tree, index);
+    return image->materialized[index] != NULL;
+}
+
+// Every action, and every condition eval_mapped cannot run
+static bool materialize_expressions(TreeImage *image) {
+    for (size_t i = 0; i < image->node_count; i++) {
+        const ImageNode *node = &image->nodes[i];
+        if (node->type == NODE_CONDITION) {
+            if (!runs_mapped(image->tree, node->expression) &&
+                !materialize(image, node->expression)) {
+                return false;
+            }
+        } else if (node->type == NODE_ACTION) {
+            uint32_t expression = node->expression;
+            for (uint32_t k = 0; k < node->expression_count; k++) {
+                if (!materialize(image, expression)) return false;
+                expression = ast_compact_node(image->tree, expression)->next_sibling;
+            }
+        }
+    }
+    return true;
+}
+
+static void destroy_condition_ctx(void *ctx) {
+    eval_context_destroy(ctx);
+}
+
+static void create_condition_ctx_key(void) {
+    pthread_key_create(&condition_ctx_key, destroy_condition_ctx);
+}
+
+static eval_context_t* thread_condition_ctx(runtime_env_t *env) {
+    if (condition_ctx && condition_env == env) return condition_ctx;
+
+    eval_context_destroy(condition_ctx);
+    condition_ctx = eval_context_create(env);
+    condition_env = condition_ctx ? env : NULL;
+    if (condition_ctx) {
+        eval_set_tracing(condition_ctx, false);
+        eval_set_explanation(condition_ctx, false);
+    }
+
+    // Freed with the thread
+    pthread_once(&condition_ctx_once, create_condition_ctx_key);
+    pthread_setspecific(condition_ctx_key, condition_ctx);
+    return condition_ctx;
+}
+
+static bool eval_condition(TreeImage *image, uint32_t index, runtime_env_t *env) {
+    reasons_value_t value;
+    ast_node_t *condition = image->materialized[index];
+    if (!condition) {
+        return eval_mapped(image->tree, index, env, &value) && value_is_truthy(&value);
+    }
+
+    eval_context_t *ctx = thread_condition_ctx(env);
+    if (!ctx) return false;
+
+    value = eval_tree(ctx, condition);
+    bool truthy = value_is_truthy(&value);
+    reasons_value_free(&value);
+    return truthy;
+}
+
+/* ======== PUBLIC API IMPLEMENTATION ======== */
+
+bool tree_image_write(const char *path, const DecisionTree *tree) {
+    TreeNode *root = tree_root(tree);
+    if (!path || !root) {
+        error_set(ERROR_INVALID_ARGUMENT, "Image path and a tree with a root are required");
+        return false;
+    }
+
+    NodeList list = {0};
+    collect_nodes(&list, root);
+
+    StringPool pool = {0};
+    pool.offsets = hashtable_create(256, NULL);
+
+    ImageNode *image_nodes = list.failed ? NULL : mem_alloc(list.count * sizeof(ImageNode));
+    double *thresholds = image_nodes ? mem_alloc(list.count * sizeof(double)) : NULL;
+    uint32_t *first_child = thresholds ? mem_alloc(list.count * sizeof(uint32_t)) : NULL;
+    ast_node_t *program = first_child ? ast_create_node(AST_PROGRAM) : NULL;
+    ast_compact_t *expressions = NULL;
+    char *module_image = NULL;
+    size_t module_size = 0;
+    bool written = false;
+
+    if (!program || !pool.offsets) {
+        error_set(ERROR_MEMORY, "Failed to allocate tree image");
+        goto cleanup;
+    }
+
+    memset(image_nodes, 0, list.count * sizeof(ImageNode));
+    for (size_t i = 0; i < list.count; i++) {
+        TreeNode *node = list.nodes[i];
+        ImageNode *image_node = &image_nodes[i];
+        int line = 0, column = 0;
+        tree_node_location(node, &line, &column);
+
+        image_node->type = (uint8_t)tree_node_type(node);
+        image_node->branch[0] = list.branches[i * 2];
+        image_node->branch[1] = list.branches[i * 2 + 1];
+        image_node->id = pool_add(&pool, tree_node_id(node));
+        image_node->description = pool_add(&pool, tree_node_description(node));
+        image_node->line = line;
+        image_node->column = column;
+        image_node->expression = TREE_IMAGE_NONE;
+        image_node->threshold = TREE_IMAGE_NONE;
+    }
+
+    if (pool.failed || !collect_expressions(&list, image_nodes, thresholds, program, first_child)) {
+        error_set(ERROR_MEMORY, "Failed to collect tree image expressions");
+        goto cleanup;
+    }
+
+    expressions = ast_compact_from_ast(program);
+    module_image = expressions ? module_encode(expressions, &module_size) : NULL;
+    if (!module_image) goto cleanup;
+
+    // Program children are in the order collect_expressions added them
+    size_t child_count = ast_get_child_count(program);
+    uint32_t *child_index = mem_alloc((child_count + 1) * sizeof(uint32_t));
+    if (!child_index) goto cleanup;
+
+    size_t ordinal = 0;
+    for (uint32_t child = ast_compact_node(expressions, 0)->first_child;
+         child != AST_COMPACT_NONE && ordinal < child_count;
+         child = ast_compact_node(expressions, child)->next_sibling) {
+        child_index[ordinal++] = child;
+    }
+
+    size_t threshold_count = 0;
+    for (size_t i = 0; i < list.count; i++) {
+        if (image_nodes[i].expression_count > 0) {
+            image_nodes[i].expression = child_index[first_child[i]];
+        }
+        if (image_nodes[i].type == NODE_CONDITION) threshold_count++;
+    }
+    mem_free(child_index);
+
+    size_t sizes[IMAGE_SECTION_COUNT] = {
+        list.count * sizeof(ImageNode),
+        threshold_count * sizeof(double),
+        pool.size,
+        module_size
+    };
+    const void *sources[IMAGE_SECTION_COUNT] = { image_nodes, thresholds, pool.data, module_image };
+
+    ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMAGE_MAGIC, 4);
+    header.version = TREE_IMAGE_FORMAT_VERSION;
+    header.header_size = sizeof(ImageHeader);
+    header.byte_order = IMAGE_BYTE_ORDER;
+    header.node_size = sizeof(ImageNode);
+    header.section_count = IMAGE_SECTION_COUNT;
+
+    size_t offset = align_up(sizeof(ImageHeader));
+    for (int i = 0; i < IMAGE_SECTION_COUNT; i++) {
+        header.sections[i].kind = (uint32_t)i;
+        header.sections[i].offset = offset;
+        header.sections[i].size = sizes[i];
+        offset = align_up(offset + sizes[i]);
+    }
+
+    char *image = mem_alloc(offset);
+    if (!image) {
+        error_set(ERROR_MEMORY, "Failed to allocate tree image");
+        goto cleanup;
+    }
+    memset(image, 0, offset);
+
+    for (int i = 0; i < IMAGE_SECTION_COUNT; i++) {
+        if (sizes[i] > 0) memcpy(image + header.sections[i].offset, sources[i], sizes[i]);
+        header.sections[i].crc = image_crc32(image + header.sections[i].offset, sizes[i]);
+    }
+    header.header_crc = header_crc(&header);
+    memcpy(image, &header, sizeof(header));
+
+    written = file_write_all(path, image, offset, true);
+    mem_free(image);
+
+    if (written) {
+        LOG_DEBUG("Wrote tree image %s: %zu nodes, %zu string bytes, %zu expression bytes, %zu bytes",
+                  path, list.count, pool.size, module_size, offset);
+    }
+
+cleanup:
+    mem_free(module_image);
+    ast_compact_destroy(expressions);
+    ast_destroy(program);
+    mem_free(first_child);
+    mem_free(thresholds);
+    mem_free(image_nodes);
+    hashtable_destroy(pool.offsets);
+    mem_free(pool.data);
+    mem_free(list.branches);
+    mem_free(list.nodes);
+    return written;
+}
+
+TreeImage* tree_image_load(const char *path) {
+    if (!path) return NULL;
+
+    MappedFile mapped = file_mmap(path);
+    if (!mapped.data) {
+        LOG_ERROR("Cannot map tree image: %s", path);
+        return NULL;
+    }
+
+    const char *base = mapped.data;
+    const ImageHeader *header = (const ImageHeader*)base;
+    if (mapped.size < sizeof(ImageHeader) || !check_header(header, mapped.size, path)) {
+        file_munmap(&mapped);
+        return NULL;
+    }
+
+    for (int i = 0; i < IMAGE_SECTION_COUNT; i++) {
+        const ImageSection *section = &header->sections[i];
+        if (image_crc32(base + section->offset, section->size) != section->crc) {
+            LOG_ERROR("%s: tree image checksum mismatch", path);
+            file_munmap(&mapped);
+            return NULL;
+        }
+    }
+
+    const ImageSection *nodes = &header->sections[IMAGE_SECTION_NODES];
+    const ImageSection *thresholds = &header->sections[IMAGE_SECTION_THRESHOLDS];
+    const ImageSection *strings = &header->sections[IMAGE_SECTION_STRINGS];
+    const ImageSection *expressions = &header->sections[IMAGE_SECTION_EXPRESSIONS];
+    if (nodes->size == 0 || nodes->size % sizeof(ImageNode) != 0 ||
+        thresholds->size % sizeof(double) != 0 ||
+        (strings->size > 0 && base[strings->offset + strings->size - 1] != '\0')) {
+        LOG_ERROR("%s: malformed tree image sections", path);
+        file_munmap(&mapped);
+        return NULL;
+    }
+
+    TreeImage *image = mem_alloc(sizeof(TreeImage));
+    if (!image) {
+        file_munmap(&mapped);
+        return NULL;
+    }
+    memset(image, 0, sizeof(TreeImage));
+    image->mapped = mapped;
+    image->nodes = (const ImageNode*)(base + nodes->offset);
+    image->node_count = nodes->size / sizeof(ImageNode);
+    image->thresholds = (const double*)(base + thresholds->offset);
+    image->threshold_count = thresholds->size / sizeof(double);
+    image->strings = base + strings->offset;
+    image->expressions = module_open(base + expressions->offset, expressions->size, path);
+    image->tree = module_tree(image->expressions);
+
+    if (!image->tree || !check_nodes(image, strings->size)) {
+        LOG_ERROR("%s: corrupt tree image", path);
+        tree_image_unload(image);
+        return NULL;
+    }
+
+    size_t expression_count = ast_compact_size(image->tree);
+    image->materialized = mem_alloc(expression_count * sizeof(ast_node_t*));
+    if (image->materialized) {
+        memset(image->materialized, 0, expression_count * sizeof(ast_node_t*));
+    }
+    if (!image->materialized || !materialize_expressions(image)) {
+        LOG_ERROR("%s: cannot prepare tree image expressions", path);
+        tree_image_unload(image);
+        return NULL;
+    }
+
+    LOG_DEBUG("Loaded tree image %s: %zu nodes, %zu bytes mapped",
+              path, image->node_count, mapped.size);
+    return image;
+}
+
+void tree_image_unload(TreeImage *image) {
+    if (!image) return;
+
+    if (image->materialized) {
+        size_t expression_count = ast_compact_size(image->tree);
+        for (size_t i = 0; i < expression_count; i++) {
+            ast_destroy(image->materialized[i]);
+        }
+        mem_free(image->materialized);
+    }
+    module_unload(image->expressions);
+    file_munmap(&image->mapped);
+    mem_free(image);
+}
+
+size_t tree_image_node_count(const TreeImage *image) {
+    return image ? image->node_count : 0;
+}
+
+size_t tree_image_file_size(const TreeImage *image) {
+    return image ? image->mapped.size : 0;
+}
+
+uint32_t tree_image_find_node(const TreeImage *image, const char *id) {
+    if (!image || !id) return TREE_IMAGE_NONE;
+
+    // Linear: images are for evaluation; lookups belong to tooling
+    for (size_t i = 0; i < image->node_count; i++) {
+        uint32_t offset = image->nodes[i].id;
+        if (offset != TREE_IMAGE_NONE && strcmp(image->strings + offset, id) == 0) {
+            return (uint32_t)i;
+        }
+    }
+    return TREE_IMAGE_NONE;
+}
+
+NodeType tree_image_node_type(const TreeImage *image, uint32_t index) {
+    // Callers index within tree_image_node_count
+    return (NodeType)image->nodes[index].type;
+}
+
+const char* tree_image_node_id(const TreeImage *image, uint32_t index) {
+    if (!image || index >= image->node_count || image->nodes[index].id == TREE_IMAGE_NONE) {
+        return NULL;
+    }
+    return image->strings + image->nodes[index].id;
+}
+
+reasons_value_t tree_image_evaluate(TreeImage *image, runtime_env_t *env, uint32_t *leaf) {
+    reasons_value_t result = {VALUE_NULL};
+    if (leaf) *leaf = TREE_IMAGE_NONE;
+    if (!image) return result;
+
+    uint32_t index = 0;
+    while (index != TREE_IMAGE_NONE) {
+        const ImageNode *node = &image->nodes[index];
+        if (leaf) *leaf = index;
+
+        switch (node->type) {
+            case NODE_CONDITION: {
+                bool taken = eval_condition(image, node->expression, env);
+                index = node->branch[taken ? 0 : 1];
+                break;
+            }
+
+            case NODE_ACTION: {
+                uint32_t expression = node->expression;
+                for (uint32_t k = 0; k < node->expression_count; k++) {
+                    ast_node_t *action = image->materialized[expression];
+                    if (action) {
+                        consequence_result_t cr = runtime_execute_consequence(
+                            env, action, (consequence_type_t)node->action_type);
+                        if (cr.success && cr.value) result = *cr.value;
+                    }
+                    expression = ast_compact_node(image->tree, expression)->next_sibling;
+                }
+                index = TREE_IMAGE_NONE;
+                break;
+            }
+
+            case NODE_OUTCOME:
+                result = reasons_value_clone(ast_compact_literal(image->tree, node->expression));
+                index = TREE_IMAGE_NONE;
+                break;
+
+            default:
+                index = TREE_IMAGE_NONE;
+                break;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,254 @@
+/*
+ * workload.c - Synthetic Workload Generator for Reasons DSL
+ *
+ * Features:
+ * - Seeded, reproducible .reasons programs: rule count, sub-rule depth,
+ *   fan-out, variable count, numeric/categorical mix, condition width
+ * - Matching CSV and JSONL input datasets over the same variables
+ * - Input skew to control how predictable each branch is
+ */
+
+#include "reasons/workload.h"
+#include "utils/error.h"
+#include "utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* ======== CONSTANTS ======== */
+
+#define WORKLOAD_DATA_STREAM 0xD1B54A32D192ED03ULL
+#define WORKLOAD_MAX_SKEW 0.99
+
+static const char *workload_actions[] = {"approve", "review", "deny", "escalate", "notify"};
+
+#define WORKLOAD_ACTION_COUNT (sizeof(workload_actions) / sizeof(workload_actions[0]))
+
+/* ======== PRIVATE HELPER FUNCTIONS ======== */
+
+// splitmix64: every seed, including 0, gives a full-period stream
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double next_unit(uint64_t *state) {
+    return (double)(next_random(state) >> 11) / (double)(1ULL << 53);
+}
+
+static unsigned next_below(uint64_t *state, unsigned bound) {
+    return bound ? (unsigned)(next_random(state) % bound) : 0;
+}
+
+static bool options_valid(const WorkloadOptions *options) {
+    if (!options || options->variables == 0 || options->fanout == 0 || options->terms == 0) {
+        error_set(ERROR_INVALID_ARGUMENT, "Workload needs variables, fan-out and terms");
+        return false;
+    }
+    if (workload_categorical_count(options) > 0 && options->categories == 0) {
+        error_set(ERROR_INVALID_ARGUMENT, "Categorical variables need at least one category");
+        return false;
+    }
+    return true;
+}
+
+static double clamp_skew(double skew) {
+    if (skew < 0) return 0;
+    return skew > WORKLOAD_MAX_SKEW ? WORKLOAD_MAX_SKEW : skew;
+}
+
+static void write_indent(FILE *output, unsigned level) {
+    for (unsigned i = 0; i < level; i++) fputs("    ", output);
+}
+
+static void write_comparison(FILE *output, const WorkloadOptions *options, uint64_t *rng) {
+    static const char *numeric_ops[] = {"<", "<=", ">", ">="};
+
+    unsigned index = next_below(rng, options->variables);
+    char name[32];
+    workload_variable_name(options, index, name, sizeof(name));
+
+    if (index < options->variables - workload_categorical_count(options)) {
+        double threshold = next_unit(rng) * WORKLOAD_NUMERIC_RANGE;
+        fprintf(output, "%s %s %.2f", name, numeric_ops[next_below(rng, 4)], threshold);
+    } else {
+        fprintf(output, "%s %s \"v%u\"", name, next_below(rng, 4) ? "==" : "!=",
+                next_below(rng, options->categories));
+    }
+}
+
+static void write_decision(FILE *output, const WorkloadOptions *options, unsigned level,
+                           uint64_t *rng) {
+    write_indent(output, level);
+    fputs("if ", output);
+
+    unsigned terms = 1 + next_below(rng, options->terms);
+    for (unsigned t = 0; t < terms; t++) {
+        if (t > 0) fputs(next_below(rng, 3) ? " && " : " || ", output);
+        write_comparison(output, options, rng);
+    }
+
+    fprintf(output, " then %s else %s end\n",
+            workload_actions[next_below(rng, WORKLOAD_ACTION_COUNT)],
+            workload_actions[next_below(rng, WORKLOAD_ACTION_COUNT)]);
+}
+
+static void write_rule(FILE *output, const WorkloadOptions *options, const char *name,
+                       unsigned level, uint64_t *rng) {
+    write_indent(output, level);
+    fprintf(output, "rule %s {\n", name);
+
+    for (unsigned i = 0; i < options->fanout; i++) {
+        if (level < options->depth) {
+            char child[256];
+            snprintf(child, sizeof(child), "%s_%u", name, i);
+            write_rule(output, options, child, level + 1, rng);
+        } else {
+            write_decision(output, options, level + 1, rng);
+        }
+    }
+
+    write_indent(output, level);
+    fputs("}\n", output);
+}
+
+static double sample_numeric(double skew, uint64_t *rng) {
+    // u^(1/(1-skew)) leaves skew 0 uniform and pulls mass towards 0 above it
+    return pow(next_unit(rng), 1.0 / (1.0 - skew)) * WORKLOAD_NUMERIC_RANGE;
+}
+
+static unsigned sample_category(unsigned categories, double skew, uint64_t *rng) {
+    // Geometric weights (1 - skew)^k: equal at skew 0, v0 dominating near 1
+    double ratio = 1.0 - skew;
+    double total = 0, weight = 1;
+    for (unsigned k = 0; k < categories; k++) {
+        total += weight;
+        weight *= ratio;
+    }
+
+    double target = next_unit(rng) * total;
+    weight = 1;
+    for (unsigned k = 0; k + 1 < categories; k++) {
+        if (target < weight) return k;
+        target -= weight;
+        weight *= ratio;
+    }
+    return categories - 1;
+}
+
+/* ======== PUBLIC API IMPLEMENTATION ======== */
+
+void workload_options_default(WorkloadOptions *options) {
+    if (!options) return;
+    options->seed = 1;
+    options->rules = 100;
+    options->depth = 1;
+    options->fanout = 4;
+    options->variables = 8;
+    options->categorical = 0.25;
+    options->categories = 5;
+    options->terms = 2;
+    options->skew = 0;
+}
+
+unsigned workload_categorical_count(const WorkloadOptions *options) {
+    if (!options) return 0;
+    double fraction = options->categorical < 0 ? 0 :
+                      options->categorical > 1 ? 1 : options->categorical;
+    return (unsigned)(fraction * options->variables + 0.5);
+}
+
+void workload_variable_name(const WorkloadOptions *options, unsigned index,
+                            char *buffer, size_t size) {
+    unsigned numeric = options->variables - workload_categorical_count(options);
+    if (index < numeric) {
+        snprintf(buffer, size, "n%u", index);
+    } else {
+        snprintf(buffer, size, "c%u", index - numeric);
+    }
+}
+
+size_t workload_decision_count(const WorkloadOptions *options) {
+    if (!options) return 0;
+    size_t count = options->rules;
+    for (unsigned level = 0; level <= options->depth; level++) {
+        if (options->fanout && count > SIZE_MAX / options->fanout) return SIZE_MAX;
+        count *= options->fanout;
+    }
+    return count;
+}
+
+bool workload_write_program(FILE *output, const WorkloadOptions *options) {
+    if (!output || !options_valid(options)) return false;
+
+    fprintf(output, "# Generated workload: seed=%llu rules=%u depth=%u fanout=%u "
+            "variables=%u categorical=%u categories=%u terms=%u\n\n",
+            (unsigned long long)options->seed, options->rules, options->depth,
+            options->fanout, options->variables, workload_categorical_count(options),
+            options->categories, options->terms);
+
+    uint64_t rng = options->seed;
+    for (unsigned i = 0; i < options->rules; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "rule_%u", i);
+        write_rule(output, options, name, 0, &rng);
+        fputc('\n', output);
+    }
+
+    if (ferror(output)) {
+        error_set(ERROR_FILE_IO, "Failed to write generated program");
+        return false;
+    }
+    LOG_DEBUG("Generated %u rules, %zu decisions", options->rules,
+              workload_decision_count(options));
+    return true;
+}
+
+bool workload_write_dataset(FILE *output, const WorkloadOptions *options, size_t rows,
+                            WorkloadFormat format) {
+    if (!output || !options_valid(options)) return false;
+
+    unsigned numeric = options->variables - workload_categorical_count(options);
+    double skew = clamp_skew(options->skew);
+    uint64_t rng = options->seed ^ WORKLOAD_DATA_STREAM;
+    char name[32];
+
+    if (format == WORKLOAD_CSV) {
+        for (unsigned v = 0; v < options->variables; v++) {
+            workload_variable_name(options, v, name, sizeof(name));
+            fprintf(output, "%s%s", v > 0 ? "," : "", name);
+        }
+        fputc('\n', output);
+    }
+
+    for (size_t row = 0; row < rows; row++) {
+        if (format == WORKLOAD_JSONL) fputc('{', output);
+
+        for (unsigned v = 0; v < options->variables; v++) {
+            if (format == WORKLOAD_JSONL) {
+                workload_variable_name(options, v, name, sizeof(name));
+                fprintf(output, "%s\"%s\": ", v > 0 ? ", " : "", name);
+            } else if (v > 0) {
+                fputc(',', output);
+            }
+
+            if (v < numeric) {
+                fprintf(output, "%.4f", sample_numeric(skew, &rng));
+            } else {
+                unsigned category = sample_category(options->categories, skew, &rng);
+                fprintf(output, format == WORKLOAD_JSONL ? "\"v%u\"" : "v%u", category);
+            }
+        }
+
+        fputs(format == WORKLOAD_JSONL ? "}\n" : "\n", output);
+    }
+
+    if (ferror(output)) {
+        error_set(ERROR_FILE_IO, "Failed to write generated dataset");
+        return false;
+    }
+    return true;
+}
@@ -56,6 +56,7 @@ static void cmd_version(REPLState *repl, const char *args);
 static void cmd_reset(REPLState *repl, const char *args);
 static void cmd_coverage(REPLState *repl, const char *args);
 static void cmd_profile(REPLState *repl, const char *args);
+static void cmd_heap(REPLState *repl, const char *args);
 
 /* Command table */
 static const REPLCommand commands[] = {
@@ -75,6 +76,8 @@ static const REPLCommand commands[] = {
     {"reset", cmd_reset, "Reset the environment", ".reset"},
     {"coverage", cmd_coverage, "Show coverage information", ".coverage"},
     {"profile", cmd_profile, "Show performance profile", ".profile"},
+    {"heap", cmd_heap, "Sample heap allocations by call site",
+     ".heap [start [interval]|stop|reset|pprof <file>|speedscope <file>]"},
     {NULL, NULL, NULL, NULL} // Sentinel
 };
 
@@ -342,6 +345,53 @@ static void cmd_profile(REPLState *repl, const char *args) {
     printf("Performance profiling not implemented yet\n");
 }
 
+static void cmd_heap(REPLState *repl, const char *args) {
+    if (!args || *args == '\0') {
+        if (!memory_heap_profile_dump(stdout, HEAP_PROFILE_TEXT)) {
+            printf("Heap profiler is not running. Use '.heap start' first.\n");
+        }
+        return;
+    }
+    
+    char action[32] = {0};
+    char operand[1024] = {0};
+    sscanf(args, "%31s %1023s", action, operand);
+    
+    if (strcmp(action, "start") == 0) {
+        size_t interval = *operand ? (size_t)strtoull(operand, NULL, 10) : 0;
+        memory_heap_profile_start(interval);
+        printf("Heap profiler started (1 sample per ~%zu bytes)\n",
+               interval ? interval : (size_t)HEAP_PROFILE_DEFAULT_INTERVAL);
+    } else if (strcmp(action, "stop") == 0) {
+        memory_heap_profile_stop();
+        printf("Heap profiler stopped\n");
+    } else if (strcmp(action, "reset") == 0) {
+        memory_heap_profile_reset();
+        printf("Heap profile cleared\n");
+    } else if (strcmp(action, "pprof") == 0 || strcmp(action, "speedscope") == 0) {
+        if (*operand == '\0') {
+            printf("Usage: .heap %s <file>\n", action);
+            return;
+        }
+        if (!memory_heap_profile_active()) {
+            printf("Heap profiler is not running. Use '.heap start' first.\n");
+            return;
+        }
+        
+        FILE *f = fopen(operand, "w");
+        if (!f) {
+            printf("Error: Could not open file for writing: %s\n", operand);
+            return;
+        }
+        memory_heap_profile_dump(f, strcmp(action, "pprof") == 0 ?
+                                 HEAP_PROFILE_PPROF : HEAP_PROFILE_SPEEDSCOPE);
+        fclose(f);
+        printf("Heap profile written to: %s\n", operand);
+    } else {
+        printf("Usage: .heap [start [interval]|stop|reset|pprof <file>|speedscope <file>]\n");
+    }
+}
+
 /* ======== PUBLIC API ======== */
 
 void handle_repl_command(REPLState *repl, const char *input) {
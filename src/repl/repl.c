@@ -19,6 +19,7 @@
 #include "reasons/eval.h"
 #include "reasons/parser.h"
 #include "reasons/lexer.h"
+#include "reasons/incremental.h"
 #include "reasons/runtime.h"
 #include "reasons/debugger.h"
 #include "repl/commands.h"
@@ -47,6 +48,7 @@ struct REPLState {
     unsigned line_count;         // Input line counter
     char *last_error;            // Last error message
     char *current_script;        // Currently loaded script
+    incremental_doc_t *script_doc; // Parsed script, kept for reloads
     vector_t *input_buffer;      // For multiline input
 };
 
@@ -81,6 +83,7 @@ static void cleanup_repl(REPLState *repl) {
     // Free other resources
     if (repl->last_error) mem_free(repl->last_error);
     if (repl->current_script) mem_free(repl->current_script);
+    incremental_destroy(repl->script_doc);
 }
 
 static bool is_incomplete_input(const char *input) {
@@ -240,6 +243,86 @@ static void handle_input(REPLState *repl, const char *input) {
     lexer_destroy(lexer);
 }
 
+// `use` paths in a loaded script are relative to the script
+static void script_base_dir(const char *path, char *base_dir, size_t size) {
+    const char *slash = strrchr(path, '/');
+    size_t dir_length = slash ? (size_t)(slash - path) : 0;
+    if (dir_length == 0 || dir_length >= size) {
+        snprintf(base_dir, size, "%s", slash ? "/" : ".");
+    } else {
+        memcpy(base_dir, path, dir_length);
+        base_dir[dir_length] = '\0';
+    }
+}
+
+// Scripts containing .commands are REPL sessions, never declaration files
+static bool has_repl_commands(const char *script) {
+    const char *line = script;
+    while (*line) {
+        while (*line == ' ' || *line == '\t') line++;
+        if (*line == '.') return true;
+        const char *newline = strchr(line, '\n');
+        if (!newline) break;
+        line = newline + 1;
+    }
+    return false;
+}
+
+// Runs a script through the incremental document when it consists only of
+// top-level declarations; false, having evaluated nothing, for anything
+// else (including syntax errors, which the line-by-line path reports)
+static bool load_declarations(REPLState *repl, const char *script, bool reload) {
+    if (has_repl_commands(script)) return false;
+    
+    bool parsed;
+    if (reload) {
+        parsed = incremental_update(repl->script_doc, script);
+    } else {
+        incremental_destroy(repl->script_doc);
+        repl->script_doc = incremental_create(script);
+        parsed = repl->script_doc && !incremental_has_errors(repl->script_doc);
+    }
+    if (!parsed) return false;
+    
+    if (repl->verbose) {
+        incremental_statistics_t stats;
+        incremental_get_statistics(repl->script_doc, &stats);
+        printf("Parsed %zu declarations (%zu reparsed, %zu unchanged), "
+               "%zu of %zu tokens re-lexed in %.3f ms\n",
+               stats.declarations_total, stats.declarations_reparsed,
+               stats.declarations_reused, stats.tokens_relexed, stats.tokens_total,
+               stats.update_ms);
+    }
+    
+    // Evaluate the whole program
+    reasons_value_t result = eval_node(repl->eval_ctx, incremental_program(repl->script_doc));
+    if (result.type != VALUE_VOID) {
+        printf("=> ");
+        reasons_value_print(&result, stdout);
+        printf("\n");
+    }
+    reasons_value_free(&result);
+    return true;
+}
+
+static void run_script_lines(REPLState *repl, char *script) {
+    // Process each line
+    char *saveptr;
+    char *line = strtok_r(script, "\n", &saveptr);
+    while (line) {
+        // Skip empty lines and comments
+        if (*line != '\0' && *line != '#') {
+            char *trimmed = string_trim(line);
+            if (*trimmed != '\0') {
+                // Handle input line
+                handle_input(repl, trimmed);
+            }
+            mem_free(trimmed);
+        }
+        line = strtok_r(NULL, "\n", &saveptr);
+    }
+}
+
 static void print_welcome_banner() {
     printf("\n");
     printf("=============================================\n");
@@ -365,28 +448,27 @@ void repl_load_script(REPLState *repl, const char *filename) {
         return;
     }
     
+    // Reloading the same script only reparses the declarations that changed
+    bool reload = repl->script_doc && repl->current_script &&
+                  strcmp(repl->current_script, filename) == 0;
+    
     // Update current script
     if (repl->current_script) mem_free(repl->current_script);
     repl->current_script = string_duplicate(filename);
     
-    printf("Loading script: %s\n", filename);
+    printf("%s script: %s\n", reload ? "Reloading" : "Loading", filename);
     
-    // Process each line
-    char *saveptr;
-    char *line = strtok_r(script, "\n", &saveptr);
-    while (line) {
-        // Skip empty lines and comments
-        if (*line != '\0' && *line != '#') {
-            char *trimmed = string_trim(line);
-            if (*trimmed != '\0') {
-                // Handle input line
-                handle_input(repl, trimmed);
-            }
-            mem_free(trimmed);
-        }
-        line = strtok_r(NULL, "\n", &saveptr);
-    }
+    char base_dir[1024];
+    script_base_dir(filename, base_dir, sizeof(base_dir));
+    eval_set_base_dir(repl->eval_ctx, base_dir);
     
+    if (!load_declarations(repl, script, reload)) {
+        // Not a pure declaration file: run it as typed input
+        incremental_destroy(repl->script_doc);
+        repl->script_doc = NULL;
+        error_clear();
+        run_script_lines(repl, script);
+    }
     mem_free(script);
 }
 
@@ -0,0 +1,441 @@
+/*
+ * bench.c - Benchmark Harness for Reasons DSL
+ *
+ * Features:
+ * - Batch calibration so short operations are timed above clock resolution
+ * - Warmup samples discarded before recording
+ * - Per-sample timings kept for later statistical comparison
+ * - Median, percentile, mean and spread summaries
+ * - Table and JSON output
+ * - Baseline comparison: Mann-Whitney U test and Hodges-Lehmann
+ *   confidence intervals on the per-sample timings
+ */
+
+#include "utils/bench.h"
+#include "utils/memory.h"
+#include "utils/string_utils.h"
+#include "utils/error.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define BENCH_MAX_BATCH ((size_t)1 << 30)
+
+/* ======== GLOBAL VARIABLES ======== */
+
+static volatile size_t bench_sink;
+
+/* ======== PRIVATE HELPER FUNCTIONS ======== */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double time_batch(const BenchCase *bench, void *state, size_t batch, size_t *items) {
+    double start = now_seconds();
+    for (size_t i = 0; i < batch; i++) {
+        *items = bench->run(state);
+    }
+    return now_seconds() - start;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void write_json_string(FILE *output, const char *str) {
+    fputc('"', output);
+    for (const char *p = str ? str : ""; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(output, "\\%c", *p);
+        } else if ((unsigned char)*p < 0x20) {
+            fprintf(output, "\\u%04x", (unsigned char)*p);
+        } else {
+            fputc(*p, output);
+        }
+    }
+    fputc('"', output);
+}
+
+typedef struct {
+    double value;
+    bool from_a;
+} RankedSample;
+
+static int compare_ranked(const void *a, const void *b) {
+    return compare_doubles(&((const RankedSample*)a)->value, &((const RankedSample*)b)->value);
+}
+
+static double normal_upper_tail(double z) {
+    return 0.5 * erfc(z / sqrt(2.0));
+}
+
+// z with P(Z > z) = tail, by bisection; precise enough for interval ranks
+static double normal_quantile(double tail) {
+    double low = 0, high = 40;
+    for (int i = 0; i < 100; i++) {
+        double mid = (low + high) / 2;
+        if (normal_upper_tail(mid) > tail) low = mid;
+        else high = mid;
+    }
+    return (low + high) / 2;
+}
+
+static const char* verdict_name(BenchVerdict verdict) {
+    switch (verdict) {
+        case BENCH_IMPROVED: return "improved";
+        case BENCH_REGRESSED: return "REGRESSED";
+        default: return "unchanged";
+    }
+}
+
+static void format_duration(char *buffer, size_t size, double ns) {
+    if (ns < 1e3) {
+        snprintf(buffer, size, "%.1f ns", ns);
+    } else if (ns < 1e6) {
+        snprintf(buffer, size, "%.2f us", ns / 1e3);
+    } else if (ns < 1e9) {
+        snprintf(buffer, size, "%.2f ms", ns / 1e6);
+    } else {
+        snprintf(buffer, size, "%.2f s", ns / 1e9);
+    }
+}
+
+/* ======== PUBLIC API IMPLEMENTATION ======== */
+
+void bench_options_default(BenchOptions *options) {
+    if (!options) return;
+    options->warmup = 3;
+    options->repetitions = 15;
+    options->min_sample_time = 0.01;
+}
+
+bool bench_run(const BenchCase *bench, const BenchOptions *options, BenchResult *result) {
+    if (!bench || !bench->run || !result) {
+        error_set(ERROR_INVALID_ARGUMENT, "Invalid benchmark");
+        return false;
+    }
+
+    BenchOptions defaults;
+    if (!options) {
+        bench_options_default(&defaults);
+        options = &defaults;
+    }
+
+    memset(result, 0, sizeof(BenchResult));
+    result->name = string_dup(bench->name);
+    result->item_unit = bench->item_unit;
+    size_t repetitions = options->repetitions > 0 ? options->repetitions : 1;
+    result->samples = mem_alloc(repetitions * sizeof(double));
+    if (!result->name || !result->samples) {
+        bench_result_free(result);
+        return false;
+    }
+
+    void *state = bench->setup ? bench->setup(bench->param) : NULL;
+    if (bench->setup && !state) {
+        bench_result_free(result);
+        return false;
+    }
+
+    // Calibrate: the first batch that lasts long enough also warms up
+    size_t batch = 1;
+    size_t items = 0;
+    while (time_batch(bench, state, batch, &items) < options->min_sample_time &&
+           batch < BENCH_MAX_BATCH) {
+        batch *= 2;
+    }
+
+    for (unsigned i = 0; i < options->warmup; i++) {
+        time_batch(bench, state, batch, &items);
+    }
+
+    for (size_t i = 0; i < repetitions; i++) {
+        double elapsed = time_batch(bench, state, batch, &items);
+        result->samples[i] = elapsed * 1e9 / (double)batch;
+    }
+
+    if (bench->teardown) bench->teardown(state);
+
+    result->batch = batch;
+    result->items = items;
+    result->sample_count = repetitions;
+    bench_summarize(result);
+    return true;
+}
+
+void bench_result_free(BenchResult *result) {
+    if (!result) return;
+    mem_free(result->name);
+    mem_free(result->samples);
+    result->name = NULL;
+    result->samples = NULL;
+    result->sample_count = 0;
+}
+
+void bench_summarize(BenchResult *result) {
+    if (!result || result->sample_count == 0) return;
+
+    size_t count = result->sample_count;
+    double *sorted = mem_alloc(count * sizeof(double));
+    if (!sorted) return;
+    memcpy(sorted, result->samples, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), compare_doubles);
+
+    double sum = 0;
+    for (size_t i = 0; i < count; i++) sum += sorted[i];
+    double mean = sum / (double)count;
+
+    double squares = 0;
+    for (size_t i = 0; i < count; i++) squares += (sorted[i] - mean) * (sorted[i] - mean);
+
+    result->min = sorted[0];
+    result->max = sorted[count - 1];
+    result->mean = mean;
+    result->stddev = count > 1 ? sqrt(squares / (double)(count - 1)) : 0;
+    result->median = bench_percentile(sorted, count, 50);
+    result->p90 = bench_percentile(sorted, count, 90);
+    result->p99 = bench_percentile(sorted, count, 99);
+    result->items_per_second = result->median > 0 ?
+        (double)result->items * 1e9 / result->median : 0;
+
+    mem_free(sorted);
+}
+
+double bench_percentile(const double *sorted, size_t count, double percentile) {
+    if (!sorted || count == 0) return 0;
+    if (percentile <= 0) return sorted[0];
+    if (percentile >= 100) return sorted[count - 1];
+
+    double rank = percentile / 100.0 * (double)(count - 1);
+    size_t lower = (size_t)rank;
+    double fraction = rank - (double)lower;
+    if (lower + 1 >= count) return sorted[count - 1];
+    return sorted[lower] + fraction * (sorted[lower + 1] - sorted[lower]);
+}
+
+void bench_print_table(FILE *output, const BenchResult *results, size_t count) {
+    if (!output) return;
+
+    fprintf(output, "%-36s %12s %12s %12s %8s %16s\n",
+            "benchmark", "median", "p90", "p99", "cv", "throughput");
+
+    for (size_t i = 0; i < count; i++) {
+        const BenchResult *r = &results[i];
+        char median[32], p90[32], p99[32], throughput[48];
+        format_duration(median, sizeof(median), r->median);
+        format_duration(p90, sizeof(p90), r->p90);
+        format_duration(p99, sizeof(p99), r->p99);
+
+        if (r->items > 0 && r->item_unit) {
+            double rate = r->items_per_second;
+            const char *scale = "";
+            if (rate >= 1e9) { rate /= 1e9; scale = "G"; }
+            else if (rate >= 1e6) { rate /= 1e6; scale = "M"; }
+            else if (rate >= 1e3) { rate /= 1e3; scale = "K"; }
+            snprintf(throughput, sizeof(throughput), "%.2f%s %s/s", rate, scale, r->item_unit);
+        } else {
+            snprintf(throughput, sizeof(throughput), "-");
+        }
+
+        double cv = r->mean > 0 ? r->stddev / r->mean * 100.0 : 0;
+        fprintf(output, "%-36s %12s %12s %12s %7.1f%% %16s\n",
+                r->name, median, p90, p99, cv, throughput);
+    }
+}
+
+bool bench_write_json(FILE *output, const BenchResult *results, size_t count,
+                      const BenchOptions *options) {
+    if (!output) return false;
+
+    BenchOptions defaults;
+    if (!options) {
+        bench_options_default(&defaults);
+        options = &defaults;
+    }
+
+    char created[32];
+    time_t now = time(NULL);
+    strftime(created, sizeof(created), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    fprintf(output, "{\n");
+    fprintf(output, "  \"format\": \"reasons-bench\",\n");
+    fprintf(output, "  \"version\": 1,\n");
+    fprintf(output, "  \"created\": \"%s\",\n", created);
+    fprintf(output, "  \"options\": {\"warmup\": %u, \"repetitions\": %u, \"min_sample_time\": %.6f},\n",
+            options->warmup, options->repetitions, options->min_sample_time);
+    fprintf(output, "  \"benchmarks\": [");
+
+    for (size_t i = 0; i < count; i++) {
+        const BenchResult *r = &results[i];
+        fprintf(output, "%s\n    {\n      \"name\": ", i > 0 ? "," : "");
+        write_json_string(output, r->name);
+        fprintf(output, ",\n      \"unit\": \"ns\",\n      \"item_unit\": ");
+        write_json_string(output, r->item_unit);
+        fprintf(output, ",\n      \"batch\": %zu,\n      \"items\": %zu,\n", r->batch, r->items);
+        fprintf(output, "      \"min\": %.3f,\n      \"median\": %.3f,\n      \"mean\": %.3f,\n",
+                r->min, r->median, r->mean);
+        fprintf(output, "      \"p90\": %.3f,\n      \"p99\": %.3f,\n      \"max\": %.3f,\n",
+                r->p90, r->p99, r->max);
+        fprintf(output, "      \"stddev\": %.3f,\n      \"items_per_second\": %.3f,\n",
+                r->stddev, r->items_per_second);
+        fprintf(output, "      \"samples\": [");
+        for (size_t s = 0; s < r->sample_count; s++) {
+            fprintf(output, "%s%.3f", s > 0 ? ", " : "", r->samples[s]);
+        }
+        fprintf(output, "]\n    }");
+    }
+
+    fprintf(output, "%s]\n}\n", count > 0 ? "\n  " : "");
+    return !ferror(output);
+}
+
+void bench_compare_options_default(BenchCompareOptions *options) {
+    if (!options) return;
+    options->threshold = 0.05;
+    options->alpha = 0.01;
+}
+
+double bench_mann_whitney(const double *a, size_t count_a, const double *b, size_t count_b) {
+    if (!a || !b || count_a == 0 || count_b == 0) return 1.0;
+
+    size_t total = count_a + count_b;
+    RankedSample *ranked = mem_alloc(total * sizeof(RankedSample));
+    if (!ranked) return 1.0;
+    for (size_t i = 0; i < count_a; i++) ranked[i] = (RankedSample){a[i], true};
+    for (size_t i = 0; i < count_b; i++) ranked[count_a + i] = (RankedSample){b[i], false};
+    qsort(ranked, total, sizeof(RankedSample), compare_ranked);
+
+    // Rank sum of a, ties sharing their average rank
+    double rank_sum = 0;
+    double tie_term = 0;
+    for (size_t i = 0; i < total; ) {
+        size_t j = i + 1;
+        while (j < total && ranked[j].value == ranked[i].value) j++;
+        double rank = (double)(i + 1 + j) / 2;
+        for (size_t k = i; k < j; k++) {
+            if (ranked[k].from_a) rank_sum += rank;
+        }
+        double ties = (double)(j - i);
+        tie_term += ties * ties * ties - ties;
+        i = j;
+    }
+    mem_free(ranked);
+
+    double n1 = (double)count_a;
+    double n2 = (double)count_b;
+    double n = (double)total;
+    double u = rank_sum - n1 * (n1 + 1) / 2;
+    double variance = n1 * n2 / 12 * ((n + 1) - tie_term / (n * (n - 1)));
+    if (variance <= 0) return 1.0;
+
+    // Continuity-corrected, two-sided
+    double z = (fabs(u - n1 * n2 / 2) - 0.5) / sqrt(variance);
+    if (z < 0) z = 0;
+    double p = 2 * normal_upper_tail(z);
+    return p > 1 ? 1 : p;
+}
+
+bool bench_compare(const BenchResult *baseline, const BenchResult *candidate,
+                   const BenchCompareOptions *options, BenchComparison *comparison) {
+    if (!baseline || !candidate || !comparison ||
+        baseline->sample_count == 0 || candidate->sample_count == 0) {
+        return false;
+    }
+
+    BenchCompareOptions defaults;
+    if (!options) {
+        bench_compare_options_default(&defaults);
+        options = &defaults;
+    }
+
+    memset(comparison, 0, sizeof(BenchComparison));
+    comparison->name = candidate->name;
+    comparison->baseline_median = baseline->median;
+    comparison->candidate_median = candidate->median;
+    comparison->p_value = bench_mann_whitney(baseline->samples, baseline->sample_count,
+                                             candidate->samples, candidate->sample_count);
+
+    // Hodges-Lehmann: every candidate/baseline ratio, sorted
+    size_t n1 = baseline->sample_count;
+    size_t n2 = candidate->sample_count;
+    size_t pairs = n1 * n2;
+    double *ratios = mem_alloc(pairs * sizeof(double));
+    if (!ratios) return false;
+    for (size_t i = 0; i < n1; i++) {
+        double base = baseline->samples[i] > 0 ? baseline->samples[i] : 1e-9;
+        for (size_t j = 0; j < n2; j++) {
+            ratios[i * n2 + j] = candidate->samples[j] / base;
+        }
+    }
+    qsort(ratios, pairs, sizeof(double), compare_doubles);
+
+    // The interval excludes the k - 1 smallest and largest ratios
+    double z = normal_quantile(options->alpha / 2);
+    double k = floor((double)pairs / 2 -
+                     z * sqrt((double)n1 * (double)n2 * (double)(n1 + n2 + 1) / 12));
+    size_t skip = k > 1 ? (size_t)k - 1 : 0;
+    if (skip >= (pairs + 1) / 2) skip = (pairs - 1) / 2;
+
+    comparison->change = bench_percentile(ratios, pairs, 50) - 1;
+    comparison->change_low = ratios[skip] - 1;
+    comparison->change_high = ratios[pairs - 1 - skip] - 1;
+    mem_free(ratios);
+
+    comparison->verdict = BENCH_UNCHANGED;
+    if (comparison->p_value < options->alpha) {
+        if (comparison->change > options->threshold) {
+            comparison->verdict = BENCH_REGRESSED;
+        } else if (comparison->change < -options->threshold) {
+            comparison->verdict = BENCH_IMPROVED;
+        }
+    }
+    return true;
+}
+
+void bench_print_comparison(FILE *output, const BenchComparison *comparisons, size_t count,
+                            const BenchCompareOptions *options) {
+    if (!output) return;
+
+    BenchCompareOptions defaults;
+    if (!options) {
+        bench_compare_options_default(&defaults);
+        options = &defaults;
+    }
+
+    char confidence[32];
+    snprintf(confidence, sizeof(confidence), "%g%% CI", (1 - options->alpha) * 100);
+    fprintf(output, "%-36s %12s %12s %9s %19s %9s  %s\n",
+            "benchmark", "baseline", "candidate", "change", confidence, "p", "verdict");
+
+    size_t regressed = 0, improved = 0;
+    for (size_t i = 0; i < count; i++) {
+        const BenchComparison *c = &comparisons[i];
+        char baseline[32], candidate[32], interval[48];
+        format_duration(baseline, sizeof(baseline), c->baseline_median);
+        format_duration(candidate, sizeof(candidate), c->candidate_median);
+        snprintf(interval, sizeof(interval), "[%+.1f%%, %+.1f%%]",
+                 c->change_low * 100, c->change_high * 100);
+
+        fprintf(output, "%-36s %12s %12s %+8.1f%% %19s %9.2g  %s\n",
+                c->name, baseline, candidate, c->change * 100, interval, c->p_value,
+                verdict_name(c->verdict));
+
+        if (c->verdict == BENCH_REGRESSED) regressed++;
+        if (c->verdict == BENCH_IMPROVED) improved++;
+    }
+
+    fprintf(output, "\n%zu regressed, %zu improved, %zu unchanged (threshold %.1f%%, alpha %g)\n",
+            regressed, improved, count - regressed - improved,
+            options->threshold * 100, options->alpha);
+}
+
+void bench_consume(size_t value) {
+    bench_sink += value;
+}
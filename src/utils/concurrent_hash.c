@@ -0,0 +1,230 @@
+/*
+ * concurrent_hash.c - Sharded Concurrent Hash Table for Reasons DSL
+ *
+ * Features:
+ * - Keys spread over power-of-two shards by hash
+ * - Reader-writer lock per shard: concurrent lookups never block each other
+ * - Shards padded to cache lines to avoid false sharing between locks
+ * - Copy-out lookups that stay safe under concurrent updates and never
+ *   read past the stored value
+ * - Same key/value copying semantics as the hashtable_* API
+ */
+
+#include "utils/concurrent_hash.h"
+#include "utils/hash.h"
+#include "utils/memory.h"
+#include "utils/logger.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/* ======== CONSTANTS ======== */
+
+#define CACHE_LINE_SIZE 64
+#define DEFAULT_SHARDS_PER_CPU 4
+#define MIN_SHARDS 8
+#define MAX_SHARDS 1024
+
+/* ======== STRUCTURE DEFINITIONS ======== */
+
+typedef struct {
+    pthread_rwlock_t lock;
+    HashTable *table;
+    // Keep neighbouring shard locks on separate cache lines
+    char padding[CACHE_LINE_SIZE -
+                 (sizeof(pthread_rwlock_t) + sizeof(HashTable*)) % CACHE_LINE_SIZE];
+} HashShard;
+
+// Stored values carry their size so lookups copy no more than was stored
+typedef union {
+    size_t size;
+    double align_double;        // Keep the payload aligned for any scalar
+    void *align_pointer;
+} ValueHeader;
+
+typedef struct {
+    HashIterCallback callback;
+    void *user_data;
+} IterateAdapter;
+
+struct ConcurrentHashTable {
+    HashShard *shards;
+    size_t shard_count;         // Power of 2
+    size_t shard_mask;
+    HashFunction hash_func;
+};
+
+/* ======== PRIVATE HELPER FUNCTIONS ======== */
+
+static uint32_t default_hash(const void *key, size_t key_size) {
+    // FNV-1a hash
+    const unsigned char *bytes = key;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < key_size; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619;
+    }
+    return hash;
+}
+
+static size_t default_shard_count(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    return (size_t)cpus * DEFAULT_SHARDS_PER_CPU;
+}
+
+static inline HashShard* shard_for(ConcurrentHashTable *table, const void *key, size_t key_size) {
+    // The inner tables index by the low bits of their own mixed hash, so the
+    // shard is picked from the high bits to keep the two independent
+    uint32_t hash = table->hash_func(key, key_size);
+    hash ^= hash >> 15;
+    hash *= 0x2c1b3c6d;
+    hash ^= hash >> 12;
+    return &table->shards[(hash >> 16) & table->shard_mask];
+}
+
+static void iterate_stored(const void *key, size_t key_size, void *value, void *user_data) {
+    IterateAdapter *adapter = user_data;
+    adapter->callback(key, key_size, (ValueHeader*)value + 1, adapter->user_data);
+}
+
+/* ======== PUBLIC API IMPLEMENTATION ======== */
+
+ConcurrentHashTable* concurrent_hashtable_create(size_t initial_capacity, size_t shard_count,
+                                                 HashFunction hash_func) {
+    ConcurrentHashTable *table = mem_alloc(sizeof(ConcurrentHashTable));
+    if (!table) return NULL;
+    
+    size_t wanted = shard_count > 0 ? shard_count : default_shard_count();
+    size_t count = 1;
+    while (count < wanted && count < MAX_SHARDS) count <<= 1;
+    if (shard_count == 0 && count < MIN_SHARDS) count = MIN_SHARDS;
+    
+    // The padding only separates locks if the array starts on a cache
+    // line, which mem_alloc does not promise: shards come from the system
+    // allocator, aligned
+    void *shards = NULL;
+    if (posix_memalign(&shards, CACHE_LINE_SIZE, count * sizeof(HashShard)) != 0) {
+        mem_free(table);
+        return NULL;
+    }
+    table->shards = shards;
+    
+    table->shard_count = count;
+    table->shard_mask = count - 1;
+    table->hash_func = hash_func ? hash_func : default_hash;
+    
+    size_t per_shard = initial_capacity / count + 1;
+    for (size_t i = 0; i < count; i++) {
+        HashShard *shard = &table->shards[i];
+        shard->table = hashtable_create(per_shard * 2, hash_func);
+        if (!shard->table || pthread_rwlock_init(&shard->lock, NULL) != 0) {
+            LOG_ERROR("Failed to initialize shard %zu of concurrent hash table", i);
+            if (shard->table) hashtable_destroy(shard->table);
+            for (size_t j = 0; j < i; j++) {
+                pthread_rwlock_destroy(&table->shards[j].lock);
+                hashtable_destroy(table->shards[j].table);
+            }
+            free(table->shards);
+            mem_free(table);
+            return NULL;
+        }
+    }
+    
+    return table;
+}
+
+void concurrent_hashtable_destroy(ConcurrentHashTable *table) {
+    if (!table) return;
+    
+    for (size_t i = 0; i < table->shard_count; i++) {
+        pthread_rwlock_destroy(&table->shards[i].lock);
+        hashtable_destroy(table->shards[i].table);
+    }
+    free(table->shards);
+    mem_free(table);
+}
+
+void concurrent_hashtable_set(ConcurrentHashTable *table, const void *key, size_t key_size,
+                              const void *value, size_t value_size) {
+    if (!table || !key || key_size == 0) return;
+    
+    // Framed outside the lock; the inner table copies the frame
+    size_t stored_size = sizeof(ValueHeader) + value_size;
+    ValueHeader *stored = mem_alloc(stored_size);
+    if (!stored) return;
+    stored->size = value_size;
+    if (value_size > 0) memcpy(stored + 1, value, value_size);
+    
+    HashShard *shard = shard_for(table, key, key_size);
+    pthread_rwlock_wrlock(&shard->lock);
+    hashtable_set(shard->table, key, key_size, stored, stored_size);
+    pthread_rwlock_unlock(&shard->lock);
+    
+    mem_free(stored);
+}
+
+bool concurrent_hashtable_get(ConcurrentHashTable *table, const void *key, size_t key_size,
+                              void *value_out, size_t value_size) {
+    if (!table || !key || key_size == 0) return false;
+    
+    HashShard *shard = shard_for(table, key, key_size);
+    pthread_rwlock_rdlock(&shard->lock);
+    ValueHeader *value = hashtable_get(shard->table, key, key_size);
+    if (value && value_out && value_size > 0) {
+        memcpy(value_out, value + 1, value->size < value_size ? value->size : value_size);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    
+    return value != NULL;
+}
+
+bool concurrent_hashtable_remove(ConcurrentHashTable *table, const void *key, size_t key_size) {
+    if (!table || !key || key_size == 0) return false;
+    
+    HashShard *shard = shard_for(table, key, key_size);
+    pthread_rwlock_wrlock(&shard->lock);
+    bool removed = hashtable_remove(shard->table, key, key_size);
+    pthread_rwlock_unlock(&shard->lock);
+    
+    return removed;
+}
+
+size_t concurrent_hashtable_size(ConcurrentHashTable *table) {
+    if (!table) return 0;
+    
+    size_t total = 0;
+    for (size_t i = 0; i < table->shard_count; i++) {
+        HashShard *shard = &table->shards[i];
+        pthread_rwlock_rdlock(&shard->lock);
+        total += hashtable_size(shard->table);
+        pthread_rwlock_unlock(&shard->lock);
+    }
+    return total;
+}
+
+void concurrent_hashtable_clear(ConcurrentHashTable *table) {
+    if (!table) return;
+    
+    for (size_t i = 0; i < table->shard_count; i++) {
+        HashShard *shard = &table->shards[i];
+        pthread_rwlock_wrlock(&shard->lock);
+        hashtable_clear(shard->table);
+        pthread_rwlock_unlock(&shard->lock);
+    }
+}
+
+void concurrent_hashtable_iterate(ConcurrentHashTable *table, HashIterCallback callback,
+                                  void *user_data) {
+    if (!table || !callback) return;
+    
+    IterateAdapter adapter = { callback, user_data };
+    for (size_t i = 0; i < table->shard_count; i++) {
+        HashShard *shard = &table->shards[i];
+        pthread_rwlock_rdlock(&shard->lock);
+        hashtable_iterate(shard->table, iterate_stored, &adapter);
+        pthread_rwlock_unlock(&shard->lock);
+    }
+}
@@ -2,13 +2,13 @@
  * hash.c - Comprehensive Hash Table Implementation for Reasons DSL
  *
  * Features:
- * - Open addressing with linear probing
+ * - Open addressing over power-of-two tables (no modulo on probes)
+ * - SwissTable-style control bytes matched 16 at a time (SSE2 or scalar)
+ * - Cached hashes: resizes and deletions never rehash keys
+ * - Tombstone-free deletion via backward shifting
  * - Automatic resizing
  * - Custom hash functions
- * - Key deletion support
  * - Key iteration
- * - Memory efficiency
- * - Statistics collection
  * - Thread safety option
  */
 
@@ -16,28 +16,41 @@
 #include "utils/memory.h"
 #include "utils/error.h"
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASH_USE_SSE2 1
+#endif
+
 /* ======== CONSTANTS ======== */
 
 #define INITIAL_CAPACITY 16
-#define LOAD_FACTOR 0.75
+#define GROUP_WIDTH 16              // Control bytes examined per probe step
+#define MAX_LOAD_NUM 3              // Maximum load factor 3/4
+#define MAX_LOAD_DEN 4
 #define GROWTH_FACTOR 2
 
+#define CTRL_EMPTY 0x80             // Only control value with the high bit set
+#define H1(hash) ((hash) >> 7)      // Home slot bits
+#define H2(hash) ((uint8_t)((hash) & 0x7F)) // Tag stored in the control byte
+
 /* ======== STRUCTURE DEFINITIONS ======== */
 
 typedef struct HashEntry {
     void *key;
     void *value;
     size_t key_size;
-    bool deleted;
+    uint32_t hash;                  // Cached (mixed) hash of the key
 } HashEntry;
 
 struct HashTable {
+    uint8_t *ctrl;                  // capacity + GROUP_WIDTH control bytes
     HashEntry *entries;
-    size_t capacity;
+    size_t capacity;                // Always a power of two
+    size_t mask;                    // capacity - 1
     size_t size;
-    size_t deleted_count;
     HashFunction hash_func;
     bool thread_safe;
     pthread_mutex_t lock;
@@ -56,63 +69,199 @@ static uint32_t default_hash(const void *key, size_t key_size) {
     return hash;
 }
 
-static bool keys_equal(const void *key1, size_t key1_size, 
+static inline uint32_t mix_hash(uint32_t hash) {
+    // Murmur3 finalizer: both the home slot and the tag need well-spread bits,
+    // even when a custom hash function is weak in its low bits
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+static bool keys_equal(const void *key1, size_t key1_size,
                       const void *key2, size_t key2_size) {
     if (key1_size != key2_size) return false;
     return memcmp(key1, key2, key1_size) == 0;
 }
 
-static void hash_table_resize(HashTable *table, size_t new_capacity) {
-    HashEntry *new_entries = mem_calloc(new_capacity, sizeof(HashEntry));
-    if (!new_entries) return;
+static size_t round_up_capacity(size_t capacity) {
+    size_t cap = INITIAL_CAPACITY;
+    while (cap < capacity) cap <<= 1;
+    return cap;
+}
+
+/* Bit i is set when control byte i of the group equals h2 */
+static inline uint32_t group_match(const uint8_t *group, uint8_t h2) {
+#ifdef HASH_USE_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)h2)));
+#else
+    uint32_t bits = 0;
+    for (int i = 0; i < GROUP_WIDTH; i++) {
+        if (group[i] == h2) bits |= 1u << i;
+    }
+    return bits;
+#endif
+}
+
+/* Bit i is set when control byte i of the group is empty */
+static inline uint32_t group_match_empty(const uint8_t *group) {
+#ifdef HASH_USE_SSE2
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+    uint32_t bits = 0;
+    for (int i = 0; i < GROUP_WIDTH; i++) {
+        if (group[i] & CTRL_EMPTY) bits |= 1u << i;
+    }
+    return bits;
+#endif
+}
+
+static inline int lowest_bit(uint32_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(bits);
+#else
+    int index = 0;
+    while (!(bits & 1u)) {
+        bits >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+static inline void set_ctrl(HashTable *table, size_t index, uint8_t value) {
+    table->ctrl[index] = value;
+    // The first group is mirrored past the end so probes can load 16 bytes
+    // from any slot without wrapping
+    if (index < GROUP_WIDTH) {
+        table->ctrl[table->capacity + index] = value;
+    }
+}
+
+/* Returns the slot holding key, or SIZE_MAX. *insert_at receives the first
+ * empty slot of the probe run when the key is absent. */
+static size_t find_slot(HashTable *table, const void *key, size_t key_size,
+                        uint32_t hash, size_t *insert_at) {
+    uint8_t h2 = H2(hash);
+    size_t pos = H1(hash) & table->mask;
     
-    // Rehash all entries
-    for (size_t i = 0; i < table->capacity; i++) {
-        HashEntry *entry = &table->entries[i];
-        if (entry->key && !entry->deleted) {
-            uint32_t hash = table->hash_func(entry->key, entry->key_size);
-            size_t index = hash % new_capacity;
-            
-            // Find empty slot
-            while (new_entries[index].key) {
-                index = (index + 1) % new_capacity;
+    // Linear probing, one group of control bytes at a time; the load factor
+    // guarantees an empty slot, so the loop always terminates
+    for (;;) {
+        const uint8_t *group = table->ctrl + pos;
+        
+        uint32_t matches = group_match(group, h2);
+        while (matches) {
+            size_t index = (pos + lowest_bit(matches)) & table->mask;
+            HashEntry *entry = &table->entries[index];
+            if (entry->hash == hash &&
+                keys_equal(key, key_size, entry->key, entry->key_size)) {
+                return index;
             }
-            
-            new_entries[index] = *entry;
+            matches &= matches - 1;
+        }
+        
+        uint32_t empty = group_match_empty(group);
+        if (empty) {
+            if (insert_at) *insert_at = (pos + lowest_bit(empty)) & table->mask;
+            return SIZE_MAX;
         }
+        
+        pos = (pos + GROUP_WIDTH) & table->mask;
+    }
+}
+
+/* First empty slot of the probe run, for keys known to be absent */
+static size_t find_empty_slot(HashTable *table, uint32_t hash) {
+    size_t pos = H1(hash) & table->mask;
+    for (;;) {
+        uint32_t empty = group_match_empty(table->ctrl + pos);
+        if (empty) return (pos + lowest_bit(empty)) & table->mask;
+        pos = (pos + GROUP_WIDTH) & table->mask;
+    }
+}
+
+static bool hash_table_alloc(HashTable *table, size_t capacity) {
+    uint8_t *ctrl = mem_alloc(capacity + GROUP_WIDTH);
+    HashEntry *entries = mem_calloc(capacity, sizeof(HashEntry));
+    if (!ctrl || !entries) {
+        mem_free(ctrl);
+        mem_free(entries);
+        return false;
     }
     
-    // Update table
-    mem_free(table->entries);
-    table->entries = new_entries;
-    table->capacity = new_capacity;
-    table->deleted_count = 0;
+    memset(ctrl, CTRL_EMPTY, capacity + GROUP_WIDTH);
+    table->ctrl = ctrl;
+    table->entries = entries;
+    table->capacity = capacity;
+    table->mask = capacity - 1;
+    return true;
+}
+
+static void hash_table_resize(HashTable *table, size_t new_capacity) {
+    uint8_t *old_ctrl = table->ctrl;
+    HashEntry *old_entries = table->entries;
+    size_t old_capacity = table->capacity;
+    
+    // On failure the old table stays in place, just fuller
+    if (!hash_table_alloc(table, new_capacity)) return;
+    
+    // Reinsert using the cached hashes
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_ctrl[i] & CTRL_EMPTY) continue;
+        
+        HashEntry *entry = &old_entries[i];
+        size_t index = find_empty_slot(table, entry->hash);
+        table->entries[index] = *entry;
+        set_ctrl(table, index, H2(entry->hash));
+    }
+    
+    mem_free(old_ctrl);
+    mem_free(old_entries);
 }
 
 static void hash_table_maybe_resize(HashTable *table) {
-    size_t load = table->size + table->deleted_count;
-    if (load > table->capacity * LOAD_FACTOR) {
-        size_t new_capacity = table->capacity * GROWTH_FACTOR;
-        hash_table_resize(table, new_capacity);
+    if ((table->size + 1) * MAX_LOAD_DEN > table->capacity * MAX_LOAD_NUM) {
+        hash_table_resize(table, table->capacity * GROWTH_FACTOR);
     }
 }
 
+static void hash_table_erase_slot(HashTable *table, size_t hole) {
+    // Backward-shift deletion: pull later members of the probe run into the
+    // hole so lookups never need tombstones
+    size_t next = (hole + 1) & table->mask;
+    while (!(table->ctrl[next] & CTRL_EMPTY)) {
+        size_t home = H1(table->entries[next].hash) & table->mask;
+        
+        // Move unless the entry's home lies cyclically in (hole, next]
+        if (((next - home) & table->mask) >= ((next - hole) & table->mask)) {
+            table->entries[hole] = table->entries[next];
+            set_ctrl(table, hole, table->ctrl[next]);
+            hole = next;
+        }
+        next = (next + 1) & table->mask;
+    }
+    
+    memset(&table->entries[hole], 0, sizeof(HashEntry));
+    set_ctrl(table, hole, CTRL_EMPTY);
+}
+
 /* ======== PUBLIC API IMPLEMENTATION ======== */
 
 HashTable* hashtable_create(size_t initial_capacity, HashFunction hash_func) {
     HashTable *table = mem_alloc(sizeof(HashTable));
     if (!table) return NULL;
     
-    size_t cap = initial_capacity > 0 ? initial_capacity : INITIAL_CAPACITY;
-    table->entries = mem_calloc(cap, sizeof(HashEntry));
-    if (!table->entries) {
+    size_t cap = round_up_capacity(initial_capacity > 0 ? initial_capacity : INITIAL_CAPACITY);
+    if (!hash_table_alloc(table, cap)) {
         mem_free(table);
         return NULL;
     }
     
-    table->capacity = cap;
     table->size = 0;
-    table->deleted_count = 0;
     table->hash_func = hash_func ? hash_func : default_hash;
     table->thread_safe = false;
     
@@ -126,6 +275,14 @@ void hashtable_destroy(HashTable *table) {
         pthread_mutex_destroy(&table->lock);
     }
     
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (!(table->ctrl[i] & CTRL_EMPTY)) {
+            mem_free(table->entries[i].key);
+            mem_free(table->entries[i].value);
+        }
+    }
+    
+    mem_free(table->ctrl);
     mem_free(table->entries);
     mem_free(table);
 }
@@ -141,67 +298,53 @@ void hashtable_set_thread_safe(HashTable *table, bool thread_safe) {
     table->thread_safe = thread_safe;
 }
 
-void hashtable_set(HashTable *table, const void *key, size_t key_size, 
+void hashtable_set(HashTable *table, const void *key, size_t key_size,
                   const void *value, size_t value_size) {
     if (!table || !key || key_size == 0) return;
     
     if (table->thread_safe) pthread_mutex_lock(&table->lock);
     
-    // Resize if needed
+    // Resize if needed; a failed resize must still leave one empty slot
+    // so probe runs terminate
     hash_table_maybe_resize(table);
-    
-    uint32_t hash = table->hash_func(key, key_size);
-    size_t index = hash % table->capacity;
-    size_t start_index = index;
-    
-    HashEntry *existing = NULL;
-    HashEntry *first_deleted = NULL;
-    
-    // Find slot
-    while (table->entries[index].key) {
-        if (table->entries[index].deleted) {
-            if (!first_deleted) first_deleted = &table->entries[index];
-        } else if (keys_equal(key, key_size, table->entries[index].key, 
-                             table->entries[index].key_size)) {
-            existing = &table->entries[index];
-            break;
-        }
-        
-        index = (index + 1) % table->capacity;
-        if (index == start_index) break; // Full table
+    if (table->size + 1 >= table->capacity) {
+        if (table->thread_safe) pthread_mutex_unlock(&table->lock);
+        return;
     }
     
-    HashEntry *entry;
-    if (existing) {
-        entry = existing;
-        mem_free(entry->value);
-    } else if (first_deleted) {
-        entry = first_deleted;
-        mem_free(entry->key);
-        mem_free(entry->value);
-        table->deleted_count--;
-    } else {
-        entry = &table->entries[index];
-        table->size++;
-    }
+    uint32_t hash = mix_hash(table->hash_func(key, key_size));
+    size_t index;
+    size_t found = find_slot(table, key, key_size, hash, &index);
     
-    // Set key and value
-    entry->key = mem_alloc(key_size);
-    if (!entry->key) {
+    void *value_copy = mem_alloc(value_size);
+    if (!value_copy) {
         if (table->thread_safe) pthread_mutex_unlock(&table->lock);
         return;
     }
-    memcpy(entry->key, key, key_size);
-    entry->key_size = key_size;
+    memcpy(value_copy, value, value_size);
     
-    entry->value = mem_alloc(value_size);
-    if (!entry->value) {
-        mem_free(entry->key);
-        if (table->thread_safe) pthread_mutex_unlock(&table->lock);
-        return;
+    if (found != SIZE_MAX) {
+        // Existing key: only the value changes
+        HashEntry *entry = &table->entries[found];
+        mem_free(entry->value);
+        entry->value = value_copy;
+    } else {
+        void *key_copy = mem_alloc(key_size);
+        if (!key_copy) {
+            mem_free(value_copy);
+            if (table->thread_safe) pthread_mutex_unlock(&table->lock);
+            return;
+        }
+        memcpy(key_copy, key, key_size);
+        
+        HashEntry *entry = &table->entries[index];
+        entry->key = key_copy;
+        entry->key_size = key_size;
+        entry->value = value_copy;
+        entry->hash = hash;
+        set_ctrl(table, index, H2(hash));
+        table->size++;
     }
-    memcpy(entry->value, value, value_size);
-    entry->deleted = false;
     
     if (table->thread_safe) pthread_mutex_unlock(&table->lock);
 }
@@ -211,24 +354,12 @@ void* hashtable_get(HashTable *table, const void *key, size_t key_size) {
     
     if (table->thread_safe) pthread_mutex_lock(&table->lock);
     
-    uint32_t hash = table->hash_func(key, key_size);
-    size_t index = hash % table->capacity;
-    size_t start_index = index;
-    
-    while (table->entries[index].key) {
-        if (!table->entries[index].deleted && 
-            keys_equal(key, key_size, table->entries[index].key, 
-                      table->entries[index].key_size)) {
-            if (table->thread_safe) pthread_mutex_unlock(&table->lock);
-            return table->entries[index].value;
-        }
-        
-        index = (index + 1) % table->capacity;
-        if (index == start_index) break; // Full table
-    }
+    uint32_t hash = mix_hash(table->hash_func(key, key_size));
+    size_t index = find_slot(table, key, key_size, hash, NULL);
+    void *value = index != SIZE_MAX ? table->entries[index].value : NULL;
     
     if (table->thread_safe) pthread_mutex_unlock(&table->lock);
-    return NULL;
+    return value;
 }
 
 bool hashtable_remove(HashTable *table, const void *key, size_t key_size) {
@@ -236,33 +367,20 @@ bool hashtable_remove(HashTable *table, const void *key, size_t key_size) {
     
     if (table->thread_safe) pthread_mutex_lock(&table->lock);
     
-    uint32_t hash = table->hash_func(key, key_size);
-    size_t index = hash % table->capacity;
-    size_t start_index = index;
-    
-    while (table->entries[index].key) {
-        if (!table->entries[index].deleted && 
-            keys_equal(key, key_size, table->entries[index].key, 
-                      table->entries[index].key_size)) {
-            table->entries[index].deleted = true;
-            table->size--;
-            table->deleted_count++;
-            
-            // Cleanup if needed
-            if (table->deleted_count > table->size) {
-                hash_table_resize(table, table->capacity);
-            }
-            
-            if (table->thread_safe) pthread_mutex_unlock(&table->lock);
-            return true;
-        }
-        
-        index = (index + 1) % table->capacity;
-        if (index == start_index) break; // Full table
+    uint32_t hash = mix_hash(table->hash_func(key, key_size));
+    size_t index = find_slot(table, key, key_size, hash, NULL);
+    if (index == SIZE_MAX) {
+        if (table->thread_safe) pthread_mutex_unlock(&table->lock);
+        return false;
     }
     
+    mem_free(table->entries[index].key);
+    mem_free(table->entries[index].value);
+    hash_table_erase_slot(table, index);
+    table->size--;
+    
     if (table->thread_safe) pthread_mutex_unlock(&table->lock);
-    return false;
+    return true;
 }
 
 size_t hashtable_size(HashTable *table) {
@@ -276,16 +394,14 @@ void hashtable_clear(HashTable *table) {
     if (table->thread_safe) pthread_mutex_lock(&table->lock);
     
     for (size_t i = 0; i < table->capacity; i++) {
-        if (table->entries[i].key) {
+        if (!(table->ctrl[i] & CTRL_EMPTY)) {
             mem_free(table->entries[i].key);
             mem_free(table->entries[i].value);
-            table->entries[i].key = NULL;
-            table->entries[i].value = NULL;
-            table->entries[i].deleted = false;
         }
     }
+    memset(table->entries, 0, table->capacity * sizeof(HashEntry));
+    memset(table->ctrl, CTRL_EMPTY, table->capacity + GROUP_WIDTH);
     table->size = 0;
-    table->deleted_count = 0;
     
     if (table->thread_safe) pthread_mutex_unlock(&table->lock);
 }
@@ -296,7 +412,7 @@ void hashtable_iterate(HashTable *table, HashIterCallback callback, void *user_d
     if (table->thread_safe) pthread_mutex_lock(&table->lock);
     
     for (size_t i = 0; i < table->capacity; i++) {
-        if (table->entries[i].key && !table->entries[i].deleted) {
+        if (!(table->ctrl[i] & CTRL_EMPTY)) {
             callback(table->entries[i].key, table->entries[i].key_size,
                      table->entries[i].value, user_data);
         }
@@ -0,0 +1,41 @@
+/*
+ * small_vector.c - Growth Path for Typed and Small Vectors in Reasons DSL
+ *
+ * Features:
+ * - Out-of-line growth shared by all VECTOR_DEFINE/SMALL_VECTOR_DEFINE types
+ * - Spills inline storage to the heap on first growth
+ * - Geometric (doubling) capacity growth
+ */
+
+#include "utils/small_vector.h"
+#include "utils/memory.h"
+#include <stdint.h>
+#include <string.h>
+
+/* ======== PUBLIC API IMPLEMENTATION ======== */
+
+bool small_vector_grow(void **data, size_t *capacity, size_t element_size,
+                       void *inline_buf, size_t size, size_t min_capacity) {
+    size_t new_capacity = *capacity ? *capacity * 2 : SMALL_VECTOR_MIN_CAPACITY;
+    while (new_capacity < min_capacity) new_capacity *= 2;
+    if (new_capacity > SIZE_MAX / element_size) return false;
+    
+    void *new_data;
+    if (*data == inline_buf) {
+        // First spill (or first allocation of a plain vector): copy out
+        new_data = mem_alloc(new_capacity * element_size);
+        if (!new_data) return false;
+        if (size) memcpy(new_data, *data, size * element_size);
+    } else {
+        new_data = mem_realloc(*data, new_capacity * element_size);
+        if (!new_data) return false;
+    }
+    
+    *data = new_data;
+    *capacity = new_capacity;
+    return true;
+}
+
+void small_vector_release(void *data, void *inline_buf) {
+    if (data && data != inline_buf) mem_free(data);
+}
@@ -9,7 +9,7 @@
  * - Sorting and searching
  * - Stack operations
  * - Range operations
- * - Memory efficiency
+ * - Memory efficiency (lazy buffer allocation)
  * - Iterator support
  */
 
@@ -19,6 +19,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* ======== CONSTANTS ======== */
+
+#define VECTOR_MIN_CAPACITY 4
+
 /* ======== STRUCTURE DEFINITIONS ======== */
 
 struct Vector {
@@ -58,12 +62,7 @@ Vector* vector_create(size_t element_size) {
     vector->data = NULL;
     vector->free_func = NULL;
     
-    // Start with capacity for 16 elements
-    if (!vector_resize(vector, 16)) {
-        mem_free(vector);
-        return NULL;
-    }
-    
+    // The buffer is allocated on first append: many vectors stay empty
     return vector;
 }
 
@@ -129,7 +128,7 @@ void vector_append(Vector *vector, const void *element) {
     if (!vector) return;
     
     if (vector->size >= vector->capacity) {
-        size_t new_capacity = vector->capacity * 2;
+        size_t new_capacity = vector->capacity ? vector->capacity * 2 : VECTOR_MIN_CAPACITY;
         if (!vector_resize(vector, new_capacity)) {
             return;
         }
@@ -149,7 +148,7 @@ void vector_insert(Vector *vector, size_t index, const void *element) {
     }
     
     if (vector->size >= vector->capacity) {
-        size_t new_capacity = vector->capacity * 2;
+        size_t new_capacity = vector->capacity ? vector->capacity * 2 : VECTOR_MIN_CAPACITY;
         if (!vector_resize(vector, new_capacity)) {
             return;
         }
@@ -224,7 +223,9 @@ Vector* vector_dup(Vector *vector) {
         return NULL;
     }
     
-    memcpy(copy->data, vector->data, vector->size * vector->element_size);
+    if (vector->size) {
+        memcpy(copy->data, vector->data, vector->size * vector->element_size);
+    }
     copy->size = vector->size;
     copy->free_func = vector->free_func;
     